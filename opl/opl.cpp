@@ -50,6 +50,7 @@ static opl_driver_t *driver = nullptr;
 static int init_stage_reg_writes = 1;
 
 unsigned int opl_sample_rate = 22050;
+opl_stats_func_t opl_stats_func = nullptr;
 
 //
 // Init/shutdown code.
@@ -129,6 +130,14 @@ opl_init_result_t OPL_Init(unsigned int port_base)
 
     if (driver_name != nullptr)
     {
+        // The render driver is not in the list, as it must never be
+        // selected automatically.
+
+        if (!strcmp(driver_name, opl_render_driver.name))
+        {
+            return InitDriver(&opl_render_driver, port_base);
+        }
+
         // Search the list until we find the driver with this name.
 
         for (i=0; drivers[i] != nullptr; ++i)
@@ -177,6 +186,11 @@ void OPL_SetSampleRate(unsigned int rate)
     opl_sample_rate = rate;
 }
 
+void OPL_SetStatsFunc(opl_stats_func_t func)
+{
+    opl_stats_func = func;
+}
+
 void OPL_WritePort(opl_port_t port, unsigned int value)
 {
     if (driver != nullptr)
@@ -472,6 +486,12 @@ void OPL_Delay(uint64_t us)
         return;
     }
 
+    if (driver->delay_func != nullptr)
+    {
+        driver->delay_func(us);
+        return;
+    }
+
     // Create a callback that will signal this thread after the
     // specified time.
 
@@ -149,5 +149,28 @@ void OPL_Delay(uint64_t us);
 
 void OPL_SetPaused(int paused);
 
+// Function called by the SDL driver on the audio thread after it has
+// made each buffer of output, with the performance counter before and
+// after, the number of samples made, the sample rate and the number of
+// callbacks waiting.
+
+typedef void (*opl_stats_func_t)(uint64_t start, uint64_t end,
+                                 unsigned int nsamples, unsigned int rate,
+                                 unsigned int queue_depth);
+
+// Set the statistics function. Must be called before OPL_Init().
+
+void OPL_SetStatsFunc(opl_stats_func_t func);
+
+//
+// Offline rendering.
+//
+
+// Generate the next nsamples stereo samples of output from the "Render"
+// driver into buffer, invoking callbacks as they become due. Time only
+// passes for the driver as output is generated.
+
+void OPL_Render(int16_t *buffer, unsigned int nsamples);
+
 #endif
 
@@ -357,7 +357,18 @@ static void OPL3_EnvelopeUpdateKSL(opl3_slot *slot)
     slot->eg_ksl = (Bit8u)ksl;
 }
 
-static void OPL3_EnvelopeCalc(opl3_slot *slot)
+// The state of the chip timers that the envelope generator uses for
+// one sample.
+
+typedef struct
+{
+    Bit8u tremolo;
+    Bit8u eg_add;
+    Bit8u eg_state;
+    Bit16u timer;
+} opl3_egtime;
+
+static inline void OPL3_EnvelopeStep(opl3_slot *slot, const opl3_egtime *t)
 {
     Bit8u nonzero;
     Bit8u rate;
@@ -371,7 +382,8 @@ static void OPL3_EnvelopeCalc(opl3_slot *slot)
     Bit8u eg_off;
     Bit8u reset = 0;
     slot->eg_out = slot->eg_rout + (slot->reg_tl << 2)
-                 + (slot->eg_ksl >> kslshift[slot->reg_ksl]) + *slot->trem;
+                 + (slot->eg_ksl >> kslshift[slot->reg_ksl])
+                 + (slot->trem == &slot->chip->tremolo ? t->tremolo : 0);
     if (slot->key && slot->eg_gen == envelope_gen_num_release)
     {
         reset = 1;
@@ -408,13 +420,13 @@ static void OPL3_EnvelopeCalc(opl3_slot *slot)
     {
         rate_hi = 0x0f;
     }
-    eg_shift = rate_hi + slot->chip->eg_add;
+    eg_shift = rate_hi + t->eg_add;
     shift = 0;
     if (nonzero)
     {
         if (rate_hi < 12)
         {
-            if (slot->chip->eg_state)
+            if (t->eg_state)
             {
                 switch (eg_shift)
                 {
@@ -434,14 +446,14 @@ static void OPL3_EnvelopeCalc(opl3_slot *slot)
         }
         else
         {
-            shift = (rate_hi & 0x03) + eg_incstep[rate_lo][slot->chip->timer & 0x03];
+            shift = (rate_hi & 0x03) + eg_incstep[rate_lo][t->timer & 0x03];
             if (shift & 0x04)
             {
                 shift = 0x03;
             }
             if (!shift)
             {
-                shift = slot->chip->eg_state;
+                shift = t->eg_state;
             }
         }
     }
@@ -504,6 +516,17 @@ static void OPL3_EnvelopeCalc(opl3_slot *slot)
     }
 }
 
+static void OPL3_EnvelopeCalc(opl3_slot *slot)
+{
+    opl3_egtime t;
+
+    t.tremolo = slot->chip->tremolo;
+    t.eg_add = slot->chip->eg_add;
+    t.eg_state = slot->chip->eg_state;
+    t.timer = slot->chip->timer;
+    OPL3_EnvelopeStep(slot, &t);
+}
+
 static void OPL3_EnvelopeKeyOn(opl3_slot *slot, Bit8u type)
 {
     slot->key |= type;
@@ -518,24 +541,17 @@ static void OPL3_EnvelopeKeyOff(opl3_slot *slot, Bit8u type)
 // Phase Generator
 //
 
-static void OPL3_PhaseGenerate(opl3_slot *slot)
+static Bit32u OPL3_PhaseIncrement(opl3_slot *slot, Bit8u vibpos)
 {
-    opl3_chip *chip;
     Bit16u f_num;
     Bit32u basefreq;
-    Bit8u rm_xor, n_bit;
-    Bit32u noise;
-    Bit16u phase;
 
-    chip = slot->chip;
     f_num = slot->channel->f_num;
     if (slot->reg_vib)
     {
         Bit8s range;
-        Bit8u vibpos;
 
         range = (f_num >> 7) & 7;
-        vibpos = slot->chip->vibpos;
 
         if (!(vibpos & 3))
         {
@@ -554,12 +570,23 @@ static void OPL3_PhaseGenerate(opl3_slot *slot)
         f_num += range;
     }
     basefreq = (f_num << slot->channel->block) >> 1;
+    return (basefreq * mt[slot->reg_mult]) >> 1;
+}
+
+static void OPL3_PhaseGenerate(opl3_slot *slot)
+{
+    opl3_chip *chip;
+    Bit8u rm_xor, n_bit;
+    Bit32u noise;
+    Bit16u phase;
+
+    chip = slot->chip;
     phase = (Bit16u)(slot->pg_phase >> 9);
     if (slot->pg_reset)
     {
         slot->pg_phase = 0;
     }
-    slot->pg_phase += (basefreq * mt[slot->reg_mult]) >> 1;
+    slot->pg_phase += OPL3_PhaseIncrement(slot, chip->vibpos);
     // Rhythm mode
     noise = chip->noise;
     slot->pg_phase_out = phase;
@@ -1043,24 +1070,15 @@ static Bit16s OPL3_ClipSample(Bit32s sample)
     return (Bit16s)sample;
 }
 
-void OPL3_Generate(opl3_chip *chip, Bit16s *buf)
+// Sum the outputs of all channels for the left or right speaker.
+
+static Bit32s OPL3_MixChannels(opl3_chip *chip, Bit8u right)
 {
+    Bit32s mix = 0;
+    Bit16s accm;
     Bit8u ii;
     Bit8u jj;
-    Bit16s accm;
-    Bit8u shift = 0;
-
-    buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
 
-    for (ii = 0; ii < 15; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
-    }
-
-    chip->mixbuff[0] = 0;
     for (ii = 0; ii < 18; ii++)
     {
         accm = 0;
@@ -1068,45 +1086,18 @@ void OPL3_Generate(opl3_chip *chip, Bit16s *buf)
         {
             accm += *chip->channel[ii].out[jj];
         }
-        chip->mixbuff[0] += (Bit16s)(accm & chip->channel[ii].cha);
-    }
-
-    for (ii = 15; ii < 18; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
+        mix += (Bit16s)(accm & (right ? chip->channel[ii].chb
+                                      : chip->channel[ii].cha));
     }
 
-    buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
-
-    for (ii = 18; ii < 33; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
-    }
+    return mix;
+}
 
-    chip->mixbuff[1] = 0;
-    for (ii = 0; ii < 18; ii++)
-    {
-        accm = 0;
-        for (jj = 0; jj < 4; jj++)
-        {
-            accm += *chip->channel[ii].out[jj];
-        }
-        chip->mixbuff[1] += (Bit16s)(accm & chip->channel[ii].chb);
-    }
+// Advance the tremolo, vibrato and envelope timers by one sample.
 
-    for (ii = 33; ii < 36; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
-    }
+static void OPL3_UpdateTimers(opl3_chip *chip)
+{
+    Bit8u shift = 0;
 
     if ((chip->timer & 0x3f) == 0x3f)
     {
@@ -1160,7 +1151,13 @@ void OPL3_Generate(opl3_chip *chip, Bit16s *buf)
     }
 
     chip->eg_state ^= 1;
+}
 
+// Apply the buffered register writes that are due by the end of
+// the current sample.
+
+static void OPL3_ProcessWriteBuf(opl3_chip *chip)
+{
     while (chip->writebuf[chip->writebuf_cur].time <= chip->writebuf_samplecnt)
     {
         if (!(chip->writebuf[chip->writebuf_cur].reg & 0x200))
@@ -1175,6 +1172,66 @@ void OPL3_Generate(opl3_chip *chip, Bit16s *buf)
     chip->writebuf_samplecnt++;
 }
 
+void OPL3_Generate(opl3_chip *chip, Bit16s *buf)
+{
+    Bit8u ii;
+
+    buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
+
+    for (ii = 0; ii < 15; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    chip->mixbuff[0] = OPL3_MixChannels(chip, 0);
+
+    for (ii = 15; ii < 18; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
+
+    for (ii = 18; ii < 33; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    chip->mixbuff[1] = OPL3_MixChannels(chip, 1);
+
+    for (ii = 33; ii < 36; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    OPL3_UpdateTimers(chip);
+    OPL3_ProcessWriteBuf(chip);
+}
+
+// Interpolate the next output sample between the last two samples
+// generated at the native rate.
+
+static void OPL3_Interpolate(opl3_chip *chip, Bit16s *buf)
+{
+    buf[0] = (Bit16s)((chip->oldsamples[0] * (chip->rateratio - chip->samplecnt)
+                     + chip->samples[0] * chip->samplecnt) / chip->rateratio);
+    buf[1] = (Bit16s)((chip->oldsamples[1] * (chip->rateratio - chip->samplecnt)
+                     + chip->samples[1] * chip->samplecnt) / chip->rateratio);
+    chip->samplecnt += 1 << RSM_FRAC;
+}
+
 void OPL3_GenerateResampled(opl3_chip *chip, Bit16s *buf)
 {
     while (chip->samplecnt >= chip->rateratio)
@@ -1184,108 +1241,551 @@ void OPL3_GenerateResampled(opl3_chip *chip, Bit16s *buf)
         OPL3_Generate(chip, chip->samples);
         chip->samplecnt -= chip->rateratio;
     }
-    buf[0] = (Bit16s)((chip->oldsamples[0] * (chip->rateratio - chip->samplecnt)
-                     + chip->samples[0] * chip->samplecnt) / chip->rateratio);
-    buf[1] = (Bit16s)((chip->oldsamples[1] * (chip->rateratio - chip->samplecnt)
-                     + chip->samples[1] * chip->samplecnt) / chip->rateratio);
-    chip->samplecnt += 1 << RSM_FRAC;
+    OPL3_Interpolate(chip, buf);
 }
 
-void OPL3_Reset(opl3_chip *chip, Bit32u samplerate)
+//
+// Block generation
+//
+// OPL3_GenerateBlock() gives the same output as calling OPL3_Generate()
+// for each sample, but works on up to OPL_BLOCK_SIZE samples at a time
+// between register writes. The envelope and phase of a slot depend only
+// on the slot itself and on the chip timers, so each slot is stepped
+// through the whole block on its own, into arrays of envelope levels
+// and phases. Only the slot outputs, which modulate each other within
+// a sample, are then worked out a sample at a time, from tables of the
+// waveforms rather than a call through envelope_sin for every slot.
+//
+
+#define OPL_BLOCK_SIZE 128
+
+typedef struct
 {
-    Bit8u slotnum;
-    Bit8u channum;
+    opl3_egtime egtime[OPL_BLOCK_SIZE];
+    Bit8u vibpos[OPL_BLOCK_SIZE];
+    Bit32u noise[OPL_BLOCK_SIZE];
+    Bit16s eg_out[36][OPL_BLOCK_SIZE];
+    Bit16u phase_out[36][OPL_BLOCK_SIZE];
+
+    // The slot outputs that each speaker mixes, leaving out channels
+    // that are silent or not routed to it.
+    Bit16s *mix_out[2][18][4];
+    Bit8u mix_num_out[2][18];
+    Bit8u mix_channels[2];
+} opl3_block;
+
+// Attenuation and sign of each waveform at each phase, before the
+// envelope is added.
+
+static Bit16u wf_out[8][0x400];
+static Bit16u wf_neg[8][0x400];
+static Bit8u wf_tables_built = 0;
+
+static void OPL3_BuildWaveformTables(void)
+{
+    Bit16u phase, p;
+    Bit16u out, neg;
+    Bit16u sine, halfsine;
+    Bit8u wf;
 
-    memset(chip, 0, sizeof(opl3_chip));
-    for (slotnum = 0; slotnum < 36; slotnum++)
+    if (wf_tables_built)
     {
-        chip->slot[slotnum].chip = chip;
-        chip->slot[slotnum].mod = &chip->zeromod;
-        chip->slot[slotnum].eg_rout = 0x1ff;
-        chip->slot[slotnum].eg_out = 0x1ff;
-        chip->slot[slotnum].eg_gen = envelope_gen_num_release;
-        chip->slot[slotnum].trem = (Bit8u*)&chip->zeromod;
-        chip->slot[slotnum].slot_num = slotnum;
+        return;
     }
-    for (channum = 0; channum < 18; channum++)
+
+    for (phase = 0; phase < 0x400; phase++)
     {
-        chip->channel[channum].slots[0] = &chip->slot[ch_slot[channum]];
-        chip->channel[channum].slots[1] = &chip->slot[ch_slot[channum] + 3];
-        chip->slot[ch_slot[channum]].channel = &chip->channel[channum];
-        chip->slot[ch_slot[channum] + 3].channel = &chip->channel[channum];
-        if ((channum % 9) < 3)
+        if (phase & 0x100)
         {
-            chip->channel[channum].pair = &chip->channel[channum + 3];
+            sine = logsinrom[(phase & 0xff) ^ 0xff];
         }
-        else if ((channum % 9) < 6)
+        else
         {
-            chip->channel[channum].pair = &chip->channel[channum - 3];
+            sine = logsinrom[phase & 0xff];
+        }
+        if (phase & 0x80)
+        {
+            halfsine = logsinrom[((phase ^ 0xff) << 1) & 0xff];
+        }
+        else
+        {
+            halfsine = logsinrom[(phase << 1) & 0xff];
         }
-        chip->channel[channum].chip = chip;
-        chip->channel[channum].out[0] = &chip->zeromod;
-        chip->channel[channum].out[1] = &chip->zeromod;
-        chip->channel[channum].out[2] = &chip->zeromod;
-        chip->channel[channum].out[3] = &chip->zeromod;
-        chip->channel[channum].chtype = ch_2op;
-        chip->channel[channum].cha = 0xffff;
-        chip->channel[channum].chb = 0xffff;
-        chip->channel[channum].ch_num = channum;
-        OPL3_ChannelSetupAlg(&chip->channel[channum]);
-    }
-    chip->noise = 1;
-    chip->rateratio = (samplerate << RSM_FRAC) / 49716;
-    chip->tremoloshift = 4;
-    chip->vibshift = 1;
-}
 
-void OPL3_WriteReg(opl3_chip *chip, Bit16u reg, Bit8u v)
-{
-    Bit8u high = (reg >> 8) & 0x01;
-    Bit8u regm = reg & 0xff;
-    switch (regm & 0xf0)
-    {
-    case 0x00:
-        if (high)
+        for (wf = 0; wf < 8; wf++)
         {
-            switch (regm & 0x0f)
+            out = 0;
+            neg = 0;
+            switch (wf)
             {
-            case 0x04:
-                OPL3_ChannelSet4Op(chip, v);
+            case 0:
+                neg = (phase & 0x200) ? 0xffff : 0;
+                out = sine;
                 break;
-            case 0x05:
-                chip->newm = v & 0x01;
+            case 1:
+                out = (phase & 0x200) ? 0x1000 : sine;
+                break;
+            case 2:
+                out = sine;
+                break;
+            case 3:
+                out = (phase & 0x100) ? 0x1000 : logsinrom[phase & 0xff];
+                break;
+            case 4:
+                neg = ((phase & 0x300) == 0x100) ? 0xffff : 0;
+                out = (phase & 0x200) ? 0x1000 : halfsine;
+                break;
+            case 5:
+                out = (phase & 0x200) ? 0x1000 : halfsine;
+                break;
+            case 6:
+                neg = (phase & 0x200) ? 0xffff : 0;
+                break;
+            case 7:
+                p = phase;
+                if (phase & 0x200)
+                {
+                    neg = 0xffff;
+                    p = (phase & 0x1ff) ^ 0x1ff;
+                }
+                out = p << 3;
                 break;
             }
+            wf_out[wf][phase] = out;
+            wf_neg[wf][phase] = neg;
         }
-        else
+    }
+
+    wf_tables_built = 1;
+}
+
+// Record the chip timers for each sample of the block, and the noise
+// generator at the start of each sample, and advance them to the end.
+
+static void OPL3_BlockTimers(opl3_chip *chip, opl3_block *block, Bit32u n)
+{
+    Bit32u i, j;
+
+    for (i = 0; i < n; i++)
+    {
+        block->egtime[i].tremolo = chip->tremolo;
+        block->egtime[i].eg_add = chip->eg_add;
+        block->egtime[i].eg_state = chip->eg_state;
+        block->egtime[i].timer = chip->timer;
+        block->vibpos[i] = chip->vibpos;
+        block->noise[i] = chip->noise;
+
+        // Each slot steps the noise generator once. Nine steps can be
+        // taken at a time, before a new bit reaches bit 14.
+        for (j = 0; j < 36; j += 9)
         {
-            switch (regm & 0x0f)
+            chip->noise = (chip->noise >> 9)
+                        | ((((chip->noise >> 14) ^ chip->noise) & 0x1ff) << 14);
+        }
+
+        OPL3_UpdateTimers(chip);
+    }
+}
+
+// Step the envelope and phase generators of a slot through the block.
+
+static void OPL3_SlotBlock(opl3_slot *slot, opl3_block *block, Bit32u n)
+{
+    Bit16s *eg_out = block->eg_out[slot->slot_num];
+    Bit16u *phase_out = block->phase_out[slot->slot_num];
+    Bit8u reset[OPL_BLOCK_SIZE];
+    Bit8u any_reset = 0;
+    Bit32u inc[8];
+    Bit32u phase;
+    Bit32u i;
+    Bit16s level;
+
+    if ((slot->eg_rout & 0x1f8) == 0x1f8
+     && ((slot->eg_gen == envelope_gen_num_release && !slot->key)
+      || (slot->eg_gen == envelope_gen_num_sustain && slot->key)))
+    {
+        // The envelope has finished, and stays at the lowest level
+        // until the slot is keyed on again. Only tremolo changes.
+        level = (slot->reg_tl << 2) + (slot->eg_ksl >> kslshift[slot->reg_ksl]);
+        for (i = 0; i < n; i++)
+        {
+            eg_out[i] = level + (i == 0 ? slot->eg_rout : 0x1ff);
+            if (slot->trem == &slot->chip->tremolo)
             {
-            case 0x08:
-                chip->nts = (v >> 6) & 0x01;
-                break;
+                eg_out[i] += block->egtime[i].tremolo;
             }
+            reset[i] = 0;
         }
-        break;
-    case 0x20:
-    case 0x30:
-        if (ad_slot[regm & 0x1f] >= 0)
+        slot->eg_rout = 0x1ff;
+        slot->eg_out = eg_out[n - 1];
+        slot->pg_reset = 0;
+    }
+    else
+    {
+        for (i = 0; i < n; i++)
         {
-            OPL3_SlotWrite20(&chip->slot[18 * high + ad_slot[regm & 0x1f]], v);
+            OPL3_EnvelopeStep(slot, &block->egtime[i]);
+            eg_out[i] = slot->eg_out;
+            reset[i] = (Bit8u)slot->pg_reset;
+            any_reset |= reset[i];
         }
-        break;
-    case 0x40:
-    case 0x50:
-        if (ad_slot[regm & 0x1f] >= 0)
+    }
+
+    phase = slot->pg_phase;
+
+    if (!any_reset && !slot->reg_vib)
+    {
+        // The usual case: the phase just goes up by the same amount
+        // every sample.
+        inc[0] = OPL3_PhaseIncrement(slot, 0);
+        for (i = 0; i < n; i++)
         {
-            OPL3_SlotWrite40(&chip->slot[18 * high + ad_slot[regm & 0x1f]], v);
+            phase_out[i] = (Bit16u)((phase + i * inc[0]) >> 9);
         }
-        break;
-    case 0x60:
-    case 0x70:
-        if (ad_slot[regm & 0x1f] >= 0)
-        {
-            OPL3_SlotWrite60(&chip->slot[18 * high + ad_slot[regm & 0x1f]], v);
+        phase += n * inc[0];
+    }
+    else
+    {
+        for (i = 0; i < 8; i++)
+        {
+            inc[i] = OPL3_PhaseIncrement(slot, (Bit8u)i);
+        }
+        for (i = 0; i < n; i++)
+        {
+            phase_out[i] = (Bit16u)(phase >> 9);
+            if (reset[i])
+            {
+                phase = 0;
+            }
+            phase += inc[block->vibpos[i]];
+        }
+    }
+
+    slot->pg_phase = phase;
+}
+
+// Replace the phases of the hi-hat, snare drum and top cymbal slots in
+// rhythm mode, as OPL3_PhaseGenerate() does.
+
+static void OPL3_RhythmBlock(opl3_chip *chip, opl3_block *block, Bit32u n)
+{
+    Bit16u *hh = block->phase_out[13];
+    Bit16u *sd = block->phase_out[16];
+    Bit16u *tc = block->phase_out[17];
+    Bit8u rm_xor;
+    Bit32u noise;
+    Bit16u phase;
+    Bit32u i;
+
+    if (!(chip->rhy & 0x20))
+    {
+        phase = hh[n - 1];
+        chip->rm_hh_bit2 = (phase >> 2) & 1;
+        chip->rm_hh_bit3 = (phase >> 3) & 1;
+        chip->rm_hh_bit7 = (phase >> 7) & 1;
+        chip->rm_hh_bit8 = (phase >> 8) & 1;
+        return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        // The noise bits that slots 13 and 16 see.
+        noise = block->noise[i];
+
+        phase = hh[i];
+        chip->rm_hh_bit2 = (phase >> 2) & 1;
+        chip->rm_hh_bit3 = (phase >> 3) & 1;
+        chip->rm_hh_bit7 = (phase >> 7) & 1;
+        chip->rm_hh_bit8 = (phase >> 8) & 1;
+        rm_xor = (chip->rm_hh_bit2 ^ chip->rm_hh_bit7)
+               | (chip->rm_hh_bit3 ^ chip->rm_tc_bit5)
+               | (chip->rm_tc_bit3 ^ chip->rm_tc_bit5);
+        hh[i] = rm_xor << 9;
+        if (rm_xor ^ ((noise >> 13) & 1))
+        {
+            hh[i] |= 0xd0;
+        }
+        else
+        {
+            hh[i] |= 0x34;
+        }
+
+        sd[i] = (chip->rm_hh_bit8 << 9)
+              | ((chip->rm_hh_bit8 ^ ((noise >> 16) & 1)) << 8);
+
+        phase = tc[i];
+        chip->rm_tc_bit3 = (phase >> 3) & 1;
+        chip->rm_tc_bit5 = (phase >> 5) & 1;
+        rm_xor = (chip->rm_hh_bit2 ^ chip->rm_hh_bit7)
+               | (chip->rm_hh_bit3 ^ chip->rm_tc_bit5)
+               | (chip->rm_tc_bit3 ^ chip->rm_tc_bit5);
+        tc[i] = (rm_xor << 9) | 0x80;
+    }
+}
+
+// Work out which slot outputs the speakers mix during the block. The
+// channel routing only changes when registers are written.
+
+static void OPL3_BlockMix(opl3_chip *chip, opl3_block *block)
+{
+    opl3_channel *channel;
+    Bit16u mask;
+    Bit8u side, ii, jj, num;
+
+    for (side = 0; side < 2; side++)
+    {
+        block->mix_channels[side] = 0;
+
+        for (ii = 0; ii < 18; ii++)
+        {
+            channel = &chip->channel[ii];
+            mask = side ? channel->chb : channel->cha;
+            num = 0;
+
+            for (jj = 0; mask != 0 && jj < 4; jj++)
+            {
+                if (channel->out[jj] != &chip->zeromod)
+                {
+                    block->mix_out[side][block->mix_channels[side]][num]
+                        = channel->out[jj];
+                    num++;
+                }
+            }
+
+            if (num > 0)
+            {
+                block->mix_num_out[side][block->mix_channels[side]] = num;
+                block->mix_channels[side]++;
+            }
+        }
+    }
+}
+
+// The same sum as OPL3_MixChannels(). The mask of each channel is either
+// all ones or zero, so it does not need applying.
+
+static inline Bit32s OPL3_MixBlock(const opl3_block *block, Bit8u side)
+{
+    Bit32s mix = 0;
+    Bit16s accm;
+    Bit8u ii;
+    Bit8u jj;
+
+    for (ii = 0; ii < block->mix_channels[side]; ii++)
+    {
+        accm = 0;
+        for (jj = 0; jj < block->mix_num_out[side][ii]; jj++)
+        {
+            accm += *block->mix_out[side][ii][jj];
+        }
+        mix += accm;
+    }
+
+    return mix;
+}
+
+static inline void OPL3_SlotOutput(opl3_slot *slot, const opl3_block *block,
+                                   Bit32u i)
+{
+    Bit16u phase;
+    Bit16u envelope;
+
+    OPL3_SlotCalcFB(slot);
+    phase = (Bit16u)(block->phase_out[slot->slot_num][i] + *slot->mod) & 0x3ff;
+    envelope = (Bit16u)block->eg_out[slot->slot_num][i];
+    slot->out = OPL3_EnvelopeCalcExp(wf_out[slot->reg_wf][phase] + (envelope << 3))
+              ^ wf_neg[slot->reg_wf][phase];
+}
+
+static void OPL3_GenerateBlockPart(opl3_chip *chip, Bit16s *buf, Bit32u n)
+{
+    opl3_block block;
+    opl3_slot *slot;
+    Bit32u i;
+    Bit8u ii;
+
+    OPL3_BlockTimers(chip, &block, n);
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        OPL3_SlotBlock(&chip->slot[ii], &block, n);
+    }
+
+    OPL3_RhythmBlock(chip, &block, n);
+    OPL3_BlockMix(chip, &block);
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        slot = &chip->slot[ii];
+        slot->pg_phase_out = block.phase_out[ii][n - 1];
+    }
+
+    // The slots are generated in the same order as OPL3_Generate(), and
+    // the speakers are mixed at the same points in between.
+
+    for (i = 0; i < n; i++)
+    {
+        buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
+
+        for (ii = 0; ii < 15; ii++)
+        {
+            OPL3_SlotOutput(&chip->slot[ii], &block, i);
+        }
+
+        chip->mixbuff[0] = OPL3_MixBlock(&block, 0);
+
+        for (ii = 15; ii < 18; ii++)
+        {
+            OPL3_SlotOutput(&chip->slot[ii], &block, i);
+        }
+
+        buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
+
+        for (ii = 18; ii < 33; ii++)
+        {
+            OPL3_SlotOutput(&chip->slot[ii], &block, i);
+        }
+
+        chip->mixbuff[1] = OPL3_MixBlock(&block, 1);
+
+        for (ii = 33; ii < 36; ii++)
+        {
+            OPL3_SlotOutput(&chip->slot[ii], &block, i);
+        }
+
+        buf += 2;
+    }
+
+    chip->writebuf_samplecnt += n - 1;
+    OPL3_ProcessWriteBuf(chip);
+}
+
+void OPL3_GenerateBlock(opl3_chip *chip, Bit16s *buf, Bit32u numsamples)
+{
+    Bit32u n;
+    Bit64u due;
+
+    while (numsamples > 0)
+    {
+        n = numsamples < OPL_BLOCK_SIZE ? numsamples : OPL_BLOCK_SIZE;
+
+        // Stop after the sample at the end of which the next buffered
+        // register write is due.
+        if (chip->writebuf[chip->writebuf_cur].reg & 0x200)
+        {
+            due = chip->writebuf[chip->writebuf_cur].time;
+            if (due < chip->writebuf_samplecnt)
+            {
+                due = chip->writebuf_samplecnt;
+            }
+            if (due - chip->writebuf_samplecnt < n)
+            {
+                n = (Bit32u)(due - chip->writebuf_samplecnt) + 1;
+            }
+        }
+
+        OPL3_GenerateBlockPart(chip, buf, n);
+        buf += n * 2;
+        numsamples -= n;
+    }
+}
+
+void OPL3_Reset(opl3_chip *chip, Bit32u samplerate)
+{
+    Bit8u slotnum;
+    Bit8u channum;
+
+    memset(chip, 0, sizeof(opl3_chip));
+    for (slotnum = 0; slotnum < 36; slotnum++)
+    {
+        chip->slot[slotnum].chip = chip;
+        chip->slot[slotnum].mod = &chip->zeromod;
+        chip->slot[slotnum].eg_rout = 0x1ff;
+        chip->slot[slotnum].eg_out = 0x1ff;
+        chip->slot[slotnum].eg_gen = envelope_gen_num_release;
+        chip->slot[slotnum].trem = (Bit8u*)&chip->zeromod;
+        chip->slot[slotnum].slot_num = slotnum;
+    }
+    for (channum = 0; channum < 18; channum++)
+    {
+        chip->channel[channum].slots[0] = &chip->slot[ch_slot[channum]];
+        chip->channel[channum].slots[1] = &chip->slot[ch_slot[channum] + 3];
+        chip->slot[ch_slot[channum]].channel = &chip->channel[channum];
+        chip->slot[ch_slot[channum] + 3].channel = &chip->channel[channum];
+        if ((channum % 9) < 3)
+        {
+            chip->channel[channum].pair = &chip->channel[channum + 3];
+        }
+        else if ((channum % 9) < 6)
+        {
+            chip->channel[channum].pair = &chip->channel[channum - 3];
+        }
+        chip->channel[channum].chip = chip;
+        chip->channel[channum].out[0] = &chip->zeromod;
+        chip->channel[channum].out[1] = &chip->zeromod;
+        chip->channel[channum].out[2] = &chip->zeromod;
+        chip->channel[channum].out[3] = &chip->zeromod;
+        chip->channel[channum].chtype = ch_2op;
+        chip->channel[channum].cha = 0xffff;
+        chip->channel[channum].chb = 0xffff;
+        chip->channel[channum].ch_num = channum;
+        OPL3_ChannelSetupAlg(&chip->channel[channum]);
+    }
+    chip->noise = 1;
+    chip->rateratio = (samplerate << RSM_FRAC) / 49716;
+    OPL3_BuildWaveformTables();
+    chip->tremoloshift = 4;
+    chip->vibshift = 1;
+}
+
+void OPL3_WriteReg(opl3_chip *chip, Bit16u reg, Bit8u v)
+{
+    Bit8u high = (reg >> 8) & 0x01;
+    Bit8u regm = reg & 0xff;
+    switch (regm & 0xf0)
+    {
+    case 0x00:
+        if (high)
+        {
+            switch (regm & 0x0f)
+            {
+            case 0x04:
+                OPL3_ChannelSet4Op(chip, v);
+                break;
+            case 0x05:
+                chip->newm = v & 0x01;
+                break;
+            }
+        }
+        else
+        {
+            switch (regm & 0x0f)
+            {
+            case 0x08:
+                chip->nts = (v >> 6) & 0x01;
+                break;
+            }
+        }
+        break;
+    case 0x20:
+    case 0x30:
+        if (ad_slot[regm & 0x1f] >= 0)
+        {
+            OPL3_SlotWrite20(&chip->slot[18 * high + ad_slot[regm & 0x1f]], v);
+        }
+        break;
+    case 0x40:
+    case 0x50:
+        if (ad_slot[regm & 0x1f] >= 0)
+        {
+            OPL3_SlotWrite40(&chip->slot[18 * high + ad_slot[regm & 0x1f]], v);
+        }
+        break;
+    case 0x60:
+    case 0x70:
+        if (ad_slot[regm & 0x1f] >= 0)
+        {
+            OPL3_SlotWrite60(&chip->slot[18 * high + ad_slot[regm & 0x1f]], v);
         }
         break;
     case 0x80:
@@ -1367,11 +1867,430 @@ void OPL3_WriteRegBuffered(opl3_chip *chip, Bit16u reg, Bit8u v)
 
 void OPL3_GenerateStream(opl3_chip *chip, Bit16s *sndptr, Bit32u numsamples)
 {
+    Bit16s native[OPL_BLOCK_SIZE * 2];
+    Bit32u count, needed, n, pos, i;
+    Bit32s samplecnt;
+
+    while (numsamples > 0)
+    {
+        // Count how many output samples can be made from one block
+        // of samples at the native rate.
+        count = 0;
+        needed = 0;
+        samplecnt = chip->samplecnt;
+
+        while (count < numsamples)
+        {
+            n = 0;
+            while (samplecnt >= chip->rateratio)
+            {
+                samplecnt -= chip->rateratio;
+                n++;
+            }
+            if (needed + n > OPL_BLOCK_SIZE)
+            {
+                break;
+            }
+            needed += n;
+            samplecnt += 1 << RSM_FRAC;
+            count++;
+        }
+
+        // Only at very low output rates does one output sample need
+        // more than a block.
+        if (count == 0)
+        {
+            OPL3_GenerateResampled(chip, sndptr);
+            sndptr += 2;
+            numsamples--;
+            continue;
+        }
+
+        OPL3_GenerateBlock(chip, native, needed);
+
+        pos = 0;
+        for (i = 0; i < count; i++)
+        {
+            while (chip->samplecnt >= chip->rateratio)
+            {
+                chip->oldsamples[0] = chip->samples[0];
+                chip->oldsamples[1] = chip->samples[1];
+                chip->samples[0] = native[pos * 2];
+                chip->samples[1] = native[pos * 2 + 1];
+                chip->samplecnt -= chip->rateratio;
+                pos++;
+            }
+            OPL3_Interpolate(chip, sndptr);
+            sndptr += 2;
+        }
+
+        numsamples -= count;
+    }
+}
+
+#ifdef TEST
+
+//
+// Check that OPL3_GenerateBlock() and OPL3_GenerateStream() give the
+// same output, bit for bit, as generating a sample at a time. Register
+// dumps in the raw OPL format that examples/droplay plays can be given
+// on the command line; otherwise a corpus of random register writes is
+// made up that covers OPL3 mode, four-operator channels, rhythm mode
+// and every waveform.
+//
+
+#include <time.h>
+
+#define RAW_HEADER        "DBRAWOPL"
+#define RAW_DATA_OFFSET   28
+#define RANDOM_DUMPS      8
+#define RANDOM_WRITES     2000
+#define MAX_CHUNK         700
+
+typedef struct
+{
+    Bit16u reg;       // Register to write, or 0xffff for a delay.
+    Bit8u val;
+    Bit32u delay_ms;
+} dump_event_t;
+
+typedef struct
+{
+    dump_event_t *events;
+    Bit32u num_events;
+    Bit32u max_events;
+} dump_t;
+
+static Bit32u rand_state;
+
+static Bit32u Random(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+static void AddEvent(dump_t *dump, Bit16u reg, Bit8u val, Bit32u delay_ms)
+{
+    if (dump->num_events == dump->max_events)
+    {
+        dump->max_events = dump->max_events ? dump->max_events * 2 : 256;
+        dump->events = (dump_event_t *) realloc(dump->events,
+            dump->max_events * sizeof(*dump->events));
+        if (dump->events == nullptr)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(-1);
+        }
+    }
+
+    dump->events[dump->num_events].reg = reg;
+    dump->events[dump->num_events].val = val;
+    dump->events[dump->num_events].delay_ms = delay_ms;
+    dump->num_events++;
+}
+
+// Read a raw OPL dump. Commands 0 and 1 are short and long delays in
+// milliseconds, 2 and 3 select the low and high register banks, and 4
+// escapes a register number below 5.
+
+static int LoadDump(dump_t *dump, const char *filename)
+{
+    char header[8];
+    int bank = 0;
+    int reg, val;
+    FILE *stream;
+
+    stream = fopen(filename, "rb");
+
+    if (stream == nullptr)
+    {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return 0;
+    }
+
+    if (fread(header, 1, 8, stream) < 8
+     || strncmp(header, RAW_HEADER, 8) != 0
+     || fseek(stream, RAW_DATA_OFFSET, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "%s: raw OPL header not found\n", filename);
+        fclose(stream);
+        return 0;
+    }
+
+    for (;;)
+    {
+        reg = fgetc(stream);
+        if (reg == EOF)
+        {
+            break;
+        }
+
+        switch (reg)
+        {
+        case 0x00:
+            AddEvent(dump, 0xffff, 0, (fgetc(stream) & 0xff) + 1);
+            break;
+        case 0x01:
+            val = fgetc(stream) & 0xff;
+            val |= (fgetc(stream) & 0xff) << 8;
+            AddEvent(dump, 0xffff, 0, val + 1);
+            break;
+        case 0x02:
+        case 0x03:
+            bank = reg - 0x02;
+            break;
+        case 0x04:
+            reg = fgetc(stream) & 0xff;
+            // fall through
+        default:
+            val = fgetc(stream);
+            if (val == EOF)
+            {
+                break;
+            }
+            AddEvent(dump, (Bit16u)((bank << 8) | reg), (Bit8u)val, 0);
+            break;
+        }
+    }
+
+    fclose(stream);
+    return 1;
+}
+
+// Make up a dump of random writes to the registers that matter for
+// sound generation, with short delays in between.
+
+static void RandomDump(dump_t *dump, Bit32u seed)
+{
+    static const Bit8u slot_regs[] = { 0x20, 0x40, 0x60, 0x80, 0xe0 };
+    Bit16u bank, reg;
     Bit32u i;
 
-    for(i = 0; i < numsamples; i++)
+    rand_state = seed * 2654435761u + 1;
+
+    AddEvent(dump, 0x105, (Random() & 3) != 0, 0);
+    AddEvent(dump, 0x104, Random() & 0x3f, 0);
+    AddEvent(dump, 0x08, Random() & 0x40, 0);
+
+    for (i = 0; i < RANDOM_WRITES; i++)
+    {
+        bank = (Random() & 1) << 8;
+
+        switch (Random() % 10)
+        {
+        case 0:
+        case 1:
+        case 2:
+            reg = slot_regs[Random() % 5] + Random() % 0x16;
+            break;
+        case 3:
+            reg = 0xa0 + Random() % 9;
+            break;
+        case 4:
+        case 5:
+            reg = 0xb0 + Random() % 9;
+            break;
+        case 6:
+            reg = 0xc0 + Random() % 9;
+            break;
+        case 7:
+            reg = 0xbd;
+            bank = 0;
+            break;
+        case 8:
+            reg = (Random() & 1) ? 0x104 : 0x105;
+            bank = 0;
+            break;
+        default:
+            AddEvent(dump, 0xffff, 0, Random() % 20);
+            continue;
+        }
+
+        AddEvent(dump, bank | reg, (Bit8u)Random(), 0);
+    }
+
+    AddEvent(dump, 0xffff, 0, 1000);
+}
+
+// Play a dump on two chips, one a sample at a time and the other in
+// blocks of random sizes, and compare the output.
+
+static int CompareDump(const dump_t *dump, Bit32u samplerate,
+                       clock_t *ref_time, clock_t *block_time)
+{
+    static opl3_chip ref, blk;
+    static Bit16s ref_buf[MAX_CHUNK * 2], blk_buf[MAX_CHUNK * 2];
+    Bit64u position, total;
+    Bit32u i, j, n, remaining;
+    clock_t start;
+    int native;
+
+    native = samplerate == 49716;
+    OPL3_Reset(&ref, samplerate);
+    OPL3_Reset(&blk, samplerate);
+    position = 0;
+    total = 0;
+
+    for (i = 0; i < dump->num_events; i++)
+    {
+        if (dump->events[i].reg != 0xffff)
+        {
+            OPL3_WriteRegBuffered(&ref, dump->events[i].reg,
+                                  dump->events[i].val);
+            OPL3_WriteRegBuffered(&blk, dump->events[i].reg,
+                                  dump->events[i].val);
+            continue;
+        }
+
+        total += (Bit64u) dump->events[i].delay_ms * samplerate;
+        remaining = (Bit32u)(total / 1000 - position);
+
+        while (remaining > 0)
+        {
+            n = 1 + Random() % MAX_CHUNK;
+            if (n > remaining)
+            {
+                n = remaining;
+            }
+
+            start = clock();
+            for (j = 0; j < n; j++)
+            {
+                if (native)
+                {
+                    OPL3_Generate(&ref, ref_buf + j * 2);
+                }
+                else
+                {
+                    OPL3_GenerateResampled(&ref, ref_buf + j * 2);
+                }
+            }
+            *ref_time += clock() - start;
+
+            start = clock();
+            if (native)
+            {
+                OPL3_GenerateBlock(&blk, blk_buf, n);
+            }
+            else
+            {
+                OPL3_GenerateStream(&blk, blk_buf, n);
+            }
+            *block_time += clock() - start;
+
+            for (j = 0; j < n * 2; j++)
+            {
+                if (ref_buf[j] != blk_buf[j])
+                {
+                    printf("  %u Hz: sample %llu (%s) differs: %d != %d\n",
+                           samplerate,
+                           (unsigned long long) (position + j / 2),
+                           (j & 1) ? "right" : "left",
+                           ref_buf[j], blk_buf[j]);
+                    return 0;
+                }
+            }
+
+            position += n;
+            remaining -= n;
+        }
+    }
+
+    return 1;
+}
+
+// Every waveform table entry must give the same output as the
+// waveform functions, at every envelope level.
+
+static int CheckWaveformTables(void)
+{
+    Bit16u phase, envelope;
+    Bit16s expected, result;
+    Bit8u wf;
+
+    OPL3_BuildWaveformTables();
+
+    for (wf = 0; wf < 8; wf++)
+    {
+        for (phase = 0; phase < 0x400; phase++)
+        {
+            for (envelope = 0; envelope < 0x400; envelope++)
+            {
+                expected = envelope_sin[wf](phase, envelope);
+                result = OPL3_EnvelopeCalcExp(wf_out[wf][phase]
+                                              + (envelope << 3))
+                       ^ wf_neg[wf][phase];
+
+                if (expected != result)
+                {
+                    printf("Waveform %d, phase %d, envelope %d: %d != %d\n",
+                           wf, phase, envelope, expected, result);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    static const Bit32u samplerates[] = {
+        49716, 44100, 48000, 22050, 11025
+    };
+    clock_t ref_time = 0, block_time = 0;
+    dump_t dump;
+    int failed = 0;
+    int num_dumps;
+    int i, j;
+
+    if (!CheckWaveformTables())
     {
-        OPL3_GenerateResampled(chip, sndptr);
-        sndptr += 2;
+        return 1;
     }
+
+    num_dumps = argc > 1 ? argc - 1 : RANDOM_DUMPS;
+
+    for (i = 0; i < num_dumps; i++)
+    {
+        memset(&dump, 0, sizeof(dump));
+
+        if (argc > 1)
+        {
+            if (!LoadDump(&dump, argv[i + 1]))
+            {
+                failed = 1;
+                continue;
+            }
+            printf("%s:\n", argv[i + 1]);
+        }
+        else
+        {
+            RandomDump(&dump, i);
+            printf("Random dump %d:\n", i);
+        }
+
+        for (j = 0; j < (int) (sizeof(samplerates) / sizeof(*samplerates)); j++)
+        {
+            rand_state = i + j + 1;
+            if (!CompareDump(&dump, samplerates[j], &ref_time, &block_time))
+            {
+                failed = 1;
+            }
+        }
+
+        free(dump.events);
+    }
+
+    printf("%s. Sample at a time: %.2fs, blocks: %.2fs\n",
+           failed ? "FAILED" : "All output identical",
+           (double) ref_time / CLOCKS_PER_SEC,
+           (double) block_time / CLOCKS_PER_SEC);
+
+    return failed;
 }
+
+#endif
@@ -0,0 +1,193 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Timers and callback scheduling for the OPL drivers that use the
+//     software emulator, where time is measured in generated samples.
+//
+//     None of this locks: the SDL driver calls it from its mixing
+//     thread only, apart from the timers, which are only used by the
+//     thread that sets them.
+//
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "opl.hpp"
+#include "opl_internal.hpp"
+#include "opl_emu.hpp"
+
+void OPL_Emu_InitTimers(opl_emu_timers_t *timers)
+{
+    timers->timer1.rate = 12500;
+    timers->timer1.enabled = 0;
+    timers->timer1.value = 0;
+    timers->timer1.expire_time = 0;
+
+    timers->timer2.rate = 3125;
+    timers->timer2.enabled = 0;
+    timers->timer2.value = 0;
+    timers->timer2.expire_time = 0;
+}
+
+// Value read from the status register at the given time.
+
+unsigned int OPL_Emu_ReadStatus(opl_emu_timers_t *timers, uint64_t now)
+{
+    unsigned int result = 0;
+
+    if (timers->timer1.enabled && now > timers->timer1.expire_time)
+    {
+        result |= 0x80;   // Either have expired
+        result |= 0x40;   // Timer 1 has expired
+    }
+
+    if (timers->timer2.enabled && now > timers->timer2.expire_time)
+    {
+        result |= 0x80;   // Either have expired
+        result |= 0x20;   // Timer 2 has expired
+    }
+
+    return result;
+}
+
+static void OPLTimer_CalculateEndTime(opl_timer_t *timer, uint64_t now)
+{
+    int tics;
+
+    // If the timer is enabled, calculate the time when the timer
+    // will expire.
+
+    if (timer->enabled)
+    {
+        tics = 0x100 - timer->value;
+        timer->expire_time = now + ((uint64_t) tics * OPL_SECOND) / timer->rate;
+    }
+}
+
+// Handle a write to a timer register. Returns zero if reg_num is not
+// a timer register, in which case the write is for the chip.
+
+int OPL_Emu_WriteTimerRegister(opl_emu_timers_t *timers, uint64_t now,
+                               unsigned int reg_num, unsigned int value)
+{
+    switch (reg_num)
+    {
+        case OPL_REG_TIMER1:
+            timers->timer1.value = value;
+            OPLTimer_CalculateEndTime(&timers->timer1, now);
+            return 1;
+
+        case OPL_REG_TIMER2:
+            timers->timer2.value = value;
+            OPLTimer_CalculateEndTime(&timers->timer2, now);
+            return 1;
+
+        case OPL_REG_TIMER_CTRL:
+            if (value & 0x80)
+            {
+                timers->timer1.enabled = 0;
+                timers->timer2.enabled = 0;
+            }
+            else
+            {
+                if ((value & 0x40) == 0)
+                {
+                    timers->timer1.enabled = (value & 0x01) != 0;
+                    OPLTimer_CalculateEndTime(&timers->timer1, now);
+                }
+
+                if ((value & 0x20) == 0)
+                {
+                    timers->timer2.enabled = (value & 0x02) != 0;
+                    OPLTimer_CalculateEndTime(&timers->timer2, now);
+                }
+            }
+
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+void OPL_Emu_InitCallbacks(opl_emu_callbacks_t *callbacks)
+{
+    callbacks->queue = OPL_Queue_Create();
+    callbacks->pause_offset = 0;
+    callbacks->in_callback = 0;
+    callbacks->callback_time = 0;
+}
+
+void OPL_Emu_FreeCallbacks(opl_emu_callbacks_t *callbacks)
+{
+    if (callbacks->queue != nullptr)
+    {
+        OPL_Queue_Destroy(callbacks->queue);
+        callbacks->queue = nullptr;
+    }
+}
+
+void OPL_Emu_SetCallback(opl_emu_callbacks_t *callbacks, uint64_t now,
+                         uint64_t us, opl_callback_t callback, void *data)
+{
+    if (callbacks->in_callback)
+    {
+        OPL_Queue_Push(callbacks->queue, callback, data,
+                       callbacks->callback_time + us);
+    }
+    else
+    {
+        OPL_Queue_Push(callbacks->queue, callback, data,
+                       now - callbacks->pause_offset + us);
+    }
+}
+
+// Time at which the next callback is due, allowing for pauses. The
+// queue must not be empty.
+
+uint64_t OPL_Emu_NextCallbackTime(opl_emu_callbacks_t *callbacks)
+{
+    return OPL_Queue_Peek(callbacks->queue) + callbacks->pause_offset;
+}
+
+int OPL_Emu_CallbackDue(opl_emu_callbacks_t *callbacks, uint64_t now)
+{
+    return !OPL_Queue_IsEmpty(callbacks->queue)
+        && now >= OPL_Emu_NextCallbackTime(callbacks);
+}
+
+// Invoke the callbacks that are due by the given time. Keep invoking
+// them until there are no more left: callbacks run on this thread, so
+// any callbacks they set are added to the queue directly.
+
+void OPL_Emu_InvokeCallbacks(opl_emu_callbacks_t *callbacks, uint64_t now)
+{
+    opl_callback_t callback;
+    void *callback_data;
+
+    while (OPL_Emu_CallbackDue(callbacks, now))
+    {
+        callbacks->callback_time = OPL_Queue_Peek(callbacks->queue);
+
+        if (!OPL_Queue_Pop(callbacks->queue, &callback, &callback_data))
+        {
+            break;
+        }
+
+        callbacks->in_callback = 1;
+        callback(callback_data);
+        callbacks->in_callback = 0;
+    }
+}
@@ -0,0 +1,70 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Timers and callback scheduling for the OPL drivers that use the
+//     software emulator, where time is measured in generated samples.
+//
+
+#ifndef OPL_EMU_H
+#define OPL_EMU_H
+
+#include "opl.hpp"
+#include "opl_queue.hpp"
+
+typedef struct
+{
+    unsigned int rate;        // Number of times the timer is advanced per sec.
+    unsigned int enabled;     // Non-zero if timer is enabled.
+    unsigned int value;       // Last value that was set.
+    uint64_t expire_time;     // Calculated time that timer will expire.
+} opl_timer_t;
+
+// The emulator does not do timer stuff itself.
+
+typedef struct
+{
+    opl_timer_t timer1;
+    opl_timer_t timer2;
+} opl_emu_timers_t;
+
+typedef struct
+{
+    // Queue of callbacks waiting to be invoked.
+    opl_callback_queue_t *queue;
+
+    // Time offset (in us) due to the fact that callbacks were
+    // previously paused.
+    uint64_t pause_offset;
+
+    // While a callback is being invoked, the time that it was due. New
+    // callbacks that it sets are timed from then rather than from the
+    // current time, which can be up to a sample later.
+    int in_callback;
+    uint64_t callback_time;
+} opl_emu_callbacks_t;
+
+void OPL_Emu_InitTimers(opl_emu_timers_t *timers);
+unsigned int OPL_Emu_ReadStatus(opl_emu_timers_t *timers, uint64_t now);
+int OPL_Emu_WriteTimerRegister(opl_emu_timers_t *timers, uint64_t now,
+                               unsigned int reg_num, unsigned int value);
+
+void OPL_Emu_InitCallbacks(opl_emu_callbacks_t *callbacks);
+void OPL_Emu_FreeCallbacks(opl_emu_callbacks_t *callbacks);
+void OPL_Emu_SetCallback(opl_emu_callbacks_t *callbacks, uint64_t now,
+                         uint64_t us, opl_callback_t callback, void *data);
+int OPL_Emu_CallbackDue(opl_emu_callbacks_t *callbacks, uint64_t now);
+uint64_t OPL_Emu_NextCallbackTime(opl_emu_callbacks_t *callbacks);
+void OPL_Emu_InvokeCallbacks(opl_emu_callbacks_t *callbacks, uint64_t now);
+
+#endif /* #ifndef OPL_EMU_H */
@@ -33,6 +33,7 @@ typedef void (*opl_lock_func)(void);
 typedef void (*opl_unlock_func)(void);
 typedef void (*opl_set_paused_func)(int paused);
 typedef void (*opl_adjust_callbacks_func)(float value);
+typedef void (*opl_delay_func)(uint64_t us);
 
 typedef struct
 {
@@ -48,11 +49,16 @@ typedef struct
     opl_unlock_func unlock_func;
     opl_set_paused_func set_paused_func;
     opl_adjust_callbacks_func adjust_callbacks_func;
+
+    // Optional: drivers that only advance time while generating output
+    // implement OPL_Delay() themselves.
+    opl_delay_func delay_func;
 } opl_driver_t;
 
 // Sample rate to use when doing software emulation.
 
 extern unsigned int opl_sample_rate;
+extern opl_stats_func_t opl_stats_func;
 
 
 #if (defined(__i386__) || defined(__x86_64__)) && defined(HAVE_IOPERM)
@@ -65,6 +71,7 @@ extern opl_driver_t opl_openbsd_driver;
 extern opl_driver_t opl_win32_driver;
 #endif
 extern opl_driver_t opl_sdl_driver;
+extern opl_driver_t opl_render_driver;
 
 
 #endif /* #ifndef OPL_INTERNAL_H */
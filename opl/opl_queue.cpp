@@ -58,6 +58,11 @@ int OPL_Queue_IsEmpty(opl_callback_queue_t *queue)
     return queue->num_entries == 0;
 }
 
+unsigned int OPL_Queue_Size(opl_callback_queue_t *queue)
+{
+    return queue->num_entries;
+}
+
 void OPL_Queue_Clear(opl_callback_queue_t *queue)
 {
     queue->num_entries = 0;
@@ -0,0 +1,249 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     OPL offline rendering interface.
+//
+//     Emulates the chip like the SDL driver, but without a sound
+//     device: output is only generated when OPL_Render() asks for it,
+//     and time only passes as it is generated. Everything happens on
+//     the calling thread, so there is nothing to lock. The driver is
+//     never selected automatically; set OPL_DRIVER=Render to use it.
+//
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opl3.hpp"
+
+#include "opl.hpp"
+#include "opl_internal.hpp"
+
+#include "opl_emu.hpp"
+
+// Callbacks waiting to be invoked. The queue is null when the driver
+// is not running.
+
+static opl_emu_callbacks_t callbacks = { nullptr, 0, 0, 0 };
+
+// Current time, in us since startup.
+
+static uint64_t current_time;
+static int render_paused;
+
+// Samples generated since startup; current_time is worked out from
+// this so that rounding does not add up.
+
+static uint64_t current_sample;
+
+// OPL software emulator structure.
+
+static opl3_chip opl_chip;
+
+// Register number that was written.
+
+static int register_num = 0;
+
+static opl_emu_timers_t timers;
+
+// Advance time by the specified number of samples, invoking any
+// callback functions as appropriate.
+
+static void AdvanceTime(unsigned int nsamples)
+{
+    uint64_t now;
+
+    current_sample += nsamples;
+    now = (current_sample * OPL_SECOND) / opl_sample_rate;
+
+    if (render_paused)
+    {
+        callbacks.pause_offset += now - current_time;
+    }
+
+    current_time = now;
+
+    OPL_Emu_InvokeCallbacks(&callbacks, current_time);
+}
+
+// Number of samples until the next callback is due, or max_samples if
+// that is sooner.
+
+static unsigned int SamplesToNextCallback(unsigned int max_samples)
+{
+    uint64_t next_callback_time;
+    uint64_t next_sample;
+
+    if (render_paused || OPL_Queue_IsEmpty(callbacks.queue))
+    {
+        return max_samples;
+    }
+
+    // Work from the sample count rather than current_time, which has
+    // been rounded down, so that the callback is run at the same
+    // sample however the output is split into blocks.
+
+    next_callback_time = OPL_Emu_NextCallbackTime(&callbacks);
+    next_sample = (next_callback_time * opl_sample_rate + OPL_SECOND - 1)
+                / OPL_SECOND;
+
+    if (next_sample <= current_sample)
+    {
+        return 0;
+    }
+
+    return next_sample - current_sample < max_samples
+         ? (unsigned int) (next_sample - current_sample) : max_samples;
+}
+
+void OPL_Render(int16_t *buffer, unsigned int nsamples)
+{
+    unsigned int filled, n;
+
+    if (callbacks.queue == nullptr)
+    {
+        memset(buffer, 0, nsamples * 4);
+        return;
+    }
+
+    filled = 0;
+
+    while (filled < nsamples)
+    {
+        n = SamplesToNextCallback(nsamples - filled);
+
+        OPL3_GenerateStream(&opl_chip, buffer + filled * 2, n);
+        filled += n;
+
+        AdvanceTime(n);
+    }
+}
+
+static void OPL_Render_Shutdown(void)
+{
+    OPL_Emu_FreeCallbacks(&callbacks);
+}
+
+static int OPL_Render_Init(unsigned int port_base)
+{
+    OPL_Emu_InitCallbacks(&callbacks);
+    OPL_Emu_InitTimers(&timers);
+    current_time = 0;
+    current_sample = 0;
+    render_paused = 0;
+
+    OPL3_Reset(&opl_chip, opl_sample_rate);
+
+    return 1;
+}
+
+static unsigned int OPL_Render_PortRead(opl_port_t port)
+{
+    if (port == OPL_REGISTER_PORT_OPL3)
+    {
+        return 0xff;
+    }
+
+    return OPL_Emu_ReadStatus(&timers, current_time);
+}
+
+static void WriteRegister(unsigned int reg_num, unsigned int value)
+{
+    if (!OPL_Emu_WriteTimerRegister(&timers, current_time, reg_num, value))
+    {
+        OPL3_WriteRegBuffered(&opl_chip, reg_num, value);
+    }
+}
+
+static void OPL_Render_PortWrite(opl_port_t port, unsigned int value)
+{
+    if (port == OPL_REGISTER_PORT)
+    {
+        register_num = value;
+    }
+    else if (port == OPL_REGISTER_PORT_OPL3)
+    {
+        register_num = value | 0x100;
+    }
+    else if (port == OPL_DATA_PORT)
+    {
+        WriteRegister(register_num, value);
+    }
+}
+
+static void OPL_Render_SetCallback(uint64_t us, opl_callback_t callback,
+                                   void *data)
+{
+    OPL_Emu_SetCallback(&callbacks, current_time, us, callback, data);
+}
+
+static void OPL_Render_ClearCallbacks(void)
+{
+    OPL_Queue_Clear(callbacks.queue);
+}
+
+static void OPL_Render_Lock(void)
+{
+}
+
+static void OPL_Render_Unlock(void)
+{
+}
+
+static void OPL_Render_SetPaused(int paused)
+{
+    render_paused = paused;
+}
+
+static void OPL_Render_AdjustCallbacks(float factor)
+{
+    OPL_Queue_AdjustCallbacks(callbacks.queue, current_time, factor);
+}
+
+// Nothing else will make time pass, so generate the samples and throw
+// them away.
+
+static void OPL_Render_Delay(uint64_t us)
+{
+    int16_t buffer[256 * 2];
+    uint64_t nsamples;
+    unsigned int n;
+
+    nsamples = (us * opl_sample_rate + OPL_SECOND - 1) / OPL_SECOND;
+
+    while (nsamples > 0)
+    {
+        n = nsamples < 256 ? (unsigned int) nsamples : 256;
+        OPL_Render(buffer, n);
+        nsamples -= n;
+    }
+}
+
+opl_driver_t opl_render_driver =
+{
+    "Render",
+    OPL_Render_Init,
+    OPL_Render_Shutdown,
+    OPL_Render_PortRead,
+    OPL_Render_PortWrite,
+    OPL_Render_SetCallback,
+    OPL_Render_ClearCallbacks,
+    OPL_Render_Lock,
+    OPL_Render_Unlock,
+    OPL_Render_SetPaused,
+    OPL_Render_AdjustCallbacks,
+    OPL_Render_Delay,
+};
@@ -23,6 +23,8 @@
 #include <errno.h>
 #include <assert.h>
 
+#include <atomic>
+
 #include <SDL.h>
 #include <SDL_mixer.h>
 
@@ -31,7 +33,9 @@
 #include "opl.hpp"
 #include "opl_internal.hpp"
 
-#include "opl_queue.hpp"
+#include "opl_emu.hpp"
+
+#include "../utils/spsc_queue.hpp"
 
 
 #ifndef DISABLE_SDL2MIXER
@@ -39,40 +43,68 @@
 
 #define MAX_SOUND_SLICE_TIME 100 /* ms */
 
+// Number of commands that can be waiting for the mixing thread.
+
+#define COMMAND_QUEUE_LEN 2048
+
+// The chip and the callback queue belong to the mixing thread. Other
+// threads pass register writes and callback changes to it through the
+// command queue, so that the mixing callback never has to wait for
+// them.
+
+typedef enum
+{
+    OPL_COMMAND_WRITE_REGISTER,
+    OPL_COMMAND_SET_CALLBACK,
+    OPL_COMMAND_CLEAR_CALLBACKS,
+    OPL_COMMAND_SET_PAUSED,
+    OPL_COMMAND_ADJUST_CALLBACKS,
+} opl_command_type_t;
+
 typedef struct
 {
-    unsigned int rate;        // Number of times the timer is advanced per sec.
-    unsigned int enabled;     // Non-zero if timer is enabled.
-    unsigned int value;       // Last value that was set.
-    uint64_t expire_time;     // Calculated time that timer will expire.
-} opl_timer_t;
+    opl_command_type_t type;
+
+    // Register number and value, or the paused flag.
+    unsigned int reg;
+    unsigned int value;
+
+    // Callback to schedule, us from the time the command is run.
+    uint64_t us;
+    opl_callback_t callback;
+    void *data;
+
+    float factor;
+} opl_command_t;
+
+static spsc_queue<opl_command_t, COMMAND_QUEUE_LEN> command_queue;
+
+// Thread that the mixing callback runs on.
+
+static std::atomic<SDL_threadID> mix_thread;
 
 // When the callback mutex is locked using OPL_Lock, callback functions
 // are not invoked.
 
 static SDL_mutex *callback_mutex = nullptr;
 
-// Queue of callbacks waiting to be invoked.
+// Set when callbacks were due but could not be invoked because the
+// callback mutex was locked; they are left for the next mixing call.
 
-static opl_callback_queue_t *callback_queue;
+static int callbacks_blocked;
 
-// Mutex used to control access to the callback queue.
+// Callbacks waiting to be invoked.
 
-static SDL_mutex *callback_queue_mutex = nullptr;
+static opl_emu_callbacks_t callbacks;
 
 // Current time, in us since startup:
 
-static uint64_t current_time;
+static std::atomic<uint64_t> current_time;
 
 // If non-zero, playback is currently paused.
 
 static int opl_sdl_paused;
 
-// Time offset (in us) due to the fact that callbacks
-// were previously paused.
-
-static uint64_t pause_offset;
-
 // OPL software emulator structure.
 
 static opl3_chip opl_chip;
@@ -82,14 +114,15 @@ static int opl_opl3mode;
 
 static uint8_t *mix_buffer = nullptr;
 
-// Register number that was written.
+// Register number that was written, by the mixing thread and by
+// other threads.
 
+static int mix_register_num = 0;
 static int register_num = 0;
 
 // Timers; DBOPL does not do timer stuff itself.
 
-static opl_timer_t timer1 = { 12500, 0, 0, 0 };
-static opl_timer_t timer2 = { 3125, 0, 0, 0 };
+static opl_emu_timers_t timers;
 
 // SDL parameters.
 
@@ -105,57 +138,115 @@ static int SDLIsInitialized(void)
     return Mix_QuerySpec(&freq, &format, &channels);
 }
 
+static void WriteRegister(unsigned int reg_num, unsigned int value);
+
+static int InMixThread(void)
+{
+    return SDL_ThreadID() == mix_thread.load();
+}
+
+static void RunCommand(const opl_command_t *command)
+{
+    switch (command->type)
+    {
+        case OPL_COMMAND_WRITE_REGISTER:
+            WriteRegister(command->reg, command->value);
+            break;
+
+        case OPL_COMMAND_SET_CALLBACK:
+            OPL_Emu_SetCallback(&callbacks, current_time.load(), command->us,
+                                command->callback, command->data);
+            break;
+
+        case OPL_COMMAND_CLEAR_CALLBACKS:
+            OPL_Queue_Clear(callbacks.queue);
+            break;
+
+        case OPL_COMMAND_SET_PAUSED:
+            opl_sdl_paused = command->value;
+            break;
+
+        case OPL_COMMAND_ADJUST_CALLBACKS:
+            OPL_Queue_AdjustCallbacks(callbacks.queue, current_time.load(),
+                                      command->factor);
+            break;
+    }
+}
+
+// Run the commands that other threads have queued.
+
+static void RunCommands(void)
+{
+    opl_command_t *command;
+
+    while ((command = command_queue.front()) != nullptr)
+    {
+        RunCommand(command);
+        command_queue.pop_front();
+    }
+}
+
+// Run a command now if called from the mixing thread (ie. from a
+// callback), or queue it for the mixing thread otherwise.
+
+static void SendCommand(const opl_command_t *command)
+{
+    if (InMixThread())
+    {
+        RunCommand(command);
+        return;
+    }
+
+    // Only threads other than the mixing thread wait here. The queue
+    // is emptied every time the mixing callback runs.
+
+    while (!command_queue.push(*command))
+    {
+        SDL_Delay(1);
+    }
+}
+
 // Advance time by the specified number of samples, invoking any
 // callback functions as appropriate.
 
 static void AdvanceTime(unsigned int nsamples)
 {
-    opl_callback_t callback;
-    void *callback_data;
-    uint64_t us;
-
-    SDL_LockMutex(callback_queue_mutex);
+    uint64_t us, now;
 
     // Advance time.
 
     us = ((uint64_t) nsamples * OPL_SECOND) / mixing_freq;
-    current_time += us;
+    now = current_time.load() + us;
+    current_time.store(now);
 
     if (opl_sdl_paused)
     {
-        pause_offset += us;
+        callbacks.pause_offset += us;
     }
 
-    // Are there callbacks to invoke now?  Keep invoking them
-    // until there are no more left.
-
-    while (!OPL_Queue_IsEmpty(callback_queue)
-        && current_time >= OPL_Queue_Peek(callback_queue) + pause_offset)
+    if (!OPL_Emu_CallbackDue(&callbacks, now))
     {
-        // Pop the callback from the queue to invoke it.
+        return;
+    }
 
-        if (!OPL_Queue_Pop(callback_queue, &callback, &callback_data))
-        {
-            break;
-        }
+    // Callbacks must not be invoked while the control thread holds
+    // OPL_Lock(), but the mixing thread must not wait for it either;
+    // the callbacks are left until the next time instead.
 
-        // The mutex stuff here is a bit complicated.  We must
-        // hold callback_mutex when we invoke the callback (so that
-        // the control thread can use OPL_Lock() to prevent callbacks
-        // from being invoked), but we must not be holding
-        // callback_queue_mutex, as the callback must be able to
-        // call OPL_SetCallback to schedule new callbacks.
+    if (SDL_TryLockMutex(callback_mutex) != 0)
+    {
+        callbacks_blocked = 1;
+        return;
+    }
 
-        SDL_UnlockMutex(callback_queue_mutex);
+    // Anything queued while the lock was held has to be seen first:
+    // callbacks may have been cleared because their data was freed.
 
-        SDL_LockMutex(callback_mutex);
-        callback(callback_data);
-        SDL_UnlockMutex(callback_mutex);
+    RunCommands();
 
-        SDL_LockMutex(callback_queue_mutex);
-    }
+    OPL_Emu_InvokeCallbacks(&callbacks, now);
 
-    SDL_UnlockMutex(callback_queue_mutex);
+    SDL_UnlockMutex(callback_mutex);
 }
 
 // Call the OPL emulator code to fill the specified buffer.
@@ -180,32 +271,43 @@ static void OPL_Mix_Callback(int chan, void *stream, int len, void *udata)
 {
     unsigned int filled, buffer_samples;
     Uint8 *buffer = (Uint8*)stream;
+    uint64_t start = 0;
+
+    if (opl_stats_func != nullptr)
+    {
+        start = SDL_GetPerformanceCounter();
+    }
 
     // Repeatedly call the OPL emulator update function until the buffer is
     // full.
     filled = 0;
     buffer_samples = len / 4;
 
+    mix_thread.store(SDL_ThreadID());
+    callbacks_blocked = 0;
+
     while (filled < buffer_samples)
     {
         uint64_t next_callback_time;
         uint64_t nsamples;
 
-        SDL_LockMutex(callback_queue_mutex);
+        RunCommands();
 
         // Work out the time until the next callback waiting in
         // the callback queue must be invoked.  We can then fill the
         // buffer with this many samples.
 
-        if (opl_sdl_paused || OPL_Queue_IsEmpty(callback_queue))
+        if (opl_sdl_paused || callbacks_blocked
+         || OPL_Queue_IsEmpty(callbacks.queue))
         {
             nsamples = buffer_samples - filled;
         }
         else
         {
-            next_callback_time = OPL_Queue_Peek(callback_queue) + pause_offset;
+            next_callback_time = OPL_Emu_NextCallbackTime(&callbacks);
 
-            nsamples = (next_callback_time - current_time) * mixing_freq;
+            nsamples = (next_callback_time - current_time.load())
+                     * mixing_freq;
             nsamples = (nsamples + OPL_SECOND - 1) / OPL_SECOND;
 
             if (nsamples > buffer_samples - filled)
@@ -214,8 +316,6 @@ static void OPL_Mix_Callback(int chan, void *stream, int len, void *udata)
             }
         }
 
-        SDL_UnlockMutex(callback_queue_mutex);
-
         // Add emulator output to buffer.
 
         FillBuffer(buffer + filled * 4, nsamples);
@@ -225,6 +325,12 @@ static void OPL_Mix_Callback(int chan, void *stream, int len, void *udata)
 
         AdvanceTime(nsamples);
     }
+
+    if (opl_stats_func != nullptr)
+    {
+        opl_stats_func(start, SDL_GetPerformanceCounter(), buffer_samples,
+                       mixing_freq, OPL_Queue_Size(callbacks.queue));
+    }
 }
 
 static void OPL_SDL_Shutdown(void)
@@ -235,7 +341,7 @@ static void OPL_SDL_Shutdown(void)
     {
         Mix_CloseAudio();
         SDL_QuitSubSystem(SDL_INIT_AUDIO);
-        OPL_Queue_Destroy(callback_queue);
+        OPL_Emu_FreeCallbacks(&callbacks);
         free(mix_buffer);
         sdl_was_initialized = 0;
     }
@@ -254,11 +360,8 @@ static void OPL_SDL_Shutdown(void)
         callback_mutex = nullptr;
     }
 
-    if (callback_queue_mutex != nullptr)
-    {
-        SDL_DestroyMutex(callback_queue_mutex);
-        callback_queue_mutex = nullptr;
-    }
+    command_queue.clear();
+    mix_thread.store(0);
 }
 
 static unsigned int GetSliceSize(void)
@@ -319,12 +422,13 @@ static int OPL_SDL_Init(unsigned int port_base)
     }
 
     opl_sdl_paused = 0;
-    pause_offset = 0;
 
     // Queue structure of callbacks to invoke.
 
-    callback_queue = OPL_Queue_Create();
-    current_time = 0;
+    OPL_Emu_InitCallbacks(&callbacks);
+    OPL_Emu_InitTimers(&timers);
+    current_time.store(0);
+    command_queue.clear();
 
     // Get the mixer frequency, format and number of channels.
 
@@ -351,7 +455,6 @@ static int OPL_SDL_Init(unsigned int port_base)
     opl_opl3mode = 0;
 
     callback_mutex = SDL_CreateMutex();
-    callback_queue_mutex = SDL_CreateMutex();
 
     // Set postmix that adds the OPL music. This is deliberately done
     // as a postmix and not using Mix_HookMusic() as the latter disables
@@ -363,119 +466,74 @@ static int OPL_SDL_Init(unsigned int port_base)
 
 static unsigned int OPL_SDL_PortRead(opl_port_t port)
 {
-    unsigned int result = 0;
-
     if (port == OPL_REGISTER_PORT_OPL3)
     {
         return 0xff;
     }
 
-    if (timer1.enabled && current_time > timer1.expire_time)
-    {
-        result |= 0x80;   // Either have expired
-        result |= 0x40;   // Timer 1 has expired
-    }
-
-    if (timer2.enabled && current_time > timer2.expire_time)
-    {
-        result |= 0x80;   // Either have expired
-        result |= 0x20;   // Timer 2 has expired
-    }
-
-    return result;
+    return OPL_Emu_ReadStatus(&timers, current_time.load());
 }
 
-static void OPLTimer_CalculateEndTime(opl_timer_t *timer)
-{
-    int tics;
-
-    // If the timer is enabled, calculate the time when the timer
-    // will expire.
-
-    if (timer->enabled)
-    {
-        tics = 0x100 - timer->value;
-        timer->expire_time = current_time
-                           + ((uint64_t) tics * OPL_SECOND) / timer->rate;
-    }
-}
+// Write a register of the emulated chip. Only called on the mixing
+// thread.
 
 static void WriteRegister(unsigned int reg_num, unsigned int value)
 {
-    switch (reg_num)
+    if (reg_num == OPL_REG_NEW)
     {
-        case OPL_REG_TIMER1:
-            timer1.value = value;
-            OPLTimer_CalculateEndTime(&timer1);
-            break;
-
-        case OPL_REG_TIMER2:
-            timer2.value = value;
-            OPLTimer_CalculateEndTime(&timer2);
-            break;
-
-        case OPL_REG_TIMER_CTRL:
-            if (value & 0x80)
-            {
-                timer1.enabled = 0;
-                timer2.enabled = 0;
-            }
-            else
-            {
-                if ((value & 0x40) == 0)
-                {
-                    timer1.enabled = (value & 0x01) != 0;
-                    OPLTimer_CalculateEndTime(&timer1);
-                }
-
-                if ((value & 0x20) == 0)
-                {
-                    timer1.enabled = (value & 0x02) != 0;
-                    OPLTimer_CalculateEndTime(&timer2);
-                }
-            }
-
-            break;
-
-        case OPL_REG_NEW:
-            opl_opl3mode = value & 0x01;
-
-        default:
-            OPL3_WriteRegBuffered(&opl_chip, reg_num, value);
-            break;
+        opl_opl3mode = value & 0x01;
     }
+
+    OPL3_WriteRegBuffered(&opl_chip, reg_num, value);
 }
 
+// The timers are only read by the thread that sets them, so writes to
+// them are handled on that thread rather than queued.
+
 static void OPL_SDL_PortWrite(opl_port_t port, unsigned int value)
 {
+    opl_command_t command;
+    int *reg;
+
+    reg = InMixThread() ? &mix_register_num : &register_num;
+
     if (port == OPL_REGISTER_PORT)
     {
-        register_num = value;
+        *reg = value;
     }
     else if (port == OPL_REGISTER_PORT_OPL3)
     {
-        register_num = value | 0x100;
+        *reg = value | 0x100;
     }
-    else if (port == OPL_DATA_PORT)
+    else if (port == OPL_DATA_PORT
+          && !OPL_Emu_WriteTimerRegister(&timers, current_time.load(),
+                                         *reg, value))
     {
-        WriteRegister(register_num, value);
+        command.type = OPL_COMMAND_WRITE_REGISTER;
+        command.reg = *reg;
+        command.value = value;
+        SendCommand(&command);
     }
 }
 
 static void OPL_SDL_SetCallback(uint64_t us, opl_callback_t callback,
                                 void *data)
 {
-    SDL_LockMutex(callback_queue_mutex);
-    OPL_Queue_Push(callback_queue, callback, data,
-                   current_time - pause_offset + us);
-    SDL_UnlockMutex(callback_queue_mutex);
+    opl_command_t command;
+
+    command.type = OPL_COMMAND_SET_CALLBACK;
+    command.us = us;
+    command.callback = callback;
+    command.data = data;
+    SendCommand(&command);
 }
 
 static void OPL_SDL_ClearCallbacks(void)
 {
-    SDL_LockMutex(callback_queue_mutex);
-    OPL_Queue_Clear(callback_queue);
-    SDL_UnlockMutex(callback_queue_mutex);
+    opl_command_t command;
+
+    command.type = OPL_COMMAND_CLEAR_CALLBACKS;
+    SendCommand(&command);
 }
 
 static void OPL_SDL_Lock(void)
@@ -490,14 +548,20 @@ static void OPL_SDL_Unlock(void)
 
 static void OPL_SDL_SetPaused(int paused)
 {
-    opl_sdl_paused = paused;
+    opl_command_t command;
+
+    command.type = OPL_COMMAND_SET_PAUSED;
+    command.value = paused;
+    SendCommand(&command);
 }
 
 static void OPL_SDL_AdjustCallbacks(float factor)
 {
-    SDL_LockMutex(callback_queue_mutex);
-    OPL_Queue_AdjustCallbacks(callback_queue, current_time, factor);
-    SDL_UnlockMutex(callback_queue_mutex);
+    opl_command_t command;
+
+    command.type = OPL_COMMAND_ADJUST_CALLBACKS;
+    command.factor = factor;
+    SendCommand(&command);
 }
 
 opl_driver_t opl_sdl_driver =
@@ -0,0 +1,674 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Offline audio renderer. Plays a music lump from a WAD through
+//     the OPL music code and the emulated chip, and sound effects
+//     through the software mixer, with no sound device, and writes
+//     the output to a WAV file as fast as it can be made.
+//     Reports how much faster than real time that was, and the CPU
+//     time taken by each block, so that it can be used both as a
+//     benchmark and to check that changes to the audio code leave
+//     the output the same.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "doomtype.hpp"
+#include "i_sound.hpp"
+#include "i_swap.hpp"
+#include "i_system.hpp"
+#include "m_argv.hpp"
+#include "m_misc.hpp"
+#include "memio.hpp"
+#include "midifile.hpp"
+#include "mus2mid.hpp"
+#include "opl.hpp"
+#include "v_diskicon.hpp"
+#include "w_wad.hpp"
+#include "z_zone.hpp"
+
+#define DEFAULT_BLOCK_SIZE 512
+#define DEFAULT_LOOP_SECONDS 60
+#define DEFAULT_SFX_INTERVAL 250
+#define DEFAULT_SFX_CHANNELS 8
+
+// Time rendered after the last event of the song, for notes to die
+// away.
+
+#define TAIL_SECONDS 2
+
+// i_oplmusic.cpp, i_sdlsound.cpp and w_wad.cpp use these from
+// i_sound.cpp and v_diskicon.cpp, which would bring the sound and video
+// code with them.
+
+int snd_samplerate = 44100;
+int snd_cachesize = 64 * 1024 * 1024;
+int snd_maxslicetime_ms = 28;
+int snd_pitchshift = 0;
+
+boolean IsMid(byte *mem, int len)
+{
+    return len > 4 && !memcmp(mem, "MThd", 4);
+}
+
+boolean IsMus(byte *mem, int len)
+{
+    return len > 4 && !memcmp(mem, "MUS\x1a", 4);
+}
+
+void V_BeginRead(size_t nbytes)
+{
+}
+
+#ifdef DISABLE_SDL2MIXER
+
+// Without SDL_mixer there is no software mixer. LoadSfx() refuses
+// -sfx, so these are never used.
+
+sound_module_t sound_softmix_module;
+
+boolean I_SoftMix_InitRender(int samplerate)
+{
+    return false;
+}
+
+void I_SoftMix_Render(int16_t *buffer, unsigned int nframes)
+{
+}
+
+#endif
+
+static char opl_driver_env[] = "OPL_DRIVER=Render";
+
+// Sound effects to play, one after another, every sfx_interval
+// samples, on sfx_channels channels in turn.
+
+static sfxinfo_t *sfx;
+static int num_sfx;
+static unsigned int sfx_interval, sfx_channels;
+static unsigned int sfx_started;
+
+// Samples rendered so far, and the sample at which the next sound
+// effect starts.
+
+static unsigned int render_sample, next_sfx_sample;
+
+// Length of a song in microseconds, from the time of its last event.
+
+static uint64_t SongLength(byte *data, int len)
+{
+    MEMFILE *instream, *outstream;
+    midi_file_t *file;
+    midi_timeline_event_t *timeline;
+    unsigned int num_events;
+    void *buf;
+    size_t buf_len;
+    uint64_t result = 0;
+
+    if (IsMid(data, len))
+    {
+        file = MIDI_LoadMemory(data, len);
+    }
+    else
+    {
+        instream = mem_fopen_read(data, len);
+        outstream = mem_fopen_write();
+        file = nullptr;
+
+        if (mus2mid(instream, outstream) == 0)
+        {
+            mem_get_buf(outstream, &buf, &buf_len);
+            file = MIDI_LoadMemory(buf, buf_len);
+        }
+
+        mem_fclose(instream);
+        mem_fclose(outstream);
+    }
+
+    if (file != nullptr)
+    {
+        timeline = MIDI_GetTimeline(file, &num_events);
+
+        if (num_events > 0)
+        {
+            result = timeline[num_events - 1].time;
+        }
+
+        MIDI_FreeFile(file);
+    }
+
+    return result;
+}
+
+static void WriteLE16(byte *p, unsigned int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+}
+
+static void WriteLE32(byte *p, unsigned int value)
+{
+    WriteLE16(p, value & 0xffff);
+    WriteLE16(p + 2, value >> 16);
+}
+
+// Write the header of a 16-bit stereo WAV file holding nsamples
+// samples.
+
+static void WriteWAVHeader(FILE *stream, unsigned int rate,
+                           unsigned int nsamples)
+{
+    byte header[44];
+
+    memcpy(header, "RIFF", 4);
+    WriteLE32(header + 4, 36 + nsamples * 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    WriteLE32(header + 16, 16);
+    WriteLE16(header + 20, 1);           // PCM
+    WriteLE16(header + 22, 2);           // Channels
+    WriteLE32(header + 24, rate);
+    WriteLE32(header + 28, rate * 4);    // Bytes per second
+    WriteLE16(header + 32, 4);           // Bytes per sample
+    WriteLE16(header + 34, 16);          // Bits per channel
+    memcpy(header + 36, "data", 4);
+    WriteLE32(header + 40, nsamples * 4);
+
+    fwrite(header, 1, sizeof(header), stream);
+}
+
+static int CompareTimes(const void *a, const void *b)
+{
+    uint64_t ta = *(const uint64_t *) a;
+    uint64_t tb = *(const uint64_t *) b;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+static lumpindex_t FindSong(const char *name)
+{
+    lumpindex_t lump;
+    char *music_name;
+
+    lump = W_CheckNumForName(name);
+
+    // Allow the "d_" prefix to be left out, as with -music in the
+    // games.
+
+    if (lump < 0)
+    {
+        music_name = M_StringJoin("d_", name, nullptr);
+        lump = W_CheckNumForName(music_name);
+        free(music_name);
+    }
+
+    return lump;
+}
+
+// Set up the sound effects given with -sfx, starting at argument p.
+
+static void LoadSfx(int p)
+{
+#ifdef DISABLE_SDL2MIXER
+    I_Error("Sound effects need the software mixer, which needs SDL_mixer");
+#endif
+
+    sfx = static_cast<sfxinfo_t *>(calloc(myargc - p, sizeof(sfxinfo_t)));
+
+    if (sfx == nullptr)
+    {
+        I_Error("Failed to allocate %d sound effects", myargc - p);
+    }
+
+    for (num_sfx = 0; p < myargc && myargv[p][0] != '-'; ++p, ++num_sfx)
+    {
+        if (W_CheckNumForName(myargv[p]) < 0)
+        {
+            I_Error("Sound lump '%s' not found", myargv[p]);
+        }
+
+        M_StringCopy(sfx[num_sfx].name, myargv[p], sizeof(sfx[num_sfx].name));
+    }
+}
+
+// Start the next sound effect, panned across the stereo field in turn.
+
+static void StartSfx(void)
+{
+    sfxinfo_t *s;
+    int sep;
+
+    s = &sfx[sfx_started % num_sfx];
+    sep = (sfx_started * 64) % 255;
+
+    sound_softmix_module.StartSound(s, sfx_started % sfx_channels, 127, sep,
+                                    NORM_PITCH);
+    ++sfx_started;
+}
+
+// Render nsamples samples: the music, with the sound effects mixed on
+// top. Sound effects start at the right sample however the output is
+// split into blocks.
+
+static void RenderSamples(int16_t *buffer, unsigned int nsamples)
+{
+    unsigned int n;
+
+    while (nsamples > 0)
+    {
+        n = nsamples;
+
+        if (num_sfx > 0)
+        {
+            if (render_sample == next_sfx_sample)
+            {
+                StartSfx();
+                next_sfx_sample += sfx_interval;
+            }
+
+            if (next_sfx_sample - render_sample < n)
+            {
+                n = next_sfx_sample - render_sample;
+            }
+        }
+
+        // Silence if there is no song.
+
+        OPL_Render(buffer, n);
+
+        if (num_sfx > 0)
+        {
+            I_SoftMix_Render(buffer, n);
+        }
+
+        buffer += n * 2;
+        nsamples -= n;
+        render_sample += n;
+    }
+
+    // Release the sounds that have finished.
+
+    if (num_sfx > 0)
+    {
+        sound_softmix_module.Update();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *output_name;
+    FILE *output;
+    lumpindex_t lump;
+    byte *data;
+    int len;
+    void *handle;
+    boolean looping;
+    unsigned int block_size, num_blocks, nsamples, i, j;
+    int volume;
+    uint64_t song_length, start, elapsed, total, *block_times;
+    double freq, seconds, render_seconds;
+    int16_t *buffer;
+    int p;
+
+    myargc = argc;
+    myargv = argv;
+
+    Z_Init();
+
+    //!
+    // @arg <file>
+    //
+    // WAD file to load. More can be given with -file.
+    //
+
+    p = M_CheckParmWithArgs("-iwad", 1);
+
+    if (p == 0)
+    {
+        printf("Usage: %s -iwad <wad> [-file <pwads>] [-song <lump>] "
+               "[-sfx <lumps>] [-output <file.wav>]\n"
+               "       [-rate <hz>] [-seconds <n>] [-loop] "
+               "[-blocksize <samples>] [-volume <0-127>]\n"
+               "       [-sfxinterval <ms>] [-sfxchannels <n>]\n", argv[0]);
+        exit(1);
+    }
+
+    if (W_AddFile(myargv[p + 1]) == nullptr)
+    {
+        I_Error("Failed to open %s", myargv[p + 1]);
+    }
+
+    //!
+    // @arg <files>
+    //
+    // PWAD files to load after the IWAD.
+    //
+
+    p = M_CheckParmWithArgs("-file", 1);
+
+    if (p > 0)
+    {
+        for (++p; p < myargc && myargv[p][0] != '-'; ++p)
+        {
+            if (W_AddFile(myargv[p]) == nullptr)
+            {
+                I_Error("Failed to open %s", myargv[p]);
+            }
+        }
+    }
+
+    W_GenerateHashTable();
+
+    //!
+    // @arg <lump>
+    //
+    // Music lump to play, with or without the "d_" prefix.
+    //
+
+    p = M_CheckParmWithArgs("-song", 1);
+    lump = -1;
+
+    if (p > 0)
+    {
+        lump = FindSong(myargv[p + 1]);
+
+        if (lump < 0)
+        {
+            I_Error("Music lump '%s' not found", myargv[p + 1]);
+        }
+    }
+
+    //!
+    // @arg <lumps>
+    //
+    // Sound effect lumps to play, with their full lump names, one
+    // after another through the software mixer.
+    //
+
+    p = M_CheckParmWithArgs("-sfx", 1);
+
+    if (p > 0)
+    {
+        LoadSfx(p + 1);
+    }
+
+    if (lump < 0 && num_sfx == 0)
+    {
+        I_Error("Nothing to play; use -song <lump> or -sfx <lumps>");
+    }
+
+    //!
+    // @arg <file>
+    //
+    // WAV file to write (default render.wav).
+    //
+
+    output_name = "render.wav";
+    p = M_CheckParmWithArgs("-output", 1);
+
+    if (p > 0)
+    {
+        output_name = myargv[p + 1];
+    }
+
+    //!
+    // @arg <hz>
+    //
+    // Output sample rate (default 44100).
+    //
+
+    p = M_CheckParmWithArgs("-rate", 1);
+
+    if (p > 0)
+    {
+        snd_samplerate = atoi(myargv[p + 1]);
+    }
+
+    //!
+    // @arg <samples>
+    //
+    // Number of samples rendered at a time, and timed (default 512).
+    //
+
+    block_size = DEFAULT_BLOCK_SIZE;
+    p = M_CheckParmWithArgs("-blocksize", 1);
+
+    if (p > 0)
+    {
+        block_size = atoi(myargv[p + 1]);
+    }
+
+    //!
+    // @arg <volume>
+    //
+    // Music volume, 0-127 (default 127).
+    //
+
+    volume = 127;
+    p = M_CheckParmWithArgs("-volume", 1);
+
+    if (p > 0)
+    {
+        volume = atoi(myargv[p + 1]);
+    }
+
+    //!
+    //
+    // Play the song looping, as the games do.
+    //
+
+    looping = M_ParmExists("-loop");
+
+    //!
+    // @arg <ms>
+    //
+    // Time between the starts of sound effects (default 250).
+    //
+
+    sfx_interval = DEFAULT_SFX_INTERVAL;
+    p = M_CheckParmWithArgs("-sfxinterval", 1);
+
+    if (p > 0)
+    {
+        sfx_interval = atoi(myargv[p + 1]);
+    }
+
+    //!
+    // @arg <n>
+    //
+    // Number of channels that sound effects are played on in turn, so
+    // that up to this many play at once (default 8).
+    //
+
+    sfx_channels = DEFAULT_SFX_CHANNELS;
+    p = M_CheckParmWithArgs("-sfxchannels", 1);
+
+    if (p > 0)
+    {
+        sfx_channels = atoi(myargv[p + 1]);
+    }
+
+    if (snd_samplerate < 8000 || block_size < 1 || volume < 0 || volume > 127
+     || sfx_interval < 1 || sfx_channels < 1
+     || sfx_channels > SOFTMIX_MAX_VOICES)
+    {
+        I_Error("Invalid -rate, -blocksize, -volume, -sfxinterval or "
+                "-sfxchannels");
+    }
+
+    sfx_interval = (sfx_interval * snd_samplerate) / 1000;
+
+    if (sfx_interval < 1)
+    {
+        sfx_interval = 1;
+    }
+
+    data = nullptr;
+    len = 0;
+
+    if (lump >= 0)
+    {
+        data = W_CacheLumpNum_cast<byte *>(lump, PU_STATIC);
+        len = W_LumpLength(lump);
+    }
+
+    //!
+    // @arg <n>
+    //
+    // Number of seconds to render. The default is the length of the
+    // song and a short tail, or a minute with -loop or without a song.
+    //
+
+    p = M_CheckParmWithArgs("-seconds", 1);
+
+    if (p > 0)
+    {
+        seconds = atof(myargv[p + 1]);
+    }
+    else if (looping || lump < 0)
+    {
+        seconds = DEFAULT_LOOP_SECONDS;
+    }
+    else
+    {
+        song_length = SongLength(data, len);
+        seconds = (double) song_length / OPL_SECOND + TAIL_SECONDS;
+    }
+
+    nsamples = (unsigned int) (seconds * snd_samplerate);
+    num_blocks = (nsamples + block_size - 1) / block_size;
+
+    // Play the song through the render driver.
+
+    handle = nullptr;
+
+    if (lump >= 0)
+    {
+        putenv(opl_driver_env);
+
+        if (!music_opl_module.Init())
+        {
+            I_Error("Failed to initialize OPL music");
+        }
+
+        music_opl_module.SetMusicVolume(volume);
+
+        handle = music_opl_module.RegisterSong(data, len);
+
+        if (handle == nullptr)
+        {
+            I_Error("Failed to load music lump %s", lumpinfo[lump]->name);
+        }
+    }
+
+    // Load the sound effects before rendering starts, so that it is not
+    // timed.
+
+    if (num_sfx > 0)
+    {
+        I_SoftMix_InitRender(snd_samplerate);
+        sound_softmix_module.CacheSounds(sfx, num_sfx);
+    }
+
+    output = M_fopen(output_name, "wb");
+
+    if (output == nullptr)
+    {
+        I_Error("Failed to open %s for writing", output_name);
+    }
+
+    WriteWAVHeader(output, snd_samplerate, nsamples);
+
+    buffer = static_cast<int16_t *>(malloc(block_size * 4));
+    block_times = static_cast<uint64_t *>(malloc(num_blocks * sizeof(uint64_t)));
+
+    if (handle != nullptr)
+    {
+        music_opl_module.PlaySong(handle, looping);
+    }
+
+    freq = (double) SDL_GetPerformanceFrequency();
+    total = 0;
+
+    for (i = 0; i < num_blocks; ++i)
+    {
+        len = nsamples - i * block_size;
+
+        if (len > (int) block_size)
+        {
+            len = block_size;
+        }
+
+        start = SDL_GetPerformanceCounter();
+        RenderSamples(buffer, len);
+        elapsed = SDL_GetPerformanceCounter() - start;
+
+        block_times[i] = elapsed;
+        total += elapsed;
+
+        for (j = 0; j < (unsigned int) len * 2; ++j)
+        {
+            buffer[j] = SHORT(buffer[j]);
+        }
+
+        fwrite(buffer, 4, len, output);
+    }
+
+    fclose(output);
+
+    if (handle != nullptr)
+    {
+        music_opl_module.StopSong();
+        music_opl_module.UnRegisterSong(handle);
+        music_opl_module.Shutdown();
+    }
+
+    if (num_sfx > 0)
+    {
+        sound_softmix_module.Shutdown();
+    }
+
+    // Report.
+
+    render_seconds = total / freq;
+
+    printf("%s: %u samples at %i Hz (%.2f s) in %.3f s, "
+           "%.1fx real time\n",
+           output_name, nsamples, snd_samplerate,
+           (double) nsamples / snd_samplerate, render_seconds,
+           render_seconds > 0 ? nsamples / (snd_samplerate * render_seconds)
+                              : 0.0);
+
+    if (num_blocks > 0)
+    {
+        qsort(block_times, num_blocks, sizeof(uint64_t), CompareTimes);
+
+        printf("Block of %u samples (%.2f ms of audio): "
+               "mean %.1f us, median %.1f us, 99%% %.1f us, max %.1f us\n",
+               block_size, 1000.0 * block_size / snd_samplerate,
+               1e6 * render_seconds / num_blocks,
+               1e6 * block_times[num_blocks / 2] / freq,
+               1e6 * block_times[(num_blocks * 99) / 100] / freq,
+               1e6 * block_times[num_blocks - 1] / freq);
+    }
+
+    free(buffer);
+    free(block_times);
+    free(sfx);
+
+    return 0;
+}
@@ -19,11 +19,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <atomic>
+
+#include <SDL.h>
 
 #include "deh_str.hpp"
 #include "doomkeys.hpp"
 #include "d_iwad.hpp"
+#include "i_glob.hpp"
 #include "i_system.hpp"
 #include "m_argv.hpp"
 #include "m_config.hpp"
@@ -484,6 +492,603 @@ static void CheckDOSDefaults(void)
 
 #endif
 
+// Index of the files in each IWAD directory.
+//
+// Probing every directory for every case variation of every IWAD name
+// takes hundreds of stat calls, which is slow on network filesystems.
+// Instead each directory is listed once, with all directories read at
+// the same time, and the listings are saved in the config directory so
+// that the next run only needs the modification time of each directory.
+
+#define IWADINDEX_FILENAME  "iwadindex.dat"
+#define IWADINDEX_MAGIC     "CRIWDIDX"
+#define IWADINDEX_VERSION   1
+#define IWADINDEX_THREADS   8
+#define IWADINDEX_MAX_SIZE  (1 << 20)
+
+typedef enum
+{
+    INDEX_MISSING,
+    INDEX_FILE,
+    INDEX_DIRECTORY,
+    // The directory exists but could not be listed; its files are
+    // probed for as they are looked up.
+    INDEX_UNLISTED,
+} index_state_t;
+
+typedef struct
+{
+    char magic[8];
+    int version;
+    int num_dirs;
+} iwadindex_header_t;
+
+// Each directory in the file is followed by its path and then
+// names_len bytes of filenames, each terminated by a NUL.
+
+typedef struct
+{
+    int64_t mtime;
+    int64_t scanned;
+    int path_len;
+    int names_len;
+} iwadindex_dir_t;
+
+typedef struct
+{
+    char *path;
+    int64_t mtime;
+    int64_t scanned;
+    char *names;
+    int names_len;
+    boolean used;
+} cached_dir_t;
+
+typedef struct
+{
+    const char *dir;
+    index_state_t state;
+    int64_t mtime;
+
+    // When the directory was listed. A file created in the same second
+    // as the last change may be missing from the listing, so it is only
+    // reused if it was made after the modification time.
+    int64_t scanned;
+
+    char *names;
+    int names_len;
+    const char **sorted;
+    int num_names;
+
+    cached_dir_t *cached;
+    boolean rescanned;
+} dir_index_t;
+
+static dir_index_t *dir_index;
+
+static cached_dir_t *cached_dirs;
+static int num_cached_dirs;
+
+static std::atomic<int> index_next;
+
+// Only absolute paths are kept in the index file: the others depend on
+// the current directory.
+
+static boolean IsAbsolutePath(const char *path)
+{
+#ifdef _WIN32
+    return path[0] == '\\' || path[0] == '/'
+        || (path[0] != '\0' && path[1] == ':');
+#else
+    return path[0] == '/';
+#endif
+}
+
+static char *IndexPath(void)
+{
+    return M_StringJoin(configdir, IWADINDEX_FILENAME, nullptr);
+}
+
+static void LoadIndexFile(void)
+{
+    iwadindex_header_t header;
+    iwadindex_dir_t dir;
+    cached_dir_t *cached;
+    char *filename;
+    FILE *handle;
+    int i;
+
+    filename = IndexPath();
+    handle = M_fopen(filename, "rb");
+    free(filename);
+
+    if (handle == nullptr)
+    {
+        return;
+    }
+
+    if (fread(&header, sizeof(header), 1, handle) != 1
+     || memcmp(header.magic, IWADINDEX_MAGIC, sizeof(header.magic)) != 0
+     || header.version != IWADINDEX_VERSION
+     || header.num_dirs < 0 || header.num_dirs > MAX_IWAD_DIRS)
+    {
+        fclose(handle);
+        return;
+    }
+
+    cached_dirs = static_cast<cached_dir_t *>(
+        calloc(header.num_dirs, sizeof(*cached_dirs)));
+
+    for (i = 0; cached_dirs != nullptr && i < header.num_dirs; ++i)
+    {
+        cached = &cached_dirs[num_cached_dirs];
+
+        if (fread(&dir, sizeof(dir), 1, handle) != 1
+         || dir.path_len <= 0 || dir.path_len > IWADINDEX_MAX_SIZE
+         || dir.names_len < 0 || dir.names_len > IWADINDEX_MAX_SIZE)
+        {
+            break;
+        }
+
+        cached->path = static_cast<char *>(malloc(dir.path_len + 1));
+        cached->names = static_cast<char *>(malloc(dir.names_len + 1));
+
+        if (cached->path == nullptr || cached->names == nullptr
+         || fread(cached->path, 1, dir.path_len, handle)
+                != (size_t) dir.path_len
+         || fread(cached->names, 1, dir.names_len, handle)
+                != (size_t) dir.names_len
+         || (dir.names_len > 0 && cached->names[dir.names_len - 1] != '\0'))
+        {
+            free(cached->path);
+            free(cached->names);
+            break;
+        }
+
+        cached->path[dir.path_len] = '\0';
+        cached->mtime = dir.mtime;
+        cached->scanned = dir.scanned;
+        cached->names_len = dir.names_len;
+        ++num_cached_dirs;
+    }
+
+    fclose(handle);
+}
+
+static void FreeCachedDirs(void)
+{
+    int i;
+
+    for (i = 0; i < num_cached_dirs; ++i)
+    {
+        free(cached_dirs[i].path);
+        free(cached_dirs[i].names);
+    }
+
+    free(cached_dirs);
+    cached_dirs = nullptr;
+    num_cached_dirs = 0;
+}
+
+static cached_dir_t *FindCachedDir(const char *dir)
+{
+    int i;
+
+    if (!IsAbsolutePath(dir))
+    {
+        return nullptr;
+    }
+
+    for (i = 0; i < num_cached_dirs; ++i)
+    {
+        // A directory listed twice in the search path gets the cached
+        // listing only the first time.
+
+        if (!cached_dirs[i].used && !strcmp(cached_dirs[i].path, dir))
+        {
+            cached_dirs[i].used = true;
+            return &cached_dirs[i];
+        }
+    }
+
+    return nullptr;
+}
+
+// Whether the index of the given directory should be saved: not the
+// second time that it appears in the search path.
+
+static boolean SaveDirIndex(int i)
+{
+    int j;
+
+    if (dir_index[i].state != INDEX_DIRECTORY
+     || !IsAbsolutePath(dir_index[i].dir))
+    {
+        return false;
+    }
+
+    for (j = 0; j < i; ++j)
+    {
+        if (!strcmp(dir_index[i].dir, dir_index[j].dir))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void SaveIndexFile(void)
+{
+    iwadindex_header_t header;
+    iwadindex_dir_t dir;
+    char *filename, *tempname;
+    FILE *handle;
+    boolean ok;
+    int i, j;
+
+    filename = IndexPath();
+    tempname = M_StringJoin(filename, ".tmp", nullptr);
+    handle = M_fopen(tempname, "wb");
+
+    if (handle == nullptr)
+    {
+        free(tempname);
+        free(filename);
+        return;
+    }
+
+    memcpy(header.magic, IWADINDEX_MAGIC, sizeof(header.magic));
+    header.version = IWADINDEX_VERSION;
+    header.num_dirs = 0;
+
+    for (i = 0; i < num_iwad_dirs; ++i)
+    {
+        header.num_dirs += SaveDirIndex(i);
+    }
+
+    ok = fwrite(&header, sizeof(header), 1, handle) == 1;
+
+    for (i = 0; ok && i < num_iwad_dirs; ++i)
+    {
+        if (!SaveDirIndex(i))
+        {
+            continue;
+        }
+
+        dir.mtime = dir_index[i].mtime;
+        dir.scanned = dir_index[i].scanned;
+        dir.path_len = strlen(dir_index[i].dir);
+        dir.names_len = dir_index[i].names_len;
+
+        ok = fwrite(&dir, sizeof(dir), 1, handle) == 1
+          && fwrite(dir_index[i].dir, 1, dir.path_len, handle)
+                 == (size_t) dir.path_len;
+
+        // Names are written in sorted order, so that the listing in
+        // the file is the same however the directory returned them.
+
+        for (j = 0; ok && j < dir_index[i].num_names; ++j)
+        {
+            ok = fwrite(dir_index[i].sorted[j], 1,
+                        strlen(dir_index[i].sorted[j]) + 1, handle) > 0;
+        }
+    }
+
+    // Write to a temporary file first, so that another instance
+    // starting at the same time never sees half an index file.
+    if (fclose(handle) == 0 && ok)
+    {
+        M_remove(filename);
+        M_rename(tempname, filename);
+    }
+    else
+    {
+        M_remove(tempname);
+    }
+
+    free(tempname);
+    free(filename);
+}
+
+static int CompareNames(const void *a, const void *b)
+{
+    return strcmp(*static_cast<const char * const *>(a),
+                  *static_cast<const char * const *>(b));
+}
+
+static void SortIndexNames(dir_index_t *index)
+{
+    const char *p, *end;
+    int i;
+
+    index->num_names = 0;
+
+    for (i = 0; i < index->names_len; ++i)
+    {
+        index->num_names += index->names[i] == '\0';
+    }
+
+    index->sorted = static_cast<const char **>(
+        malloc((index->num_names + 1) * sizeof(*index->sorted)));
+
+    if (index->sorted == nullptr)
+    {
+        index->state = INDEX_UNLISTED;
+        index->num_names = 0;
+        return;
+    }
+
+    p = index->names;
+    end = index->names + index->names_len;
+
+    for (i = 0; p < end; ++i)
+    {
+        index->sorted[i] = p;
+        p += strlen(p) + 1;
+    }
+
+    qsort(index->sorted, index->num_names, sizeof(*index->sorted),
+          CompareNames);
+}
+
+// Read the names of the files in a directory. This runs on the index
+// threads, so it must not use the zone memory allocator.
+
+static void ListDirectory(dir_index_t *index)
+{
+    glob_t *glob;
+    const char *filename;
+    char *names;
+    size_t len, size;
+
+    glob = I_StartGlob(index->dir, "*", 0);
+
+    if (glob == nullptr)
+    {
+        index->state = INDEX_UNLISTED;
+        return;
+    }
+
+    index->names = nullptr;
+    index->names_len = 0;
+    size = 0;
+
+    while ((filename = I_NextGlob(glob)) != nullptr)
+    {
+        filename = M_BaseName(filename);
+        len = strlen(filename) + 1;
+
+        if (index->names_len + len > size)
+        {
+            size = (size + len) * 2;
+            names = static_cast<char *>(realloc(index->names, size));
+
+            if (names == nullptr)
+            {
+                index->state = INDEX_UNLISTED;
+                break;
+            }
+
+            index->names = names;
+        }
+
+        memcpy(index->names + index->names_len, filename, len);
+        index->names_len += len;
+    }
+
+    I_EndGlob(glob);
+}
+
+static void IndexDirectory(dir_index_t *index)
+{
+    struct stat st;
+
+    if (M_stat(index->dir, &st) != 0)
+    {
+        index->state = INDEX_MISSING;
+        return;
+    }
+
+    if ((st.st_mode & S_IFMT) != S_IFDIR)
+    {
+        index->state = INDEX_FILE;
+        return;
+    }
+
+    index->state = INDEX_DIRECTORY;
+    index->mtime = st.st_mtime;
+
+    if (index->cached != nullptr
+     && index->cached->mtime == index->mtime
+     && index->cached->scanned > index->mtime)
+    {
+        index->scanned = index->cached->scanned;
+        index->names = index->cached->names;
+        index->names_len = index->cached->names_len;
+        index->cached->names = nullptr;
+    }
+    else
+    {
+        index->scanned = time(nullptr);
+        index->rescanned = true;
+        ListDirectory(index);
+    }
+
+    if (index->state == INDEX_DIRECTORY)
+    {
+        SortIndexNames(index);
+    }
+}
+
+static int IndexThread(void *unused)
+{
+    int i;
+
+    while ((i = index_next.fetch_add(1)) < num_iwad_dirs)
+    {
+        IndexDirectory(&dir_index[i]);
+    }
+
+    return 0;
+}
+
+static void BuildIWADIndex(void)
+{
+    SDL_Thread *threads[IWADINDEX_THREADS];
+    boolean usecache, changed;
+    int num_threads;
+    int i;
+
+    //!
+    // @category obscure
+    //
+    // Don't use the index of the IWAD search directories that is kept
+    // in the config directory; list every directory again.
+    //
+
+    usecache = !M_ParmExists("-noiwadcache") && configdir != nullptr;
+
+    if (usecache)
+    {
+        LoadIndexFile();
+    }
+
+    dir_index = static_cast<dir_index_t *>(
+        calloc(num_iwad_dirs, sizeof(*dir_index)));
+
+    if (dir_index == nullptr)
+    {
+        I_Error("BuildIWADIndex: Failed to allocate the IWAD index");
+    }
+
+    for (i = 0; i < num_iwad_dirs; ++i)
+    {
+        dir_index[i].dir = iwad_dirs[i];
+        dir_index[i].cached = FindCachedDir(iwad_dirs[i]);
+    }
+
+    // Most of the time is spent waiting on the filesystem, so the
+    // directories are all read at the same time, this thread included.
+
+    index_next.store(0);
+
+    for (num_threads = 0;
+         num_threads < IWADINDEX_THREADS && num_threads < num_iwad_dirs - 1;
+         ++num_threads)
+    {
+        threads[num_threads] =
+            SDL_CreateThread(IndexThread, "iwadindex", nullptr);
+
+        if (threads[num_threads] == nullptr)
+        {
+            break;
+        }
+    }
+
+    IndexThread(nullptr);
+
+    for (i = 0; i < num_threads; ++i)
+    {
+        SDL_WaitThread(threads[i], nullptr);
+    }
+
+    // Save the index again if any directory had to be listed or is no
+    // longer in the search path.
+
+    changed = false;
+
+    for (i = 0; i < num_iwad_dirs; ++i)
+    {
+        changed = changed || (dir_index[i].rescanned && SaveDirIndex(i));
+    }
+
+    for (i = 0; i < num_cached_dirs; ++i)
+    {
+        changed = changed || !cached_dirs[i].used;
+    }
+
+    if (usecache && changed)
+    {
+        SaveIndexFile();
+    }
+
+    FreeCachedDirs();
+}
+
+static const char *FindSortedName(const dir_index_t *index, const char *name)
+{
+    const char **result;
+
+    result = static_cast<const char **>(
+        bsearch(&name, index->sorted, index->num_names,
+                sizeof(*index->sorted), CompareNames));
+
+    return result != nullptr ? *result : nullptr;
+}
+
+// Look up a filename in a directory index, trying the same case
+// variations as M_FileCaseExists() in the same order. On a
+// case-insensitive filesystem any other case matches as well.
+
+static const char *FindIndexedName(const dir_index_t *index, const char *name)
+{
+    const char *result;
+    char *probe, *ext;
+#if defined(_WIN32) || defined(__MACOSX__)
+    int i;
+#endif
+
+    result = FindSortedName(index, name);
+
+    if (result != nullptr)
+    {
+        return result;
+    }
+
+    probe = M_StringDuplicate(name);
+
+    // lowercase filename, e.g. doom2.wad
+    M_ForceLowercase(probe);
+    result = FindSortedName(index, probe);
+
+    // uppercase filename, e.g. DOOM2.WAD
+    if (result == nullptr)
+    {
+        M_ForceUppercase(probe);
+        result = FindSortedName(index, probe);
+    }
+
+    // uppercase basename with lowercase extension, e.g. DOOM2.wad
+    ext = strrchr(probe, '.');
+    if (result == nullptr && ext != nullptr && ext > probe)
+    {
+        M_ForceLowercase(ext + 1);
+        result = FindSortedName(index, probe);
+    }
+
+    // lowercase filename with uppercase first letter, e.g. Doom2.wad
+    if (result == nullptr && probe[0] != '\0')
+    {
+        M_ForceLowercase(probe + 1);
+        result = FindSortedName(index, probe);
+    }
+
+    free(probe);
+
+#if defined(_WIN32) || defined(__MACOSX__)
+    for (i = 0; result == nullptr && i < index->num_names; ++i)
+    {
+        if (!strcasecmp(index->sorted[i], name))
+        {
+            result = index->sorted[i];
+        }
+    }
+#endif
+
+    return result;
+}
+
 // Returns true if the specified path is a path to a file
 // of the specified name.
 
@@ -497,18 +1102,49 @@ static boolean DirIsFile(const char *path, const char *filename)
 // file, returning the full path to the IWAD if found, or nullptr
 // if not found.
 
-static char *CheckDirectoryHasIWAD(const char *dir, const char *iwadname)
+static char *CheckDirectoryHasIWAD(const dir_index_t *index,
+                                   const char *iwadname)
 {
-    char *filename; 
+    const char *dir = index->dir;
+    const char *found;
+    char *filename;
     char *probe;
 
     // As a special case, the "directory" may refer directly to an
     // IWAD file if the path comes from DOOMWADDIR or DOOMWADPATH.
 
-    probe = M_FileCaseExists(dir);
-    if (DirIsFile(dir, iwadname) && probe != nullptr)
+    if (DirIsFile(dir, iwadname))
     {
-        return probe;
+        if (index->state == INDEX_FILE)
+        {
+            return M_StringDuplicate(dir);
+        }
+        else if (index->state == INDEX_MISSING)
+        {
+            return M_FileCaseExists(dir);
+        }
+    }
+
+    if (index->state == INDEX_DIRECTORY)
+    {
+        found = FindIndexedName(index, iwadname);
+
+        if (found == nullptr)
+        {
+            return nullptr;
+        }
+        else if (!strcmp(dir, "."))
+        {
+            return M_StringDuplicate(found);
+        }
+        else
+        {
+            return M_StringJoin(dir, DIR_SEPARATOR_S, found, nullptr);
+        }
+    }
+    else if (index->state != INDEX_UNLISTED)
+    {
+        return nullptr;
     }
 
     // Construct the full path to the IWAD if it is located in
@@ -523,21 +1159,17 @@ static char *CheckDirectoryHasIWAD(const char *dir, const char *iwadname)
         filename = M_StringJoin(dir, DIR_SEPARATOR_S, iwadname, nullptr);
     }
 
-    free(probe);
     probe = M_FileCaseExists(filename);
     free(filename);
-    if (probe != nullptr)
-    {
-        return probe;
-    }
 
-    return nullptr;
+    return probe;
 }
 
 // Search a directory to try to find an IWAD
 // Returns the location of the IWAD if found, otherwise nullptr.
 
-static char *SearchDirectoryForIWAD(const char *dir, int mask, GameMission_t *mission)
+static char *SearchDirectoryForIWAD(const dir_index_t *index, int mask,
+                                    GameMission_t *mission)
 {
     char *filename;
     
@@ -550,7 +1182,7 @@ static char *SearchDirectoryForIWAD(const char *dir, int mask, GameMission_t *mi
             continue;
         }
 
-        filename = CheckDirectoryHasIWAD(dir, DEH_String(iwads[i].name));
+        filename = CheckDirectoryHasIWAD(index, DEH_String(iwads[i].name));
 
         if (filename != nullptr)
         {
@@ -779,6 +1411,8 @@ static void BuildIWADDirList(void)
 #endif
 #endif
 
+    BuildIWADIndex();
+
     // Don't run this function again.
 
     iwad_dirs_built = true;
@@ -793,7 +1427,26 @@ char *D_FindWADByName(const char *name)
     char *path;
     char *probe;
     int i;
-    
+
+    BuildIWADDirList();
+
+    // A bare filename is looked up in the index of each directory,
+    // the first of which is the current directory.
+
+    if (strpbrk(name, "/" DIR_SEPARATOR_S) == nullptr)
+    {
+        for (i=0; i<num_iwad_dirs; ++i)
+        {
+            probe = CheckDirectoryHasIWAD(&dir_index[i], name);
+            if (probe != nullptr)
+            {
+                return probe;
+            }
+        }
+
+        return nullptr;
+    }
+
     // Absolute path?
 
     probe = M_FileCaseExists(name);
@@ -802,34 +1455,21 @@ char *D_FindWADByName(const char *name)
         return probe;
     }
 
-    BuildIWADDirList();
-
     // Search through all IWAD paths for a file with the given name.
 
     for (i=0; i<num_iwad_dirs; ++i)
     {
-        // As a special case, if this is in DOOMWADDIR or DOOMWADPATH,
-        // the "directory" may actually refer directly to an IWAD
-        // file.
-
-        probe = M_FileCaseExists(iwad_dirs[i]);
-        if (DirIsFile(iwad_dirs[i], name) && probe != nullptr)
-        {
-            return probe;
-        }
-        free(probe);
-
         // Construct a string for the full path
 
         path = M_StringJoin(iwad_dirs[i], DIR_SEPARATOR_S, name, nullptr);
 
         probe = M_FileCaseExists(path);
+        free(path);
+
         if (probe != nullptr)
         {
             return probe;
         }
-
-        free(path);
     }
 
     // File not found
@@ -909,7 +1549,7 @@ char *D_FindIWAD(int mask, GameMission_t *mission)
     
         for (i=0; result == nullptr && i<num_iwad_dirs; ++i)
         {
-            result = SearchDirectoryForIWAD(iwad_dirs[i], mask, mission);
+            result = SearchDirectoryForIWAD(&dir_index[i], mask, mission);
         }
     }
 
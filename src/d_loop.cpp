@@ -32,6 +32,7 @@
 
 #include "net_client.hpp"
 #include "net_gui.hpp"
+#include "net_impair.hpp"
 #include "net_io.hpp"
 #include "net_query.hpp"
 #include "net_server.hpp"
@@ -450,8 +451,8 @@ boolean D_InitNetGame(net_connect_data_t *connect_data)
      || M_CheckParm("-privateserver") > 0)
     {
         NET_SV_Init();
-        NET_SV_AddModule(&net_loop_server_module);
-        NET_SV_AddModule(&net_sdl_module);
+        NET_SV_AddModule(NET_Impair_CheckModule(&net_loop_server_module));
+        NET_SV_AddModule(NET_Impair_CheckModule(&net_sdl_module));
         NET_SV_RegisterWithMaster();
 
         net_loop_client_module.InitClient();
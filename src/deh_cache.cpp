@@ -0,0 +1,998 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// Cache of dehacked patches in compiled form
+//
+// Parsing a large patch line by line at every start takes a while. The
+// sections register the tables that they change, and when a patch is
+// parsed, the bytes it changed in them and the strings it replaced are
+// saved to the config directory. The next time the same patch is
+// loaded on top of the same tables, those changes are copied straight
+// back in.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.hpp"
+#include "i_system.hpp"
+#include "m_argv.hpp"
+#include "m_config.hpp"
+#include "m_misc.hpp"
+#include "sha1.hpp"
+
+#include "deh_cache.hpp"
+#include "deh_defs.hpp"
+#include "deh_io.hpp"
+#include "deh_main.hpp"
+#include "deh_str.hpp"
+
+#define DEHCACHE_FILENAME     "dehcache.dat"
+#define DEHCACHE_MAGIC        "CRDEHCCH"
+#define DEHCACHE_VERSION      1
+#define DEHCACHE_MAX_PATCHES  32
+
+typedef struct
+{
+    char magic[8];
+    int version;
+    int numpatches;
+} dehcache_header_t;
+
+// A compiled patch is a list of changes, each a cache_op_t followed by
+// length bytes of data.
+
+typedef enum
+{
+    DEHCACHE_OP_BYTES,          // data goes at offset in the element
+    DEHCACHE_OP_INDEX,          // offset is the table index to use
+    DEHCACHE_OP_STRING,         // data is the two strings, offset is
+                                // the length of the first
+} cache_op_type_t;
+
+typedef struct
+{
+    int type;
+    int region;
+    int element;
+    int offset;
+    int length;
+} cache_op_t;
+
+typedef struct
+{
+    uint64_t value;
+    int index;
+} table_entry_t;
+
+typedef struct
+{
+    byte *base;
+    size_t len;
+    int count;
+    size_t stride;
+
+    // Where the region starts in the snapshot.
+    size_t snapshot_pos;
+
+    // For indexed regions: the table, and its values sorted.
+    const byte *table;
+    int table_len;
+    table_entry_t *sorted;
+    int num_sorted;
+} cache_region_t;
+
+typedef struct
+{
+    sha1_digest_t key;
+    byte *data;
+    int length;
+} cache_patch_t;
+
+static cache_region_t *regions = nullptr;
+static int num_regions = 0;
+
+static boolean cache_checked = false;
+static boolean cache_enabled = false;
+
+// The contents of the cache file.
+
+static cache_patch_t *patches = nullptr;
+static int num_patches = 0;
+static boolean patches_loaded = false;
+
+// The tables as they were before the patch being compiled: the bytes
+// of the plain regions one element after the other, and the table
+// indexes of the indexed regions.
+
+static byte *snapshot_bytes = nullptr;
+static int *snapshot_indexes = nullptr;
+static size_t snapshot_size;
+static int snapshot_count;
+
+typedef struct
+{
+    const char *from_text;
+    char *to_text;
+} string_snapshot_t;
+
+static string_snapshot_t *snapshot_strings = nullptr;
+static int num_snapshot_strings = 0;
+
+// The patch being compiled. Patches included by it aren't cached on
+// their own, and it isn't cached at all, because its key doesn't cover
+// what they contain.
+
+static int compile_depth = 0;
+static boolean compile_pending = false;
+static boolean compiling = false;
+static boolean compile_ok;
+static sha1_digest_t compile_key;
+
+static cache_region_t *AddRegion(void *base, size_t len, int count,
+                                 size_t stride)
+{
+    cache_region_t *region;
+
+    regions = (decltype(regions)) I_Realloc(regions,
+                                  (num_regions + 1) * sizeof(*regions));
+    region = &regions[num_regions];
+    ++num_regions;
+
+    region->base = static_cast<byte *>(base);
+    region->len = len;
+    region->count = count;
+    region->stride = stride;
+    region->table = nullptr;
+    region->table_len = 0;
+    region->sorted = nullptr;
+    region->num_sorted = 0;
+
+    return region;
+}
+
+static boolean SameRegion(cache_region_t *region, void *base, size_t len,
+                          int count, size_t stride)
+{
+    return region->base == base && region->len == len
+        && region->count == count && region->stride == stride;
+}
+
+void DEH_CacheRegion(void *base, size_t len, int count, size_t stride)
+{
+    int i;
+
+    // Several sections can change the same table.
+
+    for (i = 0; i < num_regions; ++i)
+    {
+        if (SameRegion(&regions[i], base, len, count, stride))
+        {
+            return;
+        }
+    }
+
+    AddRegion(base, len, count, stride);
+}
+
+static uint64_t TableValue(const byte *p, size_t len)
+{
+    uint64_t value = 0;
+
+    memcpy(&value, p, len);
+
+    return value;
+}
+
+static int CompareTableEntries(const void *a, const void *b)
+{
+    const table_entry_t *x = static_cast<const table_entry_t *>(a);
+    const table_entry_t *y = static_cast<const table_entry_t *>(b);
+
+    if (x->value != y->value)
+    {
+        return x->value < y->value ? -1 : 1;
+    }
+
+    return x->index - y->index;
+}
+
+void DEH_CacheIndexedRegion(void *base, size_t len, int count, size_t stride,
+                            const void *table, int table_len)
+{
+    cache_region_t *region;
+    int i, n;
+
+    if (len > sizeof(uint64_t))
+    {
+        I_Error("DEH_CacheIndexedRegion: values of %d bytes are too long",
+                (int) len);
+    }
+
+    for (i = 0; i < num_regions; ++i)
+    {
+        if (regions[i].table != nullptr
+         && SameRegion(&regions[i], base, len, count, stride))
+        {
+            return;
+        }
+    }
+
+    region = AddRegion(base, len, count, stride);
+    region->table = static_cast<const byte *>(table);
+    region->table_len = table_len;
+    region->sorted = static_cast<table_entry_t *>(
+        malloc(table_len * sizeof(*region->sorted)));
+
+    for (i = 0; i < table_len; ++i)
+    {
+        region->sorted[i].value = TableValue(region->table + i * len, len);
+        region->sorted[i].index = i;
+    }
+
+    // Of several entries with the same value, the first one is used.
+
+    qsort(region->sorted, table_len, sizeof(*region->sorted),
+          CompareTableEntries);
+
+    for (i = 0, n = 0; i < table_len; ++i)
+    {
+        if (n == 0 || region->sorted[i].value != region->sorted[n - 1].value)
+        {
+            region->sorted[n++] = region->sorted[i];
+        }
+    }
+
+    region->num_sorted = n;
+}
+
+void DEH_CacheNoRegions(void)
+{
+}
+
+// Index in the table of an indexed region of the value at p, or -1.
+
+static int TableIndex(cache_region_t *region, const byte *p)
+{
+    uint64_t value;
+    int lo, hi, mid;
+
+    value = TableValue(p, region->len);
+    lo = 0;
+    hi = region->num_sorted - 1;
+
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+
+        if (region->sorted[mid].value == value)
+        {
+            return region->sorted[mid].index;
+        }
+        else if (region->sorted[mid].value < value)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
+static byte *ElementAddress(cache_region_t *region, int element)
+{
+    return region->base + element * region->stride;
+}
+
+// If p lies within an element of a plain region, return where it is
+// in the snapshot, otherwise -1.
+
+static long SnapshotOffset(const byte *p, size_t len)
+{
+    cache_region_t *region;
+    size_t offset;
+    int element;
+    int i;
+
+    for (i = 0; i < num_regions; ++i)
+    {
+        region = &regions[i];
+
+        if (region->table != nullptr || p < region->base)
+        {
+            continue;
+        }
+
+        offset = p - region->base;
+        element = region->stride ? offset / region->stride : 0;
+        offset -= element * region->stride;
+
+        if (element < region->count && offset + len <= region->len)
+        {
+            return region->snapshot_pos + element * region->len + offset;
+        }
+    }
+
+    return -1;
+}
+
+// Copy the plain regions to bytes and look up the indexed regions in
+// their tables. The memory of the indexed regions is cleared in the
+// copy: it holds pointers, which differ from one run to the next.
+
+static void TakeSnapshot(byte *bytes, int *indexes)
+{
+    cache_region_t *region;
+    byte *addr;
+    long offset;
+    int i, j;
+
+    for (i = 0; i < num_regions; ++i)
+    {
+        region = &regions[i];
+
+        if (region->table != nullptr)
+        {
+            continue;
+        }
+
+        for (j = 0; j < region->count; ++j)
+        {
+            memcpy(bytes + region->snapshot_pos + j * region->len,
+                   ElementAddress(region, j), region->len);
+        }
+    }
+
+    for (i = 0; i < num_regions; ++i)
+    {
+        region = &regions[i];
+
+        if (region->table == nullptr)
+        {
+            continue;
+        }
+
+        for (j = 0; j < region->count; ++j)
+        {
+            addr = ElementAddress(region, j);
+            indexes[region->snapshot_pos + j] = TableIndex(region, addr);
+            offset = SnapshotOffset(addr, region->len);
+
+            if (offset >= 0)
+            {
+                memset(bytes + offset, 0, region->len);
+            }
+        }
+    }
+}
+
+static boolean CacheEnabled(void)
+{
+    unsigned int i;
+
+    if (cache_checked)
+    {
+        return cache_enabled;
+    }
+
+    cache_checked = true;
+
+    //!
+    // @category obscure
+    //
+    // Don't load dehacked patches from the cache of compiled patches
+    // in the config directory, nor save them there.
+    //
+
+    if (M_ParmExists("-nodehcache") || configdir == nullptr)
+    {
+        return false;
+    }
+
+    for (i = 0; deh_section_types[i] != nullptr; ++i)
+    {
+        if (deh_section_types[i]->cache_regions == nullptr)
+        {
+            return false;
+        }
+    }
+
+    for (i = 0; deh_section_types[i] != nullptr; ++i)
+    {
+        deh_section_types[i]->cache_regions();
+    }
+
+    snapshot_size = 0;
+    snapshot_count = 0;
+
+    for (i = 0; i < (unsigned int) num_regions; ++i)
+    {
+        if (regions[i].table != nullptr)
+        {
+            regions[i].snapshot_pos = snapshot_count;
+            snapshot_count += regions[i].count;
+        }
+        else
+        {
+            regions[i].snapshot_pos = snapshot_size;
+            snapshot_size += regions[i].len * regions[i].count;
+        }
+    }
+
+    snapshot_bytes = static_cast<byte *>(malloc(snapshot_size));
+    snapshot_indexes = static_cast<int *>(
+        malloc(snapshot_count * sizeof(*snapshot_indexes)));
+
+    cache_enabled = snapshot_bytes != nullptr && snapshot_indexes != nullptr;
+
+    return cache_enabled;
+}
+
+// The key of a patch covers its text, the override flags that change
+// how it is parsed, the layout of the regions and their contents before
+// the patch is applied, which are left in the snapshot.
+
+static void PatchKey(deh_context_t *context, sha1_digest_t key)
+{
+    sha1_context_t sha1_context;
+    int i;
+
+    SHA1_Init(&sha1_context);
+    SHA1_UpdateInt32(&sha1_context, DEHCACHE_VERSION);
+    SHA1_UpdateInt32(&sha1_context, deh_apply_cheats);
+    SHA1_UpdateInt32(&sha1_context, deh_allow_long_strings);
+    SHA1_UpdateInt32(&sha1_context, deh_allow_long_cheats);
+    SHA1_UpdateInt32(&sha1_context, deh_allow_extended_strings);
+    DEH_HashInput(context, &sha1_context);
+
+    for (i = 0; i < num_regions; ++i)
+    {
+        SHA1_UpdateInt32(&sha1_context, regions[i].len);
+        SHA1_UpdateInt32(&sha1_context, regions[i].count);
+        SHA1_UpdateInt32(&sha1_context, regions[i].table != nullptr);
+    }
+
+    TakeSnapshot(snapshot_bytes, snapshot_indexes);
+    SHA1_Update(&sha1_context, snapshot_bytes, snapshot_size);
+
+    for (i = 0; i < snapshot_count; ++i)
+    {
+        SHA1_UpdateInt32(&sha1_context, snapshot_indexes[i]);
+    }
+
+    SHA1_Final(key, &sha1_context);
+}
+
+static char *CachePath(void)
+{
+    return M_StringJoin(configdir, DEHCACHE_FILENAME, nullptr);
+}
+
+static void LoadCacheFile(void)
+{
+    dehcache_header_t header;
+    cache_patch_t *patch;
+    char *filename;
+    FILE *handle;
+    int i;
+
+    patches_loaded = true;
+
+    filename = CachePath();
+    handle = M_fopen(filename, "rb");
+    free(filename);
+
+    if (handle == nullptr)
+    {
+        return;
+    }
+
+    if (fread(&header, sizeof(header), 1, handle) != 1
+     || memcmp(header.magic, DEHCACHE_MAGIC, sizeof(header.magic)) != 0
+     || header.version != DEHCACHE_VERSION
+     || header.numpatches < 0 || header.numpatches > DEHCACHE_MAX_PATCHES)
+    {
+        fclose(handle);
+        return;
+    }
+
+    patches = static_cast<cache_patch_t *>(
+        calloc(header.numpatches, sizeof(*patches)));
+
+    for (i = 0; i < header.numpatches; ++i)
+    {
+        patch = &patches[num_patches];
+
+        if (fread(patch->key, sizeof(patch->key), 1, handle) != 1
+         || fread(&patch->length, sizeof(patch->length), 1, handle) != 1
+         || patch->length < 0 || patch->length > M_FileLength(handle))
+        {
+            break;
+        }
+
+        patch->data = static_cast<byte *>(malloc(patch->length));
+
+        if (patch->data == nullptr
+         || fread(patch->data, 1, patch->length, handle)
+                != (size_t) patch->length)
+        {
+            free(patch->data);
+            break;
+        }
+
+        ++num_patches;
+    }
+
+    fclose(handle);
+}
+
+static void SaveCacheFile(void)
+{
+    dehcache_header_t header;
+    char *filename, *tempname;
+    FILE *handle;
+    boolean ok;
+    int i;
+
+    filename = CachePath();
+    tempname = M_StringJoin(filename, ".tmp", nullptr);
+    handle = M_fopen(tempname, "wb");
+
+    if (handle == nullptr)
+    {
+        free(tempname);
+        free(filename);
+        return;
+    }
+
+    memcpy(header.magic, DEHCACHE_MAGIC, sizeof(header.magic));
+    header.version = DEHCACHE_VERSION;
+    header.numpatches = num_patches;
+
+    ok = fwrite(&header, sizeof(header), 1, handle) == 1;
+
+    for (i = 0; ok && i < num_patches; ++i)
+    {
+        ok = fwrite(patches[i].key, sizeof(patches[i].key), 1, handle) == 1
+          && fwrite(&patches[i].length, sizeof(patches[i].length), 1,
+                    handle) == 1
+          && fwrite(patches[i].data, 1, patches[i].length, handle)
+                 == (size_t) patches[i].length;
+    }
+
+    // Write to a temporary file first, so that another instance
+    // starting at the same time never sees half a cache file.
+    if (fclose(handle) == 0 && ok)
+    {
+        M_remove(filename);
+        M_rename(tempname, filename);
+    }
+    else
+    {
+        M_remove(tempname);
+    }
+
+    free(tempname);
+    free(filename);
+}
+
+// Check the changes of a compiled patch, or apply them. They are all
+// checked before any is applied, so that a corrupt cache file can't
+// leave a patch half applied.
+
+static boolean ApplyPatch(const byte *data, int length, boolean apply)
+{
+    const byte *p, *end;
+    cache_region_t *region;
+    cache_op_t op;
+
+    p = data;
+    end = data + length;
+
+    while (p < end)
+    {
+        if ((size_t) (end - p) < sizeof(op))
+        {
+            return false;
+        }
+
+        memcpy(&op, p, sizeof(op));
+        p += sizeof(op);
+
+        if (op.length < 0 || op.length > end - p)
+        {
+            return false;
+        }
+
+        if (op.type == DEHCACHE_OP_STRING)
+        {
+            if (op.offset <= 0 || op.offset >= op.length
+             || p[op.offset - 1] != '\0' || p[op.length - 1] != '\0')
+            {
+                return false;
+            }
+
+            if (apply)
+            {
+                DEH_AddStringReplacement((const char *) p,
+                                         (const char *) p + op.offset);
+            }
+
+            p += op.length;
+            continue;
+        }
+
+        if (op.region < 0 || op.region >= num_regions)
+        {
+            return false;
+        }
+
+        region = &regions[op.region];
+
+        if (op.element < 0 || op.element >= region->count)
+        {
+            return false;
+        }
+
+        if (op.type == DEHCACHE_OP_INDEX)
+        {
+            if (region->table == nullptr || op.length != 0
+             || op.offset < 0 || op.offset >= region->table_len)
+            {
+                return false;
+            }
+
+            if (apply)
+            {
+                memcpy(ElementAddress(region, op.element),
+                       region->table + op.offset * region->len, region->len);
+            }
+        }
+        else if (op.type == DEHCACHE_OP_BYTES)
+        {
+            if (region->table != nullptr || op.offset < 0
+             || (size_t) op.offset + op.length > region->len)
+            {
+                return false;
+            }
+
+            if (apply)
+            {
+                memcpy(ElementAddress(region, op.element) + op.offset,
+                       p, op.length);
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        p += op.length;
+    }
+
+    return true;
+}
+
+boolean DEH_LoadCachedPatch(deh_context_t *context)
+{
+    int i;
+
+    compile_pending = false;
+
+    if (compile_depth > 0)
+    {
+        compile_ok = false;
+        return false;
+    }
+
+    if (!CacheEnabled())
+    {
+        return false;
+    }
+
+    if (!patches_loaded)
+    {
+        LoadCacheFile();
+    }
+
+    PatchKey(context, compile_key);
+
+    for (i = 0; i < num_patches; ++i)
+    {
+        if (memcmp(patches[i].key, compile_key, sizeof(compile_key)) != 0)
+        {
+            continue;
+        }
+
+        if (ApplyPatch(patches[i].data, patches[i].length, false))
+        {
+            ApplyPatch(patches[i].data, patches[i].length, true);
+            return true;
+        }
+
+        fprintf(stderr, "DEH_LoadCachedPatch: ignoring corrupt cache entry\n");
+        break;
+    }
+
+    compile_pending = true;
+
+    return false;
+}
+
+static int CompareStringSnapshots(const void *a, const void *b)
+{
+    uintptr_t x = (uintptr_t) ((const string_snapshot_t *) a)->from_text;
+    uintptr_t y = (uintptr_t) ((const string_snapshot_t *) b)->from_text;
+
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+void DEH_StartPatchCompile(void)
+{
+    const char *from_text, *to_text;
+    int iter;
+
+    ++compile_depth;
+
+    if (compile_depth > 1)
+    {
+        return;
+    }
+
+    compiling = compile_pending;
+    compile_pending = false;
+    compile_ok = true;
+
+    if (!compiling)
+    {
+        return;
+    }
+
+    // The string replacements are kept in a table of their own. Their
+    // original strings are never freed, so they are told apart by
+    // address.
+
+    iter = 0;
+    num_snapshot_strings = 0;
+
+    while (DEH_NextStringReplacement(&iter, &from_text, &to_text))
+    {
+        snapshot_strings = (decltype(snapshot_strings)) I_Realloc(
+            snapshot_strings,
+            (num_snapshot_strings + 1) * sizeof(*snapshot_strings));
+        snapshot_strings[num_snapshot_strings].from_text = from_text;
+        snapshot_strings[num_snapshot_strings].to_text =
+            M_StringDuplicate(to_text);
+        ++num_snapshot_strings;
+    }
+
+    qsort(snapshot_strings, num_snapshot_strings, sizeof(*snapshot_strings),
+          CompareStringSnapshots);
+}
+
+typedef struct
+{
+    byte *data;
+    int length;
+    int alloced;
+} op_buffer_t;
+
+static void AddOp(op_buffer_t *buf, cache_op_t *op, const void *data)
+{
+    while (buf->length + (int) sizeof(*op) + op->length > buf->alloced)
+    {
+        buf->alloced = buf->alloced ? buf->alloced * 2 : 1024;
+        buf->data = (decltype(buf->data)) I_Realloc(buf->data, buf->alloced);
+    }
+
+    memcpy(buf->data + buf->length, op, sizeof(*op));
+    buf->length += sizeof(*op);
+    memcpy(buf->data + buf->length, data, op->length);
+    buf->length += op->length;
+}
+
+// Record the runs of bytes that differ between the snapshot and now.
+
+static void AddByteOps(op_buffer_t *buf, const byte *after)
+{
+    cache_region_t *region;
+    const byte *before;
+    cache_op_t op;
+    size_t i, start;
+    int r, j;
+
+    before = snapshot_bytes;
+    op.type = DEHCACHE_OP_BYTES;
+
+    for (r = 0; r < num_regions; ++r)
+    {
+        region = &regions[r];
+
+        if (region->table != nullptr)
+        {
+            continue;
+        }
+
+        for (j = 0; j < region->count; ++j)
+        {
+            for (i = 0; i < region->len; )
+            {
+                if (before[i] == after[i])
+                {
+                    ++i;
+                    continue;
+                }
+
+                for (start = i; i < region->len && before[i] != after[i]; ++i);
+
+                op.region = r;
+                op.element = j;
+                op.offset = start;
+                op.length = i - start;
+                AddOp(buf, &op, after + start);
+            }
+
+            before += region->len;
+            after += region->len;
+        }
+    }
+}
+
+// Record the changes to the indexed regions. Returns false if a value
+// is not in the table, so the patch can't be cached.
+
+static boolean AddIndexOps(op_buffer_t *buf, const int *after)
+{
+    cache_region_t *region;
+    const int *before;
+    cache_op_t op;
+    int r, j;
+
+    before = snapshot_indexes;
+    op.type = DEHCACHE_OP_INDEX;
+    op.length = 0;
+
+    for (r = 0; r < num_regions; ++r)
+    {
+        region = &regions[r];
+
+        if (region->table == nullptr)
+        {
+            continue;
+        }
+
+        for (j = 0; j < region->count; ++j, ++before, ++after)
+        {
+            if (*before == *after)
+            {
+                continue;
+            }
+
+            if (*after < 0)
+            {
+                return false;
+            }
+
+            op.region = r;
+            op.element = j;
+            op.offset = *after;
+            AddOp(buf, &op, nullptr);
+        }
+    }
+
+    return true;
+}
+
+static void AddStringOps(op_buffer_t *buf)
+{
+    const char *from_text, *to_text;
+    string_snapshot_t key, *found;
+    cache_op_t op;
+    char *data;
+    int iter;
+
+    op.type = DEHCACHE_OP_STRING;
+    op.region = -1;
+    op.element = 0;
+    iter = 0;
+
+    while (DEH_NextStringReplacement(&iter, &from_text, &to_text))
+    {
+        key.from_text = from_text;
+        found = static_cast<string_snapshot_t *>(
+            bsearch(&key, snapshot_strings, num_snapshot_strings,
+                    sizeof(*snapshot_strings), CompareStringSnapshots));
+
+        if (found != nullptr && !strcmp(found->to_text, to_text))
+        {
+            continue;
+        }
+
+        op.offset = strlen(from_text) + 1;
+        op.length = op.offset + strlen(to_text) + 1;
+        data = static_cast<char *>(malloc(op.length));
+        memcpy(data, from_text, op.offset);
+        memcpy(data + op.offset, to_text, op.length - op.offset);
+        AddOp(buf, &op, data);
+        free(data);
+    }
+}
+
+void DEH_FinishPatchCompile(deh_context_t *context)
+{
+    op_buffer_t buf = { nullptr, 0, 0 };
+    byte *after_bytes;
+    int *after_indexes;
+    int i;
+
+    --compile_depth;
+
+    if (compile_depth > 0 || !compiling)
+    {
+        return;
+    }
+
+    compiling = false;
+
+    if (compile_ok && !DEH_HadError(context))
+    {
+        after_bytes = static_cast<byte *>(malloc(snapshot_size));
+        after_indexes = static_cast<int *>(
+            malloc(snapshot_count * sizeof(*after_indexes)));
+        TakeSnapshot(after_bytes, after_indexes);
+
+        AddByteOps(&buf, after_bytes);
+
+        if (AddIndexOps(&buf, after_indexes))
+        {
+            AddStringOps(&buf);
+
+            // The newest patch goes first, and the oldest one drops out
+            // when the cache is full.
+
+            if (num_patches == DEHCACHE_MAX_PATCHES)
+            {
+                --num_patches;
+                free(patches[num_patches].data);
+            }
+
+            patches = (decltype(patches)) I_Realloc(patches,
+                                   (num_patches + 1) * sizeof(*patches));
+            memmove(&patches[1], &patches[0], num_patches * sizeof(*patches));
+            memcpy(patches[0].key, compile_key, sizeof(compile_key));
+            patches[0].data = buf.data;
+            patches[0].length = buf.length;
+            ++num_patches;
+
+            SaveCacheFile();
+            buf.data = nullptr;
+        }
+
+        free(buf.data);
+        free(after_bytes);
+        free(after_indexes);
+    }
+
+    for (i = 0; i < num_snapshot_strings; ++i)
+    {
+        free(snapshot_strings[i].to_text);
+    }
+
+    num_snapshot_strings = 0;
+}
+
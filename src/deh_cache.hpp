@@ -0,0 +1,53 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// Cache of dehacked patches in compiled form
+//
+
+#ifndef DEH_CACHE_H
+#define DEH_CACHE_H
+
+#include <stddef.h>
+
+#include "doomtype.hpp"
+#include "deh_defs.hpp"
+
+// Register count elements of len bytes each, stride bytes apart, that
+// dehacked sections may change.
+
+void DEH_CacheRegion(void *base, size_t len, int count, size_t stride);
+
+// As DEH_CacheRegion(), for values such as code pointers that are
+// always one of the table_len entries of table, each of len bytes.
+// The cache holds the table indexes rather than the values, and they
+// take the place of any DEH_CacheRegion() covering the same memory.
+
+void DEH_CacheIndexedRegion(void *base, size_t len, int count, size_t stride,
+                            const void *table, int table_len);
+
+// cache_regions function for sections that change nothing but string
+// replacements.
+
+void DEH_CacheNoRegions(void);
+
+// If the patch that context reads is in the cache, apply it and return
+// true. Otherwise it has to be parsed, between DEH_StartPatchCompile()
+// and DEH_FinishPatchCompile(), which add it to the cache.
+
+boolean DEH_LoadCachedPatch(deh_context_t *context);
+void DEH_StartPatchCompile(void);
+void DEH_FinishPatchCompile(deh_context_t *context);
+
+#endif /* #ifndef DEH_CACHE_H */
+
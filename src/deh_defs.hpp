@@ -27,6 +27,7 @@ typedef void *(*deh_section_start_t)(deh_context_t *context, char *line);
 typedef void (*deh_section_end_t)(deh_context_t *context, void *tag);
 typedef void (*deh_line_parser_t)(deh_context_t *context, char *line, void *tag);
 typedef void (*deh_sha1_hash_t)(sha1_context_t *context);
+typedef void (*deh_cache_regions_t)(void);
 
 struct deh_section_s
 {
@@ -52,6 +53,12 @@ struct deh_section_s
     // Called when generating an SHA1 sum of the dehacked state
 
     deh_sha1_hash_t sha1_hash;
+
+    // Called to register the memory that the section changes with
+    // DEH_CacheRegion(), so that patches can be cached in compiled
+    // form. Patches are only cached if every section has this.
+
+    deh_cache_regions_t cache_regions;
 };
 
 
@@ -149,6 +149,33 @@ void DEH_CloseFile(deh_context_t *context)
     Z_Free(context);
 }
 
+// Add the whole of the input to a SHA1 hash, leaving the read position
+// where it is.
+
+void DEH_HashInput(deh_context_t *context, sha1_context_t *sha1_context)
+{
+    byte buf[4096];
+    size_t len;
+    long pos;
+
+    if (context->type == DEH_INPUT_LUMP)
+    {
+        SHA1_Update(sha1_context, context->input_buffer,
+                    context->input_buffer_len);
+        return;
+    }
+
+    pos = ftell(context->stream);
+    fseek(context->stream, 0, SEEK_SET);
+
+    while ((len = fread(buf, 1, sizeof(buf), context->stream)) > 0)
+    {
+        SHA1_Update(sha1_context, buf, len);
+    }
+
+    fseek(context->stream, pos, SEEK_SET);
+}
+
 int DEH_GetCharFile(deh_context_t *context)
 {
     if (feof(context->stream))
@@ -28,6 +28,7 @@
 #include "m_misc.hpp"
 #include "w_wad.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -421,6 +422,7 @@ static void DEH_ParseContext(deh_context_t *context)
 int DEH_LoadFile(const char *filename)
 {
     deh_context_t *context;
+    boolean had_error;
 
     if (!deh_initialized)
     {
@@ -449,11 +451,17 @@ int DEH_LoadFile(const char *filename)
 
     AddDEHFileName(filename);
 
-    DEH_ParseContext(context);
+    if (!DEH_LoadCachedPatch(context))
+    {
+        DEH_StartPatchCompile();
+        DEH_ParseContext(context);
+        DEH_FinishPatchCompile(context);
+    }
 
+    had_error = DEH_HadError(context);
     DEH_CloseFile(context);
 
-    if (DEH_HadError(context))
+    if (had_error)
     {
         I_Error("Error parsing dehacked file");
     }
@@ -489,6 +497,7 @@ void DEH_AutoLoadPatches(const char *path)
 int DEH_LoadLump(int lumpnum, boolean allow_long, boolean allow_error)
 {
     deh_context_t *context;
+    boolean had_error;
 
     if (!deh_initialized)
     {
@@ -511,13 +520,19 @@ int DEH_LoadLump(int lumpnum, boolean allow_long, boolean allow_error)
         return 0;
     }
 
-    DEH_ParseContext(context);
+    if (!DEH_LoadCachedPatch(context))
+    {
+        DEH_StartPatchCompile();
+        DEH_ParseContext(context);
+        DEH_FinishPatchCompile(context);
+    }
 
+    had_error = DEH_HadError(context);
     DEH_CloseFile(context);
 
     // If there was an error while parsing, abort with an error, but allow
     // errors to just be ignored if allow_error=true.
-    if (!allow_error && DEH_HadError(context))
+    if (!allow_error && had_error)
     {
         I_Error("Error parsing dehacked lump");
     }
@@ -213,6 +213,26 @@ void DEH_AddStringReplacement(const char *from_text, const char *to_text)
     }
 }
 
+// Iterate over the string replacements. *iter starts at zero; returns
+// false when there are no more.
+
+boolean DEH_NextStringReplacement(int *iter, const char **from_text,
+                                  const char **to_text)
+{
+    for (; *iter < hash_table_length; ++*iter)
+    {
+        if (hash_table[*iter] != nullptr)
+        {
+            *from_text = hash_table[*iter]->from_text;
+            *to_text = hash_table[*iter]->to_text;
+            ++*iter;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 typedef enum
 {
     FORMAT_ARG_INVALID,
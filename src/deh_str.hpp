@@ -30,6 +30,8 @@ void DEH_fprintf(FILE *fstream, const char *fmt, ...) PRINTF_ATTR(2, 3);
 void DEH_snprintf(char *buffer, size_t len, const char *fmt, ...) PRINTF_ATTR(3, 4);
 void DEH_AddStringReplacement(const char *from_text, const char *to_text);
 boolean DEH_HasStringReplacement(const char *s);
+boolean DEH_NextStringReplacement(int *iter, const char **from_text,
+                                  const char **to_text);
 
 
 #if 0
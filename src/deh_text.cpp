@@ -23,6 +23,7 @@
 
 #include "z_zone.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -115,5 +116,6 @@ deh_section_t deh_section_text =
     DEH_TextParseLine,
     nullptr,
     nullptr,
+    DEH_CacheNoRegions,
 };
 
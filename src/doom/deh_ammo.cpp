@@ -21,6 +21,7 @@
 
 #include "doomdef.hpp"
 #include "doomtype.hpp"
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -92,6 +93,12 @@ static void DEH_AmmoSHA1Hash(sha1_context_t *context)
     }
 }
 
+static void DEH_AmmoCacheRegions(void)
+{
+    DEH_CacheRegion(clipammo, sizeof(clipammo), 1, 0);
+    DEH_CacheRegion(maxammo, sizeof(maxammo), 1, 0);
+}
+
 deh_section_t deh_section_ammo =
 {
     "Ammo",
@@ -100,5 +107,6 @@ deh_section_t deh_section_ammo =
     DEH_AmmoParseLine,
     nullptr,
     DEH_AmmoSHA1Hash,
+    DEH_AmmoCacheRegions,
 };
 
@@ -22,6 +22,7 @@
 
 #include "m_misc.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
 
@@ -106,4 +107,5 @@ deh_section_t deh_section_bexincl =
     DEH_BEXInclParseLine,
     nullptr,
     nullptr,
+    DEH_CacheNoRegions,
 };
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "deh_cache.hpp"
 #include "deh_bexpars.hpp"
 #include "deh_io.hpp"
 
@@ -69,6 +70,12 @@ static void DEH_BEXParsParseLine(deh_context_t *context, char *line, void *tag)
     }
 }
 
+static void DEH_BEXParsCacheRegions(void)
+{
+    DEH_CacheRegion(bex_pars, sizeof(bex_pars), 1, 0);
+    DEH_CacheRegion(bex_cpars, sizeof(bex_cpars), 1, 0);
+}
+
 deh_section_t deh_section_bexpars =
 {
     "[PARS]",
@@ -77,4 +84,5 @@ deh_section_t deh_section_bexpars =
     DEH_BEXParsParseLine,
     nullptr,
     nullptr,
+    DEH_BEXParsCacheRegions,
 };
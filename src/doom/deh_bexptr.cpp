@@ -22,6 +22,7 @@
 
 #include "info.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
 
@@ -274,6 +275,31 @@ static void DEH_BEXPtrParseLine(deh_context_t *context, char *line, void *tag)
     DEH_Warning(context, "Invalid mnemonic '%s'", value);
 }
 
+// Every code pointer that can end up in states[]: those of the
+// original states, then the ones named in the table above.
+
+static actionf_t cache_codeptrs[NUMSTATES + arrlen(bex_codeptrtable)];
+
+static void DEH_BEXPtrCacheRegions(void)
+{
+    size_t i;
+
+    for (i = 0; i < NUMSTATES; i++)
+    {
+        cache_codeptrs[i] = codeptrs[i];
+    }
+
+    for (i = 0; i < arrlen(bex_codeptrtable); i++)
+    {
+        cache_codeptrs[NUMSTATES + i] = bex_codeptrtable[i].pointer;
+    }
+
+    DEH_CacheRegion(states, sizeof(states), 1, 0);
+    DEH_CacheIndexedRegion(&states[0].action, sizeof(actionf_t), NUMSTATES,
+                           sizeof(state_t), cache_codeptrs,
+                           arrlen(cache_codeptrs));
+}
+
 deh_section_t deh_section_bexptr =
 {
     "[CODEPTR]",
@@ -282,4 +308,5 @@ deh_section_t deh_section_bexptr =
     DEH_BEXPtrParseLine,
     nullptr,
     nullptr,
+    DEH_BEXPtrCacheRegions,
 };
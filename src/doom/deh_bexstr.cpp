@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -376,4 +377,5 @@ deh_section_t deh_section_bexstr =
     DEH_BEXStrParseLine,
     nullptr,
     nullptr,
+    DEH_CacheNoRegions,
 };
@@ -20,6 +20,7 @@
 
 #include "doomtype.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -134,6 +135,17 @@ static void DEH_CheatParseLine(deh_context_t *context, char *line, void *tag)
     }
 }
 
+static void DEH_CheatCacheRegions(void)
+{
+    size_t i;
+
+    for (i=0; i<arrlen(allcheats); ++i)
+    {
+        DEH_CacheRegion(allcheats[i].seq->sequence,
+                        sizeof(allcheats[i].seq->sequence), 1, 0);
+    }
+}
+
 deh_section_t deh_section_cheat =
 {
     "Cheat",
@@ -142,5 +154,6 @@ deh_section_t deh_section_cheat =
     DEH_CheatParseLine,
     nullptr,
     nullptr,
+    DEH_CheatCacheRegions,
 };
 
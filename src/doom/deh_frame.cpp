@@ -22,6 +22,7 @@
 #include "d_items.hpp"
 #include "info.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -150,6 +151,14 @@ static void DEH_FrameSHA1Sum(sha1_context_t *context)
     }
 }
 
+static void DEH_FrameCacheRegions(void)
+{
+    DEH_CacheRegion(states, sizeof(states), 1, 0);
+
+    // See DEH_FrameOverflow.
+    DEH_CacheRegion(weaponinfo, sizeof(weaponinfo), 1, 0);
+}
+
 deh_section_t deh_section_frame =
 {
     "Frame",
@@ -158,5 +167,6 @@ deh_section_t deh_section_frame =
     DEH_FrameParseLine,
     nullptr,
     DEH_FrameSHA1Sum,
+    DEH_FrameCacheRegions,
 };
 
@@ -19,6 +19,7 @@
 #include <string.h>
 
 #include "doomtype.hpp"
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -216,6 +217,18 @@ static void DEH_MiscSHA1Sum(sha1_context_t *context)
     }
 }
 
+static void DEH_MiscCacheRegions(void)
+{
+    unsigned int i;
+
+    for (i=0; i<arrlen(misc_settings); ++i)
+    {
+        DEH_CacheRegion(misc_settings[i].value, sizeof(int), 1, 0);
+    }
+
+    DEH_CacheRegion(&deh_species_infighting, sizeof(int), 1, 0);
+}
+
 deh_section_t deh_section_misc =
 {
     "Misc",
@@ -224,5 +237,6 @@ deh_section_t deh_section_misc =
     DEH_MiscParseLine,
     nullptr,
     DEH_MiscSHA1Sum,
+    DEH_MiscCacheRegions,
 };
 
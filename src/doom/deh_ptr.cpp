@@ -22,6 +22,7 @@
 #include "doomtype.hpp"
 #include "info.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_io.hpp"
 #include "deh_main.hpp"
@@ -144,6 +145,14 @@ static void DEH_PointerSHA1Sum(sha1_context_t *context)
     }
 }
 
+// The code pointers are registered as an indexed region by the
+// [CODEPTR] section, which knows all of them.
+
+static void DEH_PointerCacheRegions(void)
+{
+    DEH_CacheRegion(states, sizeof(states), 1, 0);
+}
+
 deh_section_t deh_section_pointer =
 {
     "Pointer",
@@ -152,5 +161,6 @@ deh_section_t deh_section_pointer =
     DEH_PointerParseLine,
     nullptr,
     DEH_PointerSHA1Sum,
+    DEH_PointerCacheRegions,
 };
 
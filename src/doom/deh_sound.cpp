@@ -19,6 +19,7 @@
 #include <stdlib.h>
 
 #include "doomtype.hpp"
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_main.hpp"
 #include "deh_mapping.hpp"
@@ -90,6 +91,18 @@ static void DEH_SoundParseLine(deh_context_t *context, char *line, void *tag)
     DEH_SetMapping(context, &sound_mapping, sfx, variable_name, ivalue);
 }
 
+// Only the fields that can be set are cached: the rest hold pointers.
+
+static void DEH_SoundCacheRegions(void)
+{
+    DEH_CacheRegion(&S_sfx[0].priority, sizeof(int), NUMSFX, sizeof(sfxinfo_t));
+    DEH_CacheRegion(&S_sfx[0].pitch, sizeof(int), NUMSFX, sizeof(sfxinfo_t));
+    DEH_CacheRegion(&S_sfx[0].volume, sizeof(int), NUMSFX, sizeof(sfxinfo_t));
+    DEH_CacheRegion(&S_sfx[0].usefulness, sizeof(int), NUMSFX,
+                    sizeof(sfxinfo_t));
+    DEH_CacheRegion(&S_sfx[0].lumpnum, sizeof(int), NUMSFX, sizeof(sfxinfo_t));
+}
+
 deh_section_t deh_section_sound =
 {
     "Sound",
@@ -98,5 +111,6 @@ deh_section_t deh_section_sound =
     DEH_SoundParseLine,
     nullptr,
     nullptr,
+    DEH_SoundCacheRegions,
 };
 
@@ -20,6 +20,7 @@
 
 #include "doomtype.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_main.hpp"
 #include "deh_mapping.hpp"
@@ -253,6 +254,11 @@ static void DEH_ThingSHA1Sum(sha1_context_t *context)
     }
 }
 
+static void DEH_ThingCacheRegions(void)
+{
+    DEH_CacheRegion(mobjinfo, sizeof(mobjinfo), 1, 0);
+}
+
 deh_section_t deh_section_thing =
 {
     "Thing",
@@ -261,5 +267,6 @@ deh_section_t deh_section_thing =
     DEH_ThingParseLine,
     nullptr,
     DEH_ThingSHA1Sum,
+    DEH_ThingCacheRegions,
 };
 
@@ -23,6 +23,7 @@
 
 #include "d_items.hpp"
 
+#include "deh_cache.hpp"
 #include "deh_defs.hpp"
 #include "deh_main.hpp"
 #include "deh_mapping.hpp"
@@ -87,6 +88,11 @@ static void DEH_WeaponSHA1Sum(sha1_context_t *context)
     }
 }
 
+static void DEH_WeaponCacheRegions(void)
+{
+    DEH_CacheRegion(weaponinfo, sizeof(weaponinfo), 1, 0);
+}
+
 deh_section_t deh_section_weapon =
 {
     "Weapon",
@@ -95,5 +101,6 @@ deh_section_t deh_section_weapon =
     DEH_WeaponParseLine,
     nullptr,
     DEH_WeaponSHA1Sum,
+    DEH_WeaponCacheRegions,
 };
 
@@ -1843,6 +1843,27 @@ static void G_WriteLevelStat(void)
             playerItems, totalitems, playerSecrets, totalsecret);
 }
  
+//
+// [crispy] G_GameEndsAfterIntermission
+// True if the victory or cast sequence follows the intermission of the
+// level just completed rather than another level, as decided by
+// G_WorldDone() and F_Ticker().
+//
+static boolean G_GameEndsAfterIntermission (void)
+{
+    if (gamemission == GameMission_t::pack_nerve)
+	return gamemap == 8;
+
+    if (gamemission == GameMission_t::pack_master)
+	return gamemap == 21 || (gamemap == 20 && !secretexit);
+
+    if (gamemode == GameMode_t::commercial)
+	return gamemap == 30;
+
+    return gamemap == 8 ||
+	   (gameversion == GameVersion_t::exe_chex && gamemap == 5);
+}
+
 void G_DoCompleted (void) 
 { 
     int             i; 
@@ -2091,6 +2112,14 @@ void G_DoCompleted (void)
     {
         StatCopy(&wminfo);
     }
+
+    // [crispy] read the next level while the intermission screen is up,
+    // the one G_DoWorldDone() will load, unless the game ends here
+    if (!G_GameEndsAfterIntermission())
+    {
+	P_PreloadLevel (gameepisode, wminfo.next + 1);
+	S_PrefetchLevelMusic (gameepisode, wminfo.next + 1);
+    }
  
     WI_Start (&wminfo); 
 } 
@@ -2713,6 +2742,10 @@ void G_ReadDemoTiccmd (ticcmd_t* cmd)
     cmd->buttons = (unsigned char)*demo_p++; 
 } 
 
+// [crispy] lump that demobuffer points into while a demo is played back,
+// which must be released rather than freed
+static lumpindex_t demobuffer_lump = -1;
+
 // Increase the size of the demo buffer to allow unlimited demos
 
 static void IncreaseDemoBuffer(void)
@@ -2737,8 +2770,17 @@ static void IncreaseDemoBuffer(void)
     memcpy(new_demobuffer, demobuffer, current_length);
 
     // Free the old buffer and point the demo pointers at the new buffer.
+    // [crispy] in demo continue mode the old buffer is the demo lump
 
-    Z_Free(demobuffer);
+    if (demobuffer_lump >= 0)
+    {
+        W_ReleaseLumpNum(demobuffer_lump);
+        demobuffer_lump = -1;
+    }
+    else
+    {
+        Z_Free(demobuffer);
+    }
 
     demobuffer = new_demobuffer;
     demo_p = new_demop;
@@ -2988,6 +3030,7 @@ void G_DoPlayDemo (void)
     lumpnum = W_GetNumForName(defdemoname);
     gameaction = ga_nothing;
     demobuffer = static_cast<byte*>( W_CacheLumpNum(lumpnum, PU_STATIC) );
+    demobuffer_lump = lumpnum;
     demo_p = demobuffer;
 
     // [crispy] ignore empty demo lumps
@@ -3250,7 +3293,13 @@ boolean G_CheckDemoStatus (void)
 	 
     if (demoplayback) 
     { 
-        W_ReleaseLumpName(defdemoname);
+        // [crispy] in demo continue mode the lump is still needed to
+        // fill the recording buffer, and IncreaseDemoBuffer releases it
+        if (!demorecording && demobuffer_lump >= 0)
+        {
+            W_ReleaseLumpNum(demobuffer_lump);
+            demobuffer_lump = -1;
+        }
 	demoplayback = false; 
 	netdemo = false;
 	netgame = false;
@@ -25,6 +25,7 @@
 #include "z_zone.hpp"
 
 #include "deh_main.hpp"
+#include "i_audiostats.hpp"
 #include "i_input.hpp"
 #include "i_swap.hpp"
 #include "i_video.hpp"
@@ -97,6 +98,7 @@ static hu_textline_t	w_coordx;
 static hu_textline_t	w_coordy;
 static hu_textline_t	w_coorda;
 static hu_textline_t	w_fps;
+static hu_textline_t	w_audio[4];
 boolean			chat_on;
 static hu_itext_t	w_chat;
 static boolean		always_off = false;
@@ -665,6 +667,15 @@ void HU_Start(void)
 		       hu_font,
 		       HU_FONTSTART);
 
+    // audio statistics go under the player coordinates
+    for (i = 0; i < (int) arrlen(w_audio); i++)
+    {
+	HUlib_initTextLine(&w_audio[i],
+			   HU_COORDX, HU_MSGY + (4 + i) * 8,
+			   hu_font,
+			   HU_FONTSTART);
+    }
+
     
     switch ( logical_gamemission )
     {
@@ -813,6 +824,7 @@ static void HU_DrawCrosshair (void)
 
 void HU_Drawer(void)
 {
+    int i;
 
     if (crispy->cleanscreenshot)
     {
@@ -883,6 +895,14 @@ void HU_Drawer(void)
     if (plr->powers[static_cast<int>(powertype_t::pw_showfps)])
     {
 	HUlib_drawTextLine(&w_fps, false);
+
+	if (audiostats_enabled)
+	{
+	    for (i = 0; i < (int) arrlen(w_audio); i++)
+	    {
+		HUlib_drawTextLine(&w_audio[i], false);
+	    }
+	}
     }
 
     if (crispy->crosshair == CROSSHAIR_STATIC)
@@ -911,6 +931,7 @@ void HU_Drawer(void)
 
 void HU_Erase(void)
 {
+    int i;
 
     HUlib_eraseSText(&w_message);
     HUlib_eraseSText(&w_secret);
@@ -925,6 +946,11 @@ void HU_Erase(void)
     HUlib_eraseTextLine(&w_coorda);
     HUlib_eraseTextLine(&w_fps);
 
+    for (i = 0; i < (int) arrlen(w_audio); i++)
+    {
+	HUlib_eraseTextLine(&w_audio[i]);
+    }
+
 }
 
 static void Crispy_Statsline_Ratio (char *str, int str_size, const char *prefix, int count, int total, int extra)
@@ -1190,6 +1216,49 @@ void HU_Ticker(void)
 	while (*s)
 	    HUlib_addCharToTextLine(&w_fps, *(s++));
     }
+
+    // sound channels in use, longest audio callback in us, underruns
+    // and overruns, and longest sound start latency in ms
+    if (audiostats_enabled && plr->powers[static_cast<int>(powertype_t::pw_showfps)])
+    {
+	audiostats_summary_t audio;
+
+	I_GetAudioStatsSummary(&audio);
+
+	for (i = 0; i < (int) arrlen(w_audio); i++)
+	{
+	    switch (i)
+	    {
+	    case 0:
+		M_snprintf(str, sizeof(str), "%s%d/%d %sCH", crstr[CR_GRAY],
+		        audio.channels, audio.max_channels, cr_stat2);
+		break;
+	    case 1:
+		M_snprintf(str, sizeof(str), "%s%-4u %sUS", crstr[CR_GRAY],
+		        audio.callback_us, cr_stat2);
+		break;
+	    case 2:
+		M_snprintf(str, sizeof(str), "%s%-4u %sXR", crstr[CR_GRAY],
+		        audio.underruns + audio.overruns, cr_stat2);
+		break;
+	    default:
+		// only the software mixer measures it
+		if (audio.has_latency)
+		    M_snprintf(str, sizeof(str), "%s%u.%u %sLAT", crstr[CR_GRAY],
+		            audio.latency_us / 1000,
+		            (audio.latency_us / 100) % 10, cr_stat2);
+		else
+		    M_snprintf(str, sizeof(str), "%sn/a %sLAT", crstr[CR_GRAY],
+		            cr_stat2);
+		break;
+	    }
+
+	    HUlib_clearTextLine(&w_audio[i]);
+	    s = str;
+	    while (*s)
+		HUlib_addCharToTextLine(&w_audio[i], *(s++));
+	}
+    }
 }
 
 #define QUEUESIZE		128
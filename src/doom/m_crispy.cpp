@@ -148,11 +148,14 @@ multiitem_t multiitem_translucency[NUM_TRANSLUCENCY] =
     {TRANSLUCENCY_BOTH, "both"},
 };
 
-multiitem_t multiitem_sndchannels[4] =
+multiitem_t multiitem_sndchannels[6] =
 {
     {8, "8"},
     {16, "16"},
     {32, "32"},
+    {64, "64"},
+    {128, "128"},
+    {256, "256"},
 };
 
 multiitem_t multiitem_widgets[NUM_WIDGETS] =
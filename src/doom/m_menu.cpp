@@ -1567,6 +1567,24 @@ static void M_DrawCrispness1(void)
     dp_translation = nullptr;
 }
 
+// [crispy] the menu item for the current number of sound channels,
+// which need not be one of the values the menu steps through
+
+static int M_SndChannelsItem(void)
+{
+    int i;
+
+    for (i = arrlen(multiitem_sndchannels) - 1; i > 0; i--)
+    {
+        if (multiitem_sndchannels[i].value <= snd_channels)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
 static void M_DrawCrispness2(void)
 {
     M_DrawCrispnessBackground();
@@ -1576,7 +1594,7 @@ static void M_DrawCrispness2(void)
     M_DrawCrispnessSeparator(crispness_sep_audible, "Audible");
     M_DrawCrispnessItem(crispness_soundfull, "Play sounds in full length", crispy->soundfull, true);
     M_DrawCrispnessItem(crispness_soundfix, "Misc. Sound Fixes", crispy->soundfix, true);
-    M_DrawCrispnessMultiItem(crispness_sndchannels, "Sound Channels", multiitem_sndchannels, snd_channels >> 4, snd_sfxdevice != SNDDEVICE_PCSPEAKER);
+    M_DrawCrispnessMultiItem(crispness_sndchannels, "Sound Channels", multiitem_sndchannels, M_SndChannelsItem(), snd_sfxdevice != SNDDEVICE_PCSPEAKER);
     M_DrawCrispnessItem(crispness_soundmono, "Mono SFX", crispy->soundmono, true);
 
     M_DrawCrispnessSeparator(crispness_sep_navigational, "Navigational");
@@ -19,18 +19,185 @@
 //
 
 #include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
 #include "i_system.hpp"
 #include "p_local.hpp"
 #include "z_zone.hpp"
 
 #include "../../utils/memory.hpp"
 
-// [crispy] taken from mbfsrc/P_SETUP.C:547-707, slightly adapted
+// [crispy] the linedefs are rasterized in two passes, first counting the
+// blocks each one crosses and then filling in the lists, so the blockmap
+// is allocated only once. Both passes are split across threads, each
+// taking a contiguous range of linedefs and keeping its own counts.
 
-void P_CreateBlockMap(void)
+#define BLOCKMAP_MAX_THREADS 8
+#define BLOCKMAP_LINES_PER_THREAD 4096
+
+typedef struct
+{
+  int minx, miny;
+  int width;
+  unsigned tot;
+} bmapgrid_t;
+
+typedef struct
+{
+  const bmapgrid_t *grid;
+  int first, last;      // linedefs [first, last)
+  int *count;           // per block: number of linedefs, then fill position
+  int32_t *lump;        // nullptr in the counting pass
+} bmapjob_t;
+
+// [crispy] walk from block to block along a linedef,
+// taken from mbfsrc/P_SETUP.C:547-707, slightly adapted
+
+typedef struct
+{
+  int b, bend;          // current and ending block
+  int diff;             // preference to move across y (>0) instead of x (<0)
+  int dx, dy;           // block steps across x and y
+  int adx, ady;         // deltas for diff
+} linewalk_t;
+
+static void StartLine(linewalk_t *w, const line_t *ld, const bmapgrid_t *grid)
+{
+  int x, y, adx, ady, dx, dy;
+
+  // starting coordinates
+  x = (ld->v1->x >> FRACBITS) - grid->minx;
+  y = (ld->v1->y >> FRACBITS) - grid->miny;
+
+  // x-y deltas
+  adx = ld->dx >> FRACBITS, dx = adx < 0 ? -1 : 1;
+  ady = ld->dy >> FRACBITS, dy = ady < 0 ? -1 : 1;
+
+  // difference in preferring to move across y (>0) instead of x (<0)
+  w->diff = !adx ? 1 : !ady ? -1 :
+    (((x >> MAPBTOFRAC) << MAPBTOFRAC) +
+     (dx > 0 ? MAPBLOCKUNITS-1 : 0) - x) * (ady = abs(ady)) * dx -
+    (((y >> MAPBTOFRAC) << MAPBTOFRAC) +
+     (dy > 0 ? MAPBLOCKUNITS-1 : 0) - y) * (adx = abs(adx)) * dy;
+
+  // starting block
+  w->b = (y >> MAPBTOFRAC)*grid->width + (x >> MAPBTOFRAC);
+
+  // ending block
+  w->bend = (((ld->v2->y >> FRACBITS) - grid->miny) >> MAPBTOFRAC) *
+    grid->width + (((ld->v2->x >> FRACBITS) - grid->minx) >> MAPBTOFRAC);
+
+  // delta for block index when moving across y
+  w->dx = dx;
+  w->dy = dy * grid->width;
+
+  // deltas for diff inside the loop
+  w->adx = adx << MAPBTOFRAC;
+  w->ady = ady << MAPBTOFRAC;
+}
+
+// Move in either the x or y direction to the next block.
+// Returns false once the ending block has been visited.
+
+static inline boolean StepLine(linewalk_t *w)
+{
+  if (w->b == w->bend)
+    return false;
+
+  if (w->diff < 0)
+    w->diff += w->ady, w->b += w->dx;
+  else
+    w->diff -= w->adx, w->b += w->dy;
+
+  return true;
+}
+
+static int CountJob(void *data)
+{
+  bmapjob_t *job = static_cast<bmapjob_t *>(data);
+  const unsigned tot = job->grid->tot;
+  linewalk_t w;
+  int i;
+
+  for (i = job->first; i < job->last; i++)
+  {
+    StartLine(&w, &lines[i], job->grid);
+
+    while ((unsigned) w.b < tot)    // failsafe -- should ALWAYS be true
+    {
+      job->count[w.b]++;
+
+      if (!StepLine(&w))
+        break;
+    }
+  }
+
+  return 0;
+}
+
+// Each block list holds its linedefs in descending order, so the
+// linedefs are walked backwards.
+
+static int FillJob(void *data)
+{
+  bmapjob_t *job = static_cast<bmapjob_t *>(data);
+  const unsigned tot = job->grid->tot;
+  linewalk_t w;
+  int i;
+
+  for (i = job->last - 1; i >= job->first; i--)
+  {
+    StartLine(&w, &lines[i], job->grid);
+
+    while ((unsigned) w.b < tot)
+    {
+      job->lump[job->count[w.b]++] = i;
+
+      if (!StepLine(&w))
+        break;
+    }
+  }
+
+  return 0;
+}
+
+static void RunJobs(SDL_ThreadFunction func, bmapjob_t *jobs, int numjobs)
+{
+  SDL_Thread *threads[BLOCKMAP_MAX_THREADS];
+  int t;
+
+  // The first job is done on this thread, as well as any that no
+  // thread could be started for.
+
+  for (t = 1; t < numjobs; t++)
+  {
+    threads[t] = SDL_CreateThread(func, "blockmap", &jobs[t]);
+
+    if (threads[t] == nullptr)
+      func(&jobs[t]);
+  }
+
+  func(&jobs[0]);
+
+  for (t = 1; t < numjobs; t++)
+  {
+    if (threads[t] != nullptr)
+      SDL_WaitThread(threads[t], nullptr);
+  }
+}
+
+static void BuildBlockMap(blockmap_build_t *build, int numjobs)
 {
   int i;
   fixed_t minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+  bmapgrid_t grid;
+  bmapjob_t jobs[BLOCKMAP_MAX_THREADS];
+  int *counts;
+  int32_t *blockmaplump;
+  int count, ndx, n, t;
+  unsigned b;
 
   // First find limits of map
 
@@ -48,79 +215,235 @@ void P_CreateBlockMap(void)
 	  maxy = vertexes[i].y >> FRACBITS;
     }
 
-#if 0
-  // [crispy] doombsp/DRAWING.M:175-178
-  minx -= 8; miny -= 8;
-  maxx += 8; maxy += 8;
-#endif
-
   // Save blockmap parameters
 
-  bmaporgx = minx << FRACBITS;
-  bmaporgy = miny << FRACBITS;
-  bmapwidth  = ((maxx-minx) >> MAPBTOFRAC) + 1;
-  bmapheight = ((maxy-miny) >> MAPBTOFRAC) + 1;
+  build->orgx = minx << FRACBITS;
+  build->orgy = miny << FRACBITS;
+  build->width  = ((maxx-minx) >> MAPBTOFRAC) + 1;
+  build->height = ((maxy-miny) >> MAPBTOFRAC) + 1;
 
-  // Compute blockmap, which is stored as a 2d array of variable-sized lists.
-  //
-  // Pseudocode:
-  //
-  // For each linedef:
-  //
-  //   Map the starting and ending vertices to blocks.
-  //
-  //   Starting in the starting vertex's block, do:
-  //
-  //     Add linedef to current block's list, dynamically resizing it.
+  grid.minx = minx;
+  grid.miny = miny;
+  grid.width = build->width;
+  grid.tot = build->width * build->height;
+
+  // Count the linedefs in each block, per range of linedefs.
+
+  numjobs = BETWEEN(1, BLOCKMAP_MAX_THREADS, numjobs);
+  counts = static_cast<int *>(calloc(static_cast<size_t>(grid.tot) * numjobs,
+                                     sizeof(*counts)));
+
+  if (counts == nullptr)
+    I_Error("P_CreateBlockMap: failed to allocate %u blocks", grid.tot);
+
+  for (t = 0; t < numjobs; t++)
+  {
+    jobs[t].grid = &grid;
+    jobs[t].first = static_cast<int>(static_cast<int64_t>(numlines) * t / numjobs);
+    jobs[t].last = static_cast<int>(static_cast<int64_t>(numlines) * (t + 1) / numjobs);
+    jobs[t].count = counts + static_cast<size_t>(grid.tot) * t;
+    jobs[t].lump = nullptr;
+  }
+
+  RunJobs(CountJob, jobs, numjobs);
+
+  // Compute the total size of the blockmap.
   //
-  //     If current block is the same as the ending vertex's block, exit loop.
+  // Compression of empty blocks is performed by reserving two offset words
+  // at tot and tot+1.
   //
-  //     Move to an adjacent block by moving towards the ending block in
-  //     either the x or y direction, to the block which contains the linedef.
+  // 4 words, unused if this routine is called, are reserved at the start.
+
+  count = grid.tot+6;  // we need at least 1 word per block, plus reserved's
+
+  for (b = 0; b < grid.tot; b++)
+  {
+    for (n = 0, t = 0; t < numjobs; t++)
+      n += jobs[t].count[b];
+
+    if (n)
+      count += n + 2;    // 1 header word + 1 trailer word + blocklist
+  }
+
+  blockmaplump = static_cast<int32_t *>(I_Realloc(nullptr, sizeof(*blockmaplump) * count));
+  build->lump = blockmaplump;
+  build->count = count;
+
+  // Lay out the block lists, and turn the counts into the positions
+  // each range of linedefs starts filling in at. The lists are in
+  // descending order, so the last range goes first.
+
+  memset(blockmaplump, 0, 4 * sizeof(*blockmaplump));
+
+  ndx = grid.tot + 4;
+  blockmaplump[ndx++] = 0;    // Store an empty blockmap list at start
+  blockmaplump[ndx++] = -1;   // (Used for compression)
+
+  for (b = 0; b < grid.tot; b++)
+  {
+    for (n = 0, t = 0; t < numjobs; t++)
+      n += jobs[t].count[b];
+
+    if (n)                                            // Non-empty blocklist
+    {
+      blockmaplump[blockmaplump[b + 4] = ndx++] = 0;  // Store index & header
+
+      for (t = numjobs - 1; t >= 0; t--)
+      {
+        n = jobs[t].count[b];
+        jobs[t].count[b] = ndx;
+        ndx += n;
+      }
+
+      blockmaplump[ndx++] = -1;                       // Store trailer
+    }
+    else            // Empty blocklist: point to reserved empty blocklist
+      blockmaplump[b + 4] = grid.tot + 4;
+  }
+
+  // Now fill in the linedef lists.
+
+  for (t = 0; t < numjobs; t++)
+    jobs[t].lump = blockmaplump;
+
+  RunJobs(FillJob, jobs, numjobs);
+
+  free(counts);
+}
+
+// [crispy] the result is built in malloc'd memory and only installed
+// by P_InstallBlockMap(), so this can run on a worker thread
+
+void P_BuildBlockMap(blockmap_build_t *build)
+{
+  int numjobs;
 
+  numjobs = MIN(SDL_GetCPUCount(), numlines / BLOCKMAP_LINES_PER_THREAD);
+
+  BuildBlockMap(build, numjobs);
+}
+
+void P_InstallBlockMap(blockmap_build_t *build)
+{
+  bmaporgx = build->orgx;
+  bmaporgy = build->orgy;
+  bmapwidth = build->width;
+  bmapheight = build->height;
+
+  blockmaplump = zmalloc<decltype(blockmaplump)>(sizeof(*blockmaplump) * build->count, PU_LEVEL, 0);
+  memcpy(blockmaplump, build->lump, sizeof(*blockmaplump) * build->count);
+  free(build->lump);
+  build->lump = nullptr;
+
+  // [crispy] copied over from P_LoadBlockMap()
   {
-    typedef struct { int n, nalloc, *list; } bmap_t;  // blocklist structure
-    unsigned tot = bmapwidth * bmapheight;            // size of blockmap
-    bmap_t *bmap = static_cast<bmap_t*>( calloc(sizeof *bmap, tot) ) ;         // array of blocklists
+    int count = sizeof(*blocklinks) * bmapwidth * bmapheight;
+    blocklinks = zmalloc<decltype(blocklinks)>(count, PU_LEVEL, 0);
+    memset(blocklinks, 0, count);
+    blockmap = blockmaplump+4;
+  }
+
+  fprintf(stderr, "+BLOCKMAP)\n");
+}
+
+void P_CreateBlockMap(void)
+{
+  blockmap_build_t build;
+
+  P_BuildBlockMap(&build);
+  P_InstallBlockMap(&build);
+}
+
+#ifdef TEST
+
+//
+// Benchmark of P_BuildBlockMap() against the MBF code it replaced,
+// which kept a growing list per block. Give a WAD file and a map name
+// to use the VERTEXES and LINEDEFS of that map; otherwise a large map
+// of random linedefs is made up.
+//
+
+#include <stdio.h>
+
+#include "i_timer.hpp"
+#include "m_argv.hpp"
+
+#define BENCH_RUNS 10
+
+int numvertexes;
+vertex_t *vertexes;
+int numlines;
+line_t *lines;
+int32_t *blockmaplump;
+int32_t *blockmap;
+int bmapwidth;
+int bmapheight;
+fixed_t bmaporgx;
+fixed_t bmaporgy;
+mobj_t **blocklinks;
+
+// The blockmap as it was built before.
+
+static void RefBuildBlockMap(blockmap_build_t *build)
+{
+  int i;
+  fixed_t minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+
+  for (i=0; i<numvertexes; i++)
+    {
+      if (vertexes[i].x >> FRACBITS < minx)
+	minx = vertexes[i].x >> FRACBITS;
+      else
+	if (vertexes[i].x >> FRACBITS > maxx)
+	  maxx = vertexes[i].x >> FRACBITS;
+      if (vertexes[i].y >> FRACBITS < miny)
+	miny = vertexes[i].y >> FRACBITS;
+      else
+	if (vertexes[i].y >> FRACBITS > maxy)
+	  maxy = vertexes[i].y >> FRACBITS;
+    }
+
+  build->orgx = minx << FRACBITS;
+  build->orgy = miny << FRACBITS;
+  build->width  = ((maxx-minx) >> MAPBTOFRAC) + 1;
+  build->height = ((maxy-miny) >> MAPBTOFRAC) + 1;
+
+  {
+    typedef struct { int n, nalloc, *list; } bmap_t;
+    const int bmapwidth = build->width;
+    int32_t *blockmaplump;
+    unsigned tot = build->width * build->height;
+    bmap_t *bmap = static_cast<bmap_t*>( calloc(sizeof *bmap, tot) ) ;
     int x, y, adx, ady, bend;
 
     for (i=0; i < numlines; i++)
       {
 	int dx, dy, diff, b;
 
-	// starting coordinates
 	x = (lines[i].v1->x >> FRACBITS) - minx;
 	y = (lines[i].v1->y >> FRACBITS) - miny;
 
-	// x-y deltas
 	adx = lines[i].dx >> FRACBITS, dx = adx < 0 ? -1 : 1;
 	ady = lines[i].dy >> FRACBITS, dy = ady < 0 ? -1 : 1;
 
-	// difference in preferring to move across y (>0) instead of x (<0)
 	diff = !adx ? 1 : !ady ? -1 :
 	  (((x >> MAPBTOFRAC) << MAPBTOFRAC) +
 	   (dx > 0 ? MAPBLOCKUNITS-1 : 0) - x) * (ady = abs(ady)) * dx -
 	  (((y >> MAPBTOFRAC) << MAPBTOFRAC) +
 	   (dy > 0 ? MAPBLOCKUNITS-1 : 0) - y) * (adx = abs(adx)) * dy;
 
-	// starting block, and pointer to its blocklist structure
 	b = (y >> MAPBTOFRAC)*bmapwidth + (x >> MAPBTOFRAC);
 
-	// ending block
 	bend = (((lines[i].v2->y >> FRACBITS) - miny) >> MAPBTOFRAC) *
 	    bmapwidth + (((lines[i].v2->x >> FRACBITS) - minx) >> MAPBTOFRAC);
 
-	// delta for pointer when moving across y
 	dy *= bmapwidth;
 
-	// deltas for diff inside the loop
 	adx <<= MAPBTOFRAC;
 	ady <<= MAPBTOFRAC;
 
-	// Now we simply iterate block-by-block until we reach the end block.
-	while ((unsigned) b < tot)    // failsafe -- should ALWAYS be true
+	while ((unsigned) b < tot)
 	  {
-	    // Increase size of allocated list if necessary
 	    if (bmap[b].n >= bmap[b].nalloc)
 	    {
           size_t elem_size = sizeof (*(bmap->list));
@@ -128,16 +451,14 @@ void P_CreateBlockMap(void)
           size_t new_size =  (bmap[b].nalloc ? bmap[b].nalloc * 2 : 8)* elem_size;
 
           bmap[b].list = static_cast<int*>( I_Realloc(bmap[b].list, new_size) );
+          bmap[b].nalloc = new_size / elem_size;
       }
 
-	    // Add linedef to end of list
 	    bmap[b].list[bmap[b].n++] = i;
 
-	    // If we have reached the last block, exit
 	    if (b == bend)
 	      break;
 
-	    // Move in either the x or y direction to the next block
 	    if (diff < 0)
 	      diff += ady, b += dx;
 	    else
@@ -145,56 +466,251 @@ void P_CreateBlockMap(void)
 	  }
       }
 
-    // Compute the total size of the blockmap.
-    //
-    // Compression of empty blocks is performed by reserving two offset words
-    // at tot and tot+1.
-    //
-    // 4 words, unused if this routine is called, are reserved at the start.
-
     {
-      int count = tot+6;  // we need at least 1 word per block, plus reserved's
+      int count = tot+6;
 
       for (i = 0; i < static_cast<int>(tot); i++)
 	if (bmap[i].n)
-	  count += bmap[i].n + 2; // 1 header word + 1 trailer word + blocklist
+	  count += bmap[i].n + 2;
 
-      // Allocate blockmap lump with computed count
-      blockmaplump = zmalloc<decltype(blockmaplump)>(sizeof(*blockmaplump) * count, PU_LEVEL, 0);
+      blockmaplump = static_cast<int32_t *>(calloc(count, sizeof(*blockmaplump)));
+      build->lump = blockmaplump;
+      build->count = count;
     }
 
-    // Now compress the blockmap.
     {
-      int ndx = tot += 4;         // Advance index to start of linedef lists
-      bmap_t *bp = bmap;          // Start of uncompressed blockmap
+      int ndx = tot += 4;
+      bmap_t *bp = bmap;
 
-      blockmaplump[ndx++] = 0;    // Store an empty blockmap list at start
-      blockmaplump[ndx++] = -1;   // (Used for compression)
+      blockmaplump[ndx++] = 0;
+      blockmaplump[ndx++] = -1;
 
       for (i = 4; i < static_cast<int>(tot); i++, bp++)
-	      if (bp->n)                                      // Non-empty blocklist
+	      if (bp->n)
         {
-          blockmaplump[blockmaplump[i] = ndx++] = 0;  // Store index & header
+          blockmaplump[blockmaplump[i] = ndx++] = 0;
           do
-            blockmaplump[ndx++] = bp->list[--bp->n];  // Copy linedef list
+            blockmaplump[ndx++] = bp->list[--bp->n];
           while (bp->n);
-          blockmaplump[ndx++] = -1;                   // Store trailer
-          free(bp->list);                             // Free linedef list
+          blockmaplump[ndx++] = -1;
+          free(bp->list);
         }
-	      else            // Empty blocklist: point to reserved empty blocklist
+	      else
 	        blockmaplump[i] = tot;
 
-      free(bmap);    // Free uncompressed blockmap
+      free(bmap);
     }
   }
+}
 
-  // [crispy] copied over from P_LoadBlockMap()
+static unsigned int rand_state = 1;
+
+static int Random(int range)
+{
+  rand_state = rand_state * 1103515245 + 12345;
+  return (rand_state >> 8) % range;
+}
+
+// A made-up map of 16384x16384 units: mostly short linedefs as in
+// detailed areas, with some long ones crossing many blocks.
+
+static void MakeUpMap(int count)
+{
+  int i, len;
+
+  numvertexes = count * 2;
+  vertexes = static_cast<vertex_t *>(calloc(numvertexes, sizeof(vertex_t)));
+  numlines = count;
+  lines = static_cast<line_t *>(calloc(numlines, sizeof(line_t)));
+
+  for (i = 0; i < count; i++)
   {
-    int count = sizeof(*blocklinks) * bmapwidth * bmapheight;
-    blocklinks = zmalloc<decltype(blocklinks)>(count, PU_LEVEL, 0);
-    memset(blocklinks, 0, count);
-    blockmap = blockmaplump+4;
+    len = Random(10) == 0 ? 4096 : 128;
+    vertexes[2*i].x = (Random(16384) - 8192) << FRACBITS;
+    vertexes[2*i].y = (Random(16384) - 8192) << FRACBITS;
+    vertexes[2*i+1].x = vertexes[2*i].x + ((Random(2 * len) - len) << FRACBITS);
+    vertexes[2*i+1].y = vertexes[2*i].y + ((Random(2 * len) - len) << FRACBITS);
   }
 
-  fprintf(stderr, "+BLOCKMAP)\n");
+  for (i = 0; i < count; i++)
+  {
+    lines[i].v1 = &vertexes[2*i];
+    lines[i].v2 = &vertexes[2*i+1];
+  }
+}
+
+static byte *ReadMapLump(FILE *fstream, const byte *dir, int numentries,
+                         int maplump, const char *name, int *len)
+{
+  const byte *entry;
+  byte *data;
+  int i, pos;
+
+  for (i = maplump + 1; i < numentries && i <= maplump + ML_BLOCKMAP + 1; i++)
+  {
+    entry = dir + 16 * i;
+
+    if (!strncasecmp(reinterpret_cast<const char *>(entry + 8), name, 8))
+    {
+      pos = entry[0] | (entry[1] << 8) | (entry[2] << 16) | (entry[3] << 24);
+      *len = entry[4] | (entry[5] << 8) | (entry[6] << 16) | (entry[7] << 24);
+      data = static_cast<byte *>(malloc(*len));
+      fseek(fstream, pos, SEEK_SET);
+
+      if (fread(data, 1, *len, fstream) != static_cast<size_t>(*len))
+        break;
+
+      return data;
+    }
+  }
+
+  I_Error("Failed to read %s", name);
+  return nullptr;
+}
+
+static void LoadMap(const char *filename, const char *mapname)
+{
+  FILE *fstream;
+  byte header[12], *dir, *data;
+  int numentries, dirpos, maplump, len, recsize, i;
+  boolean hexen;
+
+  fstream = fopen(filename, "rb");
+
+  if (fstream == nullptr || fread(header, 1, 12, fstream) != 12)
+    I_Error("Failed to read %s", filename);
+
+  numentries = header[4] | (header[5] << 8) | (header[6] << 16) | (header[7] << 24);
+  dirpos = header[8] | (header[9] << 8) | (header[10] << 16) | (header[11] << 24);
+  dir = static_cast<byte *>(malloc(numentries * 16));
+  fseek(fstream, dirpos, SEEK_SET);
+
+  if (fread(dir, 16, numentries, fstream) != static_cast<size_t>(numentries))
+    I_Error("Failed to read the directory of %s", filename);
+
+  for (maplump = numentries - 1; maplump >= 0; maplump--)
+    if (!strncasecmp(reinterpret_cast<char *>(dir + 16 * maplump + 8), mapname, 8))
+      break;
+
+  if (maplump < 0)
+    I_Error("%s not found in %s", mapname, filename);
+
+  data = ReadMapLump(fstream, dir, numentries, maplump, "VERTEXES", &len);
+  numvertexes = len / 4;
+  vertexes = static_cast<vertex_t *>(calloc(numvertexes, sizeof(vertex_t)));
+
+  for (i = 0; i < numvertexes; i++)
+  {
+    vertexes[i].x = static_cast<short>(data[4*i] | (data[4*i+1] << 8)) << FRACBITS;
+    vertexes[i].y = static_cast<short>(data[4*i+2] | (data[4*i+3] << 8)) << FRACBITS;
+  }
+
+  free(data);
+
+  // Doom format linedefs are 14 bytes long, Hexen format ones 16.
+
+  hexen = maplump + ML_BLOCKMAP + 1 < numentries
+       && !strncasecmp(reinterpret_cast<char *>(dir + 16 * (maplump + ML_BLOCKMAP + 1) + 8),
+                       "BEHAVIOR", 8);
+  recsize = hexen ? 16 : 14;
+
+  data = ReadMapLump(fstream, dir, numentries, maplump, "LINEDEFS", &len);
+  numlines = len / recsize;
+  lines = static_cast<line_t *>(calloc(numlines, sizeof(line_t)));
+
+  for (i = 0; i < numlines; i++)
+  {
+    const byte *ml = data + i * recsize;
+    unsigned short v1 = ml[0] | (ml[1] << 8);
+    unsigned short v2 = ml[2] | (ml[3] << 8);
+
+    lines[i].v1 = &vertexes[v1 < numvertexes ? v1 : 0];
+    lines[i].v2 = &vertexes[v2 < numvertexes ? v2 : 0];
+  }
+
+  free(data);
+  free(dir);
+  fclose(fstream);
+}
+
+static int TimeBuild(void (*func)(blockmap_build_t *, int), int numjobs,
+                     blockmap_build_t *result)
+{
+  blockmap_build_t build;
+  int start, best, i, t;
+
+  best = INT_MAX;
+
+  for (i = 0; i < BENCH_RUNS; i++)
+  {
+    start = I_GetTimeMS();
+    func(&build, numjobs);
+    t = I_GetTimeMS() - start;
+    best = MIN(best, t);
+
+    if (i < BENCH_RUNS - 1)
+      free(build.lump);
+  }
+
+  *result = build;
+
+  return best;
+}
+
+static void RefBuild(blockmap_build_t *build, int numjobs)
+{
+  RefBuildBlockMap(build);
+}
+
+int main(int argc, char *argv[])
+{
+  blockmap_build_t ref, build;
+  int i, t, numjobs;
+
+  myargc = argc;
+  myargv = argv;
+  Z_Init();
+
+  if (argc > 2)
+    LoadMap(argv[1], argv[2]);
+  else
+    MakeUpMap(200000);
+
+  for (i = 0; i < numlines; i++)
+  {
+    lines[i].dx = lines[i].v2->x - lines[i].v1->x;
+    lines[i].dy = lines[i].v2->y - lines[i].v1->y;
+  }
+
+  printf("%d linedefs, %d vertexes, %d CPUs, best of %d runs\n",
+         numlines, numvertexes, SDL_GetCPUCount(), BENCH_RUNS);
+
+  t = TimeBuild(RefBuild, 1, &ref);
+  printf("per-block lists:   %4d ms, %d blocks, %d words\n",
+         t, ref.width * ref.height, ref.count);
+
+  for (numjobs = 1; numjobs <= BLOCKMAP_MAX_THREADS; numjobs *= 2)
+  {
+    t = TimeBuild(BuildBlockMap, numjobs, &build);
+    printf("count-then-fill:   %4d ms, %d thread%s\n",
+           t, numjobs, numjobs == 1 ? "" : "s");
+
+    if (build.width != ref.width || build.height != ref.height
+     || build.orgx != ref.orgx || build.orgy != ref.orgy
+     || build.count != ref.count
+     || memcmp(build.lump + 4, ref.lump + 4,
+               (ref.count - 4) * sizeof(*ref.lump)))
+    {
+      printf("Blockmap differs from the per-block lists!\n");
+      return 1;
+    }
+
+    free(build.lump);
+  }
+
+  free(ref.lump);
+
+  return 0;
 }
+
+#endif
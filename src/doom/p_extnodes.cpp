@@ -22,6 +22,7 @@
 #include "p_local.hpp"
 #include "i_swap.hpp"
 #include "i_system.hpp"
+#include "w_preload.hpp"
 #include "w_wad.hpp"
 #include "z_zone.hpp"
 
@@ -235,6 +236,68 @@ void P_LoadNodes_DeePBSP (int lump)
   W_ReleaseLumpNum(lump);
 }
 
+// [crispy] inflate a compressed ZDBSP nodes lump into a malloc'd buffer;
+// this does not use the zone memory, so it can run on the preload thread
+byte *P_InflateNodes (const byte *data, int len, int *outlen)
+{
+#ifdef HAVE_LIBZ
+    z_stream zstream;
+    byte *output, *newoutput;
+    int size, err;
+
+    if (len < 4 || memcmp(data, "ZNOD", 4))
+	return nullptr;
+
+    // first estimate for compression rate:
+    // output buffer size == 2.5 * input size
+    size = 2.5 * len;
+    output = static_cast<byte *>(malloc(size));
+
+    if (output == nullptr)
+	return nullptr;
+
+    // initialize stream state for decompression
+    memset(&zstream, 0, sizeof(zstream));
+    zstream.next_in = const_cast<byte *>(data) + 4;
+    zstream.avail_in = len - 4;
+    zstream.next_out = output;
+    zstream.avail_out = size;
+
+    if (inflateInit(&zstream) != Z_OK)
+    {
+	free(output);
+	return nullptr;
+    }
+
+    // resize if output buffer runs full
+    while ((err = inflate(&zstream, Z_SYNC_FLUSH)) == Z_OK)
+    {
+	int size_old = size;
+	size = 2 * size_old;
+	newoutput = static_cast<byte *>(realloc(output, size));
+
+	if (newoutput == nullptr)
+	    break;
+
+	output = newoutput;
+	zstream.next_out = output + size_old;
+	zstream.avail_out = size - size_old;
+    }
+
+    *outlen = zstream.total_out;
+
+    if (inflateEnd(&zstream) != Z_OK || err != Z_STREAM_END)
+    {
+	free(output);
+	return nullptr;
+    }
+
+    return output;
+#else
+    return nullptr;
+#endif
+}
+
 // [crispy] support maps with compressed or uncompressed ZDBSP nodes
 // adapted from prboom-plus/src/p_setup.c:1040-1331
 // heavily modified, condensed and simplyfied
@@ -258,63 +321,41 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
     unsigned int numNodes;
     vertex_t *newvertarray = nullptr;
 
-    data = W_CacheLumpNum_cast<decltype(data)>(lump, PU_LEVEL);
-
     // 0. Uncompress nodes lump (or simply skip header)
 
     if (compressed)
     {
 #ifdef HAVE_LIBZ
-	const int len =  W_LumpLength(lump);
-	int outlen, err;
-	z_stream *zstream;
-
-	// first estimate for compression rate:
-	// output buffer size == 2.5 * input size
-	outlen = 2.5 * len;
-	output = zmalloc<decltype(	output)>(outlen, PU_STATIC, 0);
-
-	// initialize stream state for decompression
-	zstream = (decltype(	zstream)) malloc(sizeof(*zstream));
-	memset(zstream, 0, sizeof(*zstream));
-	zstream->next_in = data + 4;
-	zstream->avail_in = len - 4;
-	zstream->next_out = output;
-	zstream->avail_out = outlen;
-
-	if (inflateInit(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression initialization!");
-
-	// resize if output buffer runs full
-	while ((err = inflate(zstream, Z_SYNC_FLUSH)) == Z_OK)
+	int outlen;
+
+	// [crispy] the nodes may have been inflated while the
+	// intermission screen was still up
+	output = W_TakeDecodedLump(lump, &outlen);
+
+	if (output == nullptr)
 	{
-	    int outlen_old = outlen;
-	    outlen = 2 * outlen_old;
-	    output = (decltype(	    output)) I_Realloc(output, outlen);
-	    zstream->next_out = output + outlen_old;
-	    zstream->avail_out = outlen - outlen_old;
-	}
+	    data = W_CacheLumpNum_cast<decltype(data)>(lump, PU_LEVEL);
+	    output = P_InflateNodes(data, W_LumpLength(lump), &outlen);
+
+	    if (output == nullptr)
+		I_Error("P_LoadNodes: Error during ZDBSP nodes decompression!");
 
-	if (err != Z_STREAM_END)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression!");
+	    // release the original data lump
+	    W_ReleaseLumpNum(lump);
+	}
 
 	fprintf(stderr, "P_LoadNodes: ZDBSP nodes compression ratio %.3f\n",
-	        (float)zstream->total_out/zstream->total_in);
+	        (float)outlen/(W_LumpLength(lump) - 4));
 
 	data = output;
-
-	if (inflateEnd(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression shut-down!");
-
-	// release the original data lump
-	W_ReleaseLumpNum(lump);
-	free(zstream);
 #else
 	I_Error("P_LoadNodes: Compressed ZDBSP nodes are not supported!");
 #endif
     }
     else
     {
+	data = W_CacheLumpNum_cast<decltype(data)>(lump, PU_LEVEL);
+
 	// skip header
 	data += 4;
     }
@@ -489,7 +530,7 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
 
 #ifdef HAVE_LIBZ
     if (compressed)
-	Z_Free(output);
+	free(output);
     else
 #endif
     W_ReleaseLumpNum(lump);
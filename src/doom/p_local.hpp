@@ -286,6 +286,22 @@ extern mobj_t**		blocklinks;	// for thing chains
 // [crispy] factor out map lump name and number finding into a separate function
 extern int P_GetNumForMap (int episode, int map, boolean critical);
 
+// [crispy] blockmap built in malloc'd memory by P_BuildBlockMap(), which
+// only reads the vertexes and linedefs and so can run on a worker thread
+typedef struct
+{
+    fixed_t	orgx;
+    fixed_t	orgy;
+    int		width;
+    int		height;
+    int32_t*	lump;
+    int		count;
+} blockmap_build_t;
+
+void P_BuildBlockMap (blockmap_build_t *build);
+void P_InstallBlockMap (blockmap_build_t *build);
+void P_CreateBlockMap (void);
+
 // [crispy] blinking key or skull in the status bar
 #define KEYBLINKMASK 0x8
 #define KEYBLINKTICS (7*KEYBLINKMASK)
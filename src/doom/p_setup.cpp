@@ -22,6 +22,8 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <SDL.h>
+
 #include "z_zone.hpp"
 
 #include "deh_main.hpp"
@@ -33,6 +35,7 @@
 #include "g_game.hpp"
 
 #include "i_system.hpp"
+#include "w_preload.hpp"
 #include "w_wad.hpp"
 
 #include "doomdef.hpp"
@@ -309,9 +312,8 @@ void P_SegLengths (boolean contrast_only)
 		li->length = (uint32_t)(sqrt((double)dx*dx + (double)dy*dy)/2);
 
 		// [crispy] re-calculate angle used for rendering
-		viewx = li->v1->r_x;
-		viewy = li->v1->r_y;
-		li->r_angle = R_PointToAngleCrispy(li->v2->r_x, li->v2->r_y);
+		li->r_angle = R_PointToAngleCrispy2(li->v1->r_x, li->v1->r_y,
+		                                    li->v2->r_x, li->v2->r_y);
 		// [crispy] more than just a little adjustment?
 		// back to the original angle then
 		if (anglediff(li->r_angle, li->angle) > ANG60/2)
@@ -1104,6 +1106,78 @@ int P_GetNumForMap (int episode, int map, boolean critical)
 // pointer to the current map lump info struct
 lumpinfo_t *maplumpinfo;
 
+// [crispy] steps of the level setup that only depend on data that has
+// already been loaded are run on worker threads, while the main thread
+// goes on loading; and the lumps of the next level are read ahead
+static boolean async_setup;
+
+static SDL_Thread *P_StartJob (SDL_ThreadFunction func, const char *name,
+                               void *data)
+{
+    SDL_Thread *thread = nullptr;
+
+    if (async_setup)
+    {
+	thread = SDL_CreateThread(func, name, data);
+    }
+
+    // [crispy] no thread, so just do it now
+    if (thread == nullptr)
+    {
+	func(data);
+    }
+
+    return thread;
+}
+
+static void P_FinishJob (SDL_Thread **thread)
+{
+    if (*thread != nullptr)
+    {
+	SDL_WaitThread(*thread, nullptr);
+	*thread = nullptr;
+    }
+}
+
+static int P_BuildBlockMapJob (void *data)
+{
+    P_BuildBlockMap(static_cast<blockmap_build_t *>(data));
+    return 0;
+}
+
+static int P_SegLengthsJob (void *data)
+{
+    P_SegLengths(false);
+    return 0;
+}
+
+void P_PreloadLevel (int episode, int map)
+{
+    int lumpnum, i;
+
+    if (!async_setup)
+    {
+	return;
+    }
+
+    W_FinishPreload();
+
+    lumpnum = P_GetNumForMap(episode, map, false);
+
+    if (lumpnum < 0)
+    {
+	return;
+    }
+
+    // [crispy] compressed ZDBSP nodes are inflated right away
+    for (i = ML_THINGS; i <= ML_BLOCKMAP; i++)
+    {
+	W_PreloadLump(lumpnum + i, i == ML_NODES ? P_InflateNodes : nullptr);
+    }
+
+    W_StartPreload();
+}
+
 //
 // P_SetupLevel
 //
@@ -1119,6 +1193,9 @@ P_SetupLevel
     int		lumpnum;
     boolean	crispy_validblockmap;
     mapformat_t	crispy_mapformat;
+    blockmap_build_t blockmap_build;
+    SDL_Thread	*blockmap_job = nullptr;
+    SDL_Thread	*seglengths_job = nullptr;
 	
     totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
     // [crispy] count spawned monsters
@@ -1181,6 +1258,7 @@ P_SetupLevel
     musinfo.from_savegame = false;
 
     Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    W_ReleasePrefetchedLumps ();
 
     // UNUSED W_Profile ();
     P_InitThinkers ();
@@ -1251,14 +1329,18 @@ P_SetupLevel
 	P_LoadLineDefs_Hexen (lumpnum+ML_LINEDEFS);
     else
     P_LoadLineDefs (lumpnum+ML_LINEDEFS);
-    // [crispy] (re-)create BLOCKMAP if necessary
+    // [crispy] (re-)create BLOCKMAP if necessary,
+    // while the nodes are loaded
     if (!crispy_validblockmap)
     {
-	extern void P_CreateBlockMap (void);
-	P_CreateBlockMap();
+	blockmap_job = P_StartJob(P_BuildBlockMapJob, "blockmap", &blockmap_build);
     }
     if (crispy_mapformat & (MFMT_ZDBSPX | MFMT_ZDBSPZ))
+    {
+	// [crispy] ZDBSP nodes may add vertexes, which the blockmap must not see
+	P_FinishJob(&blockmap_job);
 	P_LoadNodes_ZDBSP (lumpnum+ML_NODES, crispy_mapformat & MFMT_ZDBSPZ);
+    }
     else
     if (crispy_mapformat & MFMT_DEEPBSP)
     {
@@ -1273,13 +1355,20 @@ P_SetupLevel
     P_LoadSegs (lumpnum+ML_SEGS);
     }
 
+    if (!crispy_validblockmap)
+    {
+	P_FinishJob(&blockmap_job);
+	P_InstallBlockMap(&blockmap_build);
+    }
+
     P_GroupLines ();
     P_LoadReject (lumpnum+ML_REJECT);
 
     // [crispy] remove slime trails
     P_RemoveSlimeTrails();
-    // [crispy] fix long wall wobble
-    P_SegLengths(false);
+    // [crispy] fix long wall wobble,
+    // while the things are spawned
+    seglengths_job = P_StartJob(P_SegLengthsJob, "seglengths", nullptr);
     // [crispy] blinking key or skull in the status bar
     memset(st_keyorskull, 0, sizeof(st_keyorskull));
 
@@ -1320,6 +1409,11 @@ P_SetupLevel
     if (precache)
 	R_PrecacheLevel ();
 
+    P_FinishJob(&seglengths_job);
+
+    // [crispy] drop whatever was read ahead and not used
+    W_FinishPreload();
+
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
 
 }
@@ -1331,6 +1425,15 @@ P_SetupLevel
 //
 void P_Init (void)
 {
+    //!
+    // @category obscure
+    //
+    // Set up levels on the main thread only, and don't read the next
+    // level ahead during the intermission.
+    //
+
+    async_setup = !M_ParmExists("-noasyncload");
+
     P_InitSwitchList ();
     P_InitPicAnims ();
     R_InitSprites (sprnames);
@@ -35,6 +35,9 @@ P_SetupLevel
   int		playermask,
   skill_t	skill);
 
+// [crispy] Start reading the lumps of the next level in the background.
+void P_PreloadLevel (int episode, int map);
+
 // Called by startup code.
 void P_Init (void);
 
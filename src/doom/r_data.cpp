@@ -40,6 +40,11 @@
 #include "r_data.hpp"
 #include "v_trans.hpp" // [crispy] tranmap, CRMAX
 #include "r_bmaps.hpp" // [crispy] R_BrightmapForTexName()
+#include "i_timer.hpp"
+#include "m_argv.hpp"
+#include "m_config.hpp" // [crispy] configdir
+#include "sha1.hpp"
+#include "w_checksum.hpp"
 
 #include "../../utils/memory.hpp"
 //
@@ -401,6 +406,21 @@ void R_GenerateComposite (int texnum)
 
 
 
+//
+// R_CheckPatchFormat
+// [crispy] detect patches in PNG format... and fail
+//
+static void R_CheckPatchFormat (int lump, const void *data)
+{
+    const unsigned char *magic = (const unsigned char *) data;
+
+    if (magic[0] == 0x89 &&
+        magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G')
+    {
+	I_Error("Patch in PNG format detected: %.8s", lumpinfo[lump]->name);
+    }
+}
+
 //
 // R_GenerateLookup
 //
@@ -452,15 +472,7 @@ void R_GenerateLookup (int texnum)
 	x2 = x1 + SHORT(realpatch->width);
 
 	// [crispy] detect patches in PNG format... and fail
-	{
-		const unsigned char *magic = (const unsigned char *) realpatch;
-
-		if (magic[0] == 0x89 &&
-		    magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G')
-		{
-			I_Error("Patch in PNG format detected: %.8s", lumpinfo[patch->patch]->name);
-		}
-	}
+	R_CheckPatchFormat(patch->patch, realpatch);
 	
 	if (x1 < 0)
 	    x = 0;
@@ -671,6 +683,58 @@ static void GenerateTextureHashTable(void)
 }
 
 
+// [crispy] allocate the per-texture arrays for numtextures textures
+static void AllocTextureArrays(void)
+{
+    textures = zmalloc<decltype(    textures)>(numtextures * sizeof(*textures), PU_STATIC, 0);
+    texturecolumnlump = zmalloc<decltype(    texturecolumnlump)>(numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
+    texturecolumnofs = zmalloc<decltype(    texturecolumnofs)>(numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
+    texturecolumnofs2 = zmalloc<decltype(    texturecolumnofs2)>(numtextures * sizeof(*texturecolumnofs2), PU_STATIC, 0);
+    texturecomposite = zmalloc<decltype(    texturecomposite)>(numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
+    texturecomposite2 = zmalloc<decltype(    texturecomposite2)>(numtextures * sizeof(*texturecomposite2), PU_STATIC, 0);
+    texturecompositesize = zmalloc<decltype(    texturecompositesize)>(numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
+    texturewidthmask = zmalloc<decltype(    texturewidthmask)>(numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
+    texturewidth = zmalloc<decltype(    texturewidth)>(numtextures * sizeof(*texturewidth), PU_STATIC, 0);
+    textureheight = zmalloc<decltype(    textureheight)>(numtextures * sizeof(*textureheight), PU_STATIC, 0);
+    texturebrightmap = zmalloc<decltype(    texturebrightmap)>(numtextures * sizeof(*texturebrightmap), PU_STATIC, 0);
+}
+
+// [crispy] allocate the column lookups of texture i and set up the
+// values derived from its size
+static void InitTextureColumns(int i)
+{
+    texture_t *texture = textures[i];
+    int j;
+
+    texturecolumnlump[i] = zmalloc<decltype(texturecolumnlump[i])>(texture->width*sizeof(**texturecolumnlump), PU_STATIC,0);
+    texturecolumnofs[i] = zmalloc<decltype(texturecolumnofs[i])>(texture->width*sizeof(**texturecolumnofs), PU_STATIC,0);
+    texturecolumnofs2[i] = zmalloc<decltype(texturecolumnofs2[i])>(texture->width*sizeof(**texturecolumnofs2), PU_STATIC,0);
+
+    j = 1;
+    while (j*2 <= texture->width)
+	j<<=1;
+
+    texturewidthmask[i] = j-1;
+    textureheight[i] = texture->height<<FRACBITS;
+
+    // [crispy] texture width for wrapping column getter function
+    texturewidth[i] = texture->width;
+}
+
+static void FinishTextures(void)
+{
+    int i;
+
+    // Create translation table for global animation.
+    texturetranslation = zmalloc<decltype(    texturetranslation)>((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
+    
+    for (i=0 ; i<numtextures ; i++)
+	texturetranslation[i] = i;
+
+    GenerateTextureHashTable();
+}
+
+
 //
 // R_InitTextures
 // Initializes the texture list
@@ -856,17 +920,7 @@ void R_InitTextures (void)
     // [crispy] pointer to (i.e. actually before) the first texture file
     texturelump = texturelumps - 1; // [crispy] gets immediately increased below
 
-    textures = zmalloc<decltype(    textures)>(numtextures * sizeof(*textures), PU_STATIC, 0);
-    texturecolumnlump = zmalloc<decltype(    texturecolumnlump)>(numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
-    texturecolumnofs = zmalloc<decltype(    texturecolumnofs)>(numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
-    texturecolumnofs2 = zmalloc<decltype(    texturecolumnofs2)>(numtextures * sizeof(*texturecolumnofs2), PU_STATIC, 0);
-    texturecomposite = zmalloc<decltype(    texturecomposite)>(numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
-    texturecomposite2 = zmalloc<decltype(    texturecomposite2)>(numtextures * sizeof(*texturecomposite2), PU_STATIC, 0);
-    texturecompositesize = zmalloc<decltype(    texturecompositesize)>(numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
-    texturewidthmask = zmalloc<decltype(    texturewidthmask)>(numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
-    texturewidth = zmalloc<decltype(    texturewidth)>(numtextures * sizeof(*texturewidth), PU_STATIC, 0);
-    textureheight = zmalloc<decltype(    textureheight)>(numtextures * sizeof(*textureheight), PU_STATIC, 0);
-    texturebrightmap = zmalloc<decltype(    texturebrightmap)>(numtextures * sizeof(*texturebrightmap), PU_STATIC, 0);
+    AllocTextureArrays();
 
     //	Really complex printing shit...
     temp1 = W_GetNumForName (DEH_String("S_START"));  // P_???????
@@ -953,19 +1007,7 @@ void R_InitTextures (void)
 		patch->patch = W_CheckNumForName("WIPCNT"); // [crispy] dummy patch
 	    }
 	}		
-	texturecolumnlump[i] = zmalloc<decltype(texturecolumnlump[i])>(texture->width*sizeof(**texturecolumnlump), PU_STATIC,0);
-	texturecolumnofs[i] = zmalloc<decltype(	texturecolumnofs[i])>(texture->width*sizeof(**texturecolumnofs), PU_STATIC,0);
-	texturecolumnofs2[i] = zmalloc<decltype(texturecolumnofs2[i])>(texture->width*sizeof(**texturecolumnofs2), PU_STATIC,0);
-
-	j = 1;
-	while (j*2 <= texture->width)
-	    j<<=1;
-
-	texturewidthmask[i] = j-1;
-	textureheight[i] = texture->height<<FRACBITS;
-
-	// [crispy] texture width for wrapping column getter function
-	texturewidth[i] = texture->width;
+	InitTextureColumns(i);
     }
 
     Z_Free(patchlookup);
@@ -982,13 +1024,7 @@ void R_InitTextures (void)
     for (i=0 ; i<numtextures ; i++)
 	R_GenerateLookup (i);
     
-    // Create translation table for global animation.
-    texturetranslation = zmalloc<decltype(    texturetranslation)>((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
-    
-    for (i=0 ; i<numtextures ; i++)
-	texturetranslation[i] = i;
-
-    GenerateTextureHashTable();
+    FinishTextures();
 }
 
 
@@ -1043,6 +1079,355 @@ void R_InitSpriteLumps (void)
     }
 }
 
+//
+// [crispy] texture cache
+//
+// R_InitTextures and R_InitSpriteLumps have to look at every patch and
+// sprite in the WAD set, which with a stack of PWADs is a good part of
+// the startup time. Their results only depend on the WAD files, so
+// they are saved to the config directory and loaded from there on the
+// next start with the same set of files.
+//
+
+#define TEXCACHE_FILENAME "texcache.dat"
+#define TEXCACHE_MAGIC    "CRTEXCCH"
+#define TEXCACHE_VERSION  1
+
+typedef struct
+{
+    char magic[8];
+    int version;
+    sha1_digest_t key;
+    int indextime;      // ms it took to build the cached data
+    int numtextures;
+    int numspritelumps;
+} texcache_header_t;
+
+static sha1_digest_t texcache_key;
+
+static char *TextureCachePath(void)
+{
+    return M_StringJoin(configdir, TEXCACHE_FILENAME, nullptr);
+}
+
+// The cached lump numbers are only valid for the same lump directory,
+// and the cached sizes and offsets for the same lump contents. Any
+// DEHACKED renaming of the lumps that are looked up by name changes
+// the result as well.
+
+static void TextureCacheKey(sha1_digest_t key)
+{
+    static const char *const names[] = {
+        "TEXTURE1", "TEXTURE2", "PNAMES", "S_START", "S_END",
+    };
+    sha1_context_t context;
+    sha1_digest_t files;
+    int i;
+
+    W_ChecksumFiles(files);
+
+    SHA1_Init(&context);
+    SHA1_Update(&context, files, sizeof(files));
+    SHA1_UpdateInt32(&context, firstflat);
+    SHA1_UpdateInt32(&context, lastflat);
+
+    for (i = 0; i < (int) arrlen(names); i++)
+    {
+        SHA1_UpdateString(&context, (char *) DEH_String(names[i]));
+    }
+
+    SHA1_Final(key, &context);
+}
+
+static boolean ReadCacheData(byte **p, const byte *end, void *dest, size_t len)
+{
+    if (len > (size_t) (end - *p))
+    {
+        return false;
+    }
+
+    memcpy(dest, *p, len);
+    *p += len;
+    return true;
+}
+
+static boolean ParseTextureCache(byte *p, const byte *end)
+{
+    texture_t *texture;
+    short dims[3];
+    int i, x;
+
+    for (i = 0; i < numtextures; i++)
+    {
+	char name[8];
+
+	if (!ReadCacheData(&p, end, name, sizeof(name))
+	 || !ReadCacheData(&p, end, dims, sizeof(dims))
+	 || dims[0] <= 0 || dims[2] <= 0)
+	{
+	    return false;
+	}
+
+	texture = textures[i] = (texture_t*)Z_Malloc (sizeof(texture_t) + sizeof(texpatch_t) * (dims[2]-1), PU_STATIC, 0);
+	memcpy(texture->name, name, sizeof(texture->name));
+	texture->width = dims[0];
+	texture->height = dims[1];
+	texture->patchcount = dims[2];
+
+	texturebrightmap[i] = R_BrightmapForTexName(texture->name);
+
+	InitTextureColumns(i);
+	texturecomposite[i] = 0;
+	texturecomposite2[i] = 0;
+
+	if (!ReadCacheData(&p, end, texture->patches,
+	                   texture->patchcount * sizeof(texpatch_t))
+	 || !ReadCacheData(&p, end, &texturecompositesize[i], sizeof(int))
+	 || !ReadCacheData(&p, end, texturecolumnlump[i],
+	                   texture->width * sizeof(**texturecolumnlump))
+	 || !ReadCacheData(&p, end, texturecolumnofs[i],
+	                   texture->width * sizeof(**texturecolumnofs)))
+	{
+	    return false;
+	}
+
+	for (x = 0; x < texture->patchcount; x++)
+	{
+	    if (texture->patches[x].patch < 0
+	     || (unsigned) texture->patches[x].patch >= numlumps)
+	    {
+		return false;
+	    }
+	}
+
+	for (x = 0; x < texture->width; x++)
+	{
+	    if (texturecolumnlump[i][x] >= (int) numlumps)
+	    {
+		return false;
+	    }
+
+	    texturecolumnofs2[i][x] = x * texture->height;
+	}
+    }
+
+    return ReadCacheData(&p, end, spritewidth, numspritelumps * sizeof(fixed_t))
+        && ReadCacheData(&p, end, spriteoffset, numspritelumps * sizeof(fixed_t))
+        && ReadCacheData(&p, end, spritetopoffset, numspritelumps * sizeof(fixed_t))
+        && p == end;
+}
+
+static void FreeTextures(int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+	Z_Free(textures[i]);
+	Z_Free(texturecolumnlump[i]);
+	Z_Free(texturecolumnofs[i]);
+	Z_Free(texturecolumnofs2[i]);
+    }
+
+    Z_Free(textures);
+    Z_Free(texturecolumnlump);
+    Z_Free(texturecolumnofs);
+    Z_Free(texturecolumnofs2);
+    Z_Free(texturecomposite);
+    Z_Free(texturecomposite2);
+    Z_Free(texturecompositesize);
+    Z_Free(texturewidthmask);
+    Z_Free(texturewidth);
+    Z_Free(textureheight);
+    Z_Free(texturebrightmap);
+    Z_Free(spritewidth);
+    Z_Free(spriteoffset);
+    Z_Free(spritetopoffset);
+}
+
+//
+// R_LoadTextureCache
+// Set up the textures and sprite lumps from the cache file,
+//  if there is one for the current set of WAD files.
+// Returns the time it originally took to build them, or -1.
+//
+static int R_LoadTextureCache (void)
+{
+    texcache_header_t header;
+    char *filename;
+    FILE *handle;
+    byte *data, *checked;
+    byte magic[4];
+    long length;
+    boolean ok;
+    int i, j;
+
+    TextureCacheKey(texcache_key);
+
+    filename = TextureCachePath();
+    handle = M_fopen(filename, "rb");
+    free(filename);
+
+    if (handle == nullptr)
+    {
+	return -1;
+    }
+
+    length = M_FileLength(handle) - (long) sizeof(header);
+
+    if (length < 0
+     || fread(&header, sizeof(header), 1, handle) != 1
+     || memcmp(header.magic, TEXCACHE_MAGIC, sizeof(header.magic)) != 0
+     || header.version != TEXCACHE_VERSION
+     || memcmp(header.key, texcache_key, sizeof(sha1_digest_t)) != 0
+     || header.numtextures <= 0
+     || header.numspritelumps != numspritelumps)
+    {
+	fclose(handle);
+	return -1;
+    }
+
+    data = static_cast<byte *>(malloc(length));
+
+    if (data == nullptr || fread(data, 1, length, handle) != (size_t) length)
+    {
+	free(data);
+	fclose(handle);
+	return -1;
+    }
+
+    fclose(handle);
+
+    numtextures = header.numtextures;
+    AllocTextureArrays();
+    spritewidth = zmalloc<decltype(spritewidth)>(numspritelumps*sizeof(*spritewidth), PU_STATIC, 0);
+    spriteoffset = zmalloc<decltype(spriteoffset)>(numspritelumps*sizeof(*spriteoffset), PU_STATIC, 0);
+    spritetopoffset = zmalloc<decltype(spritetopoffset)>(numspritelumps*sizeof(*spritetopoffset), PU_STATIC, 0);
+
+    // textures[] gets filled in order, each texture together with its
+    // columns; clear it so that a parse error part way through knows
+    // what to free.
+    memset(textures, 0, numtextures * sizeof(*textures));
+
+    ok = ParseTextureCache(data, data + length);
+    free(data);
+
+    if (!ok)
+    {
+	int count = 0;
+
+	while (count < numtextures && textures[count] != nullptr)
+	    count++;
+
+	FreeTextures(count);
+	fprintf(stderr, "R_LoadTextureCache: ignoring corrupt cache file\n");
+	return -1;
+    }
+
+    // R_GenerateLookup() didn't get to look at the patches; apply its
+    // PNG check once to each of them. Only the signature is read, so
+    // that the patches don't have to be loaded without mmap either.
+    checked = static_cast<byte *>(calloc(numlumps, 1));
+
+    for (i = 0; i < numtextures; i++)
+    {
+	for (j = 0; j < textures[i]->patchcount; j++)
+	{
+	    int lump = textures[i]->patches[j].patch;
+
+	    if (checked == nullptr || !checked[lump])
+	    {
+		memset(magic, 0, sizeof(magic));
+		W_Read(lumpinfo[lump]->wad_file, lumpinfo[lump]->position,
+		       magic, MIN(sizeof(magic), (size_t) lumpinfo[lump]->size));
+		R_CheckPatchFormat(lump, magic);
+
+		if (checked != nullptr)
+		    checked[lump] = 1;
+	    }
+	}
+    }
+
+    free(checked);
+
+    FinishTextures();
+
+    return header.indextime;
+}
+
+//
+// R_SaveTextureCache
+// Write what R_InitTextures and R_InitSpriteLumps found to the cache.
+//
+static void R_SaveTextureCache (int indextime)
+{
+    texcache_header_t header;
+    texture_t *texture;
+    char *filename, *tempname;
+    FILE *handle;
+    short dims[3];
+    boolean ok;
+    int i;
+
+    filename = TextureCachePath();
+    tempname = M_StringJoin(filename, ".tmp", nullptr);
+    handle = M_fopen(tempname, "wb");
+
+    if (handle == nullptr)
+    {
+	free(tempname);
+	free(filename);
+	return;
+    }
+
+    memcpy(header.magic, TEXCACHE_MAGIC, sizeof(header.magic));
+    header.version = TEXCACHE_VERSION;
+    memcpy(header.key, texcache_key, sizeof(sha1_digest_t));
+    header.indextime = indextime;
+    header.numtextures = numtextures;
+    header.numspritelumps = numspritelumps;
+
+    ok = fwrite(&header, sizeof(header), 1, handle) == 1;
+
+    for (i = 0; ok && i < numtextures; i++)
+    {
+	texture = textures[i];
+	dims[0] = texture->width;
+	dims[1] = texture->height;
+	dims[2] = texture->patchcount;
+
+	ok = fwrite(texture->name, sizeof(texture->name), 1, handle) == 1
+	  && fwrite(dims, sizeof(dims), 1, handle) == 1
+	  && fwrite(texture->patches, sizeof(texpatch_t),
+	            texture->patchcount, handle) == (size_t) texture->patchcount
+	  && fwrite(&texturecompositesize[i], sizeof(int), 1, handle) == 1
+	  && fwrite(texturecolumnlump[i], sizeof(**texturecolumnlump),
+	            texture->width, handle) == (size_t) texture->width
+	  && fwrite(texturecolumnofs[i], sizeof(**texturecolumnofs),
+	            texture->width, handle) == (size_t) texture->width;
+    }
+
+    ok = ok
+      && fwrite(spritewidth, sizeof(fixed_t), numspritelumps, handle) == (size_t) numspritelumps
+      && fwrite(spriteoffset, sizeof(fixed_t), numspritelumps, handle) == (size_t) numspritelumps
+      && fwrite(spritetopoffset, sizeof(fixed_t), numspritelumps, handle) == (size_t) numspritelumps;
+
+    // Write to a temporary file first, so that another instance
+    // starting at the same time never sees half a cache file.
+    if (fclose(handle) == 0 && ok)
+    {
+	M_remove(filename);
+	M_rename(tempname, filename);
+    }
+    else
+    {
+	M_remove(tempname);
+    }
+
+    free(tempname);
+    free(filename);
+}
+
 #ifndef CRISPY_TRUECOLOR
 // [crispy] initialize translucency filter map
 // based in parts on the implementation from boom202s/R_DATA.C:676-787
@@ -1233,6 +1618,9 @@ void R_InitColormaps (void)
 //
 void R_InitData (void)
 {
+    int starttime, indextime;
+    boolean usecache;
+
     // [crispy] Moved R_InitFlats() to the top, because it sets firstflat/lastflat
     // which are required by R_InitTextures() to prevent flat lumps from being
     // mistaken as patches and by R_InitBrightmaps() to set brightmaps for flats.
@@ -1240,11 +1628,57 @@ void R_InitData (void)
     // to initialize brightmaps depending on gameversion in R_InitTextures().
     R_InitFlats ();
     R_InitBrightmaps ();
-    R_InitTextures ();
-    printf (".");
-//  R_InitFlats (); [crispy] moved ...
-    printf (".");
-    R_InitSpriteLumps ();
+
+    //!
+    // @category obscure
+    //
+    // Don't load the texture and sprite lookups from the cache in the
+    // config directory, nor save them there.
+    //
+
+    usecache = !M_ParmExists("-notexcache");
+
+    starttime = I_GetTimeMS();
+    indextime = -1;
+
+    if (usecache)
+    {
+	firstspritelump = W_GetNumForName (DEH_String("S_START")) + 1;
+	lastspritelump = W_GetNumForName (DEH_String("S_END")) - 1;
+	numspritelumps = lastspritelump - firstspritelump + 1;
+
+	indextime = R_LoadTextureCache ();
+    }
+
+    if (indextime >= 0)
+    {
+	if (devparm)
+	{
+	    printf ("\nR_InitData: loaded texture cache in %d ms "
+	            "(indexing took %d ms)", I_GetTimeMS() - starttime,
+	            indextime);
+	}
+    }
+    else
+    {
+	R_InitTextures ();
+	printf (".");
+//	R_InitFlats (); [crispy] moved ...
+	printf (".");
+	R_InitSpriteLumps ();
+
+	indextime = I_GetTimeMS() - starttime;
+
+	if (usecache)
+	{
+	    R_SaveTextureCache (indextime);
+	}
+
+	if (devparm)
+	{
+	    printf ("\nR_InitData: indexed textures in %d ms", indextime);
+	}
+    }
     printf (".");
     R_InitColormaps ();
 #ifndef CRISPY_TRUECOLOR
@@ -1384,7 +1818,7 @@ void R_PrecacheLevel (void)
 	{
 	    lump = firstflat + i;
 	    flatmemory += lumpinfo[lump]->size;
-	    W_CacheLumpNum(lump, PU_CACHE);
+	    W_PrefetchLumpNum(lump);
 	}
     }
 
@@ -1424,7 +1858,7 @@ void R_PrecacheLevel (void)
 	{
 	    lump = texture->patches[j].patch;
 	    texturememory += lumpinfo[lump]->size;
-	    W_CacheLumpNum(lump , PU_CACHE);
+	    W_PrefetchLumpNum(lump);
 	}
     }
 
@@ -1453,7 +1887,7 @@ void R_PrecacheLevel (void)
 	    {
 		lump = firstspritelump + sf->lump[k];
 		spritememory += lumpinfo[lump]->size;
-		W_CacheLumpNum(lump , PU_CACHE);
+		W_PrefetchLumpNum(lump);
 	    }
 	}
     }
@@ -289,14 +289,17 @@ R_PointOnSegSide
 // [crispy] turned into a general R_PointToAngle() flavor
 // called with either slope_div = SlopeDivCrispy() from R_PointToAngleCrispy()
 // or slope_div = SlopeDiv() else
-angle_t
+// [crispy] measured from (ox, oy) rather than from the view point
+static angle_t
 R_PointToAngleSlope
-( fixed_t	x,
+( fixed_t	ox,
+  fixed_t	oy,
+  fixed_t	x,
   fixed_t	y,
   int (*slope_div) (unsigned int num, unsigned int den))
 {	
-    x -= viewx;
-    y -= viewy;
+    x -= ox;
+    y -= oy;
     
     if ( (!x) && (!y) )
 	return 0;
@@ -380,7 +383,7 @@ R_PointToAngle
 ( fixed_t	x,
   fixed_t	y )
 {
-    return R_PointToAngleSlope (x, y, SlopeDiv);
+    return R_PointToAngleSlope (viewx, viewy, x, y, SlopeDiv);
 }
 
 // [crispy] overflow-safe R_PointToAngle() flavor
@@ -389,21 +392,33 @@ angle_t
 R_PointToAngleCrispy
 ( fixed_t	x,
   fixed_t	y )
+{
+    return R_PointToAngleCrispy2 (viewx, viewy, x, y);
+}
+
+// [crispy] R_PointToAngleCrispy() from (x1, y1) instead of the view point;
+// doesn't touch viewx and viewy, so P_SegLengths() can use it off the main thread
+angle_t
+R_PointToAngleCrispy2
+( fixed_t	x1,
+  fixed_t	y1,
+  fixed_t	x2,
+  fixed_t	y2 )
 {
     // [crispy] fix overflows for very long distances
-    int64_t y_viewy = (int64_t)y - viewy;
-    int64_t x_viewx = (int64_t)x - viewx;
+    int64_t y_viewy = (int64_t)y2 - y1;
+    int64_t x_viewx = (int64_t)x2 - x1;
 
     // [crispy] the worst that could happen is e.g. INT_MIN-INT_MAX = 2*INT_MIN
     if (x_viewx < INT_MIN || x_viewx > INT_MAX ||
         y_viewy < INT_MIN || y_viewy > INT_MAX)
     {
 	// [crispy] preserving the angle by halfing the distance in both directions
-	x = x_viewx / 2 + viewx;
-	y = y_viewy / 2 + viewy;
+	x2 = x_viewx / 2 + x1;
+	y2 = y_viewy / 2 + y1;
     }
 
-    return R_PointToAngleSlope (x, y, SlopeDivCrispy);
+    return R_PointToAngleSlope (x1, y1, x2, y2, SlopeDivCrispy);
 }
 
 angle_t
@@ -417,7 +432,7 @@ R_PointToAngle2
     viewy = y1;
     
     // [crispy] R_PointToAngle2() is never called during rendering
-    return R_PointToAngleSlope (x2, y2, SlopeDiv);
+    return R_PointToAngleSlope (viewx, viewy, x2, y2, SlopeDiv);
 }
 
 
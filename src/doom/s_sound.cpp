@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "i_audiostats.hpp"
 #include "i_sound.hpp"
 #include "i_system.hpp"
 
@@ -76,6 +77,16 @@ typedef struct
 
     int pitch;
 
+    // Positions and volume that the sound's parameters were last
+    // worked out from; they are only worked out again when one of
+    // these changes.
+    boolean params_valid;
+    fixed_t listener_x, listener_y;
+    angle_t listener_angle;
+    fixed_t source_x, source_y;
+    int base_volume;
+    int swing;
+
 } channel_t;
 
 // The set of channels available
@@ -83,6 +94,16 @@ typedef struct
 static channel_t *channels;
 static degenmobj_t *sobjs;
 
+// The channels that are playing, in a heap with the lowest priority
+// sound (the highest priority value) on top, and the position of each
+// channel in the heap (-1 if it is not playing). When every channel is
+// playing, the top of the heap says at once whether any of them can be
+// replaced by a new sound.
+
+static int *channel_heap;
+static int *channel_heap_pos;
+static int channel_heap_len;
+
 // Maximum volume of a sound effect.
 // Internal default is max out of 0-15.
 
@@ -232,6 +253,121 @@ static void S_RegisterAltMusic()
 	}
 }
 
+// [crispy] variable number of sound channels
+
+static void S_AllocChannels(void)
+{
+    int i;
+
+    channels = (decltype(channels)) I_Realloc(channels, snd_channels * sizeof(channel_t));
+    sobjs = (decltype(sobjs)) I_Realloc(sobjs, snd_channels * sizeof(degenmobj_t));
+    channel_heap = (decltype(channel_heap)) I_Realloc(channel_heap, snd_channels * sizeof(int));
+    channel_heap_pos = (decltype(channel_heap_pos)) I_Realloc(channel_heap_pos, snd_channels * sizeof(int));
+
+    // Free all channels for use
+    for (i = 0; i < snd_channels; i++)
+    {
+        channels[i].sfxinfo = 0;
+        channel_heap_pos[i] = -1;
+    }
+
+    channel_heap_len = 0;
+}
+
+static int ChannelHeapPriority(int pos)
+{
+    return channels[channel_heap[pos]].sfxinfo->priority;
+}
+
+static void ChannelHeapSet(int pos, int cnum)
+{
+    channel_heap[pos] = cnum;
+    channel_heap_pos[cnum] = pos;
+}
+
+static void ChannelHeapSiftUp(int pos)
+{
+    int cnum = channel_heap[pos];
+    int priority = channels[cnum].sfxinfo->priority;
+    int parent;
+
+    while (pos > 0)
+    {
+        parent = (pos - 1) / 2;
+
+        if (ChannelHeapPriority(parent) >= priority)
+        {
+            break;
+        }
+
+        ChannelHeapSet(pos, channel_heap[parent]);
+        pos = parent;
+    }
+
+    ChannelHeapSet(pos, cnum);
+}
+
+static void ChannelHeapSiftDown(int pos)
+{
+    int cnum = channel_heap[pos];
+    int priority = channels[cnum].sfxinfo->priority;
+    int child;
+
+    for (;;)
+    {
+        child = pos * 2 + 1;
+
+        if (child >= channel_heap_len)
+        {
+            break;
+        }
+
+        if (child + 1 < channel_heap_len
+         && ChannelHeapPriority(child + 1) > ChannelHeapPriority(child))
+        {
+            ++child;
+        }
+
+        if (ChannelHeapPriority(child) <= priority)
+        {
+            break;
+        }
+
+        ChannelHeapSet(pos, channel_heap[child]);
+        pos = child;
+    }
+
+    ChannelHeapSet(pos, cnum);
+}
+
+static void ChannelHeapAdd(int cnum)
+{
+    ChannelHeapSet(channel_heap_len, cnum);
+    ++channel_heap_len;
+    ChannelHeapSiftUp(channel_heap_len - 1);
+}
+
+static void ChannelHeapRemove(int cnum)
+{
+    int pos = channel_heap_pos[cnum];
+
+    channel_heap_pos[cnum] = -1;
+    --channel_heap_len;
+
+    if (pos == channel_heap_len)
+    {
+        return;
+    }
+
+    // Fill the hole with the last entry, which may need to go either
+    // way.
+
+    cnum = channel_heap[channel_heap_len];
+    ChannelHeapSet(pos, cnum);
+    ChannelHeapSiftUp(pos);
+    ChannelHeapSiftDown(channel_heap_pos[cnum]);
+}
+
 //
 // Initializes sound stuff, including volume
 // Sets channels, SFX and music volume,
@@ -267,14 +403,11 @@ void S_Init(int sfxVolume, int musicVolume)
     // (the maximum numer of sounds rendered
     // simultaneously) within zone memory.
     // [crispy] variable number of sound channels
-    channels = (decltype(    channels)) I_Realloc(nullptr, snd_channels*sizeof(channel_t));
-    sobjs = (decltype(    sobjs)) I_Realloc(nullptr, snd_channels*sizeof(degenmobj_t));
-
-    // Free all channels for use
-    for (i=0 ; i<snd_channels ; i++)
+    if (snd_channels > I_MaxSoundChannels())
     {
-        channels[i].sfxinfo = 0;
+        snd_channels = I_MaxSoundChannels();
     }
+    S_AllocChannels();
 
     // no sounds are playing, and they are not mus_paused
     mus_paused = 0;
@@ -346,6 +479,7 @@ static void S_StopChannel(int cnum)
         // degrade usefulness of sound data
 
         c->sfxinfo->usefulness--;
+        ChannelHeapRemove(cnum);
         c->sfxinfo = nullptr;
         c->origin = nullptr;
     }
@@ -358,25 +492,12 @@ static void S_StopChannel(int cnum)
 //
 static short prevmap = -1;
 
-void S_Start(void)
+// Music for a level.
+
+static int S_LevelMusic(int episode, int map)
 {
-    int cnum;
     int mnum;
 
-    // kill all playing sounds at start of level
-    //  (trust me - a good idea)
-    for (cnum=0 ; cnum<snd_channels ; cnum++)
-    {
-        if (channels[cnum].sfxinfo)
-        {
-            S_StopChannel(cnum);
-        }
-    }
-
-    // start new music for the level
-    if (musicVolume) // [crispy] do not reset pause state at zero music volume
-    mus_paused = 0;
-
     if (gamemode == GameMode_t::commercial)
     {
         const int nmus[] =
@@ -392,13 +513,13 @@ void S_Start(void)
             mus_ddtbl2,
         };
 
-        if ((gameepisode == 2 || gamemission == GameMission_t::pack_nerve) &&
-            gamemap <= arrlen(nmus))
+        if ((episode == 2 || gamemission == GameMission_t::pack_nerve) &&
+            map <= arrlen(nmus))
         {
-            mnum = nmus[gamemap - 1];
+            mnum = nmus[map - 1];
         }
         else
-        mnum = mus_runnin + gamemap - 1;
+        mnum = mus_runnin + map - 1;
     }
     else
     {
@@ -417,17 +538,17 @@ void S_Start(void)
             mus_e1m9,        // Tim          e4m9
         };
 
-        if (gameepisode < 4 || gameepisode == 5) // [crispy] Sigil
+        if (episode < 4 || episode == 5) // [crispy] Sigil
         {
-            mnum = mus_e1m1 + (gameepisode-1)*9 + gamemap-1;
+            mnum = mus_e1m1 + (episode-1)*9 + map-1;
         }
         else
         {
-            mnum = spmus[gamemap-1];
+            mnum = spmus[map-1];
 
             // [crispy] support dedicated music tracks for the 4th episode
             {
-                const int sp_mnum = mus_e1m1 + 3 * 9 + gamemap - 1;
+                const int sp_mnum = mus_e1m1 + 3 * 9 + map - 1;
 
                 if (S_music[sp_mnum].lumpnum > 0)
                 {
@@ -437,6 +558,30 @@ void S_Start(void)
         }
     }
 
+    return mnum;
+}
+
+void S_Start(void)
+{
+    int cnum;
+    int mnum;
+
+    // kill all playing sounds at start of level
+    //  (trust me - a good idea)
+    for (cnum=0 ; cnum<snd_channels ; cnum++)
+    {
+        if (channels[cnum].sfxinfo)
+        {
+            S_StopChannel(cnum);
+        }
+    }
+
+    // start new music for the level
+    if (musicVolume) // [crispy] do not reset pause state at zero music volume
+    mus_paused = 0;
+
+    mnum = S_LevelMusic(gameepisode, gamemap);
+
     // [crispy] do not change music if not changing map (preserves IDMUS choice)
     {
 	const short curmap = (gameepisode << 8) + gamemap;
@@ -453,6 +598,45 @@ void S_Start(void)
     S_ChangeMusic(mnum, true);
 }
 
+//
+// Give the music code a chance to get the music of a level ready,
+// while the intermission screen is up before it.
+//
+
+void S_PrefetchLevelMusic(int episode, int map)
+{
+    musicinfo_t *music;
+    char namebuf[9];
+    int lumpnum;
+    void *data;
+
+    if (nodrawers && singletics)
+    {
+        return;
+    }
+
+    music = &S_music[S_LevelMusic(episode, map)];
+
+    // get lumpnum if neccessary, as S_ChangeMusic() does
+    if (!music->lumpnum)
+    {
+        M_snprintf(namebuf, sizeof(namebuf), "d_%s", DEH_String(music->name));
+        lumpnum = W_CheckNumForName(namebuf);
+
+        // [crispy] leave a missing lump to S_ChangeMusic() to complain about
+        if (lumpnum < 0)
+        {
+            return;
+        }
+
+        music->lumpnum = lumpnum;
+    }
+
+    data = W_CacheLumpNum(music->lumpnum, PU_STATIC);
+    I_PrefetchSong(data, W_LumpLength(music->lumpnum));
+    W_ReleaseLumpNum(music->lumpnum);
+}
+
 void S_StopSound(mobj_t *origin)
 {
     int cnum;
@@ -524,6 +708,13 @@ static int S_GetChannel(mobj_t *origin, sfxinfo_t *sfxinfo)
     // None available
     if (cnum == snd_channels)
     {
+        // Nothing playing has as low a priority?
+        if (channel_heap_len == 0
+         || ChannelHeapPriority(0) < sfxinfo->priority)
+        {
+            return -1;
+        }
+
         // Look for lower priority
         for (cnum=0 ; cnum<snd_channels ; cnum++)
         {
@@ -550,6 +741,8 @@ static int S_GetChannel(mobj_t *origin, sfxinfo_t *sfxinfo)
     // channel is decided to be cnum.
     c->sfxinfo = sfxinfo;
     c->origin = origin;
+    c->params_valid = false;
+    ChannelHeapAdd(cnum);
 
     return cnum;
 }
@@ -577,6 +770,13 @@ static int S_AdjustSoundParams(mobj_t *listener, mobj_t *source,
     adx = abs(listener->x - source->x);
     ady = abs(listener->y - source->y);
 
+    // The distance is at least as far as along either axis, so a
+    // source that far away along one is out of range straight away.
+    if (!doom1map8 && (adx > S_CLIPPING_DIST || ady > S_CLIPPING_DIST))
+    {
+        return 0;
+    }
+
     // From _GG1_ p.428. Appox. eucledian distance fast.
     approx_dist = adx + ady - ((adx < ady ? adx : ady)>>1);
 
@@ -855,6 +1055,29 @@ void S_UpdateSounds(mobj_t *listener)
                 //  or modify their params
                 if (c->origin && listener != c->origin && c->origin != players[displayplayer].so) // [crispy] weapon sound source
                 {
+                    // Nothing to do if neither the listener nor the
+                    // source has moved since last time.
+                    if (c->params_valid
+                     && c->listener_x == listener->x
+                     && c->listener_y == listener->y
+                     && c->listener_angle == listener->angle
+                     && c->source_x == c->origin->x
+                     && c->source_y == c->origin->y
+                     && c->base_volume == volume
+                     && c->swing == stereo_swing)
+                    {
+                        continue;
+                    }
+
+                    c->params_valid = true;
+                    c->listener_x = listener->x;
+                    c->listener_y = listener->y;
+                    c->listener_angle = listener->angle;
+                    c->source_x = c->origin->x;
+                    c->source_y = c->origin->y;
+                    c->base_volume = volume;
+                    c->swing = stereo_swing;
+
                     audible = S_AdjustSoundParams(listener,
                                                   c->origin,
                                                   &volume,
@@ -878,6 +1101,8 @@ void S_UpdateSounds(mobj_t *listener)
             }
         }
     }
+
+    I_AudioStatsDepth(AUDIOSTAT_CHANNELS, channel_heap_len, snd_channels);
 }
 
 void S_SetMusicVolume(int volume)
@@ -1118,22 +1343,16 @@ void S_UpdateSndChannels (int choice)
 		snd_channels >>= 1;
 	}
 
-	if (snd_channels > 32)
+	if (snd_channels > I_MaxSoundChannels())
 	{
 		snd_channels = 8;
 	}
 	else if (snd_channels < 8)
 	{
-		snd_channels = 32;
+		snd_channels = I_MaxSoundChannels();
 	}
 
-	channels = (decltype(	channels)) I_Realloc(channels, snd_channels * sizeof(channel_t));
-	sobjs = (decltype(	sobjs)) I_Realloc(sobjs, snd_channels * sizeof(degenmobj_t));
-
-	for (i = 0; i < snd_channels; i++)
-	{
-		channels[i].sfxinfo = 0;
-	}
+	S_AllocChannels();
 }
 
 void S_UpdateStereoSeparation (void)
@@ -46,6 +46,10 @@ void S_Shutdown(void);
 
 void S_Start(void);
 
+// Get the music of a level ready to be played.
+
+void S_PrefetchLevelMusic(int episode, int map);
+
 //
 // Start sound for thing at <origin>
 //  using <sound_id> from sounds.h
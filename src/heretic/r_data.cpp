@@ -705,7 +705,7 @@ void R_PrecacheLevel(void)
         {
             lump = firstflat + i;
             flatmemory += lumpinfo[lump]->size;
-            W_CacheLumpNum(lump, PU_CACHE);
+            W_PrefetchLumpNum(lump);
         }
 
     Z_Free(flatpresent);
@@ -735,7 +735,7 @@ void R_PrecacheLevel(void)
         {
             lump = texture->patches[j].patch;
             texturememory += lumpinfo[lump]->size;
-            W_CacheLumpNum(lump, PU_CACHE);
+            W_PrefetchLumpNum(lump);
         }
     }
 
@@ -765,7 +765,7 @@ void R_PrecacheLevel(void)
             {
                 lump = firstspritelump + sf->lump[k];
                 spritememory += lumpinfo[lump]->size;
-                W_CacheLumpNum(lump, PU_CACHE);
+                W_PrefetchLumpNum(lump);
             }
         }
     }
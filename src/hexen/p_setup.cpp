@@ -700,6 +700,7 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
     }
 
     Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
+    W_ReleasePrefetchedLumps();
 
     P_InitThinkers();
     leveltime = 0;
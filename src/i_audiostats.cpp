@@ -0,0 +1,477 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Audio pipeline statistics, enabled with -audiostats.
+//
+//     The audio thread records how long the code it runs for us takes,
+//     how regularly the output device asks for more, and when sounds
+//     that have been started are first mixed. All of it is kept in
+//     atomic counters, so that recording never waits for the main
+//     thread. Times are put in histograms with a bucket for each power
+//     of two microseconds.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <SDL.h>
+#ifndef DISABLE_SDL2MIXER
+#include <SDL_mixer.h>
+#endif
+
+#include "doomtype.hpp"
+#include "i_audiostats.hpp"
+#include "i_timer.hpp"
+#include "m_argv.hpp"
+#include "opl.hpp"
+
+#define NUM_BUCKETS 20
+
+// A device callback that comes this many periods after the last one
+// is counted as an underrun, in eighths.
+
+#define LATE_PERIODS 12
+
+typedef struct
+{
+    std::atomic<unsigned int> count;
+    std::atomic<uint64_t> total_us;
+    std::atomic<unsigned int> max_us;
+    std::atomic<unsigned int> recent_max_us;
+    std::atomic<unsigned int> buckets[NUM_BUCKETS];
+} histogram_t;
+
+typedef struct
+{
+    histogram_t times;
+    std::atomic<unsigned int> overruns;
+} callback_stats_t;
+
+typedef struct
+{
+    std::atomic<int> depth;
+    std::atomic<int> max_depth;
+    std::atomic<int> capacity;
+} depth_stats_t;
+
+boolean audiostats_enabled = false;
+
+static uint64_t counter_freq;
+
+static callback_stats_t callback_stats[NUM_AUDIOSTAT_CALLBACKS];
+static depth_stats_t depth_stats[NUM_AUDIOSTAT_DEPTHS];
+
+static histogram_t latency;
+
+// Time between calls from the output device, and the calls that were
+// late.
+
+static histogram_t device_intervals;
+static std::atomic<unsigned int> device_underruns;
+static uint64_t device_last_call;
+static int device_freq;
+static int device_frame_size;
+static std::atomic<unsigned int> device_period_us;
+
+// Lock taken on the audio thread.
+
+static histogram_t lock_waits;
+static std::atomic<unsigned int> lock_contended;
+
+// What the overlay last showed, and when it was last updated.
+
+static audiostats_summary_t summary;
+static int summary_time = -1;
+
+static const char *callback_names[] =
+{
+    "Software mixer",
+    "OPL emulator",
+    "PC speaker",
+};
+
+static const char *depth_names[] =
+{
+    "Sound channels",
+    "Mixer voices",
+    "OPL callbacks",
+};
+
+static unsigned int CounterToUS(uint64_t start, uint64_t end)
+{
+    uint64_t us;
+
+    if (end <= start)
+    {
+        return 0;
+    }
+
+    us = ((end - start) * 1000000) / counter_freq;
+
+    return us > 0xffffffffu ? 0xffffffffu : (unsigned int) us;
+}
+
+static void AtomicMax(std::atomic<unsigned int> *value, unsigned int x)
+{
+    unsigned int old = value->load(std::memory_order_relaxed);
+
+    while (x > old
+        && !value->compare_exchange_weak(old, x, std::memory_order_relaxed))
+    {
+    }
+}
+
+static void AddToHistogram(histogram_t *hist, unsigned int us)
+{
+    unsigned int bucket, n;
+
+    for (bucket = 0, n = us; n > 1 && bucket < NUM_BUCKETS - 1; n >>= 1)
+    {
+        ++bucket;
+    }
+
+    hist->count.fetch_add(1, std::memory_order_relaxed);
+    hist->total_us.fetch_add(us, std::memory_order_relaxed);
+    hist->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    AtomicMax(&hist->max_us, us);
+    AtomicMax(&hist->recent_max_us, us);
+}
+
+// Called by the OPL library after each buffer it makes.
+
+static void OPLStatsFunc(uint64_t start, uint64_t end, unsigned int nsamples,
+                         unsigned int rate, unsigned int queue_depth)
+{
+    I_AudioStatsCallback(AUDIOSTAT_OPL, start, end,
+                         (unsigned int) (((uint64_t) nsamples * 1000000)
+                                         / rate));
+    I_AudioStatsDepth(AUDIOSTAT_OPL_QUEUE, queue_depth, 0);
+}
+
+void I_InitAudioStats(void)
+{
+    //!
+    // @category obscure
+    //
+    // Gather statistics about the audio code: how long the audio
+    // thread takes, output device underruns, queue depths and the
+    // time from a sound being started to being mixed. They are shown
+    // beside the FPS counter and printed on exit.
+    //
+
+    if (!M_ParmExists("-audiostats"))
+    {
+        return;
+    }
+
+    audiostats_enabled = true;
+    counter_freq = SDL_GetPerformanceFrequency();
+
+    OPL_SetStatsFunc(OPLStatsFunc);
+}
+
+#ifndef DISABLE_SDL2MIXER
+
+// Called for every buffer the device asks for, after everything else
+// has been mixed into it.
+
+static void DeviceCallback(int chan, void *stream, int len, void *udata)
+{
+    uint64_t now;
+    unsigned int interval, period_us;
+
+    now = SDL_GetPerformanceCounter();
+    period_us = (unsigned int) (((uint64_t) (len / device_frame_size)
+                                 * 1000000) / device_freq);
+    device_period_us.store(period_us, std::memory_order_relaxed);
+
+    if (device_last_call != 0)
+    {
+        interval = CounterToUS(device_last_call, now);
+        AddToHistogram(&device_intervals, interval);
+
+        // If this buffer was asked for much later than it should have
+        // been, the device ran out of audio before it.
+
+        if (interval > (period_us * LATE_PERIODS) / 8)
+        {
+            device_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    device_last_call = now;
+}
+
+#endif
+
+void I_WatchAudioDevice(void)
+{
+#ifndef DISABLE_SDL2MIXER
+    int freq, channels;
+    Uint16 format;
+
+    if (!audiostats_enabled || Mix_QuerySpec(&freq, &format, &channels) == 0)
+    {
+        return;
+    }
+
+    device_freq = freq;
+    device_frame_size = channels * ((format & 0xff) / 8);
+
+    Mix_RegisterEffect(MIX_CHANNEL_POST, DeviceCallback, nullptr, nullptr);
+#endif
+}
+
+void I_AudioStatsCallback(audiostat_callback_t which, uint64_t start,
+                          uint64_t end, unsigned int period_us)
+{
+    callback_stats_t *stats;
+    unsigned int us;
+
+    if (!audiostats_enabled)
+    {
+        return;
+    }
+
+    stats = &callback_stats[which];
+    us = CounterToUS(start, end);
+    AddToHistogram(&stats->times, us);
+
+    if (period_us > 0 && us > period_us)
+    {
+        stats->overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void I_AudioStatsLatency(uint64_t start, uint64_t end)
+{
+    if (audiostats_enabled)
+    {
+        AddToHistogram(&latency, CounterToUS(start, end));
+    }
+}
+
+void I_AudioStatsDepth(audiostat_depth_t which, int depth, int capacity)
+{
+    depth_stats_t *stats;
+    int old;
+
+    if (!audiostats_enabled)
+    {
+        return;
+    }
+
+    stats = &depth_stats[which];
+    stats->depth.store(depth, std::memory_order_relaxed);
+
+    if (capacity > 0)
+    {
+        stats->capacity.store(capacity, std::memory_order_relaxed);
+    }
+
+    old = stats->max_depth.load(std::memory_order_relaxed);
+
+    while (depth > old
+        && !stats->max_depth.compare_exchange_weak(old, depth,
+                                                   std::memory_order_relaxed))
+    {
+    }
+}
+
+void I_AudioStatsLock(uint64_t start, uint64_t end, boolean contended)
+{
+    if (!audiostats_enabled)
+    {
+        return;
+    }
+
+    AddToHistogram(&lock_waits, CounterToUS(start, end));
+
+    if (contended)
+    {
+        lock_contended.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void I_GetAudioStatsSummary(audiostats_summary_t *result)
+{
+    unsigned int callback_us, us;
+    int now, i;
+
+    now = I_GetTimeMS();
+
+    // The longest times are taken once a second, so that they stay on
+    // the screen long enough to be read.
+
+    if (summary_time < 0 || now - summary_time >= 1000)
+    {
+        callback_us = 0;
+
+        for (i = 0; i < NUM_AUDIOSTAT_CALLBACKS; ++i)
+        {
+            us = callback_stats[i].times.recent_max_us.exchange(0);
+
+            if (us > callback_us)
+            {
+                callback_us = us;
+            }
+        }
+
+        summary.callback_us = callback_us;
+        summary.latency_us = latency.recent_max_us.exchange(0);
+        summary_time = now;
+    }
+
+    summary.has_latency =
+        callback_stats[AUDIOSTAT_SOFTMIX].times.count.load() > 0;
+    summary.channels = depth_stats[AUDIOSTAT_CHANNELS].depth.load();
+    summary.max_channels = depth_stats[AUDIOSTAT_CHANNELS].capacity.load();
+    summary.underruns = device_underruns.load();
+    summary.overruns = 0;
+
+    for (i = 0; i < NUM_AUDIOSTAT_CALLBACKS; ++i)
+    {
+        summary.overruns += callback_stats[i].overruns.load();
+    }
+
+    *result = summary;
+}
+
+static void PrintHistogram(const char *name, const char *what,
+                           histogram_t *hist)
+{
+    unsigned int count, i, n, sum, p50, p99;
+
+    count = hist->count.load();
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Percentiles are given as the top of the bucket they fall in.
+
+    p50 = p99 = 0;
+    sum = 0;
+
+    for (i = 0; i < NUM_BUCKETS; ++i)
+    {
+        sum += hist->buckets[i].load();
+
+        if (p50 == 0 && sum * 2 >= count)
+        {
+            p50 = 2u << i;
+        }
+
+        if (p99 == 0 && sum * 100 >= count * 99ull)
+        {
+            p99 = 2u << i;
+        }
+    }
+
+    printf("  %-16s %u %s, mean %u us, 50%% < %u us, 99%% < %u us, "
+           "max %u us\n",
+           name, count, what, (unsigned int) (hist->total_us.load() / count),
+           p50, p99, hist->max_us.load());
+
+    printf("  %-16s", "");
+
+    for (i = 0; i < NUM_BUCKETS; ++i)
+    {
+        n = hist->buckets[i].load();
+
+        if (n > 0)
+        {
+            printf(" <%uus:%u", 2u << i, n);
+        }
+    }
+
+    printf("\n");
+}
+
+void I_PrintAudioStats(void)
+{
+    callback_stats_t *stats;
+    depth_stats_t *depth;
+    int i;
+
+    if (!audiostats_enabled)
+    {
+        return;
+    }
+
+    printf("Audio statistics:\n");
+
+    if (device_intervals.count.load() > 0)
+    {
+        PrintHistogram("Output device", "buffers", &device_intervals);
+        printf("  %-16s %u underruns (buffers of %u us asked for late)\n",
+               "", device_underruns.load(), device_period_us.load());
+    }
+
+    for (i = 0; i < NUM_AUDIOSTAT_CALLBACKS; ++i)
+    {
+        stats = &callback_stats[i];
+        PrintHistogram(callback_names[i], "calls", &stats->times);
+
+        if (stats->times.count.load() > 0 && i != AUDIOSTAT_PCSOUND)
+        {
+            printf("  %-16s %u overruns (took longer than the audio "
+                   "they made)\n", "", stats->overruns.load());
+        }
+    }
+
+    PrintHistogram("Sound latency", "sounds", &latency);
+
+    if (latency.count.load() > 0)
+    {
+        printf("  %-16s (until first mixed; the device buffer comes on "
+               "top)\n", "");
+    }
+    else if (callback_stats[AUDIOSTAT_SOFTMIX].times.count.load() == 0)
+    {
+        printf("  %-16s (only measured with the software mixer)\n", "");
+    }
+
+    PrintHistogram("Lock waits", "locks", &lock_waits);
+
+    if (lock_waits.count.load() > 0)
+    {
+        printf("  %-16s %u contended\n", "", lock_contended.load());
+    }
+
+    for (i = 0; i < NUM_AUDIOSTAT_DEPTHS; ++i)
+    {
+        depth = &depth_stats[i];
+
+        if (depth->max_depth.load() == 0)
+        {
+            continue;
+        }
+
+        if (depth->capacity.load() > 0)
+        {
+            printf("  %-16s at most %i of %i in use\n", depth_names[i],
+                   depth->max_depth.load(), depth->capacity.load());
+        }
+        else
+        {
+            printf("  %-16s at most %i\n", depth_names[i],
+                   depth->max_depth.load());
+        }
+    }
+}
+
@@ -0,0 +1,97 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Audio pipeline statistics, enabled with -audiostats.
+//
+
+#ifndef I_AUDIOSTATS_H
+#define I_AUDIOSTATS_H
+
+#include "doomtype.hpp"
+
+// Code run on the audio thread that is timed.
+
+typedef enum
+{
+    AUDIOSTAT_SOFTMIX,      // Software sound effect mixer
+    AUDIOSTAT_OPL,          // OPL emulator
+    AUDIOSTAT_PCSOUND,      // PC speaker tone callback
+    NUM_AUDIOSTAT_CALLBACKS
+} audiostat_callback_t;
+
+// Things that are counted.
+
+typedef enum
+{
+    AUDIOSTAT_CHANNELS,     // Sound channels in use
+    AUDIOSTAT_VOICES,       // Software mixer voices playing
+    AUDIOSTAT_OPL_QUEUE,    // OPL callbacks waiting
+    NUM_AUDIOSTAT_DEPTHS
+} audiostat_depth_t;
+
+// What the on-screen overlay shows.
+
+typedef struct
+{
+    int channels, max_channels;
+    unsigned int underruns, overruns;
+
+    // Longest callback and longest sound start latency in the last
+    // second, in microseconds.
+    unsigned int callback_us;
+    unsigned int latency_us;
+
+    // Sound start latency is only measured by the software mixer; false
+    // if it hasn't run.
+    boolean has_latency;
+} audiostats_summary_t;
+
+extern boolean audiostats_enabled;
+
+// Check for -audiostats. Call before the sound and music modules are
+// started.
+
+void I_InitAudioStats(void);
+
+// Start watching the output device, once it has been opened.
+
+void I_WatchAudioDevice(void);
+
+// Print everything that has been gathered to stdout.
+
+void I_PrintAudioStats(void);
+
+// Record a call of timed code on the audio thread, with the performance
+// counter values before and after. If it made period_us of audio, it
+// is counted as an overrun if it took longer than that.
+
+void I_AudioStatsCallback(audiostat_callback_t which, uint64_t start,
+                          uint64_t end, unsigned int period_us);
+
+// Record the time from a sound being started to its first sample being
+// mixed.
+
+void I_AudioStatsLatency(uint64_t start, uint64_t end);
+
+void I_AudioStatsDepth(audiostat_depth_t which, int depth, int capacity);
+
+// Record an attempt to take a lock on the audio thread, and whether it
+// had to wait for it.
+
+void I_AudioStatsLock(uint64_t start, uint64_t end, boolean contended);
+
+void I_GetAudioStatsSummary(audiostats_summary_t *summary);
+
+#endif /* #ifndef I_AUDIOSTATS_H */
+
@@ -22,6 +22,8 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <atomic>
+
 #include <SDL.h>
 #include <SDL_mixer.h>
 
@@ -54,6 +56,14 @@ const char *music_pack_path = "";
 #define MID_HEADER_MAGIC "MThd"
 #define MUS_HEADER_MAGIC "MUS\x1a"
 
+// Length of a SHA1 hash written out in hex, with the terminator.
+#define HASH_STR_LEN (sizeof(sha1_digest_t) * 2 + 1)
+
+// Substitute files no bigger than this are read into memory by
+// I_MP_PrefetchSong; bigger ones are still opened from disk.
+#define PREFETCH_MAX_SIZE (64 * 1024 * 1024)
+#define PREFETCH_CHUNK_SIZE (1024 * 1024)
+
 // Starting with 2.6.0, SDL_mixer supports OGG and FLAC looping natively.
 // TODO: Once SDL_mixer 2.6.0+ is a requirement, delete the old looping code.
 #if !defined(USE_SDL_MIXER_LOOPING)
@@ -112,8 +122,37 @@ typedef struct
     unsigned int samplerate_hz;
     int start_time, end_time;
 } file_metadata_t;
+
+// Loop points already read from a file, so that a track is only parsed
+// the first time it is played.
+typedef struct
+{
+    char *filename;
+    file_metadata_t metadata;
+} loop_index_t;
 #endif // !USE_SDL_MIXER_LOOPING
 
+// A registered song: the music, and the file data it plays from if the
+// file was read into memory.
+typedef struct
+{
+    Mix_Music *music;
+    byte *file_data;
+} mp_song_t;
+
+// Substitute file for a song that is about to be registered, found and
+// read by a background thread.
+typedef struct
+{
+    char hash[HASH_STR_LEN];
+    const char *filename;
+    byte *data;
+    size_t len;
+#if !USE_SDL_MIXER_LOOPING
+    file_metadata_t metadata;
+#endif
+} prefetch_t;
+
 static subst_music_t *subst_music = nullptr;
 static unsigned int subst_music_len = 0;
 
@@ -132,8 +171,18 @@ static file_metadata_t file_metadata;
 // Position (in samples) that we have reached in the current track.
 // This is updated by the TrackPositionCallback function.
 static unsigned int current_track_pos;
+
+// Loop points of every file read so far. Also used by the prefetch
+// thread, so only touched with loop_index_lock held.
+static loop_index_t *loop_index = nullptr;
+static unsigned int loop_index_len = 0;
+static SDL_mutex *loop_index_lock = nullptr;
 #endif // !USE_SDL_MIXER_LOOPING
 
+static prefetch_t prefetch;
+static SDL_Thread *prefetch_thread = nullptr;
+static std::atomic<bool> prefetch_cancel;
+
 // Currently playing music track.
 static Mix_Music *current_track_music = nullptr;
 
@@ -656,25 +705,50 @@ static void ReadLoopPoints(const char *filename, file_metadata_t *metadata)
         metadata->valid = false;
     }
 }
+
+// Get the loop points of a file, reading them from the file only if it
+// has not been seen before.
+static void LookupLoopPoints(const char *filename, file_metadata_t *metadata)
+{
+    loop_index_t *entry;
+    unsigned int i;
+
+    SDL_LockMutex(loop_index_lock);
+
+    for (i = 0; i < loop_index_len; ++i)
+    {
+        if (!strcmp(loop_index[i].filename, filename))
+        {
+            *metadata = loop_index[i].metadata;
+            SDL_UnlockMutex(loop_index_lock);
+            return;
+        }
+    }
+
+    SDL_UnlockMutex(loop_index_lock);
+
+    ReadLoopPoints(filename, metadata);
+
+    SDL_LockMutex(loop_index_lock);
+
+    ++loop_index_len;
+    loop_index = (loop_index_t *) I_Realloc(loop_index, sizeof(loop_index_t) * loop_index_len);
+    entry = &loop_index[loop_index_len - 1];
+    entry->filename = M_StringDuplicate(filename);
+    entry->metadata = *metadata;
+
+    SDL_UnlockMutex(loop_index_lock);
+}
 #endif // !USE_SDL_MIXER_LOOPING
 
-// Given a MUS lump, look up a substitute MUS file to play instead
-// (or nullptr to just use normal MIDI playback).
+// Write out the SHA1 hash of a MUS lump in hex.
 
-static const char *GetSubstituteMusicFile(void *data, size_t data_len)
+static void HashLump(void *data, size_t data_len, char *hash_str)
 {
     sha1_context_t context;
     sha1_digest_t hash;
-    const char *filename;
-    char hash_str[sizeof(sha1_digest_t) * 2 + 1];
     unsigned int i;
 
-    // Don't bother doing a hash if we're never going to find anything.
-    if (subst_music_len == 0)
-    {
-        return nullptr;
-    }
-
     SHA1_Init(&context);
     SHA1_Update(&context, (byte*)data, data_len);
     SHA1_Final(hash, &context);
@@ -682,9 +756,18 @@ static const char *GetSubstituteMusicFile(void *data, size_t data_len)
     // Build a string representation of the hash.
     for (i = 0; i < sizeof(sha1_digest_t); ++i)
     {
-        M_snprintf(hash_str + i * 2, sizeof(hash_str) - i * 2,
+        M_snprintf(hash_str + i * 2, HASH_STR_LEN - i * 2,
                    "%02x", hash[i]);
     }
+}
+
+// Given the hash of a MUS lump, look up a substitute MUS file to play
+// instead (or nullptr to just use normal MIDI playback).
+
+static const char *GetSubstituteMusicFile(const char *hash_str)
+{
+    const char *filename;
+    unsigned int i;
 
     // Look for a hash that matches.
     // The substitute mapping list can (intentionally) contain multiple
@@ -1102,10 +1185,14 @@ static void DumpSubstituteConfig(const char *filename)
 
 // Shutdown music
 
+static void FinishPrefetch(void);
+
 static void I_MP_ShutdownMusic(void)
 {
     if (music_initialized)
     {
+        FinishPrefetch();
+
         Mix_HaltMusic();
         music_initialized = false;
 
@@ -1194,6 +1281,11 @@ static boolean I_MP_InitMusic(void)
 #if !USE_SDL_MIXER_LOOPING
     // Register an effect function to track the music position.
     Mix_RegisterEffect(MIX_CHANNEL_POST, TrackPositionCallback, nullptr, nullptr);
+
+    if (loop_index_lock == nullptr)
+    {
+        loop_index_lock = SDL_CreateMutex();
+    }
 #endif // !USE_SDL_MIXER_LOOPING
 
     return music_initialized;
@@ -1222,7 +1314,7 @@ static void I_MP_PlaySong(void *handle, boolean looping)
         return;
     }
 
-    current_track_music = (Mix_Music *) handle;
+    current_track_music = ((mp_song_t *) handle)->music;
     current_track_loop = looping;
 
     if (looping)
@@ -1286,7 +1378,7 @@ static void I_MP_StopSong(void)
 
 static void I_MP_UnRegisterSong(void *handle)
 {
-    Mix_Music *music = (Mix_Music *) handle;
+    mp_song_t *song = (mp_song_t *) handle;
 
     if (!music_initialized)
     {
@@ -1298,27 +1390,229 @@ static void I_MP_UnRegisterSong(void *handle)
         return;
     }
 
-    Mix_FreeMusic(music);
+    // The music reads from the file data, so free that afterwards.
+    Mix_FreeMusic(song->music);
+    free(song->file_data);
+    free(song);
+}
+
+// Read a whole file into memory, giving up if the prefetch is
+// cancelled.
+
+static byte *ReadWholeFile(const char *filename, size_t *len)
+{
+    FILE *fs;
+    byte *data;
+    long size;
+    size_t pos, n;
+
+    fs = M_fopen(filename, "rb");
+
+    if (fs == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (fseek(fs, 0, SEEK_END) != 0 || (size = ftell(fs)) <= 0
+     || size > PREFETCH_MAX_SIZE || fseek(fs, 0, SEEK_SET) != 0)
+    {
+        fclose(fs);
+        return nullptr;
+    }
+
+    data = (byte *) malloc(size);
+
+    if (data == nullptr)
+    {
+        fclose(fs);
+        return nullptr;
+    }
+
+    for (pos = 0; pos < (size_t) size; pos += n)
+    {
+        n = (size_t) size - pos;
+
+        if (n > PREFETCH_CHUNK_SIZE)
+        {
+            n = PREFETCH_CHUNK_SIZE;
+        }
+
+        if (prefetch_cancel.load() || fread(data + pos, 1, n, fs) < n)
+        {
+            free(data);
+            fclose(fs);
+            return nullptr;
+        }
+    }
+
+    fclose(fs);
+    *len = size;
+
+    return data;
+}
+
+static int PrefetchThread(void *unused)
+{
+    prefetch.filename = GetSubstituteMusicFile(prefetch.hash);
+
+    if (prefetch.filename == nullptr || prefetch_cancel.load())
+    {
+        return 0;
+    }
+
+    prefetch.data = ReadWholeFile(prefetch.filename, &prefetch.len);
+
+#if !USE_SDL_MIXER_LOOPING
+    if (!prefetch_cancel.load())
+    {
+        LookupLoopPoints(prefetch.filename, &prefetch.metadata);
+    }
+#endif // !USE_SDL_MIXER_LOOPING
+
+    return 0;
+}
+
+// Stop the prefetch thread and throw away what it has read.
+
+static void FinishPrefetch(void)
+{
+    if (prefetch_thread != nullptr)
+    {
+        prefetch_cancel.store(true);
+        SDL_WaitThread(prefetch_thread, nullptr);
+        prefetch_thread = nullptr;
+    }
+
+    free(prefetch.data);
+    memset(&prefetch, 0, sizeof(prefetch));
+}
+
+// Find and read the substitute file for a song that is going to be
+// registered soon, such as the music of the next level while the
+// intermission screen is up, so that registering it does not have to
+// wait for the disk. The song does not have to be registered;
+// anything that has been read is thrown away by the next prefetch.
+
+void I_MP_PrefetchSong(void *data, int len)
+{
+    char hash[HASH_STR_LEN];
+
+    if (!music_initialized || subst_music_len == 0)
+    {
+        return;
+    }
+
+    HashLump(data, len, hash);
+
+    if (!strcmp(prefetch.hash, hash))
+    {
+        return;
+    }
+
+    FinishPrefetch();
+
+    M_StringCopy(prefetch.hash, hash, sizeof(prefetch.hash));
+
+    prefetch_cancel.store(false);
+    prefetch_thread = SDL_CreateThread(PrefetchThread, "prefetch music",
+                                       nullptr);
+
+    // If no thread could be started, the song is just loaded as usual
+    // when it is registered.
+
+    if (prefetch_thread == nullptr)
+    {
+        memset(&prefetch, 0, sizeof(prefetch));
+    }
 }
 
 static void *I_MP_RegisterSong(void *data, int len)
 {
+    char hash[HASH_STR_LEN];
     const char *filename;
+    byte *file_data;
+    size_t file_len;
     Mix_Music *music;
+    mp_song_t *song;
+#if !USE_SDL_MIXER_LOOPING
+    file_metadata_t metadata;
+#endif
 
     if (!music_initialized)
     {
         return nullptr;
     }
 
-    // See if we're substituting this MUS for a high-quality replacement.
-    filename = GetSubstituteMusicFile(data, len);
+    // Don't bother doing a hash if we're never going to find anything.
+    if (subst_music_len == 0)
+    {
+        return nullptr;
+    }
+
+    HashLump(data, len, hash);
+
+    // If this is the song that was prefetched, take what the thread has
+    // found, waiting for it to finish if it is still reading. Other
+    // songs, such as the intermission music, leave it running.
+
+    file_data = nullptr;
+    file_len = 0;
+
+    if (prefetch.hash[0] != '\0' && !strcmp(prefetch.hash, hash))
+    {
+        if (prefetch_thread != nullptr)
+        {
+            SDL_WaitThread(prefetch_thread, nullptr);
+            prefetch_thread = nullptr;
+        }
+
+        filename = prefetch.filename;
+        file_data = prefetch.data;
+        file_len = prefetch.len;
+#if !USE_SDL_MIXER_LOOPING
+        metadata = prefetch.metadata;
+#endif // !USE_SDL_MIXER_LOOPING
+
+        memset(&prefetch, 0, sizeof(prefetch));
+    }
+    else
+    {
+        // See if we're substituting this MUS for a high-quality replacement.
+        filename = GetSubstituteMusicFile(hash);
+
+#if !USE_SDL_MIXER_LOOPING
+        if (filename != nullptr)
+        {
+            // Read loop point metadata from the file so that we know
+            // where to loop the music.
+            LookupLoopPoints(filename, &metadata);
+        }
+#endif // !USE_SDL_MIXER_LOOPING
+    }
+
     if (filename == nullptr)
     {
         return nullptr;
     }
 
-    music = Mix_LoadMUS(filename);
+    music = nullptr;
+
+    if (file_data != nullptr)
+    {
+        music = Mix_LoadMUS_RW(SDL_RWFromConstMem(file_data, file_len), 1);
+
+        if (music == nullptr)
+        {
+            free(file_data);
+            file_data = nullptr;
+        }
+    }
+
+    if (music == nullptr)
+    {
+        music = Mix_LoadMUS(filename);
+    }
+
     if (music == nullptr)
     {
         // Fall through and play MIDI normally, but print an error
@@ -1329,11 +1623,14 @@ static void *I_MP_RegisterSong(void *data, int len)
     }
 
 #if !USE_SDL_MIXER_LOOPING
-    // Read loop point metadata from the file so that we know where
-    // to loop the music.
-    ReadLoopPoints(filename, &file_metadata);
+    file_metadata = metadata;
 #endif // !USE_SDL_MIXER_LOOPING
-    return music;
+
+    song = (mp_song_t *) malloc(sizeof(mp_song_t));
+    song->music = music;
+    song->file_data = file_data;
+
+    return song;
 }
 
 // Is the song playing?
@@ -1487,6 +1784,10 @@ static void I_NULL_PollMusic(void)
 {
 }
 
+void I_MP_PrefetchSong(void *data, int len)
+{
+}
+
 music_module_t music_pack_module =
 {
     nullptr,
@@ -27,6 +27,7 @@
 #include "deh_main.hpp"
 #include "i_sound.hpp"
 #include "i_swap.hpp"
+#include "m_argv.hpp"
 #include "m_misc.hpp"
 #include "w_wad.hpp"
 #include "z_zone.hpp"
@@ -336,6 +337,18 @@ static unsigned int num_tracks = 0;
 static unsigned int running_tracks = 0;
 static boolean song_looping;
 
+// If true, the events of all tracks are played from the song's
+// timeline by a single callback, rather than each track scheduling a
+// callback for each of its events.
+
+static boolean use_timeline;
+
+// Song timeline, and the next event to play from it.
+
+static midi_timeline_event_t *timeline;
+static unsigned int timeline_len;
+static unsigned int timeline_pos;
+
 // Tempo control variables
 
 static unsigned int ticks_per_beat;
@@ -1263,7 +1276,13 @@ static void PitchBendEvent(opl_track_data_t *track, midi_event_t *event)
 
 static void MetaSetTempo(unsigned int tempo)
 {
-    OPL_AdjustCallbacks((float) us_per_beat / tempo);
+    // Timeline event times already include tempo changes.
+
+    if (!use_timeline)
+    {
+        OPL_AdjustCallbacks((float) us_per_beat / tempo);
+    }
+
     us_per_beat = tempo;
 }
 
@@ -1356,6 +1375,7 @@ static void ProcessEvent(opl_track_data_t *track, midi_event_t *event)
 }
 
 static void ScheduleTrack(opl_track_data_t *track);
+static void StartTimeline(void);
 static void InitChannel(opl_channel_data_t *channel);
 
 // Restart a song from the beginning.
@@ -1368,10 +1388,17 @@ static void RestartSong(void *unused)
 
     start_music_volume = current_music_volume;
 
-    for (i = 0; i < num_tracks; ++i)
+    if (use_timeline)
     {
-        MIDI_RestartIterator(tracks[i].iter);
-        ScheduleTrack(&tracks[i]);
+        StartTimeline();
+    }
+    else
+    {
+        for (i = 0; i < num_tracks; ++i)
+        {
+            MIDI_RestartIterator(tracks[i].iter);
+            ScheduleTrack(&tracks[i]);
+        }
     }
 
     for (i = 0; i < MIDI_CHANNELS_PER_TRACK; ++i)
@@ -1440,6 +1467,58 @@ static void ScheduleTrack(opl_track_data_t *track)
     OPL_SetCallback(us, TrackTimerCallback, track);
 }
 
+// Callback function invoked when the events at the next time in the
+// timeline are due. Plays every event at that time, and schedules
+// itself again for the time after. Times are relative to the event
+// just played rather than to when the callback ran, so that lateness
+// does not add up over the song.
+
+static void TimelineCallback(void *unused)
+{
+    midi_timeline_event_t *entry;
+    uint64_t time;
+
+    time = timeline[timeline_pos].time;
+
+    while (timeline_pos < timeline_len && timeline[timeline_pos].time == time)
+    {
+        entry = &timeline[timeline_pos];
+        ++timeline_pos;
+
+        ProcessEvent(&tracks[entry->track], entry->event);
+
+        if (entry->event->event_type == MIDI_EVENT_META
+         && entry->event->data.meta.type == MIDI_META_END_OF_TRACK)
+        {
+            --running_tracks;
+        }
+    }
+
+    if (timeline_pos < timeline_len)
+    {
+        OPL_SetCallback(timeline[timeline_pos].time - time,
+                        TimelineCallback, nullptr);
+    }
+    else if (song_looping)
+    {
+        // As in TrackTimerCallback, wait 5ms before restarting.
+
+        OPL_SetCallback(5000, RestartSong, nullptr);
+    }
+}
+
+// Play the timeline from the start.
+
+static void StartTimeline(void)
+{
+    timeline_pos = 0;
+
+    if (timeline_len > 0)
+    {
+        OPL_SetCallback(timeline[0].time, TimelineCallback, nullptr);
+    }
+}
+
 // Initialize a channel.
 
 static void InitChannel(opl_channel_data_t *channel)
@@ -1466,9 +1545,12 @@ static void StartTrack(midi_file_t *file, unsigned int track_num)
     track = &tracks[track_num];
     track->iter = MIDI_IterateTrack(file, track_num);
 
-    // Schedule the first event.
+    // Schedule the first event, unless the timeline is used instead.
 
-    ScheduleTrack(track);
+    if (!use_timeline)
+    {
+        ScheduleTrack(track);
+    }
 }
 
 // Start playing a mid
@@ -1508,6 +1590,12 @@ static void I_OPL_PlaySong(void *handle, boolean looping)
         StartTrack(file, i);
     }
 
+    if (use_timeline)
+    {
+        timeline = MIDI_GetTimeline(file, &timeline_len);
+        StartTimeline();
+    }
+
     for (i = 0; i < MIDI_CHANNELS_PER_TRACK; ++i)
     {
         InitChannel(&channels[i]);
@@ -1590,6 +1678,9 @@ static void I_OPL_StopSong(void)
     tracks = nullptr;
     num_tracks = 0;
 
+    timeline = nullptr;
+    timeline_len = 0;
+
     OPL_Unlock();
 }
 
@@ -1606,24 +1697,24 @@ static void I_OPL_UnRegisterSong(void *handle)
     }
 }
 
-static boolean ConvertMus(byte *musdata, int len, char *filename)
+// Convert a MUS lump to MIDI in memory and load the result.
+
+static midi_file_t *LoadMus(byte *musdata, int len)
 {
     MEMFILE *instream;
     MEMFILE *outstream;
     void *outbuf;
     size_t outbuf_len;
-    int result;
+    midi_file_t *result = nullptr;
 
     instream = mem_fopen_read(musdata, len);
     outstream = mem_fopen_write();
 
-    result = mus2mid(instream, outstream);
-
-    if (result == 0)
+    if (mus2mid(instream, outstream) == 0)
     {
         mem_get_buf(outstream, &outbuf, &outbuf_len);
 
-        M_WriteFile(filename, outbuf, outbuf_len);
+        result = MIDI_LoadMemory(outbuf, outbuf_len);
     }
 
     mem_fclose(instream);
@@ -1635,7 +1726,6 @@ static boolean ConvertMus(byte *musdata, int len, char *filename)
 static void *I_OPL_RegisterSong(void *data, int len)
 {
     midi_file_t *result;
-    char *filename;
 
     if (!music_initialized)
     {
@@ -1645,32 +1735,23 @@ static void *I_OPL_RegisterSong(void *data, int len)
     // MUS files begin with "MUS"
     // Reject anything which doesnt have this signature
 
-    filename = M_TempFile("doom.mid");
-
     // [crispy] remove MID file size limit
     if (IsMid((byte*)data, len) /* && len < MAXMIDLENGTH */)
     {
-        M_WriteFile(filename, data, len);
+        result = MIDI_LoadMemory(data, len);
     }
     else
     {
         // Assume a MUS file and try to convert
 
-        ConvertMus((byte*)data, len, filename);
+        result = LoadMus((byte*)data, len);
     }
 
-    result = MIDI_LoadFile(filename);
-
     if (result == nullptr)
     {
         fprintf(stderr, "I_OPL_RegisterSong: Failed to load MID.\n");
     }
 
-    // remove file now
-
-    M_remove(filename);
-    free(filename);
-
     return result;
 }
 
@@ -1745,6 +1826,15 @@ static boolean I_OPL_InitMusic(void)
     // into their correct orientation.
     opl_stereo_correct = strstr(dmxoption, "-reverse") != nullptr;
 
+    //!
+    // @category obscure
+    //
+    // Play OPL music by scheduling a callback for each event of each
+    // track, rather than from a single timeline of the whole song.
+    //
+
+    use_timeline = !M_ParmExists("-noopltimeline");
+
     // Initialize all registers.
 
     OPL_InitRegisters(opl_opl3mode);
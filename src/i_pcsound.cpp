@@ -21,6 +21,7 @@
 #include "doomtype.hpp"
 
 #include "deh_str.hpp"
+#include "i_audiostats.hpp"
 #include "i_sound.hpp"
 #include "m_misc.hpp"
 #include "w_wad.hpp"
@@ -64,10 +65,27 @@ static const uint16_t divisors[] = {
 static void PCSCallbackFunc(int *duration, int *freq)
 {
     unsigned int tone;
+    uint64_t start = 0;
+    boolean contended;
+    int result;
 
     *duration = 1000 / 140;
 
-    if (SDL_LockMutex(sound_lock) < 0)
+    if (audiostats_enabled)
+    {
+        // Find out whether the main thread is holding the lock.
+
+        start = SDL_GetPerformanceCounter();
+        contended = SDL_TryLockMutex(sound_lock) != 0;
+        result = contended ? SDL_LockMutex(sound_lock) : 0;
+        I_AudioStatsLock(start, SDL_GetPerformanceCounter(), contended);
+    }
+    else
+    {
+        result = SDL_LockMutex(sound_lock);
+    }
+
+    if (result < 0)
     {
         *freq = 0;
         return;
@@ -101,6 +119,12 @@ static void PCSCallbackFunc(int *duration, int *freq)
     }
 
     SDL_UnlockMutex(sound_lock);
+
+    if (audiostats_enabled)
+    {
+        I_AudioStatsCallback(AUDIOSTAT_PCSOUND, start,
+                             SDL_GetPerformanceCounter(), 0);
+    }
 }
 
 static boolean CachePCSLump(sfxinfo_t *sfxinfo)
@@ -48,6 +48,18 @@ const char *timidity_cfg_path = "";
 
 static  char *temp_timidity_cfg = nullptr;
 
+// MIDI data converted from MUS. SDL_mixer may read it for as long as
+// the song is loaded, so it is kept until the song is unregistered.
+
+typedef struct converted_song_s
+{
+    Mix_Music *music;
+    MEMFILE *midi;
+    struct converted_song_s *next;
+} converted_song_t;
+
+static converted_song_t *converted_songs = nullptr;
+
 // If the temp_timidity_cfg config variable is set, generate a "wrapper"
 // config file for Timidity to point to the actual config file. This
 // is needed to inject a "dir" command so that the patches are read
@@ -372,6 +384,7 @@ static void I_SDL_StopSong(void)
 static void I_SDL_UnRegisterSong(void *handle)
 {
     Mix_Music *music = (Mix_Music *) handle;
+    converted_song_t **prev, *song;
 
     if (!music_initialized)
     {
@@ -382,14 +395,27 @@ static void I_SDL_UnRegisterSong(void *handle)
     {
         Mix_FreeMusic(music);
     }
+
+    for (prev = &converted_songs; *prev != nullptr; prev = &(*prev)->next)
+    {
+        if ((*prev)->music == music)
+        {
+            song = *prev;
+            *prev = song->next;
+            mem_fclose(song->midi);
+            free(song);
+            break;
+        }
+    }
 }
 
-static boolean ConvertMus(byte *musdata, int len, const char *filename)
+// Convert a MUS lump to MIDI, returning a stream holding the result,
+// or nullptr on failure.
+
+static MEMFILE *ConvertMusToMemory(byte *musdata, int len)
 {
     MEMFILE *instream;
     MEMFILE *outstream;
-    void *outbuf;
-    size_t outbuf_len;
     int result;
 
     instream = mem_fopen_read(musdata, len);
@@ -397,32 +423,46 @@ static boolean ConvertMus(byte *musdata, int len, const char *filename)
 
     result = mus2mid(instream, outstream);
 
-    if (result == 0)
+    mem_fclose(instream);
+
+    if (result != 0)
     {
-        mem_get_buf(outstream, &outbuf, &outbuf_len);
+        mem_fclose(outstream);
+        return nullptr;
+    }
+
+    return outstream;
+}
+
+static boolean ConvertMus(byte *musdata, int len, const char *filename)
+{
+    MEMFILE *outstream;
+    void *outbuf;
+    size_t outbuf_len;
+
+    outstream = ConvertMusToMemory(musdata, len);
 
-        M_WriteFile(filename, outbuf, outbuf_len);
+    if (outstream == nullptr)
+    {
+        return 1;
     }
 
-    mem_fclose(instream);
+    mem_get_buf(outstream, &outbuf, &outbuf_len);
+
+    M_WriteFile(filename, outbuf, outbuf_len);
+
     mem_fclose(outstream);
 
-    return result;
+    return 0;
 }
 
-static void *I_SDL_RegisterSong(void *data, int len)
+// Load a song for an external MIDI program, which needs a file to play.
+
+static Mix_Music *LoadSongFile(void *data, int len)
 {
     char *filename;
     Mix_Music *music;
 
-    if (!music_initialized)
-    {
-        return nullptr;
-    }
-
-    // MUS files begin with "MUS"
-    // Reject anything which doesnt have this signature
-
     filename = M_TempFile("doom"); // [crispy] generic filename
 
     // [crispy] Reverse Choco's logic from "if (MIDI)" to "if (not MUS)"
@@ -442,28 +482,75 @@ static void *I_SDL_RegisterSong(void *data, int len)
         ConvertMus((byte*)data, len, filename);
     }
 
-    // Load the MIDI. In an ideal world we'd be using Mix_LoadMUS_RW()
-    // by now, but Mix_SetMusicCMD() only works with Mix_LoadMUS(), so
-    // we have to generate a temporary file.
+    // Mix_SetMusicCMD() only works with Mix_LoadMUS(), so we have to
+    // generate a temporary file. The program won't find the file to
+    // play if we delete it, so this leaves a mess on disk :(
 
     music = Mix_LoadMUS(filename);
-    if (music == nullptr)
+
+    free(filename);
+
+    return music;
+}
+
+static void *I_SDL_RegisterSong(void *data, int len)
+{
+    converted_song_t *song;
+    MEMFILE *midi;
+    void *buf;
+    size_t buf_len;
+    Mix_Music *music;
+
+    if (!music_initialized)
     {
-        // Failed to load
-        fprintf(stderr, "Error loading midi: %s\n", Mix_GetError());
+        return nullptr;
     }
 
-    // Remove the temporary MIDI file; however, when using an external
-    // MIDI program we can't delete the file. Otherwise, the program
-    // won't find the file to play. This means we leave a mess on
-    // disk :(
+    if (strlen(snd_musiccmd) > 0)
+    {
+        music = LoadSongFile(data, len);
+    }
+    else if (!IsMus((byte*)data, len)) // [crispy] MUS_HEADER_MAGIC
+    {
+        // The lump stays cached until the song is unregistered, so
+        // SDL_mixer can read it in place.
 
-    if (strlen(snd_musiccmd) == 0)
+        music = Mix_LoadMUS_RW(SDL_RWFromConstMem(data, len), SDL_TRUE);
+    }
+    else
     {
-        M_remove(filename);
+        // Assume a MUS file and try to convert
+
+        midi = ConvertMusToMemory((byte*)data, len);
+        music = nullptr;
+
+        if (midi != nullptr)
+        {
+            mem_get_buf(midi, &buf, &buf_len);
+            music = Mix_LoadMUS_RW(SDL_RWFromConstMem(buf, buf_len),
+                                   SDL_TRUE);
+
+            if (music != nullptr)
+            {
+                song = static_cast<converted_song_t *>(
+                    malloc(sizeof(converted_song_t)));
+                song->music = music;
+                song->midi = midi;
+                song->next = converted_songs;
+                converted_songs = song;
+            }
+            else
+            {
+                mem_fclose(midi);
+            }
+        }
     }
 
-    free(filename);
+    if (music == nullptr)
+    {
+        // Failed to load
+        fprintf(stderr, "Error loading midi: %s\n", Mix_GetError());
+    }
 
     return music;
 }
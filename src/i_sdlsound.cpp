@@ -23,6 +23,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+
+#include <atomic>
+
 #include <SDL.h>
 #include <SDL_mixer.h>
 
@@ -31,6 +34,7 @@
 #endif
 
 #include "deh_str.hpp"
+#include "i_audiostats.hpp"
 #include "i_sound.hpp"
 #include "i_system.hpp"
 #include "i_swap.hpp"
@@ -41,6 +45,14 @@
 
 #include "doomtype.hpp"
 
+#include "../utils/spsc_queue.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) \
+ || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTMIX_SSE2
+#include <emmintrin.h>
+#endif
+
 
 // [crispy] values 3 and higher might reproduce DOOM.EXE more accurately,
 // but 1 is closer to "use_libsamplerate = 0" which is the default in Choco
@@ -55,13 +67,38 @@ int use_libsamplerate = 1;
 
 float libsamplerate_scale = 0.65f;
 
+// If non-zero, sound effects are mixed by our own mixer rather than
+// played on SDL_mixer channels.
+
+int snd_softmixer = 0;
+
 
 #ifndef DISABLE_SDL2MIXER
 
 
 #define LOW_PASS_FILTER
 //#define DEBUG_DUMP_WAVS
-#define NUM_CHANNELS 16*2 // [crispy] support up to 32 sound channels
+#define NUM_CHANNELS MAX_SOUND_CHANNELS // [crispy] support up to 32 sound channels
+
+// Number of chains in the hash table of allocated sounds. Must be a
+// power of two.
+
+#define SOUND_HASH_SIZE 1024
+
+// Pitch-shifted versions of each sound are made in the background for
+// pitches up to this far either side of NORM_PITCH, which are the ones
+// the games pick most often.
+
+#define PITCH_PRECACHE_RANGE 4
+
+// Software mixer limits: the number of frames mixed at a time, the
+// number of frames over which a change of volume or panning is spread,
+// and the number of commands that can be waiting for the mixing thread.
+// The number of voices, SOFTMIX_MAX_VOICES, is in i_sound.hpp.
+
+#define SOFTMIX_BLOCK_FRAMES 512
+#define SOFTMIX_RAMP_FRAMES 128
+#define SOFTMIX_QUEUE_LEN 1024
 
 typedef struct allocated_sound_s allocated_sound_t;
 
@@ -71,9 +108,25 @@ struct allocated_sound_s
     Mix_Chunk chunk;
     int use_count;
     int pitch;
+
+    // If true, this is a pitch-shifted sound made in advance, which is
+    // kept after it has been played.
+    boolean pregenerated;
+
     allocated_sound_t *prev, *next;
+    allocated_sound_t *hash_next;
 };
 
+// A pitch-shifted sound for the background thread to make.
+
+typedef struct
+{
+    allocated_sound_t *base;
+    int pitch;
+    Uint32 len;
+    allocated_sound_t *result;
+} pitch_precache_t;
+
 static boolean sound_initialized = false;
 
 static allocated_sound_t *channels_playing[NUM_CHANNELS];
@@ -88,14 +141,37 @@ static boolean (*ExpandSoundData)(sfxinfo_t *sfxinfo,
                                   int bits,
                                   int length) = nullptr;
 
-// Doubly-linked list of allocated sounds.
-// When a sound is played, it is moved to the head, so that the oldest
-// sounds not used recently are at the tail.
+// Doubly-linked list of the allocated sounds that are not in use.
+// When a sound stops being used, it is put at the head, so that the
+// oldest sounds not used recently are at the tail. Sounds that are in
+// use are not in the list, so the tail can always be freed.
 
 static allocated_sound_t *allocated_sounds_head = nullptr;
 static allocated_sound_t *allocated_sounds_tail = nullptr;
 static int allocated_sounds_size = 0;
 
+// All allocated sounds, hashed by sfxinfo and pitch.
+
+static allocated_sound_t *allocated_sounds_hash[SOUND_HASH_SIZE];
+
+// Sound effects that were precached, for making pitch-shifted versions.
+
+static sfxinfo_t *precached_sounds = nullptr;
+static int num_precached_sounds = 0;
+
+// Pitch-shifted sounds being made by the background thread. The
+// thread fills in the results in order and counts them in
+// pitch_precache_done; the main thread adds them to the cache as they
+// appear. The base sounds are locked until the thread is finished.
+
+static pitch_precache_t *pitch_precache = nullptr;
+static int num_pitch_precache = 0;
+static int pitch_precache_collected = 0;
+static std::atomic<int> pitch_precache_done;
+static std::atomic<bool> pitch_precache_cancel;
+static SDL_Thread *pitch_precache_thread = nullptr;
+static boolean pitch_precache_started = false;
+
 
 // Hook a sound into the linked list at the head.
 
@@ -139,11 +215,42 @@ static void AllocatedSoundUnlink(allocated_sound_t *snd)
     }
 }
 
+static unsigned int SoundHash(sfxinfo_t *sfxinfo, int pitch)
+{
+    uintptr_t p = (uintptr_t) sfxinfo / sizeof(sfxinfo_t);
+
+    return (unsigned int) (p * 37 + pitch) & (SOUND_HASH_SIZE - 1);
+}
+
+static void AllocatedSoundHashAdd(allocated_sound_t *snd)
+{
+    unsigned int hash = SoundHash(snd->sfxinfo, snd->pitch);
+
+    snd->hash_next = allocated_sounds_hash[hash];
+    allocated_sounds_hash[hash] = snd;
+}
+
+static void AllocatedSoundHashRemove(allocated_sound_t *snd)
+{
+    allocated_sound_t **p;
+
+    p = &allocated_sounds_hash[SoundHash(snd->sfxinfo, snd->pitch)];
+
+    while (*p != snd)
+    {
+        p = &(*p)->hash_next;
+    }
+
+    *p = snd->hash_next;
+}
+
 static void FreeAllocatedSound(allocated_sound_t *snd)
 {
-    // Unlink from linked list.
+    // Unlink from linked list and hash table. Only sounds that are not
+    // in use are freed, so it is always in the list.
 
     AllocatedSoundUnlink(snd);
+    AllocatedSoundHashRemove(snd);
 
     // Keep track of the amount of allocated sound data:
 
@@ -152,30 +259,21 @@ static void FreeAllocatedSound(allocated_sound_t *snd)
     free(snd);
 }
 
-// Search from the tail backwards along the allocated sounds list, find
-// and free a sound that is not in use, to free up memory.  Return true
-// for success.
+// Free the sound that has gone unused for longest, to free up memory.
+// Return true for success.
 
 static boolean FindAndFreeSound(void)
 {
-    allocated_sound_t *snd;
-
-    snd = allocated_sounds_tail;
-
-    while (snd != nullptr)
+    if (allocated_sounds_tail == nullptr)
     {
-        if (snd->use_count == 0)
-        {
-            FreeAllocatedSound(snd);
-            return true;
-        }
+        // No available sounds to free...
 
-        snd = snd->prev;
+        return false;
     }
 
-    // No available sounds to free...
+    FreeAllocatedSound(allocated_sounds_tail);
 
-    return false;
+    return true;
 }
 
 // Enforce SFX cache size limit.  We are just about to allocate "len"
@@ -203,32 +301,21 @@ static void ReserveCacheSpace(size_t len)
     }
 }
 
-// Allocate a block for a new sound effect.
+// Allocate the memory for a sound, without adding it to the cache.
 
-static allocated_sound_t *AllocateSound(sfxinfo_t *sfxinfo, size_t len)
+static allocated_sound_t *NewSound(sfxinfo_t *sfxinfo, size_t len, int pitch)
 {
     allocated_sound_t *snd;
 
-    // Keep allocated sounds within the cache size.
-
-    ReserveCacheSpace(len);
+    // The data will immediately follow the structure, which acts as a
+    // header.
 
-    // Allocate the sound structure and data.  The data will immediately
-    // follow the structure, which acts as a header.
+    snd = (allocated_sound_t *)malloc(sizeof(allocated_sound_t) + len);
 
-    do
+    if (snd == nullptr)
     {
-        snd = (allocated_sound_t *)malloc(sizeof(allocated_sound_t) + len);
-
-        // Out of memory?  Try to free an old sound, then loop round
-        // and try again.
-
-        if (snd == nullptr && !FindAndFreeSound())
-        {
-            return nullptr;
-        }
-
-    } while (snd == nullptr);
+        return nullptr;
+    }
 
     // Skip past the chunk structure for the audio buffer
 
@@ -236,16 +323,53 @@ static allocated_sound_t *AllocateSound(sfxinfo_t *sfxinfo, size_t len)
     snd->chunk.alen = len;
     snd->chunk.allocated = 1;
     snd->chunk.volume = MIX_MAX_VOLUME;
-    snd->pitch = NORM_PITCH;
+    snd->pitch = pitch;
+    snd->pregenerated = false;
 
     snd->sfxinfo = sfxinfo;
     snd->use_count = 0;
 
+    return snd;
+}
+
+// Add a sound to the cache.
+
+static void AddAllocatedSound(allocated_sound_t *snd)
+{
     // Keep track of how much memory all these cached sounds are using...
 
-    allocated_sounds_size += len;
+    allocated_sounds_size += snd->chunk.alen;
 
     AllocatedSoundLink(snd);
+    AllocatedSoundHashAdd(snd);
+}
+
+// Allocate a block for a new sound effect.
+
+static allocated_sound_t *AllocateSound(sfxinfo_t *sfxinfo, size_t len,
+                                        int pitch)
+{
+    allocated_sound_t *snd;
+
+    // Keep allocated sounds within the cache size.
+
+    ReserveCacheSpace(len);
+
+    do
+    {
+        snd = NewSound(sfxinfo, len, pitch);
+
+        // Out of memory?  Try to free an old sound, then loop round
+        // and try again.
+
+        if (snd == nullptr && !FindAndFreeSound())
+        {
+            return nullptr;
+        }
+
+    } while (snd == nullptr);
+
+    AddAllocatedSound(snd);
 
     return snd;
 }
@@ -254,17 +378,18 @@ static allocated_sound_t *AllocateSound(sfxinfo_t *sfxinfo, size_t len)
 
 static void LockAllocatedSound(allocated_sound_t *snd)
 {
+    // Take the sound out of the list of sounds that can be freed.
+
+    if (snd->use_count == 0)
+    {
+        AllocatedSoundUnlink(snd);
+    }
+
     // Increase use count, to stop the sound being freed.
 
     ++snd->use_count;
 
     //printf("++ %s: Use count=%i\n", snd->sfxinfo->name, snd->use_count);
-
-    // When we use a sound, re-link it into the list at the head, so
-    // that the oldest sounds fall to the end of the list for freeing.
-
-    AllocatedSoundUnlink(snd);
-    AllocatedSoundLink(snd);
 }
 
 // Unlock a sound to indicate that it may now be freed.
@@ -279,14 +404,23 @@ static void UnlockAllocatedSound(allocated_sound_t *snd)
     --snd->use_count;
 
     //printf("-- %s: Use count=%i\n", snd->sfxinfo->name, snd->use_count);
+
+    // When a sound is no longer used, link it into the list at the
+    // head, so that the oldest sounds fall to the end of the list for
+    // freeing.
+
+    if (snd->use_count == 0)
+    {
+        AllocatedSoundLink(snd);
+    }
 }
 
-// Search through the list of allocated sounds and return the one that matches
-// the supplied sfxinfo entry and pitch level.
+// Return the allocated sound that matches the supplied sfxinfo entry and
+// pitch level.
 
 static allocated_sound_t * GetAllocatedSoundBySfxInfoAndPitch(sfxinfo_t *sfxinfo, int pitch)
 {
-    allocated_sound_t * p = allocated_sounds_head;
+    allocated_sound_t * p = allocated_sounds_hash[SoundHash(sfxinfo, pitch)];
 
     while (p != nullptr)
     {
@@ -294,24 +428,17 @@ static allocated_sound_t * GetAllocatedSoundBySfxInfoAndPitch(sfxinfo_t *sfxinfo
         {
             return p;
         }
-        p = p->next;
+        p = p->hash_next;
     }
 
     return nullptr;
 }
 
-// Allocate a new sound chunk and pitch-shift an existing sound up-or-down
-// into it.
+// Length in bytes of a sound of srclen bytes when pitch-shifted.
 
-static allocated_sound_t * PitchShift(allocated_sound_t *insnd, int pitch)
+static Uint32 PitchShiftLength(Uint32 srclen, int pitch)
 {
-    allocated_sound_t * outsnd;
-    Sint16 *inp, *outp;
-    Sint16 *srcbuf, *dstbuf;
-    Uint32 srclen, dstlen;
-
-    srcbuf = (Sint16 *)insnd->chunk.abuf;
-    srclen = insnd->chunk.alen;
+    Uint32 dstlen;
 
     // determine ratio pitch:NORM_PITCH and apply to srclen, then invert.
     // This is an approximation of vanilla behaviour based on measurements
@@ -323,30 +450,286 @@ static allocated_sound_t * PitchShift(allocated_sound_t *insnd, int pitch)
         dstlen++;
     }
 
-    outsnd = AllocateSound(insnd->sfxinfo, dstlen);
+    return dstlen;
+}
 
-    if (!outsnd)
-    {
-        return nullptr;
-    }
+// Resample a sound of srclen bytes into dstlen bytes. Each output cell
+// takes the input cell at the same fraction of the way through; the
+// position is stepped along in whole cells and a remainder, so there
+// is no division per sample.
+
+static void PitchShiftData(const Sint16 *srcbuf, Uint32 srclen,
+                           Sint16 *dstbuf, Uint32 dstlen)
+{
+    Uint32 step, step_frac, frac;
+    const Sint16 *inp;
+    Sint16 *outp;
 
-    outsnd->pitch = pitch;
-    dstbuf = (Sint16 *)outsnd->chunk.abuf;
+    step = srclen / dstlen;
+    step_frac = srclen % dstlen;
+
+    inp = srcbuf;
+    frac = 0;
 
     // loop over output buffer. find corresponding input cell, copy over
     for (outp = dstbuf; outp < dstbuf + dstlen/2; ++outp)
     {
-        inp = srcbuf + (int)((float)(outp - dstbuf) / dstlen * srclen);
         *outp = *inp;
+
+        inp += step;
+        frac += step_frac;
+
+        if (frac >= dstlen)
+        {
+            frac -= dstlen;
+            ++inp;
+        }
+    }
+}
+
+// Allocate a new sound chunk and pitch-shift an existing sound up-or-down
+// into it.
+
+static allocated_sound_t * PitchShift(allocated_sound_t *insnd, int pitch)
+{
+    allocated_sound_t * outsnd;
+    Uint32 dstlen;
+
+    dstlen = PitchShiftLength(insnd->chunk.alen, pitch);
+
+    outsnd = AllocateSound(insnd->sfxinfo, dstlen, pitch);
+
+    if (!outsnd)
+    {
+        return nullptr;
     }
 
+    PitchShiftData((Sint16 *) insnd->chunk.abuf, insnd->chunk.alen,
+                   (Sint16 *) outsnd->chunk.abuf, dstlen);
+
     return outsnd;
 }
 
+static int PitchPrecacheThread(void *unused)
+{
+    pitch_precache_t *entry;
+    int i;
+
+    for (i = 0; i < num_pitch_precache && !pitch_precache_cancel.load(); ++i)
+    {
+        entry = &pitch_precache[i];
+        entry->result = NewSound(entry->base->sfxinfo, entry->len,
+                                 entry->pitch);
+
+        if (entry->result != nullptr)
+        {
+            entry->result->pregenerated = true;
+            PitchShiftData((Sint16 *) entry->base->chunk.abuf,
+                           entry->base->chunk.alen,
+                           (Sint16 *) entry->result->chunk.abuf, entry->len);
+        }
+
+        pitch_precache_done.store(i + 1, std::memory_order_release);
+    }
+
+    return 0;
+}
+
+// Add the pitch-shifted sounds that the background thread has made to
+// the cache. If cancel is true, stop the thread and throw away what has
+// not been added yet.
+
+static void CollectPitchPrecache(boolean cancel)
+{
+    pitch_precache_t *entry;
+    allocated_sound_t *snd;
+    int done, i;
+
+    if (pitch_precache == nullptr)
+    {
+        return;
+    }
+
+    if (cancel)
+    {
+        pitch_precache_cancel.store(true);
+    }
+
+    if (cancel || pitch_precache_thread == nullptr)
+    {
+        done = num_pitch_precache;
+    }
+    else
+    {
+        done = pitch_precache_done.load(std::memory_order_acquire);
+    }
+
+    if (done == num_pitch_precache && pitch_precache_thread != nullptr)
+    {
+        SDL_WaitThread(pitch_precache_thread, nullptr);
+        pitch_precache_thread = nullptr;
+    }
+
+    for (; pitch_precache_collected < done; ++pitch_precache_collected)
+    {
+        entry = &pitch_precache[pitch_precache_collected];
+        snd = entry->result;
+
+        if (snd == nullptr)
+        {
+            continue;
+        }
+
+        // The sound may have been pitch-shifted when it was played in
+        // the meantime, or the cache may have filled up.
+
+        if (cancel
+         || GetAllocatedSoundBySfxInfoAndPitch(snd->sfxinfo, snd->pitch)
+                != nullptr
+         || (snd_cachesize > 0
+          && allocated_sounds_size + entry->len > (size_t) snd_cachesize))
+        {
+            free(snd);
+            continue;
+        }
+
+        AddAllocatedSound(snd);
+    }
+
+    if (pitch_precache_collected == num_pitch_precache)
+    {
+        for (i = 0; i < num_pitch_precache; ++i)
+        {
+            UnlockAllocatedSound(pitch_precache[i].base);
+        }
+
+        free(pitch_precache);
+        pitch_precache = nullptr;
+        num_pitch_precache = 0;
+    }
+}
+
+// Start making pitch-shifted versions of the precached sounds in the
+// background, for as many as there is room for in the cache. The
+// pitches nearest NORM_PITCH come first.
+
+static void StartPitchPrecache(void)
+{
+    allocated_sound_t *base;
+    pitch_precache_t *entry;
+    size_t space;
+    int distance, pitch;
+    int i;
+
+    if (pitch_precache_started || num_precached_sounds == 0)
+    {
+        return;
+    }
+
+    pitch_precache_started = true;
+
+    //!
+    // @category obscure
+    //
+    // Don't make pitch-shifted sound effects in advance.
+    //
+
+    if (M_ParmExists("-nopitchprecache"))
+    {
+        return;
+    }
+
+    space = snd_cachesize > allocated_sounds_size
+          ? snd_cachesize - allocated_sounds_size : 0;
+
+    pitch_precache = static_cast<pitch_precache_t *>(
+        I_Realloc(nullptr, num_precached_sounds * PITCH_PRECACHE_RANGE * 2
+                           * sizeof(pitch_precache_t)));
+    num_pitch_precache = 0;
+
+    for (distance = 1; distance <= PITCH_PRECACHE_RANGE; ++distance)
+    {
+        for (pitch = NORM_PITCH - distance; pitch <= NORM_PITCH + distance;
+             pitch += distance * 2)
+        {
+            for (i = 0; i < num_precached_sounds; ++i)
+            {
+                base = GetAllocatedSoundBySfxInfoAndPitch(
+                    &precached_sounds[i], NORM_PITCH);
+
+                if (base == nullptr
+                 || GetAllocatedSoundBySfxInfoAndPitch(base->sfxinfo, pitch)
+                        != nullptr)
+                {
+                    continue;
+                }
+
+                entry = &pitch_precache[num_pitch_precache];
+                entry->base = base;
+                entry->pitch = pitch;
+                entry->len = PitchShiftLength(base->chunk.alen, pitch);
+                entry->result = nullptr;
+
+                if (snd_cachesize > 0)
+                {
+                    if (entry->len > space)
+                    {
+                        continue;
+                    }
+
+                    space -= entry->len;
+                }
+
+                ++num_pitch_precache;
+            }
+        }
+    }
+
+    if (num_pitch_precache == 0)
+    {
+        free(pitch_precache);
+        pitch_precache = nullptr;
+        return;
+    }
+
+    // Keep the base sounds until the thread is done with them.
+
+    for (i = 0; i < num_pitch_precache; ++i)
+    {
+        LockAllocatedSound(pitch_precache[i].base);
+    }
+
+    pitch_precache_collected = 0;
+    pitch_precache_done.store(0);
+    pitch_precache_cancel.store(false);
+    pitch_precache_thread = SDL_CreateThread(PitchPrecacheThread,
+                                             "pitch precache", nullptr);
+
+    // If no thread could be started, sounds are pitch-shifted when they
+    // are played, as before.
+
+    if (pitch_precache_thread == nullptr)
+    {
+        CollectPitchPrecache(true);
+    }
+}
+
 // When a sound stops, check if it is still playing.  If it is not,
 // we can mark the sound data as CACHE to be freed back for other
 // means.
 
+static void ReleaseAllocatedSound(allocated_sound_t *snd)
+{
+    UnlockAllocatedSound(snd);
+
+    // if the sound is a pitch-shift and it's not in use, immediately
+    // free it, unless it was made in advance to be kept
+    if (snd->pitch != NORM_PITCH && !snd->pregenerated && snd->use_count <= 0)
+    {
+        FreeAllocatedSound(snd);
+    }
+}
+
 static void ReleaseSoundOnChannel(int channel)
 {
     allocated_sound_t *snd = channels_playing[channel];
@@ -360,14 +743,7 @@ static void ReleaseSoundOnChannel(int channel)
 
     channels_playing[channel] = nullptr;
 
-    UnlockAllocatedSound(snd);
-
-    // if the sound is a pitch-shift and it's not in use, immediately
-    // free it
-    if (snd->pitch != NORM_PITCH && snd->use_count <= 0)
-    {
-        FreeAllocatedSound(snd);
-    }
+    ReleaseAllocatedSound(snd);
 }
 
 #ifdef HAVE_LIBSAMPLERATE
@@ -463,7 +839,7 @@ static boolean ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
 
 //    alen = src_data.output_frames_gen * 4;
 
-    snd = AllocateSound(sfxinfo, src_data.output_frames_gen * 4);
+    snd = AllocateSound(sfxinfo, src_data.output_frames_gen * 4, NORM_PITCH);
 
     if (snd == nullptr)
     {
@@ -639,7 +1015,7 @@ static boolean ExpandSoundData_SDL(sfxinfo_t *sfxinfo,
 
     // Allocate a chunk in which to expand the sound
 
-    snd = AllocateSound(sfxinfo, expanded_length);
+    snd = AllocateSound(sfxinfo, expanded_length, NORM_PITCH);
 
     if (snd == nullptr)
     {
@@ -910,6 +1286,17 @@ static void I_SDL_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
     }
 
     printf("\n");
+
+    precached_sounds = sounds;
+    num_precached_sounds = num_sounds;
+
+    // Some games only decide whether to pitch-shift after precaching;
+    // otherwise the first pitch-shifted sound starts this.
+
+    if (snd_pitchshift > 0)
+    {
+        StartPitchPrecache();
+    }
 }
 
 // Load a SFX chunk into memory and ensure that it is locked.
@@ -930,14 +1317,71 @@ static boolean LockSound(sfxinfo_t *sfxinfo)
     return true;
 }
 
-//
-// Retrieve the raw data lump index
-//  for a given SFX name.
-//
+// Get the sound data to play a SFX at the given pitch, pitch-shifting
+// it if need be, and lock it.
 
-static int I_SDL_GetSfxLumpNum(sfxinfo_t *sfx)
+static allocated_sound_t *LockSoundWithPitch(sfxinfo_t *sfxinfo, int pitch)
 {
-    char namebuf[9];
+    allocated_sound_t *snd;
+
+    if (pitch != NORM_PITCH && snd_pitchshift)
+    {
+        StartPitchPrecache();
+    }
+
+    CollectPitchPrecache(false);
+
+    if (!LockSound(sfxinfo))
+    {
+        return nullptr;
+    }
+
+    snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, pitch);
+
+    if (snd == nullptr)
+    {
+        allocated_sound_t *newsnd;
+        // fetch the base sound effect, un-pitch-shifted
+        snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH);
+
+        if (snd == nullptr)
+        {
+            return nullptr;
+        }
+
+        if (snd_pitchshift)
+        {
+            newsnd = PitchShift(snd, pitch);
+
+            if (newsnd)
+            {
+                LockAllocatedSound(newsnd);
+                UnlockAllocatedSound(snd);
+                snd = newsnd;
+            }
+        }
+    }
+    else if (snd->pitch != NORM_PITCH)
+    {
+        // Swap the lock on the base sound taken by LockSound() for
+        // one on the pitch-shifted sound that will be played.
+
+        LockAllocatedSound(snd);
+        UnlockAllocatedSound(
+            GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH));
+    }
+
+    return snd;
+}
+
+//
+// Retrieve the raw data lump index
+//  for a given SFX name.
+//
+
+static int I_SDL_GetSfxLumpNum(sfxinfo_t *sfx)
+{
+    char namebuf[9];
 
     GetSfxLumpName(sfx, namebuf, sizeof(namebuf));
 
@@ -994,39 +1438,11 @@ static int I_SDL_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, i
 
     // Get the sound data
 
-    if (!LockSound(sfxinfo))
-    {
-        return -1;
-    }
-
-    snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, pitch);
+    snd = LockSoundWithPitch(sfxinfo, pitch);
 
     if (snd == nullptr)
     {
-        allocated_sound_t *newsnd;
-        // fetch the base sound effect, un-pitch-shifted
-        snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH);
-
-        if (snd == nullptr)
-        {
-            return -1;
-        }
-
-        if (snd_pitchshift)
-        {
-            newsnd = PitchShift(snd, pitch);
-
-            if (newsnd)
-            {
-                LockAllocatedSound(newsnd);
-                UnlockAllocatedSound(snd);
-                snd = newsnd;
-            }
-        }
-    }
-    else
-    {
-        LockAllocatedSound(snd);
+        return -1;
     }
 
     // play sound
@@ -1074,6 +1490,8 @@ static void I_SDL_UpdateSound(void)
 {
     int i;
 
+    CollectPitchPrecache(false);
+
     // Check all channels to see if a sound has finished
 
     for (i=0; i<NUM_CHANNELS; ++i)
@@ -1095,6 +1513,8 @@ static void I_SDL_ShutdownSound(void)
         return;
     }
 
+    CollectPitchPrecache(true);
+
     Mix_CloseAudio();
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
 
@@ -1128,17 +1548,38 @@ static int GetSliceSize(void)
     return 1024;
 }
 
-static boolean I_SDL_InitSound(boolean _use_sfx_prefix)
+// Pick the function that converts sound effects to the mixer format.
+
+static void ChooseExpandSoundData(void)
 {
-    int i;
+    ExpandSoundData = ExpandSoundData_SDL;
 
-    use_sfx_prefix = _use_sfx_prefix;
+#ifdef HAVE_LIBSAMPLERATE
+    if (use_libsamplerate != 0)
+    {
+        if (SRC_ConversionMode() < 0)
+        {
+            I_Error("I_SDL_InitSound: Invalid value for use_libsamplerate: %i",
+                    use_libsamplerate);
+        }
 
-    // No sounds yet
-    for (i=0; i<NUM_CHANNELS; ++i)
+        ExpandSoundData = ExpandSoundData_SRC;
+    }
+#else
+    if (use_libsamplerate != 0)
     {
-        channels_playing[i] = nullptr;
+        fprintf(stderr, "I_SDL_InitSound: use_libsamplerate=%i, but "
+                        "libsamplerate support not compiled in.\n",
+                        use_libsamplerate);
     }
+#endif
+}
+
+// Open the audio device through SDL_mixer.
+
+static boolean OpenMixer(boolean _use_sfx_prefix)
+{
+    use_sfx_prefix = _use_sfx_prefix;
 
     if (SDL_Init(SDL_INIT_AUDIO) < 0)
     {
@@ -1152,29 +1593,27 @@ static boolean I_SDL_InitSound(boolean _use_sfx_prefix)
         return false;
     }
 
-    ExpandSoundData = ExpandSoundData_SDL;
-
     Mix_QuerySpec(&mixer_freq, &mixer_format, &mixer_channels);
 
-#ifdef HAVE_LIBSAMPLERATE
-    if (use_libsamplerate != 0)
-    {
-        if (SRC_ConversionMode() < 0)
-        {
-            I_Error("I_SDL_InitSound: Invalid value for use_libsamplerate: %i",
-                    use_libsamplerate);
-        }
+    ChooseExpandSoundData();
 
-        ExpandSoundData = ExpandSoundData_SRC;
+    return true;
+}
+
+static boolean I_SDL_InitSound(boolean _use_sfx_prefix)
+{
+    int i;
+
+    // No sounds yet
+    for (i=0; i<NUM_CHANNELS; ++i)
+    {
+        channels_playing[i] = nullptr;
     }
-#else
-    if (use_libsamplerate != 0)
+
+    if (!OpenMixer(_use_sfx_prefix))
     {
-        fprintf(stderr, "I_SDL_InitSound: use_libsamplerate=%i, but "
-                        "libsamplerate support not compiled in.\n",
-                        use_libsamplerate);
+        return false;
     }
-#endif
 
     Mix_AllocateChannels(NUM_CHANNELS);
 
@@ -1210,5 +1649,663 @@ sound_module_t sound_sdl_module =
     I_SDL_PrecacheSounds,
 };
 
+//
+// Software mixer.
+//
+// Sound effects are mixed into SDL_mixer's output by a single post-mix
+// callback, rather than each being played on an SDL_mixer channel, so
+// there is no limit to the number of channels but SOFTMIX_MAX_VOICES.
+// The main thread starts and stops voices by sending commands to the
+// mixing thread through a lock-free queue; volume and panning are
+// atomics that the mixing thread reads, and ramps towards, as it mixes.
+// Sound data is only released once the mixing thread has said that it
+// is finished with it.
+//
+
+typedef enum
+{
+    SOFTMIX_START,
+    SOFTMIX_STOP,
+} softmix_command_type_t;
+
+typedef struct
+{
+    softmix_command_type_t type;
+    int voice;
+    uint32_t id;
+    const Sint16 *data;
+    Uint32 frames;
+
+    // Performance counter when the sound was started, if statistics
+    // are being gathered.
+    uint64_t start_time;
+} softmix_command_t;
+
+typedef struct
+{
+    // Only used by the main thread: the sound playing, and a count of
+    // the sounds started on this voice.
+    allocated_sound_t *snd;
+    uint32_t id;
+
+    // Volume of the left channel in the low 16 bits and of the right
+    // channel in the high 16 bits, in 1/32768ths.
+    std::atomic<uint32_t> gains;
+
+    // Id of the last sound that the mixing thread is finished with.
+    std::atomic<uint32_t> done_id;
+
+    // Only used by the mixing thread.
+    const Sint16 *data;
+    Uint32 frames;
+    Uint32 pos;
+    uint32_t mix_id;
+    int left, right;
+    boolean active;
+} softmix_voice_t;
+
+// A sound that has been stopped, but may still be being read by the
+// mixing thread.
+
+typedef struct
+{
+    allocated_sound_t *snd;
+    int voice;
+    uint32_t id;
+} softmix_retired_t;
+
+static softmix_voice_t softmix_voices[SOFTMIX_MAX_VOICES];
+static spsc_queue<softmix_command_t, SOFTMIX_QUEUE_LEN> softmix_queue;
+
+static softmix_retired_t *softmix_retired = nullptr;
+static int num_softmix_retired = 0;
+static int softmix_retired_size = 0;
+
+// Mix buffer, for the mixing thread.
+
+static int32_t softmix_buffer[SOFTMIX_BLOCK_FRAMES * 2];
+
+static void SoftMix_RunCommands(void)
+{
+    softmix_command_t *cmd;
+    softmix_voice_t *voice;
+    uint32_t gains;
+
+    while ((cmd = softmix_queue.front()) != nullptr)
+    {
+        voice = &softmix_voices[cmd->voice];
+
+        switch (cmd->type)
+        {
+            case SOFTMIX_START:
+                gains = voice->gains.load(std::memory_order_relaxed);
+                voice->data = cmd->data;
+                voice->frames = cmd->frames;
+                voice->pos = 0;
+                voice->mix_id = cmd->id;
+                voice->left = gains & 0xffff;
+                voice->right = gains >> 16;
+                voice->active = voice->frames > 0;
+
+                if (!voice->active)
+                {
+                    voice->done_id.store(cmd->id, std::memory_order_release);
+                }
+                else if (cmd->start_time != 0)
+                {
+                    // It is about to be mixed.
+                    I_AudioStatsLatency(cmd->start_time,
+                                        SDL_GetPerformanceCounter());
+                }
+                break;
+
+            case SOFTMIX_STOP:
+                voice->active = false;
+                voice->done_id.store(cmd->id, std::memory_order_release);
+                break;
+        }
+
+        softmix_queue.pop_front();
+    }
+}
+
+// Add nframes stereo frames from src, at constant volume, into the mix.
+
+static void SoftMix_MixFrames(int32_t *mix, const Sint16 *src,
+                              unsigned int nframes, int left, int right)
+{
+    unsigned int i = 0;
+
+#ifdef SOFTMIX_SSE2
+    __m128i gains, samples, lo, hi, sum;
+
+    gains = _mm_set_epi16(right, left, right, left, right, left, right, left);
+
+    // Four frames at a time: multiply to 32-bit products, scale and
+    // add to the mix.
+
+    for (; i + 4 <= nframes; i += 4)
+    {
+        samples = _mm_loadu_si128((const __m128i *) (src + i * 2));
+        lo = _mm_mullo_epi16(samples, gains);
+        hi = _mm_mulhi_epi16(samples, gains);
+
+        sum = _mm_loadu_si128((__m128i *) (mix + i * 2));
+        sum = _mm_add_epi32(sum,
+                  _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15));
+        _mm_storeu_si128((__m128i *) (mix + i * 2), sum);
+
+        sum = _mm_loadu_si128((__m128i *) (mix + i * 2 + 4));
+        sum = _mm_add_epi32(sum,
+                  _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15));
+        _mm_storeu_si128((__m128i *) (mix + i * 2 + 4), sum);
+    }
+#endif
+
+    for (; i < nframes; ++i)
+    {
+        mix[i * 2] += (src[i * 2] * left) >> 15;
+        mix[i * 2 + 1] += (src[i * 2 + 1] * right) >> 15;
+    }
+}
+
+static void SoftMix_MixVoice(softmix_voice_t *voice, int32_t *mix,
+                             unsigned int nframes)
+{
+    const Sint16 *src;
+    uint32_t gains;
+    unsigned int count, ramp, i;
+    int target_left, target_right;
+    int left, right, left_step, right_step;
+
+    count = voice->frames - voice->pos;
+
+    if (count > nframes)
+    {
+        count = nframes;
+    }
+
+    src = voice->data + voice->pos * 2;
+    i = 0;
+
+    gains = voice->gains.load(std::memory_order_relaxed);
+    target_left = gains & 0xffff;
+    target_right = gains >> 16;
+
+    // Spread a change of volume or panning over a few milliseconds,
+    // so that it does not click.
+
+    if (target_left != voice->left || target_right != voice->right)
+    {
+        ramp = count < SOFTMIX_RAMP_FRAMES ? count : SOFTMIX_RAMP_FRAMES;
+
+        if (ramp > 0)
+        {
+            // Volumes with 8 bits of fraction.
+
+            left = voice->left * 256;
+            right = voice->right * 256;
+            left_step = (target_left - voice->left) * 256 / (int) ramp;
+            right_step = (target_right - voice->right) * 256 / (int) ramp;
+
+            for (; i < ramp; ++i)
+            {
+                left += left_step;
+                right += right_step;
+                mix[i * 2] += (src[i * 2] * (left >> 8)) >> 15;
+                mix[i * 2 + 1] += (src[i * 2 + 1] * (right >> 8)) >> 15;
+            }
+        }
+
+        voice->left = target_left;
+        voice->right = target_right;
+    }
+
+    SoftMix_MixFrames(mix + i * 2, src + i * 2, count - i,
+                      voice->left, voice->right);
+
+    voice->pos += count;
+
+    if (voice->pos >= voice->frames)
+    {
+        voice->active = false;
+        voice->done_id.store(voice->mix_id, std::memory_order_release);
+    }
+}
+
+// Add the mix to the output, clipping it.
+
+static void SoftMix_Output(Sint16 *out, const int32_t *mix,
+                           unsigned int nframes)
+{
+    unsigned int i = 0;
+    int32_t sample;
+
+#ifdef SOFTMIX_SSE2
+    __m128i samples, lo, hi;
+
+    for (; i + 4 <= nframes; i += 4)
+    {
+        samples = _mm_loadu_si128((const __m128i *) (out + i * 2));
+        lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        lo = _mm_add_epi32(lo, _mm_loadu_si128((const __m128i *) (mix + i * 2)));
+        hi = _mm_add_epi32(hi,
+                 _mm_loadu_si128((const __m128i *) (mix + i * 2 + 4)));
+        _mm_storeu_si128((__m128i *) (out + i * 2), _mm_packs_epi32(lo, hi));
+    }
+#endif
+
+    for (i *= 2; i < nframes * 2; ++i)
+    {
+        sample = out[i] + mix[i];
+
+        if (sample > INT16_MAX)
+        {
+            sample = INT16_MAX;
+        }
+        else if (sample < INT16_MIN)
+        {
+            sample = INT16_MIN;
+        }
+
+        out[i] = sample;
+    }
+}
+
+// Post-mix callback: called on the audio thread after SDL_mixer has
+// mixed the music.
+
+static void SoftMix_Callback(void *udata, Uint8 *stream, int len)
+{
+    Sint16 *out = (Sint16 *) stream;
+    unsigned int nframes, n, i;
+    uint64_t start = 0;
+    int voices;
+
+    if (audiostats_enabled)
+    {
+        start = SDL_GetPerformanceCounter();
+    }
+
+    SoftMix_RunCommands();
+
+    nframes = len / 4;
+
+    if (audiostats_enabled)
+    {
+        voices = 0;
+
+        for (i = 0; i < SOFTMIX_MAX_VOICES; ++i)
+        {
+            voices += softmix_voices[i].active;
+        }
+
+        I_AudioStatsDepth(AUDIOSTAT_VOICES, voices, SOFTMIX_MAX_VOICES);
+    }
+
+    while (nframes > 0)
+    {
+        n = nframes < SOFTMIX_BLOCK_FRAMES ? nframes : SOFTMIX_BLOCK_FRAMES;
+
+        memset(softmix_buffer, 0, n * 2 * sizeof(int32_t));
+
+        for (i = 0; i < SOFTMIX_MAX_VOICES; ++i)
+        {
+            if (softmix_voices[i].active)
+            {
+                SoftMix_MixVoice(&softmix_voices[i], softmix_buffer, n);
+            }
+        }
+
+        SoftMix_Output(out, softmix_buffer, n);
+
+        out += n * 2;
+        nframes -= n;
+    }
+
+    if (audiostats_enabled)
+    {
+        I_AudioStatsCallback(AUDIOSTAT_SOFTMIX, start,
+                             SDL_GetPerformanceCounter(),
+                             (unsigned int) (((uint64_t) (len / 4) * 1000000)
+                                             / mixer_freq));
+    }
+}
+
+// Send a command to the mixing thread, waiting for room in the queue
+// if it is behind.
+
+static void SoftMix_SendCommand(const softmix_command_t *cmd)
+{
+    while (!softmix_queue.push(*cmd))
+    {
+        SDL_Delay(1);
+    }
+}
+
+static boolean SoftMix_VoiceDone(int handle, uint32_t id)
+{
+    uint32_t done_id;
+
+    done_id = softmix_voices[handle].done_id.load(std::memory_order_acquire);
+
+    return (int32_t) (done_id - id) >= 0;
+}
+
+// Release the sounds that the mixing thread has finished with.
+
+static void SoftMix_ReleaseRetired(void)
+{
+    softmix_retired_t *retired;
+    int i;
+
+    for (i = 0; i < num_softmix_retired; )
+    {
+        retired = &softmix_retired[i];
+
+        if (SoftMix_VoiceDone(retired->voice, retired->id))
+        {
+            ReleaseAllocatedSound(retired->snd);
+            *retired = softmix_retired[--num_softmix_retired];
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+// Stop the sound playing on a voice, if there is one.
+
+static void SoftMix_ReleaseVoice(int handle)
+{
+    softmix_voice_t *voice = &softmix_voices[handle];
+    softmix_command_t cmd;
+    softmix_retired_t *retired;
+
+    if (voice->snd == nullptr)
+    {
+        return;
+    }
+
+    if (SoftMix_VoiceDone(handle, voice->id))
+    {
+        ReleaseAllocatedSound(voice->snd);
+    }
+    else
+    {
+        cmd.type = SOFTMIX_STOP;
+        cmd.voice = handle;
+        cmd.id = voice->id;
+        cmd.data = nullptr;
+        cmd.frames = 0;
+        cmd.start_time = 0;
+        SoftMix_SendCommand(&cmd);
+
+        if (num_softmix_retired >= softmix_retired_size)
+        {
+            softmix_retired_size = softmix_retired_size * 2 + 16;
+            softmix_retired = static_cast<softmix_retired_t *>(
+                I_Realloc(softmix_retired,
+                          softmix_retired_size * sizeof(softmix_retired_t)));
+        }
+
+        retired = &softmix_retired[num_softmix_retired++];
+        retired->snd = voice->snd;
+        retired->voice = handle;
+        retired->id = voice->id;
+    }
+
+    voice->snd = nullptr;
+}
+
+static void I_SoftMix_UpdateSoundParams(int handle, int vol, int sep)
+{
+    int left, right;
+
+    if (!sound_initialized || handle < 0 || handle >= SOFTMIX_MAX_VOICES)
+    {
+        return;
+    }
+
+    // Same volumes as are given to Mix_SetPanning().
+
+    left = ((254 - sep) * vol) / 127;
+    right = ((sep) * vol) / 127;
+
+    if (left < 0) left = 0;
+    else if ( left > 255) left = 255;
+    if (right < 0) right = 0;
+    else if (right > 255) right = 255;
+
+    left = (left * INT16_MAX) / 255;
+    right = (right * INT16_MAX) / 255;
+
+    softmix_voices[handle].gains.store(left | (right << 16),
+                                       std::memory_order_relaxed);
+}
+
+static int I_SoftMix_StartSound(sfxinfo_t *sfxinfo, int channel, int vol,
+                                int sep, int pitch)
+{
+    softmix_voice_t *voice;
+    softmix_command_t cmd;
+    allocated_sound_t *snd;
+    uint64_t start_time = 0;
+
+    if (!sound_initialized || channel < 0 || channel >= SOFTMIX_MAX_VOICES)
+    {
+        return -1;
+    }
+
+    // Latency is measured from here, so that it includes loading or
+    // pitch-shifting the sound if it is not in the cache.
+
+    if (audiostats_enabled)
+    {
+        start_time = SDL_GetPerformanceCounter();
+    }
+
+    SoftMix_ReleaseVoice(channel);
+
+    snd = LockSoundWithPitch(sfxinfo, pitch);
+
+    if (snd == nullptr)
+    {
+        return -1;
+    }
+
+    voice = &softmix_voices[channel];
+    voice->snd = snd;
+    ++voice->id;
+
+    I_SoftMix_UpdateSoundParams(channel, vol, sep);
+
+    cmd.type = SOFTMIX_START;
+    cmd.voice = channel;
+    cmd.id = voice->id;
+    cmd.data = (const Sint16 *) snd->chunk.abuf;
+    cmd.frames = snd->chunk.alen / 4;
+    cmd.start_time = start_time;
+    SoftMix_SendCommand(&cmd);
+
+    return channel;
+}
+
+static void I_SoftMix_StopSound(int handle)
+{
+    if (!sound_initialized || handle < 0 || handle >= SOFTMIX_MAX_VOICES)
+    {
+        return;
+    }
+
+    SoftMix_ReleaseVoice(handle);
+}
+
+static boolean I_SoftMix_SoundIsPlaying(int handle)
+{
+    if (!sound_initialized || handle < 0 || handle >= SOFTMIX_MAX_VOICES)
+    {
+        return false;
+    }
+
+    return softmix_voices[handle].snd != nullptr
+        && !SoftMix_VoiceDone(handle, softmix_voices[handle].id);
+}
+
+static void I_SoftMix_UpdateSound(void)
+{
+    softmix_voice_t *voice;
+    int i;
+
+    CollectPitchPrecache(false);
+
+    // Release the sounds that have finished playing.
+
+    for (i = 0; i < SOFTMIX_MAX_VOICES; ++i)
+    {
+        voice = &softmix_voices[i];
+
+        if (voice->snd != nullptr && SoftMix_VoiceDone(i, voice->id))
+        {
+            ReleaseAllocatedSound(voice->snd);
+            voice->snd = nullptr;
+        }
+    }
+
+    SoftMix_ReleaseRetired();
+}
+
+static void I_SoftMix_ShutdownSound(void)
+{
+    int i;
+
+    if (!sound_initialized)
+    {
+        return;
+    }
+
+    // Once the callback is removed, the mixing thread no longer reads
+    // any sound data.
+
+    Mix_SetPostMix(nullptr, nullptr);
+    softmix_queue.clear();
+
+    for (i = 0; i < SOFTMIX_MAX_VOICES; ++i)
+    {
+        softmix_voices[i].active = false;
+
+        if (softmix_voices[i].snd != nullptr)
+        {
+            ReleaseAllocatedSound(softmix_voices[i].snd);
+            softmix_voices[i].snd = nullptr;
+        }
+    }
+
+    for (i = 0; i < num_softmix_retired; ++i)
+    {
+        ReleaseAllocatedSound(softmix_retired[i].snd);
+    }
+
+    num_softmix_retired = 0;
+
+    I_SDL_ShutdownSound();
+}
+
+static void SoftMix_ResetVoices(void)
+{
+    int i;
+
+    for (i = 0; i < SOFTMIX_MAX_VOICES; ++i)
+    {
+        softmix_voices[i].snd = nullptr;
+        softmix_voices[i].id = 0;
+        softmix_voices[i].done_id.store(0);
+        softmix_voices[i].gains.store(0);
+        softmix_voices[i].active = false;
+    }
+
+    softmix_queue.clear();
+}
+
+static boolean I_SoftMix_InitSound(boolean _use_sfx_prefix)
+{
+    if (!snd_softmixer)
+    {
+        return false;
+    }
+
+    if (!OpenMixer(_use_sfx_prefix))
+    {
+        return false;
+    }
+
+    if (mixer_format != AUDIO_S16SYS || mixer_channels != 2)
+    {
+        fprintf(stderr, "I_SoftMix_InitSound: Software mixer needs 16-bit "
+                        "stereo output.\n");
+        Mix_CloseAudio();
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    SoftMix_ResetVoices();
+
+    // SDL_mixer's channels are not used.
+
+    Mix_AllocateChannels(0);
+    Mix_SetPostMix(SoftMix_Callback, nullptr);
+
+    SDL_PauseAudio(0);
+
+    sound_initialized = true;
+
+    return true;
+}
+
+// Set up the software mixer for offline rendering, without an audio
+// device: nothing is mixed until I_SoftMix_Render() asks for it, on the
+// calling thread. The other functions of sound_softmix_module can then
+// be used as usual.
+
+boolean I_SoftMix_InitRender(int samplerate)
+{
+    use_sfx_prefix = false;
+    mixer_freq = samplerate;
+    mixer_format = AUDIO_S16SYS;
+    mixer_channels = 2;
+
+    ChooseExpandSoundData();
+    SoftMix_ResetVoices();
+
+    sound_initialized = true;
+
+    return true;
+}
+
+// Mix the sound effects playing into nframes stereo frames of buffer,
+// as the post-mix callback would.
+
+void I_SoftMix_Render(int16_t *buffer, unsigned int nframes)
+{
+    SoftMix_Callback(nullptr, (Uint8 *) buffer, nframes * 4);
+}
+
+sound_module_t sound_softmix_module =
+{
+    sound_sdl_devices,
+    arrlen(sound_sdl_devices),
+    I_SoftMix_InitSound,
+    I_SoftMix_ShutdownSound,
+    I_SDL_GetSfxLumpNum,
+    I_SoftMix_UpdateSound,
+    I_SoftMix_UpdateSoundParams,
+    I_SoftMix_StartSound,
+    I_SoftMix_StopSound,
+    I_SoftMix_SoundIsPlaying,
+    I_SDL_PrecacheSounds,
+};
+
 
 #endif // DISABLE_SDL2MIXER
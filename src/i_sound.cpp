@@ -24,6 +24,7 @@
 #include "doomtype.hpp"
 
 #include "gusconf.hpp"
+#include "i_audiostats.hpp"
 #include "i_sound.hpp"
 #include "i_video.hpp"
 #include "m_argv.hpp"
@@ -81,6 +82,7 @@ static int snd_mport = 0;
 static sound_module_t *sound_modules[] = 
 {
 #ifndef DISABLE_SDL2MIXER
+    &sound_softmix_module,
     &sound_sdl_module,
 #endif // DISABLE_SDL2MIXER
     &sound_pcsound_module,
@@ -240,6 +242,8 @@ void I_InitSound(boolean use_sfx_prefix)
     // Auto configure the music pack directory.
     M_SetMusicPackDir();
 
+    I_InitAudioStats();
+
     // Initialize the sound and music subsystems.
 
     if (!nosound && !screensaver_mode)
@@ -271,6 +275,8 @@ void I_InitSound(boolean use_sfx_prefix)
         {
             music_packs_active = music_pack_module.Init();
         }
+
+        I_WatchAudioDevice();
     }
     // [crispy] print the SDL audio backend
     {
@@ -282,6 +288,8 @@ void I_InitSound(boolean use_sfx_prefix)
 
 void I_ShutdownSound(void)
 {
+    I_PrintAudioStats();
+
     if (sound_module != nullptr)
     {
         sound_module->Shutdown();
@@ -403,6 +411,21 @@ void I_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
     }
 }
 
+// [crispy] The largest number of sound channels that the sound module
+// in use can play at once.
+
+int I_MaxSoundChannels(void)
+{
+#ifndef DISABLE_SDL2MIXER
+    if (sound_module == &sound_softmix_module)
+    {
+        return SOFTMIX_MAX_VOICES;
+    }
+#endif // DISABLE_SDL2MIXER
+
+    return MAX_SOUND_CHANNELS;
+}
+
 void I_InitMusic(void)
 {
 }
@@ -500,6 +523,17 @@ void *I_RegisterSong(void *data, int len)
     }
 }
 
+// Hint that a song is going to be registered soon. Only the music pack
+// module has anything to do ahead of time.
+
+void I_PrefetchSong(void *data, int len)
+{
+    if (music_packs_active)
+    {
+        I_MP_PrefetchSong(data, len);
+    }
+}
+
 void I_UnRegisterSong(void *handle)
 {
     if (active_music_module != nullptr)
@@ -567,5 +601,6 @@ void I_BindSoundVariables(void)
 
     M_BindIntVariable("use_libsamplerate",       &use_libsamplerate);
     M_BindFloatVariable("libsamplerate_scale",   &libsamplerate_scale);
+    M_BindIntVariable("snd_softmixer",           &snd_softmixer);
 }
 
@@ -161,6 +161,14 @@ void I_StopSound(int channel);
 boolean I_SoundIsPlaying(int channel);
 void I_PrecacheSounds(sfxinfo_t *sounds, int num_sounds);
 
+// [crispy] The number of sound channels that SDL_mixer can play, and
+// the number of voices that the software mixer can play.
+
+#define MAX_SOUND_CHANNELS 32
+#define SOFTMIX_MAX_VOICES 256
+
+int I_MaxSoundChannels(void);
+
 // Interface for music modules
 
 typedef struct
@@ -222,6 +230,7 @@ void I_SetMusicVolume(int volume);
 void I_PauseSong(void);
 void I_ResumeSong(void);
 void *I_RegisterSong(void *data, int len);
+void I_PrefetchSong(void *data, int len);
 void I_UnRegisterSong(void *handle);
 void I_PlaySong(void *handle, boolean looping);
 void I_StopSong(void);
@@ -240,6 +249,7 @@ extern int snd_pitchshift;
 extern const char *snd_dmxoption;
 extern int use_libsamplerate;
 extern float libsamplerate_scale;
+extern int snd_softmixer;
 
 void I_BindSoundVariables(void);
 
@@ -257,7 +267,13 @@ void I_OPL_DevMessages(char *, size_t);
 
 void I_InitTimidityConfig(void);
 extern sound_module_t sound_sdl_module;
+extern sound_module_t sound_softmix_module;
 extern sound_module_t sound_pcsound_module;
+
+// Offline rendering through the software mixer, with no audio device.
+
+boolean I_SoftMix_InitRender(int samplerate);
+void I_SoftMix_Render(int16_t *buffer, unsigned int nframes);
 extern music_module_t music_sdl_module;
 extern music_module_t music_opl_module;
 extern music_module_t music_pack_module;
@@ -270,6 +286,7 @@ extern int opl_io_port;
 // For native music module:
 
 extern const char *music_pack_path;
+void I_MP_PrefetchSong(void *data, int len);
 extern const char *fluidsynth_sf_path;
 extern const char *timidity_cfg_path;
 #ifdef _WIN32
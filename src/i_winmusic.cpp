@@ -1300,24 +1300,24 @@ static void I_WIN_ResumeSong(void)
     }
 }
 
-static boolean ConvertMus(byte *musdata, int len, const char *filename)
+// Convert a MUS lump to MIDI in memory and load the result.
+
+static midi_file_t *LoadMus(byte *musdata, int len)
 {
     MEMFILE *instream;
     MEMFILE *outstream;
     void *outbuf;
     size_t outbuf_len;
-    int result;
+    midi_file_t *result = nullptr;
 
     instream = mem_fopen_read(musdata, len);
     outstream = mem_fopen_write();
 
-    result = mus2mid(instream, outstream);
-
-    if (result == 0)
+    if (mus2mid(instream, outstream) == 0)
     {
         mem_get_buf(outstream, &outbuf, &outbuf_len);
 
-        M_WriteFile(filename, outbuf, outbuf_len);
+        result = MIDI_LoadMemory(outbuf, outbuf_len);
     }
 
     mem_fclose(instream);
@@ -1329,7 +1329,6 @@ static boolean ConvertMus(byte *musdata, int len, const char *filename)
 static void *I_WIN_RegisterSong(void *data, int len)
 {
     unsigned int i;
-    char *filename;
     midi_file_t *file;
 
     MIDIPROPTIMEDIV prop_timediv;
@@ -1339,24 +1338,17 @@ static void *I_WIN_RegisterSong(void *data, int len)
     // MUS files begin with "MUS"
     // Reject anything which doesnt have this signature
 
-    filename = M_TempFile("doom.mid");
-
     if (IsMid(data, len))
     {
-        M_WriteFile(filename, data, len);
+        file = MIDI_LoadMemory(data, len);
     }
     else
     {
         // Assume a MUS file and try to convert
 
-        ConvertMus(data, len, filename);
+        file = LoadMus(data, len);
     }
 
-    file = MIDI_LoadFile(filename);
-
-    M_remove(filename);
-    free(filename);
-
     if (file == nullptr)
     {
         fprintf(stderr, "I_WIN_RegisterSong: Failed to load MID.\n");
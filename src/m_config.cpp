@@ -993,6 +993,14 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_FLOAT(libsamplerate_scale),
 
+    //!
+    // If non-zero, sound effects are mixed by a built-in software
+    // mixer instead of being played on SDL_mixer channels. This allows
+    // more than 32 sound channels to be used.
+    //
+
+    CONFIG_VARIABLE_INT(snd_softmixer),
+
     //!
     // Full path to a directory in which WAD files and dehacked patches
     // can be placed to be automatically loaded on startup. A subdirectory
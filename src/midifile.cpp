@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "doomtype.hpp"
 #include "i_swap.hpp"
@@ -58,10 +59,6 @@ typedef PACKED_STRUCT (
 
 typedef struct
 {
-    // Length in bytes:
-
-    unsigned int data_len;
-
     // Events in this track:
 
     midi_event_t *events;
@@ -83,11 +80,29 @@ struct midi_file_s
     midi_track_t *tracks;
     unsigned int num_tracks;
 
-    // Data buffer used to store data read for SysEx or meta events:
+    // The events of all tracks, one track after another:
+    midi_event_t *events;
+    unsigned int num_events;
+    unsigned int events_size;
+
+    // Copy of the file data. The data of SysEx and meta events points
+    // into it:
     byte *buffer;
     unsigned int buffer_size;
+
+    // Events of all tracks in time order, built on demand:
+    midi_timeline_event_t *timeline;
 };
 
+// Position while decoding the file data.
+
+typedef struct
+{
+    byte *data;
+    unsigned int len;
+    unsigned int pos;
+} midi_stream_t;
+
 // Check the header of a chunk:
 
 static boolean CheckChunkHeader(chunk_header_t *chunk,
@@ -111,28 +126,23 @@ static boolean CheckChunkHeader(chunk_header_t *chunk,
 
 // Read a single byte.  Returns false on error.
 
-static boolean ReadByte(byte *result, FILE *stream)
+static inline boolean ReadByte(byte *result, midi_stream_t *stream)
 {
-    int c;
-
-    c = fgetc(stream);
-
-    if (c == EOF)
+    if (stream->pos >= stream->len)
     {
         fprintf(stderr, "ReadByte: Unexpected end of file\n");
         return false;
     }
-    else
-    {
-        *result = (byte) c;
 
-        return true;
-    }
+    *result = stream->data[stream->pos];
+    ++stream->pos;
+
+    return true;
 }
 
 // Read a variable-length value.
 
-static boolean ReadVariableLength(unsigned int *result, FILE *stream)
+static boolean ReadVariableLength(unsigned int *result, midi_stream_t *stream)
 {
     int i;
     byte b = 0;
@@ -166,36 +176,21 @@ static boolean ReadVariableLength(unsigned int *result, FILE *stream)
     return false;
 }
 
-// Read a byte sequence into the data buffer.
+// Skip over a byte sequence, returning a pointer to it in the file
+// data.
 
-static void *ReadByteSequence(unsigned int num_bytes, FILE *stream)
+static byte *ReadByteSequence(unsigned int num_bytes, midi_stream_t *stream)
 {
-    unsigned int i;
     byte *result;
 
-    // Allocate a buffer. Allocate one extra byte, as malloc(0) is
-    // non-portable.
-
-    result = (byte*)malloc(num_bytes + 1);
-
-    if (result == nullptr)
+    if (num_bytes > stream->len - stream->pos)
     {
-        fprintf(stderr, "ReadByteSequence: Failed to allocate buffer\n");
+        fprintf(stderr, "ReadByteSequence: Unexpected end of file\n");
         return nullptr;
     }
 
-    // Read the data:
-
-    for (i=0; i<num_bytes; ++i)
-    {
-        if (!ReadByte(&result[i], stream))
-        {
-            fprintf(stderr, "ReadByteSequence: Error while reading byte %u\n",
-                            i);
-            free(result);
-            return nullptr;
-        }
-    }
+    result = stream->data + stream->pos;
+    stream->pos += num_bytes;
 
     return result;
 }
@@ -206,7 +201,7 @@ static void *ReadByteSequence(unsigned int num_bytes, FILE *stream)
 
 static boolean ReadChannelEvent(midi_event_t *event,
                                 byte event_type, boolean two_param,
-                                FILE *stream)
+                                midi_stream_t *stream)
 {
     byte b = 0;
 
@@ -246,7 +241,7 @@ static boolean ReadChannelEvent(midi_event_t *event,
 // Read sysex event:
 
 static boolean ReadSysExEvent(midi_event_t *event, int event_type,
-                              FILE *stream)
+                              midi_stream_t *stream)
 {
     event->event_type = static_cast<midi_event_type_t>( event_type );
 
@@ -259,7 +254,7 @@ static boolean ReadSysExEvent(midi_event_t *event, int event_type,
 
     // Read the byte sequence:
 
-    event->data.sysex.data = (byte*)ReadByteSequence(event->data.sysex.length, stream);
+    event->data.sysex.data = ReadByteSequence(event->data.sysex.length, stream);
 
     if (event->data.sysex.data == nullptr)
     {
@@ -272,7 +267,7 @@ static boolean ReadSysExEvent(midi_event_t *event, int event_type,
 
 // Read meta event:
 
-static boolean ReadMetaEvent(midi_event_t *event, FILE *stream)
+static boolean ReadMetaEvent(midi_event_t *event, midi_stream_t *stream)
 {
     byte b = 0;
 
@@ -299,7 +294,7 @@ static boolean ReadMetaEvent(midi_event_t *event, FILE *stream)
 
     // Read the byte sequence:
 
-    event->data.meta.data = (byte*)ReadByteSequence(event->data.meta.length, stream);
+    event->data.meta.data = ReadByteSequence(event->data.meta.length, stream);
 
     if (event->data.meta.data == nullptr)
     {
@@ -311,7 +306,7 @@ static boolean ReadMetaEvent(midi_event_t *event, FILE *stream)
 }
 
 static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
-                         FILE *stream)
+                         midi_stream_t *stream)
 {
     byte event_type = 0;
 
@@ -335,12 +330,7 @@ static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     if ((event_type & 0x80) == 0)
     {
         event_type = *last_event_type;
-
-        if (fseek(stream, -1, SEEK_CUR) < 0)
-        {
-            fprintf(stderr, "ReadEvent: Unable to seek in stream\n");
-            return false;
-        }
+        --stream->pos;
     }
     else
     {
@@ -389,57 +379,30 @@ static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     return false;
 }
 
-// Free an event:
-
-static void FreeEvent(midi_event_t *event)
-{
-    // Some event types have dynamically allocated buffers assigned
-    // to them that must be freed.
-
-    switch (event->event_type)
-    {
-        case MIDI_EVENT_SYSEX:
-        case MIDI_EVENT_SYSEX_SPLIT:
-            free(event->data.sysex.data);
-            break;
-
-        case MIDI_EVENT_META:
-            free(event->data.meta.data);
-            break;
-
-        default:
-            // Nothing to do.
-            break;
-    }
-}
-
 // Read and check the track chunk header
 
-static boolean ReadTrackHeader(midi_track_t *track, FILE *stream)
+static boolean ReadTrackHeader(midi_stream_t *stream)
 {
-    size_t records_read;
     chunk_header_t chunk_header;
 
-    records_read = fread(&chunk_header, sizeof(chunk_header_t), 1, stream);
-
-    if (records_read < 1)
+    if (stream->len - stream->pos < sizeof(chunk_header_t))
     {
         return false;
     }
 
-    if (!CheckChunkHeader(&chunk_header, TRACK_CHUNK_ID))
-    {
-        return false;
-    }
+    memcpy(&chunk_header, stream->data + stream->pos, sizeof(chunk_header_t));
+    stream->pos += sizeof(chunk_header_t);
 
-    track->data_len = SDL_SwapBE32(chunk_header.chunk_size);
-
-    return true;
+    return CheckChunkHeader(&chunk_header, TRACK_CHUNK_ID);
 }
 
-static boolean ReadTrack(midi_track_t *track, FILE *stream)
+// Decode the events of a track onto the end of the file's event array.
+// As before, events are read up to the end of track event, whatever
+// length the chunk header gives.
+
+static boolean ReadTrack(midi_file_t *file, midi_track_t *track,
+                         midi_stream_t *stream)
 {
-    midi_event_t *new_events;
     midi_event_t *event;
     unsigned int last_event_type;
 
@@ -448,7 +411,7 @@ static boolean ReadTrack(midi_track_t *track, FILE *stream)
 
     // Read the header:
 
-    if (!ReadTrackHeader(track, stream))
+    if (!ReadTrackHeader(stream))
     {
         return false;
     }
@@ -459,20 +422,23 @@ static boolean ReadTrack(midi_track_t *track, FILE *stream)
 
     for (;;)
     {
-        // Resize the track slightly larger to hold another event:
-
-        new_events = (decltype(        new_events)) I_Realloc(track->events, 
-                             sizeof(midi_event_t) * (track->num_events + 1));
-        track->events = new_events;
+        if (file->num_events >= file->events_size)
+        {
+            file->events_size *= 2;
+            file->events = static_cast<midi_event_t *>(
+                I_Realloc(file->events,
+                          sizeof(midi_event_t) * file->events_size));
+        }
 
         // Read the next event:
 
-        event = &track->events[track->num_events];
+        event = &file->events[file->num_events];
         if (!ReadEvent(event, &last_event_type, stream))
         {
             return false;
         }
 
+        ++file->num_events;
         ++track->num_events;
 
         // End of track?
@@ -487,22 +453,9 @@ static boolean ReadTrack(midi_track_t *track, FILE *stream)
     return true;
 }
 
-// Free a track:
-
-static void FreeTrack(midi_track_t *track)
-{
-    unsigned int i;
-
-    for (i=0; i<track->num_events; ++i)
-    {
-        FreeEvent(&track->events[i]);
-    }
-
-    free(track->events);
-}
-
-static boolean ReadAllTracks(midi_file_t *file, FILE *stream)
+static boolean ReadAllTracks(midi_file_t *file, midi_stream_t *stream)
 {
+    midi_event_t *events;
     unsigned int i;
 
     // Allocate list of tracks and read each track:
@@ -516,33 +469,51 @@ static boolean ReadAllTracks(midi_file_t *file, FILE *stream)
 
     memset(file->tracks, 0, sizeof(midi_track_t) * file->num_tracks);
 
+    // All events go into one array. Most events take three or four
+    // bytes, so this is usually enough to hold them without growing.
+
+    file->events_size = stream->len / 3 + 16;
+    file->events = static_cast<midi_event_t *>(
+        I_Realloc(nullptr, sizeof(midi_event_t) * file->events_size));
+    file->num_events = 0;
+
     // Read each track:
 
     for (i=0; i<file->num_tracks; ++i)
     {
-        if (!ReadTrack(&file->tracks[i], stream))
+        if (!ReadTrack(file, &file->tracks[i], stream))
         {
             return false;
         }
     }
 
+    // The array has finished moving, so the tracks can point into it.
+
+    events = file->events;
+
+    for (i=0; i<file->num_tracks; ++i)
+    {
+        file->tracks[i].events = events;
+        events += file->tracks[i].num_events;
+    }
+
     return true;
 }
 
 // Read and check the header chunk.
 
-static boolean ReadFileHeader(midi_file_t *file, FILE *stream)
+static boolean ReadFileHeader(midi_file_t *file, midi_stream_t *stream)
 {
-    size_t records_read;
     unsigned int format_type;
 
-    records_read = fread(&file->header, sizeof(midi_header_t), 1, stream);
-
-    if (records_read < 1)
+    if (stream->len < sizeof(midi_header_t))
     {
         return false;
     }
 
+    memcpy(&file->header, stream->data, sizeof(midi_header_t));
+    stream->pos = sizeof(midi_header_t);
+
     if (!CheckChunkHeader(&file->header.chunk_header, HEADER_CHUNK_ID)
      || SDL_SwapBE32(file->header.chunk_header.chunk_size) != 6)
     {
@@ -568,25 +539,22 @@ static boolean ReadFileHeader(midi_file_t *file, FILE *stream)
 
 void MIDI_FreeFile(midi_file_t *file)
 {
-    int i;
-
-    if (file->tracks != nullptr)
-    {
-        for (i=0; i<file->num_tracks; ++i)
-        {
-            FreeTrack(&file->tracks[i]);
-        }
-
-        free(file->tracks);
-    }
-
+    free(file->tracks);
+    free(file->events);
+    free(file->buffer);
+    free(file->timeline);
     free(file);
 }
 
-midi_file_t *MIDI_LoadFile(char *filename)
+midi_file_t *MIDI_LoadMemory(const void *data, size_t len)
 {
     midi_file_t *file;
-    FILE *stream;
+    midi_stream_t stream;
+
+    if (len > UINT_MAX - 1)
+    {
+        return nullptr;
+    }
 
     file = (midi_file_t*)malloc(sizeof(midi_file_t));
 
@@ -597,40 +565,80 @@ midi_file_t *MIDI_LoadFile(char *filename)
 
     file->tracks = nullptr;
     file->num_tracks = 0;
-    file->buffer = nullptr;
-    file->buffer_size = 0;
+    file->events = nullptr;
+    file->num_events = 0;
+    file->events_size = 0;
+    file->timeline = nullptr;
 
-    // Open file
+    // Keep a copy of the data for the events to refer to.
 
-    stream = M_fopen(filename, "rb");
+    file->buffer_size = len;
+    file->buffer = (byte*)malloc(len + 1);
 
-    if (stream == nullptr)
+    if (file->buffer == nullptr)
     {
-        fprintf(stderr, "MIDI_LoadFile: Failed to open '%s'\n", filename);
         MIDI_FreeFile(file);
         return nullptr;
     }
 
+    memcpy(file->buffer, data, len);
+
+    stream.data = file->buffer;
+    stream.len = file->buffer_size;
+    stream.pos = 0;
+
     // Read MIDI file header
 
-    if (!ReadFileHeader(file, stream))
+    if (!ReadFileHeader(file, &stream))
     {
-        fclose(stream);
         MIDI_FreeFile(file);
         return nullptr;
     }
 
     // Read all tracks:
 
-    if (!ReadAllTracks(file, stream))
+    if (!ReadAllTracks(file, &stream))
     {
-        fclose(stream);
         MIDI_FreeFile(file);
         return nullptr;
     }
 
+    return file;
+}
+
+midi_file_t *MIDI_LoadFile(char *filename)
+{
+    midi_file_t *file;
+    FILE *stream;
+    byte *data;
+    long len;
+
+    // Open file
+
+    stream = M_fopen(filename, "rb");
+
+    if (stream == nullptr)
+    {
+        fprintf(stderr, "MIDI_LoadFile: Failed to open '%s'\n", filename);
+        return nullptr;
+    }
+
+    len = M_FileLength(stream);
+    data = (byte*)malloc(len + 1);
+
+    if (data == nullptr || fread(data, 1, len, stream) < (size_t) len)
+    {
+        fprintf(stderr, "MIDI_LoadFile: Failed to read '%s'\n", filename);
+        free(data);
+        fclose(stream);
+        return nullptr;
+    }
+
     fclose(stream);
 
+    file = MIDI_LoadMemory(data, len);
+    free(data);
+
     return file;
 }
 
@@ -641,6 +649,108 @@ unsigned int MIDI_NumTracks(midi_file_t *file)
     return file->num_tracks;
 }
 
+// Order timeline events by time, and events at the same time in
+// track order. The events of the tracks are stored one track after
+// another, so that is the order of the event pointers.
+
+static int CompareTimelineEvents(const void *a, const void *b)
+{
+    const midi_timeline_event_t *ea = (const midi_timeline_event_t *) a;
+    const midi_timeline_event_t *eb = (const midi_timeline_event_t *) b;
+
+    if (ea->time != eb->time)
+    {
+        return ea->time < eb->time ? -1 : 1;
+    }
+
+    return ea->event < eb->event ? -1 : ea->event > eb->event;
+}
+
+static void BuildTimeline(midi_file_t *file)
+{
+    midi_timeline_event_t *entry;
+    midi_track_t *track;
+    midi_event_t *event;
+    unsigned int ticks_per_beat, us_per_beat;
+    uint64_t ticks, tempo_ticks, tempo_time;
+    unsigned int i;
+    int j;
+
+    file->timeline = static_cast<midi_timeline_event_t *>(
+        I_Realloc(nullptr,
+                  sizeof(midi_timeline_event_t) * (file->num_events + 1)));
+
+    // Gather the events with their times in ticks.
+
+    entry = file->timeline;
+
+    for (i = 0; i < file->num_tracks; ++i)
+    {
+        track = &file->tracks[i];
+        ticks = 0;
+
+        for (j = 0; j < track->num_events; ++j)
+        {
+            ticks += track->events[j].delta_time;
+            entry->time = ticks;
+            entry->track = i;
+            entry->event = &track->events[j];
+            ++entry;
+        }
+    }
+
+    qsort(file->timeline, file->num_events, sizeof(midi_timeline_event_t),
+          CompareTimelineEvents);
+
+    // Convert to microseconds. The tempo applies to all tracks from
+    // the time it is set; the default is 120 beats per minute.
+
+    ticks_per_beat = MIDI_GetFileTimeDivision(file);
+
+    if (ticks_per_beat == 0)
+    {
+        ticks_per_beat = 1;
+    }
+
+    us_per_beat = 500 * 1000;
+    tempo_ticks = 0;
+    tempo_time = 0;
+
+    for (i = 0; i < file->num_events; ++i)
+    {
+        entry = &file->timeline[i];
+        ticks = entry->time;
+        entry->time = tempo_time + ((ticks - tempo_ticks) * us_per_beat)
+                                 / ticks_per_beat;
+
+        event = entry->event;
+
+        if (event->event_type == MIDI_EVENT_META
+         && event->data.meta.type == MIDI_META_SET_TEMPO
+         && event->data.meta.length == 3)
+        {
+            tempo_ticks = ticks;
+            tempo_time = entry->time;
+            us_per_beat = (event->data.meta.data[0] << 16)
+                        | (event->data.meta.data[1] << 8)
+                        | event->data.meta.data[2];
+        }
+    }
+}
+
+midi_timeline_event_t *MIDI_GetTimeline(midi_file_t *file,
+                                        unsigned int *num_events)
+{
+    if (file->timeline == nullptr)
+    {
+        BuildTimeline(file);
+    }
+
+    *num_events = file->num_events;
+
+    return file->timeline;
+}
+
 // Start iterating over the events in a track.
 
 midi_track_iter_t *MIDI_IterateTrack(midi_file_t *file, unsigned int track)
@@ -18,6 +18,9 @@
 #ifndef MIDIFILE_H
 #define MIDIFILE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct midi_file_s midi_file_t;
 typedef struct midi_track_iter_s midi_track_iter_t;
 
@@ -169,10 +172,26 @@ typedef struct
     } data;
 } midi_event_t;
 
+typedef struct
+{
+    // Time of the event from the start of the song, in microseconds.
+    uint64_t time;
+
+    // Track that the event is in.
+    unsigned int track;
+
+    midi_event_t *event;
+} midi_timeline_event_t;
+
 // Load a MIDI file.
 
 midi_file_t *MIDI_LoadFile(char *filename);
 
+// Load a MIDI file from memory. The data is copied, so it need not
+// be kept after this returns.
+
+midi_file_t *MIDI_LoadMemory(const void *data, size_t len);
+
 // Free a MIDI file.
 
 void MIDI_FreeFile(midi_file_t *file);
@@ -185,6 +204,13 @@ unsigned int MIDI_GetFileTimeDivision(midi_file_t *file);
 
 unsigned int MIDI_NumTracks(midi_file_t *file);
 
+// Get the events of all tracks merged into one list in time order,
+// with tempo changes applied. The list is built the first time it is
+// needed and is freed along with the file.
+
+midi_timeline_event_t *MIDI_GetTimeline(midi_file_t *file,
+                                        unsigned int *num_events);
+
 // Start iterating over the events in a track.
 
 midi_track_iter_t *MIDI_IterateTrack(midi_file_t *file, unsigned int track_num);
@@ -19,6 +19,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+
+#include <SDL.h>
+
 #include "config.h"
 #include "doomtype.hpp"
 #include "deh_main.hpp"
@@ -42,6 +46,7 @@
 #include "net_petname.hpp"
 #include "w_checksum.hpp"
 #include "w_wad.hpp"
+#include "../utils/spsc_queue.hpp"
 
 
 typedef enum
@@ -160,6 +165,45 @@ static unsigned int gamedata_recv_time;
 // that they can adjust to us.
 static int last_latency;
 
+// Loss statistics and adaptive redundancy for the game data stream.
+
+static net_redundancy_t client_redundancy;
+
+// Network thread. If the network module can receive without allocating
+// memory, packets are received on a thread as soon as they arrive
+// rather than when the game next calls NetUpdate(), which may be a long
+// time during a slow frame, a wipe or a level load. The thread only
+// receives: each packet is queued with its sender and the time it
+// arrived, and is parsed on the main thread, which also does all the
+// sending. Game data uses the arrival time, so that time spent waiting
+// for the main thread is not counted as network latency.
+
+#define NET_THREAD_MAX_PACKET 1500
+
+// How long the thread waits for a packet before checking whether it
+// should stop.
+
+#define NET_THREAD_WAIT_MS 10
+
+typedef struct
+{
+    net_raw_addr_t from;
+    unsigned int recv_time;
+    unsigned int len;
+    byte data[NET_THREAD_MAX_PACKET];
+} net_thread_packet_t;
+
+static SDL_Thread *net_thread = nullptr;
+static std::atomic<bool> net_thread_running;
+static std::atomic<bool> net_thread_error;
+static spsc_queue<net_thread_packet_t, 256> net_thread_packets;
+
+// Time the packet being parsed arrived.
+
+static unsigned int packet_recv_time;
+
+static void NET_CL_StopThread(void);
+
 // Hash checksums of our wad directory and dehacked data.
 
 sha1_digest_t net_local_wad_sha1sum;
@@ -189,7 +233,7 @@ static void UpdateClockSync(unsigned int seq,
 
     if (seq == send_queue[seq % BACKUPTICS].seq)
     {
-        latency = I_GetTimeMS() - send_queue[seq % BACKUPTICS].time;
+        latency = packet_recv_time - send_queue[seq % BACKUPTICS].time;
     }
     else if (seq > send_queue[seq % BACKUPTICS].seq)
     {
@@ -294,6 +338,7 @@ static void NET_CL_Shutdown(void)
     {
         net_client_connected = false;
 
+        NET_CL_StopThread();
         NET_ReleaseAddress(server_addr);
 
         // Shut down network module, etc.  To do.
@@ -339,6 +384,7 @@ static void NET_CL_SendGameDataACK(void)
 
 static void NET_CL_SendTics(int start, int end)
 {
+    net_ticdiff_t *diffs[BACKUPTICS];
     net_packet_t *packet;
     int i;
 
@@ -368,14 +414,11 @@ static void NET_CL_SendTics(int start, int end)
 
     for (i=start; i<=end; ++i)
     {
-        net_server_send_t *sendobj;
-
-        sendobj = &send_queue[i % BACKUPTICS];
-
-        NET_WriteInt16(packet, last_latency);
-
-        NET_WriteTiccmdDiff(packet, &sendobj->cmd, settings.lowres_turn);
+        diffs[i - start] = &send_queue[i % BACKUPTICS].cmd;
     }
+
+    NET_WriteTiccmdDiffs(packet, client_connection.protocol, last_latency,
+                         diffs, end - start + 1, settings.lowres_turn);
     
     // Send the packet
 
@@ -414,7 +457,9 @@ void NET_CL_SendTiccmd(ticcmd_t *ticcmd, int maketic)
 
     // Send to server.
 
-    starttic = maketic - settings.extratics;
+    starttic = maketic - NET_Redundancy_ExtraTics(&client_redundancy,
+                                                  settings.extratics,
+                                                  "client");
     endtic = maketic;
 
     if (starttic < 0)
@@ -606,6 +651,8 @@ static void NET_CL_ParseGameStart(net_packet_t *packet)
     // Clear the send queue
 
     memset(&send_queue, 0x00, sizeof(send_queue));
+
+    NET_Redundancy_Init(&client_redundancy);
 }
 
 static void NET_CL_SendResendRequest(int start, int end)
@@ -732,9 +779,9 @@ static void NET_CL_CheckResends(void)
 
 static void NET_CL_ParseGameData(net_packet_t *packet)
 {
+    net_ticstream_t stream;
     net_server_recv_t *recvobj;
     unsigned int seq, num_tics;
-    unsigned int nowtime;
     int resend_start, resend_end;
     size_t i;
     int index;
@@ -749,20 +796,22 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
         return;
     }
 
-    nowtime = I_GetTimeMS();
-
     // Whatever happens, we now need to send an acknowledgement of our
     // current receive point.
 
     if (!need_to_acknowledge)
     {
         need_to_acknowledge = true;
-        gamedata_recv_time = nowtime;
+        gamedata_recv_time = packet_recv_time;
     }
 
     // Expand byte value into the full tic number
     seq = NET_CL_ExpandTicNum(seq);
     NET_Log("client: got game data, seq=%d, num_tics=%d", seq, num_tics);
+    NET_Redundancy_PacketReceived(&client_redundancy, seq, num_tics);
+
+    NET_InitTicStream(&stream, packet, client_connection.protocol,
+                      settings.lowres_turn);
 
     for (i=0; i<num_tics; ++i)
     {
@@ -770,7 +819,7 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
 
         index = seq - recvwindow_start + i;
 
-        if (!NET_ReadFullTiccmd(packet, &cmd, settings.lowres_turn))
+        if (!NET_ReadStreamFullTiccmd(&stream, &cmd))
         {
             NET_Log("client: error: failed to read ticcmd %d", i);
             return;
@@ -787,6 +836,9 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
 
         recvobj = &recvwindow[index];
 
+        NET_Redundancy_TicReceived(&client_redundancy, recvobj->active,
+                                   i == num_tics - 1);
+
         recvobj->active = true;
         recvobj->cmd = cmd;
         NET_Log("client: stored tic %d in receive window", seq + i);
@@ -880,6 +932,7 @@ static void NET_CL_ParseResendRequest(net_packet_t *packet)
 
     //printf("requested resend %i-%i .. ", start, end);
     NET_Log("client: resend request: start=%d, num_tics=%d", start, num_tics);
+    NET_Redundancy_ResendRequested(&client_redundancy);
 
     // Check we have the tics being requested.  If not, reduce the 
     // window of tics to only what we have.
@@ -987,6 +1040,140 @@ static void NET_CL_ParsePacket(net_packet_t *packet)
     }
 }
 
+//
+// Network thread
+//
+
+static void NET_CL_ThreadInitPacket(net_packet_t *packet, byte *buf,
+                                    size_t buf_len)
+{
+    packet->data = buf;
+    packet->alloced = buf_len;
+    packet->len = 0;
+    packet->pos = 0;
+}
+
+static int NET_CL_ThreadFunction(void *unused)
+{
+    net_module_t *module = server_addr->module;
+    net_thread_packet_t *queued;
+    net_packet_t packet;
+    net_raw_addr_t dropped_from;
+    byte dropped[NET_THREAD_MAX_PACKET];
+    int result;
+
+    while (net_thread_running.load())
+    {
+        // If the main thread is so far behind that the queue is full,
+        // packets are dropped, as they would be if the socket buffer
+        // filled up.
+
+        queued = net_thread_packets.begin_push();
+
+        if (queued != nullptr)
+        {
+            NET_CL_ThreadInitPacket(&packet, queued->data,
+                                    sizeof(queued->data));
+            result = module->RecvPacketRaw(&packet, &queued->from,
+                                           NET_THREAD_WAIT_MS);
+        }
+        else
+        {
+            NET_CL_ThreadInitPacket(&packet, dropped, sizeof(dropped));
+            result = module->RecvPacketRaw(&packet, &dropped_from,
+                                           NET_THREAD_WAIT_MS);
+        }
+
+        if (result < 0)
+        {
+            // I_Error() can only be called from the main thread.
+
+            net_thread_error.store(true);
+            return 0;
+        }
+
+        if (result > 0 && queued != nullptr)
+        {
+            queued->recv_time = I_GetTimeMS();
+            queued->len = packet.len;
+            net_thread_packets.end_push();
+        }
+    }
+
+    return 0;
+}
+
+static void NET_CL_StartThread(void)
+{
+    //!
+    // @category net
+    //
+    // Do not use a separate thread to receive packets from the server.
+    //
+
+    if (server_addr->module->RecvPacketRaw == nullptr
+     || M_ParmExists("-nonetthread"))
+    {
+        return;
+    }
+
+    net_thread_packets.clear();
+    net_thread_error.store(false);
+    net_thread_running.store(true);
+
+    net_thread = SDL_CreateThread(NET_CL_ThreadFunction,
+                                  "Network client thread", nullptr);
+
+    if (net_thread == nullptr)
+    {
+        NET_Log("client: failed to start network thread: %s", SDL_GetError());
+        net_thread_running.store(false);
+    }
+}
+
+static void NET_CL_StopThread(void)
+{
+    if (net_thread != nullptr)
+    {
+        net_thread_running.store(false);
+        SDL_WaitThread(net_thread, nullptr);
+        net_thread = nullptr;
+    }
+}
+
+// Parse everything the network thread has received. As with
+// NET_RecvPacket(), packets that are not from the server are ignored.
+
+static void NET_CL_RunThreadQueue(void)
+{
+    net_thread_packet_t *queued;
+    net_packet_t packet;
+    net_addr_t *addr;
+
+    if (net_thread_error.load())
+    {
+        I_Error("NET_CL_Run: Error receiving packet");
+    }
+
+    while ((queued = net_thread_packets.front()) != nullptr)
+    {
+        addr = server_addr->module->FindRawAddress(&queued->from);
+        NET_ReferenceAddress(addr);
+
+        if (addr == server_addr)
+        {
+            NET_CL_ThreadInitPacket(&packet, queued->data,
+                                    sizeof(queued->data));
+            packet.len = queued->len;
+            packet_recv_time = queued->recv_time;
+            NET_CL_ParsePacket(&packet);
+        }
+
+        NET_ReleaseAddress(addr);
+        net_thread_packets.pop_front();
+    }
+}
+
 // "Run" the client code: check for new packets, send packets as
 // needed
 
@@ -1000,17 +1187,25 @@ void NET_CL_Run(void)
         return;
     }
     
-    while (NET_RecvPacket(client_context, &addr, &packet))
+    if (net_thread != nullptr)
     {
-        // only accept packets from the server
-
-        if (addr == server_addr)
+        NET_CL_RunThreadQueue();
+    }
+    else
+    {
+        while (NET_RecvPacket(client_context, &addr, &packet))
         {
-            NET_CL_ParsePacket(packet);
-        }
+            // only accept packets from the server
 
-        NET_FreePacket(packet);
-        NET_ReleaseAddress(addr);
+            if (addr == server_addr)
+            {
+                packet_recv_time = I_GetTimeMS();
+                NET_CL_ParsePacket(packet);
+            }
+
+            NET_FreePacket(packet);
+            NET_ReleaseAddress(addr);
+        }
     }
 
     // Run the common connection code to send any packets as needed
@@ -1051,7 +1246,23 @@ static void NET_CL_SendSYN(net_connect_data_t *data)
     NET_WriteInt16(packet, NET_PACKET_TYPE_SYN);
     NET_WriteInt32(packet, NET_MAGIC_NUMBER);
     NET_WriteString(packet, PACKAGE_STRING);
-    NET_WriteProtocolList(packet);
+
+    //!
+    // @category net
+    //
+    // Only offer the original protocol when connecting, so that
+    // ticcmds are sent without the packed encoding.
+    //
+
+    if (M_ParmExists("-legacytics"))
+    {
+        NET_WriteInt8(packet, 1);
+        NET_WriteProtocol(packet, NET_PROTOCOL_CHOCOLATE_DOOM_0);
+    }
+    else
+    {
+        NET_WriteProtocolList(packet);
+    }
     NET_WriteConnectData(packet, data);
     NET_WriteString(packet, net_player_name);
     NET_Conn_SendPacket(&client_connection, packet);
@@ -1093,6 +1304,12 @@ boolean NET_CL_Connect(net_addr_t *addr, net_connect_data_t *data)
     // try to connect
     start_time = I_GetTimeMS();
     last_send_time = -1;
+
+    // The thread reads the timer, so it is only started once the timer
+    // has been read here.
+
+    NET_CL_StartThread();
+
     SetRejectReason("Unknown reason");
 
     while (client_connection.state == NET_CONN_STATE_CONNECTING)
@@ -408,6 +408,186 @@ net_packet_t *NET_Conn_NewReliable(net_connection_t *conn, int packet_type)
     return packet;
 }
 
+// Residual loss we aim for with adaptive redundancy, in parts per
+// million: the chance that every copy of a tic is lost.
+
+#define REDUNDANCY_TARGET_PPM   100
+
+// Time (in ms) before a burst loss estimate is allowed to decay.
+
+#define REDUNDANCY_BURST_DECAY  5000
+
+// How often redundancy statistics are written to the log.
+
+#define REDUNDANCY_LOG_PERIOD   5000
+
+void NET_Redundancy_Init(net_redundancy_t *r)
+{
+    memset(r, 0, sizeof(*r));
+
+    //!
+    // @category net
+    //
+    // Adapt the number of extra tics sent in each game data packet to
+    // the observed packet loss, so that lost packets are recovered
+    // from the following packets rather than by resend requests.
+    //
+
+    r->enabled = M_ParmExists("-netredundancy");
+    r->extratics = 1;
+    r->last_newest = -1;
+    r->burst_time = I_GetTimeMS();
+    r->log_time = r->burst_time;
+}
+
+// Called for every game data packet received. Packets are sent once
+// per tic, so a jump in the newest tic number means that the packets
+// in between were lost (or are arriving out of order).
+
+void NET_Redundancy_PacketReceived(net_redundancy_t *r, int first,
+                                   int num_tics)
+{
+    int newest, lost, i;
+
+    ++r->packets_recv;
+
+    newest = first + num_tics - 1;
+
+    if (newest <= r->last_newest)
+    {
+        // Resent or reordered packet; nothing new to learn.
+
+        return;
+    }
+
+    lost = r->last_newest >= 0 ? newest - r->last_newest - 1 : 0;
+    r->last_newest = newest;
+
+    if (lost > 0)
+    {
+        r->packets_lost += lost;
+
+        if (lost > r->max_burst)
+        {
+            r->max_burst = lost < NET_MAX_REDUNDANCY ? lost
+                                                     : NET_MAX_REDUNDANCY;
+            r->burst_time = I_GetTimeMS();
+        }
+
+        for (i = 0; i < lost && i < NET_MAX_REDUNDANCY; ++i)
+        {
+            r->loss_rate += (1000 - r->loss_rate) / 16;
+        }
+    }
+
+    // Round the decay up, so that the estimate falls all the way back
+    // to zero once the loss stops.
+
+    r->loss_rate -= (r->loss_rate + 15) / 16;
+}
+
+// Called for every tic read from a game data packet: duplicate is true
+// if we already had the tic, newest if it was the last in the packet.
+
+void NET_Redundancy_TicReceived(net_redundancy_t *r, boolean duplicate,
+                                boolean newest)
+{
+    if (duplicate)
+    {
+        ++r->tics_duplicate;
+    }
+    else if (!newest)
+    {
+        ++r->tics_recovered;
+    }
+}
+
+// The remote end has sent us a resend request: the redundancy we are
+// sending was not enough to cover its losses.
+
+void NET_Redundancy_ResendRequested(net_redundancy_t *r)
+{
+    ++r->resends_recv;
+
+    if (r->enabled && r->max_burst <= r->extratics)
+    {
+        r->max_burst = r->extratics < NET_MAX_REDUNDANCY ? r->extratics + 1
+                                                         : NET_MAX_REDUNDANCY;
+        r->burst_time = I_GetTimeMS();
+    }
+}
+
+// Get the number of extra tics to send in the next game data packet.
+// We only observe loss in the receive direction, but both directions
+// of a game connection normally share the same link, so that is used
+// as the estimate for our own packets, together with any resend
+// requests the other end sends us. The configured extratics value is
+// always the minimum.
+
+int NET_Redundancy_ExtraTics(net_redundancy_t *r, int extratics,
+                             const char *name)
+{
+    unsigned int nowtime;
+    int result, residual;
+
+    nowtime = I_GetTimeMS();
+
+    if (nowtime - r->log_time > REDUNDANCY_LOG_PERIOD)
+    {
+        NET_Log("redundancy[%s]: extratics=%d, loss=%d.%d%%, burst=%d, "
+                "packets=%u, lost=%u, recovered=%u, duplicate=%u, "
+                "resend requests=%u",
+                name, r->enabled ? r->extratics : extratics,
+                r->loss_rate / 10, r->loss_rate % 10, r->max_burst,
+                r->packets_recv, r->packets_lost, r->tics_recovered,
+                r->tics_duplicate, r->resends_recv);
+        r->log_time = nowtime;
+    }
+
+    if (!r->enabled)
+    {
+        return extratics;
+    }
+
+    if (r->max_burst > 0
+     && nowtime - r->burst_time > REDUNDANCY_BURST_DECAY)
+    {
+        --r->max_burst;
+        r->burst_time = nowtime;
+    }
+
+    // Find the smallest number of extra copies that brings the chance
+    // of losing every copy of a tic below the target.
+
+    result = 0;
+    residual = r->loss_rate * 1000;
+
+    while (residual > REDUNDANCY_TARGET_PPM && result < NET_MAX_REDUNDANCY)
+    {
+        residual = residual * r->loss_rate / 1000;
+        ++result;
+    }
+
+    // Always cover a single lost packet, and the longest recent burst.
+
+    if (result < 1)
+        result = 1;
+    if (result < r->max_burst)
+        result = r->max_burst;
+    if (result < extratics)
+        result = extratics;
+
+    if (result != r->extratics)
+    {
+        NET_Log("redundancy[%s]: extratics %d -> %d (loss=%d.%d%%, burst=%d)",
+                name, r->extratics, result,
+                r->loss_rate / 10, r->loss_rate % 10, r->max_burst);
+        r->extratics = result;
+    }
+
+    return result;
+}
+
 // Used to expand the least significant byte of a tic number into 
 // the full tic number, from the current tic number
 
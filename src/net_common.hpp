@@ -81,6 +81,44 @@ typedef struct
     int reliable_recv_seq;
 } net_connection_t;
 
+// Upper bound on the number of extra tics that adaptive redundancy will
+// piggyback onto a game data packet.
+
+#define NET_MAX_REDUNDANCY 8
+
+// Loss tracking for one direction of a game data stream. When adaptive
+// redundancy is enabled (-netredundancy), the number of extra tics sent
+// in each game data packet follows the loss rate we observe, so that a
+// lost datagram is repaired by the next one instead of by a resend
+// request round trip.
+
+typedef struct
+{
+    boolean enabled;
+
+    // Number of extra tics currently being sent.
+    int extratics;
+
+    // Newest tic of the most recent in-order packet received.
+    int last_newest;
+
+    // Exponentially averaged packet loss, in 1/1000ths.
+    int loss_rate;
+
+    // Longest recent run of consecutive lost packets, and when it
+    // was last raised.
+    int max_burst;
+    unsigned int burst_time;
+
+    // Statistics, dumped periodically to the -netlog output.
+    unsigned int packets_recv;
+    unsigned int packets_lost;
+    unsigned int tics_recovered;
+    unsigned int tics_duplicate;
+    unsigned int resends_recv;
+    unsigned int log_time;
+} net_redundancy_t;
+
 
 void NET_Conn_SendPacket(net_connection_t *conn, net_packet_t *packet);
 void NET_Conn_InitClient(net_connection_t *conn, net_addr_t *addr,
@@ -93,6 +131,14 @@ void NET_Conn_Disconnect(net_connection_t *conn);
 void NET_Conn_Run(net_connection_t *conn);
 net_packet_t *NET_Conn_NewReliable(net_connection_t *conn, int packet_type);
 
+void NET_Redundancy_Init(net_redundancy_t *r);
+void NET_Redundancy_PacketReceived(net_redundancy_t *r, int first, int num_tics);
+void NET_Redundancy_TicReceived(net_redundancy_t *r, boolean duplicate,
+                                boolean newest);
+void NET_Redundancy_ResendRequested(net_redundancy_t *r);
+int NET_Redundancy_ExtraTics(net_redundancy_t *r, int extratics,
+                             const char *name);
+
 // Other miscellaneous common functions
 unsigned int NET_ExpandTicNum(unsigned int relative, unsigned int b);
 boolean NET_ValidGameSettings(GameMode_t mode, GameMission_t mission,
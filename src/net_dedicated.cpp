@@ -26,6 +26,7 @@
 #include "m_argv.hpp"
 
 #include "net_common.hpp"
+#include "net_impair.hpp"
 #include "net_sdl.hpp"
 #include "net_server.hpp"
 
@@ -67,7 +68,7 @@ void NET_DedicatedServer(void)
 
     NET_OpenLog();
     NET_SV_Init();
-    NET_SV_AddModule(&net_sdl_module);
+    NET_SV_AddModule(NET_Impair_CheckModule(&net_sdl_module));
     NET_SV_RegisterWithMaster();
 
     while (true)
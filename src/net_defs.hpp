@@ -58,6 +58,14 @@ struct _net_packet_s
     unsigned int pos;
 };
 
+// Sender of a packet received by RecvPacketRaw, in a form private to
+// the module that can be stored without allocating memory.
+
+typedef struct
+{
+    byte data[16];
+} net_raw_addr_t;
+
 struct _net_module_s
 {
     // Initialize this module for use as a client
@@ -89,6 +97,22 @@ struct _net_module_s
     // Try to resolve a name to an address
 
     net_addr_t *(*ResolveAddress)(const char *addr);
+
+    // Receive a packet into a packet supplied by the caller, and store
+    // its sender in *from. If none is waiting, wait up to timeout_ms
+    // for one. This is called from the client network thread, so it
+    // must not allocate memory or call I_Error().
+    //
+    // Returns 1 if a packet was received, 0 if there was none and -1
+    // on error. May be nullptr if the module does not support it.
+
+    int (*RecvPacketRaw)(net_packet_t *packet, net_raw_addr_t *from,
+                         int timeout_ms);
+
+    // Find the address of a sender stored by RecvPacketRaw. Only called
+    // from the main thread.
+
+    net_addr_t *(*FindRawAddress)(net_raw_addr_t *from);
 };
 
 // net_addr_t
@@ -124,8 +148,12 @@ enum net_protocol_t
     // number in this enum.
     NET_PROTOCOL_CHOCOLATE_DOOM_0,
 
+    // Same as CHOCOLATE_DOOM_0, except that the ticcmds in game data
+    // packets use the bit-packed encoding (see NET_WriteTiccmdDiffs).
+    NET_PROTOCOL_CRISPY_DOOM_PACKED_1,
+
     // Add your own protocol here; be sure to add a name for it to the list
-    // in net_common.c too.
+    // in net_structrw.cpp too.
 
     NET_NUM_PROTOCOLS,
     NET_PROTOCOL_UNKNOWN,
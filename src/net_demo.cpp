@@ -0,0 +1,379 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Server-side demo recording.
+//
+//     The server only ever sees ticcmd diffs, so the full ticcmd of
+//     each player is rebuilt here the same way the clients rebuild
+//     it. The result is written in the demo format of the game being
+//     played, exactly as G_BeginRecording/G_WriteDemoTiccmd in the
+//     client would have written it, so the demos play back with the
+//     normal -playdemo.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.hpp"
+#include "d_event.hpp"
+#include "d_mode.hpp"
+#include "m_misc.hpp"
+#include "net_common.hpp"
+#include "net_defs.hpp"
+#include "net_demo.hpp"
+#include "net_structrw.hpp"
+
+#define DEMOMARKER 0x80
+
+// Version byte of a "Doom 1.91" longtics demo.
+
+#define DOOM_191_VERSION 111
+
+#define STRIFE_VERSION 101
+
+// Heretic/Hexen header flags, stored in the player one byte.
+
+#define DEMOHEADER_RESPAWN    0x20
+#define DEMOHEADER_LONGTICS   0x10
+#define DEMOHEADER_NOMONSTERS 0x02
+
+typedef enum
+{
+    DEMO_FORMAT_DOOM,
+    DEMO_FORMAT_HERETIC,
+    DEMO_FORMAT_HEXEN,
+    DEMO_FORMAT_STRIFE,
+} demo_format_t;
+
+static FILE *demo_file = nullptr;
+static demo_format_t demo_format;
+static boolean demo_longtics;
+static int demo_ticdup;
+static int demo_players;
+
+// Players still in the game, and the last ticcmd received from each.
+
+static boolean demo_ingame[NET_MAXPLAYERS];
+static ticcmd_t demo_lastcmd[NET_MAXPLAYERS];
+
+static demo_format_t DemoFormat(GameMission_t mission)
+{
+    switch (mission)
+    {
+        case GameMission_t::heretic:
+            return DEMO_FORMAT_HERETIC;
+        case GameMission_t::hexen:
+            return DEMO_FORMAT_HEXEN;
+        case GameMission_t::strife:
+            return DEMO_FORMAT_STRIFE;
+        default:
+            return DEMO_FORMAT_DOOM;
+    }
+}
+
+boolean NET_Demo_NeedLowResTurn(GameMission_t mission)
+{
+    // Strife demos only have room for the high byte of angleturn.
+
+    return DemoFormat(mission) == DEMO_FORMAT_STRIFE;
+}
+
+// Version byte for a vanilla Doom demo; see G_VanillaVersionCode.
+
+static int DoomVersionCode(GameVersion_t version)
+{
+    switch (version)
+    {
+        case GameVersion_t::exe_doom_1_666:
+            return 106;
+        case GameVersion_t::exe_doom_1_7:
+            return 107;
+        case GameVersion_t::exe_doom_1_8:
+            return 108;
+        case GameVersion_t::exe_doom_1_9:
+        default:
+            return 109;
+    }
+}
+
+static void WriteByte(int b)
+{
+    fputc(b & 0xff, demo_file);
+}
+
+static void WriteHeader(net_gamesettings_t *settings, boolean *playeringame)
+{
+    int flags;
+    int i;
+
+    switch (demo_format)
+    {
+        case DEMO_FORMAT_DOOM:
+            if (demo_longtics)
+            {
+                WriteByte(DOOM_191_VERSION);
+            }
+            else if (settings->gameversion > GameVersion_t::exe_doom_1_2)
+            {
+                WriteByte(DoomVersionCode(settings->gameversion));
+            }
+
+            WriteByte(static_cast<int>(settings->skill));
+            WriteByte(settings->episode);
+            WriteByte(settings->map);
+
+            if (demo_longtics
+             || settings->gameversion > GameVersion_t::exe_doom_1_2)
+            {
+                WriteByte(settings->deathmatch);
+                WriteByte(settings->respawn_monsters);
+                WriteByte(settings->fast_monsters);
+                WriteByte(settings->nomonsters);
+                WriteByte(0);                   // consoleplayer
+            }
+            break;
+
+        case DEMO_FORMAT_HERETIC:
+        case DEMO_FORMAT_HEXEN:
+            WriteByte(static_cast<int>(settings->skill));
+            WriteByte(settings->episode);
+            WriteByte(settings->map);
+
+            flags = 0;
+            if (settings->respawn_monsters)
+                flags |= DEMOHEADER_RESPAWN;
+            if (demo_longtics)
+                flags |= DEMOHEADER_LONGTICS;
+            if (settings->nomonsters)
+                flags |= DEMOHEADER_NOMONSTERS;
+
+            // Player one is always present; the flags share its byte.
+
+            WriteByte(1 | flags);
+
+            if (demo_format == DEMO_FORMAT_HEXEN)
+            {
+                WriteByte(settings->player_classes[0]);
+
+                for (i = 1; i < demo_players; ++i)
+                {
+                    WriteByte(playeringame[i]);
+                    WriteByte(settings->player_classes[i]);
+                }
+            }
+            else
+            {
+                for (i = 1; i < demo_players; ++i)
+                {
+                    WriteByte(playeringame[i]);
+                }
+            }
+            return;
+
+        case DEMO_FORMAT_STRIFE:
+            WriteByte(STRIFE_VERSION);
+            WriteByte(static_cast<int>(settings->skill));
+            WriteByte(settings->map);
+            WriteByte(settings->deathmatch);
+            WriteByte(settings->respawn_monsters);
+            WriteByte(settings->fast_monsters);
+            WriteByte(settings->nomonsters);
+            WriteByte(0);                       // consoleplayer
+            break;
+    }
+
+    for (i = 0; i < demo_players; ++i)
+    {
+        WriteByte(playeringame[i]);
+    }
+}
+
+static void WriteTiccmd(ticcmd_t *cmd)
+{
+    WriteByte(cmd->forwardmove);
+    WriteByte(cmd->sidemove);
+
+    if (demo_longtics)
+    {
+        WriteByte(cmd->angleturn & 0xff);
+        WriteByte((cmd->angleturn >> 8) & 0xff);
+    }
+    else
+    {
+        WriteByte(cmd->angleturn >> 8);
+    }
+
+    WriteByte(cmd->buttons);
+
+    switch (demo_format)
+    {
+        case DEMO_FORMAT_HERETIC:
+        case DEMO_FORMAT_HEXEN:
+            WriteByte(cmd->lookfly);
+            WriteByte(cmd->arti);
+            break;
+
+        case DEMO_FORMAT_STRIFE:
+            WriteByte(cmd->buttons2);
+            WriteByte(cmd->inventory & 0xff);
+            break;
+
+        default:
+            break;
+    }
+}
+
+boolean NET_Demo_Start(const char *name, GameMission_t mission,
+                       GameMode_t mode, net_gamesettings_t *settings,
+                       boolean *playeringame)
+{
+    size_t filename_size;
+    char *filename;
+    int i;
+
+    NET_Demo_Stop();
+
+    demo_format = DemoFormat(mission);
+
+    // A game continued from a savegame can't be played back from a demo.
+    // (Heretic and Hexen don't support -loadgame in net games, and leave
+    // this field unset.)
+
+    if ((demo_format == DEMO_FORMAT_DOOM || demo_format == DEMO_FORMAT_STRIFE)
+     && settings->loadgame >= 0)
+    {
+        fprintf(stderr, "SV: Not recording a demo of a loaded game.\n");
+        return false;
+    }
+
+    demo_longtics = !settings->lowres_turn;
+    demo_ticdup = settings->ticdup;
+
+    switch (demo_format)
+    {
+        case DEMO_FORMAT_DOOM:
+        case DEMO_FORMAT_HERETIC:
+            demo_players = 4;
+            break;
+        case DEMO_FORMAT_HEXEN:
+            demo_players = mode == GameMode_t::shareware ? 4 : 8;
+            break;
+        default:
+            demo_players = 8;
+            break;
+    }
+
+    // Don't overwrite existing demos; like G_RecordDemo, add a suffix.
+
+    filename_size = strlen(name) + 5 + 6;
+    filename = static_cast<char *>(malloc(filename_size));
+    M_snprintf(filename, filename_size, "%s.lmp", name);
+
+    for (i = 0; i <= 99999 && M_FileExists(filename); ++i)
+    {
+        M_snprintf(filename, filename_size, "%s-%05d.lmp", name, i);
+    }
+
+    demo_file = fopen(filename, "wb");
+
+    if (demo_file == nullptr)
+    {
+        fprintf(stderr, "SV: Failed to open %s for writing.\n", filename);
+        free(filename);
+        return false;
+    }
+
+    fprintf(stderr, "SV: Recording demo to %s\n", filename);
+    NET_Log("demo: recording to %s, longtics=%d", filename, demo_longtics);
+    free(filename);
+
+    for (i = 0; i < NET_MAXPLAYERS; ++i)
+    {
+        demo_ingame[i] = i < demo_players && playeringame[i];
+        memset(&demo_lastcmd[i], 0, sizeof(ticcmd_t));
+    }
+
+    WriteHeader(settings, playeringame);
+
+    return true;
+}
+
+void NET_Demo_WriteTic(net_full_ticcmd_t *cmd)
+{
+    ticcmd_t cmds[NET_MAXPLAYERS];
+    int i, t;
+
+    if (demo_file == nullptr)
+    {
+        return;
+    }
+
+    for (i = 0; i < demo_players; ++i)
+    {
+        if (!demo_ingame[i])
+        {
+            continue;
+        }
+
+        // A player who has left the game stays out of it; the client's
+        // G_Ticker also stops recording their ticcmds.
+
+        if (!cmd->playeringame[i])
+        {
+            demo_ingame[i] = false;
+            continue;
+        }
+
+        NET_TiccmdPatch(&demo_lastcmd[i], &cmd->cmds[i], &cmds[i]);
+        demo_lastcmd[i] = cmds[i];
+    }
+
+    // Each network tic runs ticdup game tics; see TicdupSquash in d_loop.
+
+    for (t = 0; t < demo_ticdup; ++t)
+    {
+        for (i = 0; i < demo_players; ++i)
+        {
+            if (!demo_ingame[i])
+            {
+                continue;
+            }
+
+            if (t > 0)
+            {
+                cmds[i].chatchar = 0;
+                if (cmds[i].buttons & BT_SPECIAL)
+                    cmds[i].buttons = 0;
+            }
+
+            WriteTiccmd(&cmds[i]);
+        }
+    }
+}
+
+void NET_Demo_Stop(void)
+{
+    if (demo_file == nullptr)
+    {
+        return;
+    }
+
+    WriteByte(DEMOMARKER);
+    fclose(demo_file);
+    demo_file = nullptr;
+
+    fprintf(stderr, "SV: Demo recording finished.\n");
+}
+
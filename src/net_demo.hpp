@@ -0,0 +1,50 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Server-side demo recording: writes the merged tic stream of a
+//     network game to a demo file in the format of the game being
+//     played.
+//
+
+#ifndef NET_DEMO_H
+#define NET_DEMO_H
+
+#include "d_mode.hpp"
+#include "net_defs.hpp"
+
+// Returns true if the game must use low resolution turning for a demo
+// of the given mission to be recorded accurately.
+
+boolean NET_Demo_NeedLowResTurn(GameMission_t mission);
+
+// Start recording a demo of a game with the given settings.
+// playeringame[] lists the players present when the game starts.
+// The demo is written to <name>.lmp, or <name>-NNNNN.lmp if that file
+// already exists. Returns false if recording could not be started.
+
+boolean NET_Demo_Start(const char *name, GameMission_t mission,
+                       GameMode_t mode, net_gamesettings_t *settings,
+                       boolean *playeringame);
+
+// Append the next tic. Tics must be passed in order and without gaps,
+// containing the ticcmd diffs exactly as the server received them.
+
+void NET_Demo_WriteTic(net_full_ticcmd_t *cmd);
+
+// Finish the demo and close the file. Does nothing if not recording.
+
+void NET_Demo_Stop(void);
+
+#endif /* #ifndef NET_DEMO_H */
+
@@ -0,0 +1,814 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Network impairment layer: wraps another network module and
+//     simulates a bad connection.
+//
+//     Packets are impaired in both directions: outgoing packets are
+//     held in a queue before being passed to the wrapped module, and
+//     incoming packets are pulled from the wrapped module into a
+//     second queue until they are due. The queues are serviced
+//     whenever the wrapper is polled for new packets.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.hpp"
+#include "i_system.hpp"
+#include "i_timer.hpp"
+#include "m_argv.hpp"
+#include "m_misc.hpp"
+#include "net_defs.hpp"
+#include "net_impair.hpp"
+#include "net_io.hpp"
+#include "net_packet.hpp"
+#include "z_zone.hpp"
+#include "../utils/memory.hpp"
+
+// Maximum number of modules that can be wrapped at once.
+
+#define MAX_IMPAIR_MODULES 4
+
+// Packets that would wait longer than this for link capacity are
+// dropped, as a router with a full queue would.
+
+#define MAX_LINK_BACKLOG 1000
+
+typedef struct impair_addr_s impair_addr_t;
+typedef struct impair_packet_s impair_packet_t;
+typedef struct impair_slot_s impair_slot_t;
+
+// Address of the wrapper module; handle points to the address of the
+// wrapped module, on which we hold a reference.
+
+struct impair_addr_s
+{
+    net_addr_t addr;
+    net_addr_t *inner;
+
+    // Time at which the simulated link becomes free, in each direction.
+
+    int send_free_time;
+    int recv_free_time;
+
+    // Number of packets in the queues that refer to this address. The
+    // address is not freed until they have been delivered.
+
+    int queued;
+    boolean released;
+
+    impair_addr_t *next;
+};
+
+struct impair_packet_s
+{
+    net_packet_t *packet;
+    impair_addr_t *addr;
+    int deliver_time;
+    impair_packet_t *next;
+};
+
+struct impair_slot_s
+{
+    boolean in_use;
+    net_module_t module;
+    net_module_t *inner;
+    net_impair_t params;
+    net_impair_stats_t stats;
+    unsigned int rand_state;
+    impair_addr_t *addrs;
+    impair_packet_t *send_queue;
+    impair_packet_t *recv_queue;
+};
+
+static impair_slot_t slots[MAX_IMPAIR_MODULES];
+
+// xorshift generator: each wrapped module has its own state so that
+// runs with the same seed behave the same.
+
+static unsigned int Random(impair_slot_t *slot)
+{
+    unsigned int x = slot->rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    slot->rand_state = x;
+
+    return x;
+}
+
+// Random value in the range [0, 1)
+
+static double RandomFraction(impair_slot_t *slot)
+{
+    return (Random(slot) >> 8) / 16777216.0;
+}
+
+static boolean Chance(impair_slot_t *slot, double p)
+{
+    return p > 0 && RandomFraction(slot) < p;
+}
+
+static int RandomDelay(impair_slot_t *slot)
+{
+    net_impair_t *params = &slot->params;
+    double jitter;
+    int i;
+
+    if (params->jitter <= 0)
+    {
+        return params->latency;
+    }
+
+    switch (params->distribution)
+    {
+        case NET_IMPAIR_NORMAL:
+            // Irwin-Hall: the sum of uniform variables is close enough
+            // to a normal distribution for our purposes.
+            jitter = 0;
+            for (i = 0; i < 4; ++i)
+            {
+                jitter += RandomFraction(slot);
+            }
+            jitter = jitter * params->jitter / 4;
+            break;
+
+        case NET_IMPAIR_PARETO:
+            // Shape 2: most packets arrive quickly, a few arrive very
+            // late. Capped to keep the queues bounded.
+            jitter = params->jitter
+                   * (1.0 / sqrt(1.0 - RandomFraction(slot)) - 1.0);
+            if (jitter > params->jitter * 20.0)
+            {
+                jitter = params->jitter * 20.0;
+            }
+            break;
+
+        default:
+            jitter = RandomFraction(slot) * params->jitter;
+            break;
+    }
+
+    return params->latency + (int) jitter;
+}
+
+static impair_slot_t *SlotForModule(net_module_t *module)
+{
+    int i;
+
+    for (i = 0; i < MAX_IMPAIR_MODULES; ++i)
+    {
+        if (slots[i].in_use && &slots[i].module == module)
+        {
+            return &slots[i];
+        }
+    }
+
+    return nullptr;
+}
+
+// Find the wrapper address for an address of the wrapped module,
+// creating one if it does not exist yet.
+
+static impair_addr_t *FindAddress(impair_slot_t *slot, net_addr_t *inner)
+{
+    impair_addr_t *addr;
+
+    for (addr = slot->addrs; addr != nullptr; addr = addr->next)
+    {
+        if (addr->inner == inner)
+        {
+            addr->released = false;
+            return addr;
+        }
+    }
+
+    addr = zmalloc<decltype(addr)>(sizeof(impair_addr_t), PU_STATIC, 0);
+    addr->addr.module = &slot->module;
+    addr->addr.refcount = 0;
+    addr->addr.handle = inner;
+    addr->inner = inner;
+    addr->send_free_time = 0;
+    addr->recv_free_time = 0;
+    addr->queued = 0;
+    addr->released = false;
+    addr->next = slot->addrs;
+    slot->addrs = addr;
+
+    NET_ReferenceAddress(inner);
+
+    return addr;
+}
+
+static void RemoveAddress(impair_slot_t *slot, impair_addr_t *addr)
+{
+    impair_addr_t **rover;
+
+    for (rover = &slot->addrs; *rover != nullptr; rover = &(*rover)->next)
+    {
+        if (*rover == addr)
+        {
+            *rover = addr->next;
+            NET_ReleaseAddress(addr->inner);
+            Z_Free(addr);
+            return;
+        }
+    }
+
+    I_Error("NET_Impair: Attempted to remove an unused address!");
+}
+
+static void UnqueueAddress(impair_slot_t *slot, impair_addr_t *addr)
+{
+    --addr->queued;
+
+    if (addr->queued == 0 && addr->released)
+    {
+        RemoveAddress(slot, addr);
+    }
+}
+
+// Insert into a queue, keeping it sorted by delivery time. Packets with
+// the same delivery time stay in the order they were queued.
+
+static void QueuePacket(impair_packet_t **queue, impair_packet_t *entry)
+{
+    impair_packet_t **rover;
+
+    rover = queue;
+
+    while (*rover != nullptr && (*rover)->deliver_time <= entry->deliver_time)
+    {
+        rover = &(*rover)->next;
+    }
+
+    entry->next = *rover;
+    *rover = entry;
+}
+
+// Apply the impairment to a packet: it may be dropped, delayed,
+// duplicated or reordered. *link_free_time is the time at which the
+// simulated link in this direction is free.
+
+static void ImpairPacket(impair_slot_t *slot, impair_packet_t **queue,
+                         impair_addr_t *addr, int *link_free_time,
+                         net_packet_t *packet)
+{
+    impair_packet_t *entry;
+    int nowtime, send_time;
+    int copies, i;
+
+    ++slot->stats.packets;
+    slot->stats.bytes += packet->len;
+
+    if (Chance(slot, slot->params.loss))
+    {
+        ++slot->stats.dropped;
+        return;
+    }
+
+    nowtime = I_GetTimeMS();
+    copies = 1;
+
+    if (Chance(slot, slot->params.duplicate))
+    {
+        ++slot->stats.duplicated;
+        copies = 2;
+    }
+
+    for (i = 0; i < copies; ++i)
+    {
+        // Serialize onto the link if its capacity is limited.
+
+        send_time = nowtime;
+
+        if (slot->params.bandwidth > 0)
+        {
+            if (*link_free_time < nowtime)
+            {
+                *link_free_time = nowtime;
+            }
+
+            if (*link_free_time - nowtime > MAX_LINK_BACKLOG)
+            {
+                ++slot->stats.overflowed;
+                continue;
+            }
+
+            *link_free_time += (packet->len * 1000) / slot->params.bandwidth;
+            send_time = *link_free_time;
+        }
+
+        entry = zmalloc<decltype(entry)>(sizeof(impair_packet_t),
+                                         PU_STATIC, 0);
+        entry->packet = NET_PacketDup(packet);
+        entry->addr = addr;
+        entry->deliver_time = send_time + RandomDelay(slot);
+
+        if (Chance(slot, slot->params.reorder))
+        {
+            ++slot->stats.reordered;
+            entry->deliver_time += slot->params.reorder_delay;
+        }
+
+        ++addr->queued;
+        QueuePacket(queue, entry);
+    }
+}
+
+// Pass any outgoing packets that are due to the wrapped module.
+
+static void FlushSendQueue(impair_slot_t *slot)
+{
+    impair_packet_t *entry;
+    int nowtime;
+
+    nowtime = I_GetTimeMS();
+
+    while (slot->send_queue != nullptr
+        && slot->send_queue->deliver_time <= nowtime)
+    {
+        entry = slot->send_queue;
+        slot->send_queue = entry->next;
+
+        slot->inner->SendPacket(entry->addr->inner, entry->packet);
+
+        NET_FreePacket(entry->packet);
+        UnqueueAddress(slot, entry->addr);
+        Z_Free(entry);
+    }
+}
+
+// Pull everything the wrapped module has received into the receive
+// queue.
+
+static void PollInner(impair_slot_t *slot)
+{
+    net_addr_t *inner_addr;
+    net_packet_t *packet;
+    impair_addr_t *addr;
+
+    while (slot->inner->RecvPacket(&inner_addr, &packet))
+    {
+        addr = FindAddress(slot, inner_addr);
+        ImpairPacket(slot, &slot->recv_queue, addr, &addr->recv_free_time,
+                     packet);
+        NET_FreePacket(packet);
+    }
+}
+
+static boolean Impair_InitClient(impair_slot_t *slot)
+{
+    return slot->inner->InitClient();
+}
+
+static boolean Impair_InitServer(impair_slot_t *slot)
+{
+    return slot->inner->InitServer();
+}
+
+static void Impair_SendPacket(impair_slot_t *slot, net_addr_t *addr,
+                              net_packet_t *packet)
+{
+    impair_addr_t *iaddr;
+
+    // Broadcasts are not impaired.
+
+    if (addr == &net_broadcast_addr)
+    {
+        slot->inner->SendPacket(addr, packet);
+        return;
+    }
+
+    iaddr = (impair_addr_t *) addr;
+    ImpairPacket(slot, &slot->send_queue, iaddr, &iaddr->send_free_time,
+                 packet);
+    FlushSendQueue(slot);
+}
+
+static boolean Impair_RecvPacket(impair_slot_t *slot, net_addr_t **addr,
+                                 net_packet_t **packet)
+{
+    impair_packet_t *entry;
+
+    FlushSendQueue(slot);
+    PollInner(slot);
+
+    entry = slot->recv_queue;
+
+    if (entry == nullptr || entry->deliver_time > I_GetTimeMS())
+    {
+        return false;
+    }
+
+    slot->recv_queue = entry->next;
+
+    // The caller takes a reference before the address can be released,
+    // so it stays valid even if this was the last queued packet.
+
+    --entry->addr->queued;
+    entry->addr->released = false;
+
+    *addr = &entry->addr->addr;
+    *packet = entry->packet;
+
+    Z_Free(entry);
+
+    return true;
+}
+
+static void Impair_AddrToString(impair_slot_t *slot, net_addr_t *addr,
+                                char *buffer, int buffer_len)
+{
+    impair_addr_t *iaddr = (impair_addr_t *) addr;
+
+    slot->inner->AddrToString(iaddr->inner, buffer, buffer_len);
+}
+
+static void Impair_FreeAddress(impair_slot_t *slot, net_addr_t *addr)
+{
+    impair_addr_t *iaddr = (impair_addr_t *) addr;
+
+    if (iaddr->queued > 0)
+    {
+        // Packets are still in flight; free it once they are delivered.
+
+        iaddr->released = true;
+        return;
+    }
+
+    RemoveAddress(slot, iaddr);
+}
+
+static net_addr_t *Impair_ResolveAddress(impair_slot_t *slot,
+                                         const char *address)
+{
+    net_addr_t *inner;
+
+    inner = slot->inner->ResolveAddress(address);
+
+    if (inner == nullptr)
+    {
+        return nullptr;
+    }
+
+    return &FindAddress(slot, inner)->addr;
+}
+
+// net_module_t has no context pointer, so each slot gets its own set
+// of entry points that forward to the functions above.
+
+template <int N>
+struct impair_entry_points
+{
+    static boolean InitClient(void)
+    {
+        return Impair_InitClient(&slots[N]);
+    }
+
+    static boolean InitServer(void)
+    {
+        return Impair_InitServer(&slots[N]);
+    }
+
+    static void SendPacket(net_addr_t *addr, net_packet_t *packet)
+    {
+        Impair_SendPacket(&slots[N], addr, packet);
+    }
+
+    static boolean RecvPacket(net_addr_t **addr, net_packet_t **packet)
+    {
+        return Impair_RecvPacket(&slots[N], addr, packet);
+    }
+
+    static void AddrToString(net_addr_t *addr, char *buffer, int buffer_len)
+    {
+        Impair_AddrToString(&slots[N], addr, buffer, buffer_len);
+    }
+
+    static void FreeAddress(net_addr_t *addr)
+    {
+        Impair_FreeAddress(&slots[N], addr);
+    }
+
+    static net_addr_t *ResolveAddress(const char *address)
+    {
+        return Impair_ResolveAddress(&slots[N], address);
+    }
+
+    static net_module_t module;
+};
+
+template <int N>
+net_module_t impair_entry_points<N>::module =
+{
+    impair_entry_points<N>::InitClient,
+    impair_entry_points<N>::InitServer,
+    impair_entry_points<N>::SendPacket,
+    impair_entry_points<N>::RecvPacket,
+    impair_entry_points<N>::AddrToString,
+    impair_entry_points<N>::FreeAddress,
+    impair_entry_points<N>::ResolveAddress,
+    nullptr,
+    nullptr,
+};
+
+static net_module_t *slot_modules[MAX_IMPAIR_MODULES] =
+{
+    &impair_entry_points<0>::module,
+    &impair_entry_points<1>::module,
+    &impair_entry_points<2>::module,
+    &impair_entry_points<3>::module,
+};
+
+net_module_t *NET_Impair_Module(net_module_t *module, net_impair_t *params)
+{
+    impair_slot_t *slot;
+    int i;
+
+    for (i = 0; i < MAX_IMPAIR_MODULES; ++i)
+    {
+        if (!slots[i].in_use)
+        {
+            break;
+        }
+    }
+
+    if (i >= MAX_IMPAIR_MODULES)
+    {
+        I_Error("NET_Impair_Module: Too many impaired modules");
+    }
+
+    slot = &slots[i];
+    memset(slot, 0, sizeof(impair_slot_t));
+    slot->in_use = true;
+    slot->module = *slot_modules[i];
+    slot->inner = module;
+    slot->params = *params;
+    slot->rand_state = params->seed != 0 ? params->seed : 1;
+
+    // Different wrapped modules should not make the same choices.
+
+    slot->rand_state += i * 0x9e3779b9;
+
+    if (slot->rand_state == 0)
+    {
+        slot->rand_state = 1;
+    }
+
+    return &slot->module;
+}
+
+boolean NET_Impair_GetStats(net_module_t *module, net_impair_stats_t *stats)
+{
+    impair_slot_t *slot;
+
+    slot = SlotForModule(module);
+
+    if (slot == nullptr)
+    {
+        return false;
+    }
+
+    *stats = slot->stats;
+
+    return true;
+}
+
+// Parse a rate, which may have a k or m suffix: "64k" = 64000 bytes/s.
+
+static boolean ParseRate(const char *value, int *result)
+{
+    char *end;
+    double rate;
+
+    rate = strtod(value, &end);
+
+    if (end == value || rate < 0)
+    {
+        return false;
+    }
+
+    if (*end == 'k' || *end == 'K')
+    {
+        rate *= 1000;
+        ++end;
+    }
+    else if (*end == 'm' || *end == 'M')
+    {
+        rate *= 1000000;
+        ++end;
+    }
+
+    *result = (int) rate;
+
+    return *end == '\0';
+}
+
+// Parse a probability, either a fraction ("0.02") or a percentage ("2%").
+
+static boolean ParseProbability(const char *value, double *result)
+{
+    char *end;
+    double p;
+
+    p = strtod(value, &end);
+
+    if (end == value)
+    {
+        return false;
+    }
+
+    if (*end == '%')
+    {
+        p /= 100;
+        ++end;
+    }
+
+    if (*end != '\0' || p < 0 || p > 1)
+    {
+        return false;
+    }
+
+    *result = p;
+
+    return true;
+}
+
+static boolean ParseInteger(const char *value, int *result)
+{
+    char *end;
+    long l;
+
+    l = strtol(value, &end, 10);
+
+    if (end == value || *end != '\0' || l < 0)
+    {
+        return false;
+    }
+
+    *result = (int) l;
+
+    return true;
+}
+
+static boolean ParseOption(const char *name, const char *value,
+                           net_impair_t *params)
+{
+    int seed;
+
+    if (!strcasecmp(name, "latency"))
+    {
+        return ParseInteger(value, &params->latency);
+    }
+    else if (!strcasecmp(name, "jitter"))
+    {
+        return ParseInteger(value, &params->jitter);
+    }
+    else if (!strcasecmp(name, "dist"))
+    {
+        if (!strcasecmp(value, "uniform"))
+        {
+            params->distribution = NET_IMPAIR_UNIFORM;
+        }
+        else if (!strcasecmp(value, "normal"))
+        {
+            params->distribution = NET_IMPAIR_NORMAL;
+        }
+        else if (!strcasecmp(value, "pareto"))
+        {
+            params->distribution = NET_IMPAIR_PARETO;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+    else if (!strcasecmp(name, "loss"))
+    {
+        return ParseProbability(value, &params->loss);
+    }
+    else if (!strcasecmp(name, "dup"))
+    {
+        return ParseProbability(value, &params->duplicate);
+    }
+    else if (!strcasecmp(name, "reorder"))
+    {
+        return ParseProbability(value, &params->reorder);
+    }
+    else if (!strcasecmp(name, "reorderdelay"))
+    {
+        return ParseInteger(value, &params->reorder_delay);
+    }
+    else if (!strcasecmp(name, "rate"))
+    {
+        return ParseRate(value, &params->bandwidth);
+    }
+    else if (!strcasecmp(name, "seed"))
+    {
+        if (!ParseInteger(value, &seed))
+        {
+            return false;
+        }
+
+        params->seed = seed;
+        return true;
+    }
+
+    return false;
+}
+
+boolean NET_Impair_Parse(const char *spec, net_impair_t *params)
+{
+    char *buf, *option, *value, *next;
+    boolean result;
+
+    memset(params, 0, sizeof(net_impair_t));
+    params->distribution = NET_IMPAIR_UNIFORM;
+    params->reorder_delay = 20;
+    params->seed = 1;
+
+    buf = M_StringDuplicate(spec);
+    result = true;
+
+    for (option = buf; option != nullptr && *option != '\0'; option = next)
+    {
+        next = strchr(option, ',');
+
+        if (next != nullptr)
+        {
+            *next = '\0';
+            ++next;
+        }
+
+        value = strchr(option, '=');
+
+        if (value == nullptr)
+        {
+            result = false;
+            break;
+        }
+
+        *value = '\0';
+        ++value;
+
+        if (!ParseOption(option, value, params))
+        {
+            result = false;
+            break;
+        }
+    }
+
+    free(buf);
+
+    return result;
+}
+
+net_module_t *NET_Impair_CheckModule(net_module_t *module)
+{
+    net_impair_t params;
+    int p;
+
+    //!
+    // @category net
+    // @arg <spec>
+    //
+    // Simulate a bad network connection, for testing. spec is a
+    // comma-separated list of options: latency=<ms>, jitter=<ms>,
+    // dist=uniform|normal|pareto, loss=<p>, dup=<p>, reorder=<p>,
+    // reorderdelay=<ms>, rate=<bytes/s> and seed=<n>. Probabilities
+    // may be given as percentages, eg. loss=2%.
+    //
+
+    p = M_CheckParmWithArgs("-netimpair", 1);
+
+    if (p <= 0)
+    {
+        return module;
+    }
+
+    if (!NET_Impair_Parse(myargv[p + 1], &params))
+    {
+        I_Error("Invalid -netimpair specification: '%s'", myargv[p + 1]);
+    }
+
+    return NET_Impair_Module(module, &params);
+}
+
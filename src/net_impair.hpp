@@ -0,0 +1,95 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Network impairment layer: wraps another network module and
+//     simulates a bad connection (latency, jitter, loss, duplication,
+//     reordering and limited bandwidth).
+//
+
+#ifndef NET_IMPAIR_H
+#define NET_IMPAIR_H
+
+#include "net_defs.hpp"
+
+// Shape of the random part of the packet delay.
+
+typedef enum
+{
+    NET_IMPAIR_UNIFORM,     // uniform in [0, jitter]
+    NET_IMPAIR_NORMAL,      // approximately normal, mean jitter / 2
+    NET_IMPAIR_PARETO,      // heavy tailed, scale jitter
+} net_impair_dist_t;
+
+typedef struct
+{
+    // Fixed one-way delay and random jitter, in ms.
+
+    int latency;
+    int jitter;
+    net_impair_dist_t distribution;
+
+    // Probabilities, as fractions in the range 0-1.
+
+    double loss;
+    double duplicate;
+    double reorder;
+
+    // Extra delay (ms) given to a packet that is reordered.
+
+    int reorder_delay;
+
+    // Link capacity in bytes per second in each direction, per remote
+    // address. 0 means unlimited.
+
+    int bandwidth;
+
+    // Random seed, so that runs can be reproduced.
+
+    unsigned int seed;
+} net_impair_t;
+
+typedef struct
+{
+    unsigned int packets;
+    unsigned int bytes;
+    unsigned int dropped;
+    unsigned int duplicated;
+    unsigned int reordered;
+    unsigned int overflowed;
+} net_impair_stats_t;
+
+// Parse an impairment description of the form
+// "latency=100,jitter=20,dist=normal,loss=2%,dup=0.5%,reorder=1%,
+// reorderdelay=30,rate=64k,seed=1". Returns false if invalid.
+
+boolean NET_Impair_Parse(const char *spec, net_impair_t *params);
+
+// Wrap the given module. Packets sent and received through the returned
+// module are impaired according to params. Only a small, fixed number
+// of modules can be wrapped.
+
+net_module_t *NET_Impair_Module(net_module_t *module, net_impair_t *params);
+
+// Wrap the module if the -netimpair parameter was given, or return it
+// unchanged otherwise.
+
+net_module_t *NET_Impair_CheckModule(net_module_t *module);
+
+// Read statistics for a module returned by NET_Impair_Module. Returns
+// false if it is not a wrapped module.
+
+boolean NET_Impair_GetStats(net_module_t *module, net_impair_stats_t *stats);
+
+#endif /* #ifndef NET_IMPAIR_H */
+
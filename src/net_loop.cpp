@@ -151,6 +151,8 @@ net_module_t net_loop_client_module =
     NET_CL_AddrToString,
     NET_CL_FreeAddress,
     NET_CL_ResolveAddress,
+    nullptr,
+    nullptr,
 };
 
 //-----------------------------------------------------------------------------
@@ -226,6 +228,8 @@ net_module_t net_loop_server_module =
     NET_SV_AddrToString,
     NET_SV_FreeAddress,
     NET_SV_ResolveAddress,
+    nullptr,
+    nullptr,
 };
 
 
@@ -44,6 +44,7 @@
 static boolean initted = false;
 static int port = DEFAULT_PORT;
 static UDPsocket udpsocket;
+static SDLNet_SocketSet udpsocketset;
 static UDPpacket *recvpacket;
 
 typedef struct
@@ -157,6 +158,20 @@ static void NET_SDL_FreeAddress(net_addr_t *addr)
     I_Error("NET_SDL_FreeAddress: Attempted to remove an unused address!");
 }
 
+// Lets the client network thread wait for packets on the socket.
+
+static void NET_SDL_InitSocketSet(void)
+{
+    udpsocketset = SDLNet_AllocSocketSet(1);
+
+    if (udpsocketset == nullptr)
+    {
+        I_Error("NET_SDL_InitSocketSet: Unable to allocate a socket set!");
+    }
+
+    SDLNet_UDP_AddSocket(udpsocketset, udpsocket);
+}
+
 static boolean NET_SDL_InitClient(void)
 {
     int p;
@@ -184,6 +199,8 @@ static boolean NET_SDL_InitClient(void)
     {
         I_Error("NET_SDL_InitClient: Unable to open a socket!");
     }
+
+    NET_SDL_InitSocketSet();
     
     recvpacket = SDLNet_AllocPacket(1500);
 
@@ -216,6 +233,8 @@ static boolean NET_SDL_InitServer(void)
         I_Error("NET_SDL_InitServer: Unable to bind to port %i", port);
     }
 
+    NET_SDL_InitSocketSet();
+
     recvpacket = SDLNet_AllocPacket(1500);
 #ifdef DROP_PACKETS
     srand(time(nullptr));
@@ -304,6 +323,54 @@ static boolean NET_SDL_RecvPacket(net_addr_t **addr, net_packet_t **packet)
     return true;
 }
 
+static int NET_SDL_RecvPacketRaw(net_packet_t *packet, net_raw_addr_t *from,
+                                 int timeout_ms)
+{
+    UDPpacket sdl_packet;
+    int result;
+
+    static_assert(sizeof(IPaddress) <= sizeof(from->data),
+                  "IPaddress does not fit in net_raw_addr_t");
+
+    // SDLNet_CheckSockets() returns right away if a packet is waiting.
+
+    if (timeout_ms > 0)
+    {
+        result = SDLNet_CheckSockets(udpsocketset, timeout_ms);
+
+        if (result <= 0)
+        {
+            return result;
+        }
+    }
+
+    sdl_packet.channel = -1;
+    sdl_packet.data = packet->data;
+    sdl_packet.maxlen = packet->alloced;
+
+    result = SDLNet_UDP_Recv(udpsocket, &sdl_packet);
+
+    if (result <= 0)
+    {
+        return result;
+    }
+
+    packet->len = sdl_packet.len;
+    packet->pos = 0;
+    memcpy(from->data, &sdl_packet.address, sizeof(IPaddress));
+
+    return 1;
+}
+
+static net_addr_t *NET_SDL_FindRawAddress(net_raw_addr_t *from)
+{
+    IPaddress ip;
+
+    memcpy(&ip, from->data, sizeof(IPaddress));
+
+    return NET_SDL_FindAddress(&ip);
+}
+
 void NET_SDL_AddrToString(net_addr_t *addr, char *buffer, int buffer_len)
 {
     IPaddress *ip;
@@ -378,6 +445,8 @@ net_module_t net_sdl_module =
     NET_SDL_AddrToString,
     NET_SDL_FreeAddress,
     NET_SDL_ResolveAddress,
+    NET_SDL_RecvPacketRaw,
+    NET_SDL_FindRawAddress,
 };
 
 
@@ -435,6 +504,8 @@ net_module_t net_sdl_module =
     NET_NULL_AddrToString,
     NET_NULL_FreeAddress,
     NET_NULL_ResolveAddress,
+    nullptr,
+    nullptr,
 };
 
 
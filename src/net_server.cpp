@@ -31,6 +31,7 @@
 #include "net_client.hpp"
 #include "net_common.hpp"
 #include "net_defs.hpp"
+#include "net_demo.hpp"
 #include "net_io.hpp"
 #include "net_loop.hpp"
 #include "net_packet.hpp"
@@ -45,6 +46,20 @@
 // How often to re-resolve the address of the master server?
 #define MASTER_RESOLVE_PERIOD 8 * 60 * 60 /* 8 hours */
 
+// Extra client slots for drones in relay mode, which do not count
+// against the normal limit.
+#define MAXRELAYNODES 64
+#define MAXSVNODES (MAXNETNODES + MAXRELAYNODES)
+
+// Number of complete tics kept for relaying to drones. A drone that
+// falls further behind than this is disconnected. Must be a power of 2.
+#define RELAY_BACKUPTICS 1024
+
+// Maximum number of tics sent to a relayed drone ahead of its last
+// acknowledgement, and in a single packet.
+#define RELAY_MAX_AHEAD 40
+#define RELAY_MAX_BATCH 8
+
 enum net_server_state_t
 {
     // waiting for the game to be "launched" (key player to press the start
@@ -101,6 +116,11 @@ struct net_client_t
 
     unsigned int acknowledged;
 
+    // Loss statistics and adaptive redundancy for this client's
+    // game data stream.
+
+    net_redundancy_t redundancy;
+
     // Value of max_players specified by the client on connect.
 
     int max_players;
@@ -147,7 +167,7 @@ typedef struct
 
 static net_server_state_t server_state;
 static boolean server_initialized = false;
-static net_client_t clients[MAXNETNODES];
+static net_client_t clients[MAXSVNODES];
 static net_client_t *sv_players[NET_MAXPLAYERS];
 static net_context_t *server_context;
 static GameMode_t sv_gamemode;
@@ -167,6 +187,21 @@ static net_client_recv_t recvwindow[BACKUPTICS][NET_MAXPLAYERS];
 
 #define NET_SV_ExpandTicNum(b) NET_ExpandTicNum(recvwindow_start, (b))
 
+// Merged tic stream: every tic for which the ticcmds of all players
+// have been received is committed here in order, for the server demo
+// and for relaying to drones. complete_seq is the next tic to commit.
+
+static unsigned int complete_seq;
+static net_full_ticcmd_t relay_history[RELAY_BACKUPTICS];
+
+// Maximum number of drones in relay mode, or zero if relay mode is off.
+
+static int relay_max_drones;
+
+// If non-NULL, record each game to a demo with this name.
+
+static const char *sv_demoname = nullptr;
+
 static void NET_SV_DisconnectClient(net_client_t *client)
 {
     if (client->active)
@@ -184,6 +219,14 @@ static boolean ClientConnected(net_client_t *client)
         && client->connection.state == NET_CONN_STATE_CONNECTED;
 }
 
+// In relay mode, drones are fed from the merged tic stream and are not
+// part of the lockstep between the players.
+
+static boolean ClientRelayed(net_client_t *client)
+{
+    return relay_max_drones > 0 && client->drone;
+}
+
 // Send a message to be displayed on a client's console
 
 static void NET_SV_SendConsoleMessage(net_client_t *client, const char *s, ...) PRINTF_ATTR(2, 3);
@@ -216,7 +259,7 @@ static void NET_SV_BroadcastMessage(const char *s, ...)
     M_vsnprintf(buf, sizeof(buf), s, args);
     va_end(args);
 
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i]))
         {
@@ -237,7 +280,7 @@ static void NET_SV_AssignPlayers(void)
 
     pl = 0;
 
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i]))
         {
@@ -287,7 +330,7 @@ static int NET_SV_NumReadyPlayers(void)
     int result = 0;
     int i;
 
-    for (i = 0; i < MAXNETNODES; ++i)
+    for (i = 0; i < MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i])
          && !clients[i].drone && clients[i].ready)
@@ -305,7 +348,7 @@ static int NET_SV_MaxPlayers(void)
 {
     int i;
 
-    for (i = 0; i < MAXNETNODES; ++i)
+    for (i = 0; i < MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i]))
         {
@@ -325,7 +368,7 @@ static int NET_SV_NumDrones(void)
 
     result = 0;
 
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i]) && clients[i].drone)
         {
@@ -345,7 +388,7 @@ static int NET_SV_NumClients(void)
 
     count = 0;
 
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i]))
         {
@@ -356,6 +399,23 @@ static int NET_SV_NumClients(void)
     return count;
 }
 
+// Returns true if there is a free slot for a new client.
+
+static boolean NET_SV_SlotFree(boolean drone)
+{
+    if (relay_max_drones > 0)
+    {
+        if (drone)
+        {
+            return NET_SV_NumDrones() < relay_max_drones;
+        }
+
+        return NET_SV_NumClients() - NET_SV_NumDrones() < MAXNETNODES;
+    }
+
+    return NET_SV_NumClients() < MAXNETNODES;
+}
+
 // returns a pointer to the client which controls the server
 
 static net_client_t *NET_SV_Controller(void)
@@ -367,7 +427,7 @@ static net_client_t *NET_SV_Controller(void)
 
     best = nullptr;
 
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         // Can't be controller?
 
@@ -443,16 +503,16 @@ static void NET_SV_SendWaitingData(net_client_t *client)
 }
 
 // Find the latest tic which has been acknowledged as received by
-// all clients.
+// all clients (other than relayed drones).
 
 static unsigned int NET_SV_LatestAcknowledged(void)
 {
     unsigned int lowtic = UINT_MAX;
     int i;
 
-    for (i=0; i<MAXNETNODES; ++i) 
+    for (i=0; i<MAXSVNODES; ++i) 
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&clients[i]) && !ClientRelayed(&clients[i]))
         {
             if (clients[i].acknowledged < lowtic)
             {
@@ -465,6 +525,65 @@ static unsigned int NET_SV_LatestAcknowledged(void)
 }
 
 
+// Commit tics to the merged tic stream once the ticcmds of all
+// connected players have been received for them.
+
+static void NET_SV_CommitTics(void)
+{
+    net_full_ticcmd_t *cmd;
+    net_client_recv_t *recvobj;
+    unsigned int index;
+    int i;
+
+    // The window never advances past a tic that is not complete, so
+    // complete_seq is always inside it.
+
+    for (;;)
+    {
+        index = complete_seq - recvwindow_start;
+
+        if (index >= BACKUPTICS)
+        {
+            break;
+        }
+
+        for (i = 0; i < NET_MAXPLAYERS; ++i)
+        {
+            if (sv_players[i] != nullptr && ClientConnected(sv_players[i])
+             && !recvwindow[index][i].active)
+            {
+                return;
+            }
+        }
+
+        cmd = &relay_history[complete_seq % RELAY_BACKUPTICS];
+        cmd->seq = complete_seq;
+        cmd->latency = 0;
+
+        for (i = 0; i < NET_MAXPLAYERS; ++i)
+        {
+            recvobj = &recvwindow[index][i];
+
+            cmd->playeringame[i] = sv_players[i] != nullptr
+                                && recvobj->active;
+
+            if (!cmd->playeringame[i])
+            {
+                continue;
+            }
+
+            cmd->cmds[i] = recvobj->diff;
+
+            if (recvobj->latency > cmd->latency)
+                cmd->latency = recvobj->latency;
+        }
+
+        NET_Demo_WriteTic(cmd);
+
+        ++complete_seq;
+    }
+}
+
 // Possibly advance the recv window if all connected clients have
 // used the data in the window
 
@@ -478,6 +597,8 @@ static void NET_SV_AdvanceWindow(void)
         return;
     }
 
+    NET_SV_CommitTics();
+
     lowtic = NET_SV_LatestAcknowledged();
 
     // Advance the recv window until it catches up with lowtic
@@ -530,7 +651,7 @@ static net_client_t *NET_SV_FindClient(net_addr_t *addr)
 {
     int i;
 
-    for (i=0; i<MAXNETNODES; ++i) 
+    for (i=0; i<MAXSVNODES; ++i) 
     {
         if (clients[i].active && clients[i].addr == addr)
         {
@@ -691,7 +812,7 @@ static void NET_SV_ParseSYN(net_packet_t *packet, net_client_t *client,
     num_players = NET_SV_NumPlayers();
 
     if ((!data.drone && num_players >= NET_SV_MaxPlayers())
-     || NET_SV_NumClients() >= MAXNETNODES)
+     || !NET_SV_SlotFree(data.drone))
     {
         NET_Log("server: no more players, num_players=%d, max=%d",
                 num_players, NET_SV_MaxPlayers());
@@ -735,7 +856,7 @@ static void NET_SV_ParseSYN(net_packet_t *packet, net_client_t *client,
     {
         // find a slot, or return if none found
 
-        for (i=0; i<MAXNETNODES; ++i)
+        for (i=0; i<MAXSVNODES; ++i)
         {
             if (!clients[i].active)
             {
@@ -821,7 +942,7 @@ static void NET_SV_ParseLaunch(net_packet_t *packet, net_client_t *client)
     NET_SV_AssignPlayers();
     num_players = NET_SV_NumPlayers();
 
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (!ClientConnected(&clients[i]))
             continue;
@@ -862,6 +983,14 @@ static void StartGame(void)
         }
     }
 
+    // The same goes for the server demo, if it can't hold high
+    // resolution turning.
+
+    if (sv_demoname != nullptr && NET_Demo_NeedLowResTurn(sv_gamemission))
+    {
+        sv_settings.lowres_turn = true;
+    }
+
     sv_settings.num_players = NET_SV_NumPlayers();
 
     // Copy player classes:
@@ -882,12 +1011,13 @@ static void StartGame(void)
 
     // Send start packets to each connected node
 
-    for (i = 0; i < MAXNETNODES; ++i)
+    for (i = 0; i < MAXSVNODES; ++i)
     {
         if (!ClientConnected(&clients[i]))
             continue;
 
         clients[i].last_gamedata_time = nowtime;
+        NET_Redundancy_Init(&clients[i].redundancy);
 
         startpacket = NET_Conn_NewReliable(&clients[i].connection,
                                            NET_PACKET_TYPE_GAMESTART);
@@ -903,6 +1033,20 @@ static void StartGame(void)
 
     memset(recvwindow, 0, sizeof(recvwindow));
     recvwindow_start = 0;
+    complete_seq = 0;
+
+    if (sv_demoname != nullptr)
+    {
+        boolean playeringame[NET_MAXPLAYERS];
+
+        for (i = 0; i < NET_MAXPLAYERS; ++i)
+        {
+            playeringame[i] = sv_players[i] != nullptr;
+        }
+
+        NET_Demo_Start(sv_demoname, sv_gamemission, sv_gamemode,
+                       &sv_settings, playeringame);
+    }
 }
 
 // Returns true when all nodes have indicated readiness to start the game.
@@ -911,7 +1055,7 @@ static boolean AllNodesReady(void)
 {
     unsigned int i;
 
-    for (i = 0; i < MAXNETNODES; ++i)
+    for (i = 0; i < MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i]) && !clients[i].ready)
         {
@@ -943,7 +1087,7 @@ static void SendAllWaitingData(void)
 {
     unsigned int i;
 
-    for (i = 0; i < MAXNETNODES; ++i)
+    for (i = 0; i < MAXSVNODES; ++i)
     {
         if (ClientConnected(&clients[i]) && clients[i].ready)
         {
@@ -1114,6 +1258,7 @@ static void NET_SV_CheckResends(net_client_t *client)
 
 static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
 {
+    net_ticstream_t stream;
     net_client_recv_t *recvobj;
     unsigned int seq;
     unsigned int ackseq;
@@ -1159,6 +1304,11 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
     ackseq = NET_SV_ExpandTicNum(ackseq);
     seq = NET_SV_ExpandTicNum(seq);
 
+    NET_Redundancy_PacketReceived(&client->redundancy, seq, num_tics);
+
+    NET_InitTicStream(&stream, packet, client->connection.protocol,
+                      sv_settings.lowres_turn);
+
     // Sanity checks
 
     for (i=0; i<num_tics; ++i)
@@ -1166,8 +1316,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
         net_ticdiff_t diff;
         signed int latency;
 
-        if (!NET_ReadSInt16(packet, &latency)
-         || !NET_ReadTiccmdDiff(packet, &diff, sv_settings.lowres_turn))
+        if (!NET_ReadStreamTiccmdDiff(&stream, &latency, &diff))
         {
             return;
         }
@@ -1182,6 +1331,8 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
         }
 
         recvobj = &recvwindow[index][player];
+        NET_Redundancy_TicReceived(&client->redundancy, recvobj->active,
+                                   i == num_tics - 1);
         recvobj->active = true;
         recvobj->diff = diff;
         recvobj->latency = latency;
@@ -1270,9 +1421,17 @@ static void NET_SV_ParseGameDataACK(net_packet_t *packet, net_client_t *client)
         return;
     }
 
-    // Expand 8-bit values to the full sequence number
+    // Expand 8-bit values to the full sequence number. Relayed drones
+    // can be far behind the receive window.
 
-    ackseq = NET_SV_ExpandTicNum(ackseq);
+    if (ClientRelayed(client))
+    {
+        ackseq = NET_ExpandTicNum(client->acknowledged, ackseq);
+    }
+    else
+    {
+        ackseq = NET_SV_ExpandTicNum(ackseq);
+    }
 
     // Higher acknowledgement point than we already have?
 
@@ -1286,6 +1445,7 @@ static void NET_SV_ParseGameDataACK(net_packet_t *packet, net_client_t *client)
 static void NET_SV_SendTics(net_client_t *client, 
                             unsigned int start, unsigned int end)
 {
+    net_full_ticcmd_t *cmds[BACKUPTICS];
     net_packet_t *packet;
     unsigned int i;
 
@@ -1311,10 +1471,11 @@ static void NET_SV_SendTics(net_client_t *client,
             I_Error("Wanted to send %i, but %i is in its place", i, cmd->seq);
         }
 
-        // Add command
-       
-        NET_WriteFullTiccmd(packet, cmd, sv_settings.lowres_turn);
+        cmds[i - start] = cmd;
     }
+
+    NET_WriteFullTiccmds(packet, client->connection.protocol, cmds,
+                         end - start + 1, sv_settings.lowres_turn);
     
     // Send packet
 
@@ -1344,6 +1505,8 @@ static void NET_SV_ParseResendRequest(net_packet_t *packet, net_client_t *client
 
     //printf("SV: %p: resend %i-%i\n", client, start, start+num_tics-1);
 
+    NET_Redundancy_ResendRequested(&client->redundancy);
+
     // Check we have all the requested tics
 
     last = start + num_tics - 1;
@@ -1667,9 +1830,21 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
 
     // Transmit the new tic to the client
 
-    starttic = client->sendseq - sv_settings.extratics;
+    starttic = client->sendseq
+             - NET_Redundancy_ExtraTics(&client->redundancy,
+                                        sv_settings.extratics,
+                                        NET_AddrToString(client->addr));
     endtic = client->sendseq;
 
+    // With adaptive redundancy, there is no need to repeat tics the
+    // client has already acknowledged.
+
+    if (client->redundancy.enabled
+     && starttic < static_cast<int>(client->acknowledged))
+    {
+        starttic = client->acknowledged;
+    }
+
     if (starttic < 0)
         starttic = 0;
 
@@ -1680,6 +1855,88 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     ++client->sendseq;
 }
 
+// Send the next committed tics to a relayed drone.
+
+static void NET_SV_PumpRelay(net_client_t *client)
+{
+    int starttic, endtic;
+    int i;
+
+    // The history is a circular buffer; if the drone has fallen so
+    // far behind that the tics it needs have been overwritten, it can
+    // never catch up.
+
+    if (complete_seq - client->sendseq > RELAY_BACKUPTICS)
+    {
+        NET_Log("server: drone %s fell behind, sendseq=%d, complete=%u",
+                NET_AddrToString(client->addr), client->sendseq,
+                complete_seq);
+        NET_SV_BroadcastMessage("Spectator '%s' fell too far behind and "
+                                "was disconnected", client->name);
+        NET_SV_DisconnectClient(client);
+        return;
+    }
+
+    endtic = static_cast<int>(complete_seq) - 1;
+
+    if (endtic > static_cast<int>(client->acknowledged) + RELAY_MAX_AHEAD)
+    {
+        endtic = client->acknowledged + RELAY_MAX_AHEAD;
+    }
+
+    if (endtic >= client->sendseq + RELAY_MAX_BATCH)
+    {
+        endtic = client->sendseq + RELAY_MAX_BATCH - 1;
+    }
+
+    if (endtic < client->sendseq)
+    {
+        return;
+    }
+
+    for (i = client->sendseq; i <= endtic; ++i)
+    {
+        client->sendqueue[i % BACKUPTICS] =
+            relay_history[i % RELAY_BACKUPTICS];
+    }
+
+    starttic = client->sendseq
+             - NET_Redundancy_ExtraTics(&client->redundancy,
+                                        sv_settings.extratics,
+                                        NET_AddrToString(client->addr));
+
+    if (client->redundancy.enabled
+     && starttic < static_cast<int>(client->acknowledged))
+    {
+        starttic = client->acknowledged;
+    }
+
+    if (starttic < 0)
+        starttic = 0;
+
+    NET_Log("server: relay tics %d-%d to %s", starttic, endtic,
+            NET_AddrToString(client->addr));
+    NET_SV_SendTics(client, starttic, endtic);
+
+    client->sendseq = endtic + 1;
+}
+
+// Fan the merged tic stream out to the relayed drones. This runs after
+// the players have been serviced, and drones never hold the game up.
+
+static void NET_SV_RunRelay(void)
+{
+    int i;
+
+    for (i = 0; i < MAXSVNODES; ++i)
+    {
+        if (ClientConnected(&clients[i]) && ClientRelayed(&clients[i]))
+        {
+            NET_SV_PumpRelay(&clients[i]);
+        }
+    }
+}
+
 // Prevent against deadlock: resend requests are usually only
 // triggered if we miss a packet and receive the next one.
 // If we miss a whole load of packets, we can end up in a 
@@ -1754,7 +2011,9 @@ static void NET_SV_GameEnded(void)
     server_state = SERVER_WAITING_LAUNCH;
     sv_gamemode = GameMode_t::indetermined;
 
-    for (i=0; i<MAXNETNODES; ++i)
+    NET_Demo_Stop();
+
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (clients[i].active)
         {
@@ -1833,7 +2092,9 @@ static void NET_SV_RunClient(net_client_t *client)
         }
     }
 
-    if (server_state == SERVER_IN_GAME)
+    // Relayed drones are serviced separately, after the players.
+
+    if (server_state == SERVER_IN_GAME && !ClientRelayed(client))
     {
         NET_SV_PumpSendQueue(client);
         NET_SV_CheckDeadlock(client);
@@ -1854,13 +2115,55 @@ void NET_SV_Init(void)
 {
     int i;
 
+    //!
+    // @arg <n>
+    // @category net
+    //
+    // When running a server, relay the game to up to <n> spectators
+    // (drones). Spectators are fed from the completed tics and do not
+    // take part in the lockstep, so a slow spectator can't hold up the
+    // players.
+    //
+
+    i = M_CheckParmWithArgs("-relay", 1);
+
+    if (i > 0)
+    {
+        relay_max_drones = atoi(myargv[i + 1]);
+
+        if (relay_max_drones < 1 || relay_max_drones > MAXRELAYNODES)
+        {
+            I_Error("Invalid number of relay spectators: %s (max %d)",
+                    myargv[i + 1], MAXRELAYNODES);
+        }
+    }
+    else
+    {
+        relay_max_drones = 0;
+    }
+
+    //!
+    // @arg <demo>
+    // @category net
+    //
+    // When running a server, record each game to a demo. The demo is
+    // written as the game runs, in the format of the game being played.
+    //
+
+    i = M_CheckParmWithArgs("-svrecord", 1);
+
+    if (i > 0)
+    {
+        sv_demoname = myargv[i + 1];
+    }
+
     // initialize send/receive context
 
     server_context = NET_NewContext();
 
     // no clients yet
    
-    for (i=0; i<MAXNETNODES; ++i) 
+    for (i=0; i<MAXSVNODES; ++i) 
     {
         clients[i].active = false;
     }
@@ -1958,7 +2261,7 @@ void NET_SV_Run(void)
     // "Run" any clients that may have things to do, independent of responses
     // to received packets
 
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (clients[i].active)
         {
@@ -1985,6 +2288,11 @@ void NET_SV_Run(void)
                     NET_SV_CheckResends(sv_players[i]);
                 }
             }
+
+            if (relay_max_drones > 0)
+            {
+                NET_SV_RunRelay();
+            }
             break;
     }
 }
@@ -2002,9 +2310,11 @@ void NET_SV_Shutdown(void)
     
     fprintf(stderr, "SV: Shutting down server...\n");
 
+    NET_Demo_Stop();
+
     // Disconnect all clients
     
-    for (i=0; i<MAXNETNODES; ++i)
+    for (i=0; i<MAXSVNODES; ++i)
     {
         if (clients[i].active)
         {
@@ -2023,7 +2333,7 @@ void NET_SV_Shutdown(void)
 
         running = false;
 
-        for (i=0; i<MAXNETNODES; ++i)
+        for (i=0; i<MAXSVNODES; ++i)
         {
             if (clients[i].active)
             {
@@ -0,0 +1,1516 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Network simulation driver. Runs the real server and client code
+//     in-process, connected through an in-memory transport that can be
+//     impaired with -netimpair, and reports tic latency, stalls and
+//     bandwidth for each client.
+//
+//     Client 0 is the real client in net_client.cpp, driven the way
+//     NetUpdate() drives it, including its network thread. The client
+//     code can only run once in a process, so the other players are
+//     simulated peers: they speak the same protocol but only keep the
+//     state needed to follow the game. They generate and consume
+//     ticcmds in real time without running a game.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "doomtype.hpp"
+#include "d_loop.hpp"
+#include "d_mode.hpp"
+#include "i_system.hpp"
+#include "i_timer.hpp"
+#include "m_argv.hpp"
+#include "m_misc.hpp"
+#include "net_client.hpp"
+#include "net_common.hpp"
+#include "net_defs.hpp"
+#include "net_impair.hpp"
+#include "net_io.hpp"
+#include "net_packet.hpp"
+#include "net_server.hpp"
+#include "net_structrw.hpp"
+#include "z_zone.hpp"
+#include "../utils/memory.hpp"
+#include "../utils/spsc_queue.hpp"
+
+// Tics are generated at this rate, as in the game.
+
+#define TICRATE 35
+
+// Clients do not build tics more than this far ahead of the game,
+// like BuildNewTic() in d_loop.cpp with new_sync.
+
+#define MAX_TICS_AHEAD 8
+
+// Latency histogram resolution: one bucket per millisecond.
+
+#define LATENCY_BUCKETS 4000
+
+// The client that runs net_client.cpp.
+
+#define REAL_CLIENT 0
+
+// Largest packet passed to the real client.
+
+#define MAX_PACKET_LEN 1500
+
+typedef enum
+{
+    SIM_CONNECTING,
+    SIM_WAITING_LAUNCH,
+    SIM_WAITING_START,
+    SIM_IN_GAME,
+    SIM_DISCONNECTED,
+} sim_state_t;
+
+typedef struct sim_packet_s sim_packet_t;
+
+struct sim_packet_s
+{
+    net_packet_t *packet;
+    int client;
+    sim_packet_t *next;
+};
+
+typedef struct
+{
+    sim_packet_t *head;
+    sim_packet_t **tail;
+} sim_queue_t;
+
+// Packets for the real client are passed through a queue that does not
+// allocate, as its network thread may be the one receiving them.
+
+typedef struct
+{
+    unsigned int len;
+    byte data[MAX_PACKET_LEN];
+} sim_raw_packet_t;
+
+typedef struct
+{
+    int index;
+    sim_state_t state;
+    net_connection_t connection;
+    net_gamesettings_t settings;
+    net_waitdata_t wait_data;
+    boolean received_wait_data;
+    boolean sent_launch;
+    int syn_time;
+    unsigned int rand_state;
+
+    // Send side: ticcmd diffs we have generated.
+
+    ticcmd_t last_ticcmd;
+    net_ticdiff_t send_queue[BACKUPTICS];
+    int send_seq[BACKUPTICS];
+    int send_time[BACKUPTICS];
+    int maketic;
+
+    // Receive side: which tics have arrived from the server.
+
+    int recvwindow_start;
+    boolean recv_active[BACKUPTICS];
+    int recv_resend_time[BACKUPTICS];
+    boolean need_to_acknowledge;
+    int gamedata_recv_time;
+    int last_latency;
+    net_redundancy_t redundancy;
+
+    // Game progress.
+
+    int start_time;
+    int lasttic;
+    int gametic;
+    boolean stalled;
+    int stall_start;
+
+    // Statistics.
+
+    unsigned int latency_hist[LATENCY_BUCKETS];
+    unsigned int latency_count;
+    double latency_sum;
+    int latency_max;
+    unsigned int stalls;
+    int stall_time;
+    unsigned int bytes_sent;
+    unsigned int bytes_recv;
+    unsigned int packets_sent;
+    unsigned int packets_recv;
+    unsigned int resends_sent;
+} sim_client_t;
+
+static sim_client_t sim_clients[MAXNETNODES];
+static int num_sim_clients;
+static int sim_extratics;
+static boolean sim_legacy_tics;
+static boolean sim_held_keys;
+
+static sim_queue_t server_queue;
+static sim_queue_t client_queues[MAXNETNODES];
+static spsc_queue<sim_raw_packet_t, 256> real_client_queue;
+
+// The real client's main loop is stopped for stall_ms once a second.
+
+static int stall_ms;
+static int stall_time;
+
+// Address of each client as seen by the server, and of the server as
+// seen by each client. The handle is the client index.
+
+static net_addr_t server_side_addrs[MAXNETNODES];
+static net_addr_t client_side_addrs[MAXNETNODES];
+
+// Clock adjustment made by the real client, and used by NetUpdate().
+
+fixed_t offsetms;
+
+//-----------------------------------------------------------------------------
+//
+// In-memory transport
+//
+//-----------------------------------------------------------------------------
+
+static void QueueInit(sim_queue_t *queue)
+{
+    queue->head = nullptr;
+    queue->tail = &queue->head;
+}
+
+static void QueuePush(sim_queue_t *queue, net_packet_t *packet, int client)
+{
+    sim_packet_t *entry;
+
+    entry = zmalloc<decltype(entry)>(sizeof(sim_packet_t), PU_STATIC, 0);
+    entry->packet = NET_PacketDup(packet);
+    entry->client = client;
+    entry->next = nullptr;
+
+    *queue->tail = entry;
+    queue->tail = &entry->next;
+}
+
+static net_packet_t *QueuePop(sim_queue_t *queue, int *client)
+{
+    sim_packet_t *entry;
+    net_packet_t *packet;
+
+    entry = queue->head;
+
+    if (entry == nullptr)
+    {
+        return nullptr;
+    }
+
+    queue->head = entry->next;
+
+    if (queue->head == nullptr)
+    {
+        queue->tail = &queue->head;
+    }
+
+    packet = entry->packet;
+    *client = entry->client;
+    Z_Free(entry);
+
+    return packet;
+}
+
+static int AddrIndex(net_addr_t *addr)
+{
+    return (int) (intptr_t) addr->handle;
+}
+
+static boolean SimInit(void)
+{
+    return true;
+}
+
+static void SimServerSend(net_addr_t *addr, net_packet_t *packet)
+{
+    int i;
+
+    if (addr == &net_broadcast_addr)
+    {
+        return;
+    }
+
+    i = AddrIndex(addr);
+    sim_clients[i].bytes_recv += packet->len;
+    ++sim_clients[i].packets_recv;
+
+    if (i == REAL_CLIENT)
+    {
+        sim_raw_packet_t *raw;
+
+        raw = real_client_queue.begin_push();
+
+        if (raw != nullptr && packet->len <= sizeof(raw->data))
+        {
+            memcpy(raw->data, packet->data, packet->len);
+            raw->len = packet->len;
+            real_client_queue.end_push();
+        }
+    }
+    else
+    {
+        QueuePush(&client_queues[i], packet, i);
+    }
+}
+
+static boolean SimServerRecv(net_addr_t **addr, net_packet_t **packet)
+{
+    int client;
+
+    *packet = QueuePop(&server_queue, &client);
+
+    if (*packet == nullptr)
+    {
+        return false;
+    }
+
+    *addr = &server_side_addrs[client];
+
+    return true;
+}
+
+static void SimClientSend(net_addr_t *addr, net_packet_t *packet)
+{
+    int i;
+
+    i = AddrIndex(addr);
+    sim_clients[i].bytes_sent += packet->len;
+    ++sim_clients[i].packets_sent;
+
+    if (packet->len >= 2
+     && ((packet->data[0] << 8) | packet->data[1])
+            == NET_PACKET_TYPE_GAMEDATA_RESEND)
+    {
+        ++sim_clients[i].resends_sent;
+    }
+
+    QueuePush(&server_queue, packet, i);
+}
+
+static boolean SimClientRecv(net_addr_t **addr, net_packet_t **packet)
+{
+    // Each simulated peer reads its own queue directly.
+
+    return false;
+}
+
+// Receive for the real client when it has no network thread.
+
+static boolean SimRealClientRecv(net_addr_t **addr, net_packet_t **packet)
+{
+    sim_raw_packet_t *raw;
+
+    raw = real_client_queue.front();
+
+    if (raw == nullptr)
+    {
+        return false;
+    }
+
+    *packet = NET_NewPacket(raw->len);
+    memcpy((*packet)->data, raw->data, raw->len);
+    (*packet)->len = raw->len;
+    real_client_queue.pop_front();
+
+    *addr = &client_side_addrs[REAL_CLIENT];
+
+    return true;
+}
+
+// Receive for the real client's network thread. Everything comes from
+// the server, so there is no sender to store.
+
+static int SimRealClientRecvRaw(net_packet_t *packet, net_raw_addr_t *from,
+                                int timeout_ms)
+{
+    sim_raw_packet_t *raw;
+
+    raw = real_client_queue.front();
+
+    // The simulated server runs on the main thread and doesn't wake
+    // anyone up; look again once a millisecond.
+
+    if (raw == nullptr && timeout_ms > 0)
+    {
+        I_Sleep(1);
+        raw = real_client_queue.front();
+    }
+
+    if (raw == nullptr)
+    {
+        return 0;
+    }
+
+    if (raw->len > packet->alloced)
+    {
+        real_client_queue.pop_front();
+        return -1;
+    }
+
+    memcpy(packet->data, raw->data, raw->len);
+    packet->len = raw->len;
+    packet->pos = 0;
+    real_client_queue.pop_front();
+
+    memset(from, 0, sizeof(net_raw_addr_t));
+
+    return 1;
+}
+
+static net_addr_t *SimFindRawAddress(net_raw_addr_t *from)
+{
+    return &client_side_addrs[REAL_CLIENT];
+}
+
+static void SimServerAddrToString(net_addr_t *addr, char *buffer,
+                                  int buffer_len)
+{
+    M_snprintf(buffer, buffer_len, "sim client %d", AddrIndex(addr));
+}
+
+static void SimClientAddrToString(net_addr_t *addr, char *buffer,
+                                  int buffer_len)
+{
+    M_snprintf(buffer, buffer_len, "sim server");
+}
+
+static void SimFreeAddress(net_addr_t *addr)
+{
+}
+
+static net_addr_t *SimResolveAddress(const char *address)
+{
+    return nullptr;
+}
+
+static net_module_t sim_server_module =
+{
+    SimInit,
+    SimInit,
+    SimServerSend,
+    SimServerRecv,
+    SimServerAddrToString,
+    SimFreeAddress,
+    SimResolveAddress,
+    nullptr,
+    nullptr,
+};
+
+static net_module_t sim_client_module =
+{
+    SimInit,
+    SimInit,
+    SimClientSend,
+    SimClientRecv,
+    SimClientAddrToString,
+    SimFreeAddress,
+    SimResolveAddress,
+    nullptr,
+    nullptr,
+};
+
+static net_module_t sim_real_client_module =
+{
+    SimInit,
+    SimInit,
+    SimClientSend,
+    SimRealClientRecv,
+    SimClientAddrToString,
+    SimFreeAddress,
+    SimResolveAddress,
+    SimRealClientRecvRaw,
+    SimFindRawAddress,
+};
+
+//-----------------------------------------------------------------------------
+//
+// Simulated clients
+//
+//-----------------------------------------------------------------------------
+
+static unsigned int Random(sim_client_t *client)
+{
+    unsigned int x = client->rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    client->rand_state = x;
+
+    return x;
+}
+
+static void SimConnectData(net_connect_data_t *data)
+{
+    memset(data, 0, sizeof(net_connect_data_t));
+    data->gamemode = GameMode_t::registered;
+    data->gamemission = GameMission_t::doom;
+    data->max_players = num_sim_clients;
+}
+
+static void SimGameSettings(net_gamesettings_t *settings)
+{
+    memset(settings, 0, sizeof(net_gamesettings_t));
+    settings->ticdup = 1;
+    settings->extratics = sim_extratics;
+    settings->episode = 1;
+    settings->map = 1;
+    settings->skill = skill_t::sk_medium;
+    settings->gameversion = GameVersion_t::exe_doom_1_9;
+    settings->new_sync = 1;
+    settings->loadgame = -1;
+    settings->num_players = num_sim_clients;
+}
+
+static void SimCL_SendSYN(sim_client_t *client)
+{
+    net_connect_data_t data;
+    net_packet_t *packet;
+    char name[16];
+
+    SimConnectData(&data);
+    M_snprintf(name, sizeof(name), "sim%d", client->index);
+
+    packet = NET_NewPacket(10);
+    NET_WriteInt16(packet, NET_PACKET_TYPE_SYN);
+    NET_WriteInt32(packet, NET_MAGIC_NUMBER);
+    NET_WriteString(packet, PACKAGE_STRING);
+    if (sim_legacy_tics)
+    {
+        NET_WriteInt8(packet, 1);
+        NET_WriteProtocol(packet, NET_PROTOCOL_CHOCOLATE_DOOM_0);
+    }
+    else
+    {
+        NET_WriteProtocolList(packet);
+    }
+    NET_WriteConnectData(packet, &data);
+    NET_WriteString(packet, name);
+    NET_Conn_SendPacket(&client->connection, packet);
+    NET_FreePacket(packet);
+
+    client->syn_time = I_GetTimeMS();
+}
+
+static void SimCL_SendGameStart(sim_client_t *client)
+{
+    net_gamesettings_t settings;
+    net_packet_t *packet;
+
+    SimGameSettings(&settings);
+
+    packet = NET_Conn_NewReliable(&client->connection,
+                                  NET_PACKET_TYPE_GAMESTART);
+    NET_WriteSettings(packet, &settings);
+}
+
+static void SimCL_SendTics(sim_client_t *client, int start, int end)
+{
+    net_ticdiff_t *diffs[BACKUPTICS];
+    net_packet_t *packet;
+    int i;
+
+    if (start < 0)
+    {
+        start = 0;
+    }
+
+    packet = NET_NewPacket(512);
+    NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA);
+    NET_WriteInt8(packet, client->recvwindow_start & 0xff);
+    NET_WriteInt8(packet, start & 0xff);
+    NET_WriteInt8(packet, end - start + 1);
+
+    for (i = start; i <= end; ++i)
+    {
+        diffs[i - start] = &client->send_queue[i % BACKUPTICS];
+    }
+
+    NET_WriteTiccmdDiffs(packet, client->connection.protocol,
+                         client->last_latency, diffs, end - start + 1,
+                         client->settings.lowres_turn);
+
+    NET_Conn_SendPacket(&client->connection, packet);
+    NET_FreePacket(packet);
+
+    client->need_to_acknowledge = false;
+}
+
+static void SimCL_SendAck(sim_client_t *client)
+{
+    net_packet_t *packet;
+
+    packet = NET_NewPacket(10);
+    NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_ACK);
+    NET_WriteInt8(packet, client->recvwindow_start & 0xff);
+    NET_Conn_SendPacket(&client->connection, packet);
+    NET_FreePacket(packet);
+
+    client->need_to_acknowledge = false;
+}
+
+static void SimCL_SendResendRequest(sim_client_t *client, int start, int end)
+{
+    net_packet_t *packet;
+    int nowtime;
+    int i, index;
+
+    packet = NET_NewPacket(64);
+    NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
+    NET_WriteInt32(packet, start);
+    NET_WriteInt8(packet, end - start + 1);
+    NET_Conn_SendPacket(&client->connection, packet);
+    NET_FreePacket(packet);
+
+    nowtime = I_GetTimeMS();
+
+    for (i = start; i <= end; ++i)
+    {
+        index = i - client->recvwindow_start;
+
+        if (index >= 0 && index < BACKUPTICS)
+        {
+            client->recv_resend_time[index] = nowtime;
+        }
+    }
+}
+
+// Generate a ticcmd for a player that holds movement keys down for a
+// while and turns the mouse smoothly.
+
+static void SimCL_MakeHeldTiccmd(sim_client_t *client, ticcmd_t *cmd)
+{
+    // Speeds are the walk and run speeds from g_game.cpp.
+
+    if ((Random(client) % 12) == 0)
+    {
+        static const signed char forward[] = { 0, 25, 50, -25, -50 };
+
+        cmd->forwardmove = forward[Random(client) % arrlen(forward)];
+    }
+    if ((Random(client) % 24) == 0)
+    {
+        static const signed char side[] = { 0, 24, 40, -24, -40 };
+
+        cmd->sidemove = side[Random(client) % arrlen(side)];
+    }
+    if ((Random(client) % 4) != 0)
+    {
+        // Mouse turning: the speed drifts smoothly from tic to tic.
+
+        int turn = cmd->angleturn + ((int) (Random(client) % 49) - 24) * 8;
+
+        if (turn < -1280)
+        {
+            turn = -1280;
+        }
+        else if (turn > 1280)
+        {
+            turn = 1280;
+        }
+
+        cmd->angleturn = (short) turn;
+    }
+    if ((Random(client) % 16) == 0)
+    {
+        cmd->buttons = Random(client) & 0x07;
+    }
+
+    // The consistency check is the low byte of the player's position,
+    // which changes whenever they move.
+
+    if (cmd->forwardmove != 0 || cmd->sidemove != 0)
+    {
+        cmd->consistancy = (byte) Random(client);
+    }
+}
+
+// Generate a ticcmd for the next tic: a random walk, so that the diffs
+// on the wire look like those of a real player.
+
+static void SimCL_MakeTiccmd(sim_client_t *client, ticcmd_t *result)
+{
+    ticcmd_t cmd;
+
+    cmd = client->last_ticcmd;
+
+    if (sim_held_keys)
+    {
+        SimCL_MakeHeldTiccmd(client, &cmd);
+        *result = cmd;
+        return;
+    }
+
+    if ((Random(client) % 4) == 0)
+    {
+        cmd.forwardmove = (signed char) ((int) (Random(client) % 101) - 50);
+    }
+    if ((Random(client) % 8) == 0)
+    {
+        cmd.sidemove = (signed char) ((int) (Random(client) % 81) - 40);
+    }
+    if ((Random(client) % 2) == 0)
+    {
+        cmd.angleturn = (short) ((int) (Random(client) % 2561) - 1280);
+    }
+    if ((Random(client) % 16) == 0)
+    {
+        cmd.buttons = Random(client) & 0x07;
+    }
+
+    *result = cmd;
+}
+
+static void SimCL_BuildTic(sim_client_t *client)
+{
+    ticcmd_t cmd;
+    int maketic;
+
+    SimCL_MakeTiccmd(client, &cmd);
+
+    maketic = client->maketic;
+    client->send_seq[maketic % BACKUPTICS] = maketic;
+    client->send_time[maketic % BACKUPTICS] = I_GetTimeMS();
+
+    if (client->index == REAL_CLIENT)
+    {
+        NET_CL_SendTiccmd(&cmd, maketic);
+    }
+    else
+    {
+        NET_TiccmdDiff(&client->last_ticcmd, &cmd,
+                       &client->send_queue[maketic % BACKUPTICS]);
+        SimCL_SendTics(client,
+                       maketic - NET_Redundancy_ExtraTics(&client->redundancy,
+                                                          client->settings.extratics,
+                                                          "sim"),
+                       maketic);
+    }
+
+    client->last_ticcmd = cmd;
+    ++client->maketic;
+}
+
+static void SimCL_RecordLatency(sim_client_t *client, int seq)
+{
+    int latency;
+
+    if (client->send_seq[seq % BACKUPTICS] != seq || seq >= client->maketic)
+    {
+        return;
+    }
+
+    latency = I_GetTimeMS() - client->send_time[seq % BACKUPTICS];
+
+    if (latency < 0)
+    {
+        latency = 0;
+    }
+
+    client->last_latency = latency;
+    client->latency_sum += latency;
+    ++client->latency_count;
+
+    if (latency > client->latency_max)
+    {
+        client->latency_max = latency;
+    }
+
+    if (latency >= LATENCY_BUCKETS)
+    {
+        latency = LATENCY_BUCKETS - 1;
+    }
+
+    ++client->latency_hist[latency];
+}
+
+static void SimCL_AdvanceWindow(sim_client_t *client)
+{
+    while (client->recv_active[0])
+    {
+        memmove(client->recv_active, client->recv_active + 1,
+                sizeof(boolean) * (BACKUPTICS - 1));
+        memmove(client->recv_resend_time, client->recv_resend_time + 1,
+                sizeof(int) * (BACKUPTICS - 1));
+        client->recv_active[BACKUPTICS - 1] = false;
+        client->recv_resend_time[BACKUPTICS - 1] = 0;
+        ++client->recvwindow_start;
+    }
+}
+
+static void SimCL_ParseGameData(sim_client_t *client, net_packet_t *packet)
+{
+    net_ticstream_t stream;
+    net_full_ticcmd_t cmd;
+    unsigned int seq, num_tics;
+    int resend_start, resend_end;
+    int index;
+    unsigned int i;
+
+    if (!NET_ReadInt8(packet, &seq) || !NET_ReadInt8(packet, &num_tics))
+    {
+        return;
+    }
+
+    if (!client->need_to_acknowledge)
+    {
+        client->need_to_acknowledge = true;
+        client->gamedata_recv_time = I_GetTimeMS();
+    }
+
+    seq = NET_ExpandTicNum(client->recvwindow_start, seq);
+    NET_Redundancy_PacketReceived(&client->redundancy, seq, num_tics);
+    NET_InitTicStream(&stream, packet, client->connection.protocol,
+                      client->settings.lowres_turn);
+
+    for (i = 0; i < num_tics; ++i)
+    {
+        if (!NET_ReadStreamFullTiccmd(&stream, &cmd))
+        {
+            return;
+        }
+
+        index = seq - client->recvwindow_start + i;
+
+        if (index < 0 || index >= BACKUPTICS)
+        {
+            continue;
+        }
+
+        NET_Redundancy_TicReceived(&client->redundancy,
+                                   client->recv_active[index],
+                                   i == num_tics - 1);
+
+        if (!client->recv_active[index])
+        {
+            client->recv_active[index] = true;
+            SimCL_RecordLatency(client, seq + i);
+        }
+    }
+
+    // Request a resend of any gap before this packet, as the real
+    // client does.
+
+    resend_end = seq - client->recvwindow_start;
+
+    if (resend_end > 0)
+    {
+        if (resend_end >= BACKUPTICS)
+        {
+            resend_end = BACKUPTICS - 1;
+        }
+
+        resend_start = resend_end;
+
+        for (index = resend_end - 1; index >= 0; --index)
+        {
+            if (client->recv_active[index]
+             || client->recv_resend_time[index] != 0)
+            {
+                break;
+            }
+
+            resend_start = index;
+        }
+
+        if (resend_start < resend_end)
+        {
+            SimCL_SendResendRequest(client,
+                                    client->recvwindow_start + resend_start,
+                                    client->recvwindow_start + resend_end - 1);
+        }
+    }
+
+    SimCL_AdvanceWindow(client);
+}
+
+static void SimCL_ParseResendRequest(sim_client_t *client,
+                                     net_packet_t *packet)
+{
+    unsigned int start, num_tics;
+    int end;
+
+    if (!NET_ReadInt32(packet, &start) || !NET_ReadInt8(packet, &num_tics))
+    {
+        return;
+    }
+
+    NET_Redundancy_ResendRequested(&client->redundancy);
+
+    end = start + num_tics - 1;
+
+    while ((int) start <= end
+        && client->send_seq[start % BACKUPTICS] != (int) start)
+    {
+        ++start;
+    }
+
+    while ((int) start <= end && client->send_seq[end % BACKUPTICS] != end)
+    {
+        --end;
+    }
+
+    if ((int) start <= end)
+    {
+        SimCL_SendTics(client, start, end);
+    }
+}
+
+static void SimCL_CheckResends(sim_client_t *client)
+{
+    int nowtime;
+    int start, i;
+
+    nowtime = I_GetTimeMS();
+    start = -1;
+
+    for (i = 0; i <= BACKUPTICS; ++i)
+    {
+        boolean need_resend;
+
+        need_resend = i < BACKUPTICS
+                   && !client->recv_active[i]
+                   && client->recv_resend_time[i] != 0
+                   && nowtime > client->recv_resend_time[i] + 300;
+
+        // Break deadlocks where everything in flight has been lost.
+
+        if (i == 0 && !client->recv_active[0]
+         && client->recv_resend_time[0] == 0
+         && nowtime - client->gamedata_recv_time > 1000)
+        {
+            need_resend = true;
+        }
+
+        if (need_resend && start < 0)
+        {
+            start = i;
+        }
+        else if (!need_resend && start >= 0)
+        {
+            SimCL_SendResendRequest(client, client->recvwindow_start + start,
+                                    client->recvwindow_start + i - 1);
+            start = -1;
+        }
+    }
+
+    if (client->need_to_acknowledge
+     && nowtime - client->gamedata_recv_time > 200)
+    {
+        SimCL_SendAck(client);
+    }
+}
+
+static void SimCL_ParsePacket(sim_client_t *client, net_packet_t *packet)
+{
+    unsigned int packet_type;
+    net_waitdata_t wait_data;
+    char *msg;
+
+    if (!NET_ReadInt16(packet, &packet_type))
+    {
+        return;
+    }
+
+    if (NET_Conn_Packet(&client->connection, packet, &packet_type))
+    {
+        return;
+    }
+
+    switch (packet_type)
+    {
+        case NET_PACKET_TYPE_SYN:
+            if (NET_ReadSafeString(packet) == nullptr)
+            {
+                break;
+            }
+            client->connection.protocol = NET_ReadProtocol(packet);
+            client->connection.state = NET_CONN_STATE_CONNECTED;
+            client->state = SIM_WAITING_LAUNCH;
+            break;
+
+        case NET_PACKET_TYPE_REJECTED:
+            msg = NET_ReadSafeString(packet);
+            I_Error("netsim: client %d rejected: %s", client->index,
+                    msg != nullptr ? msg : "(no reason)");
+            break;
+
+        case NET_PACKET_TYPE_WAITING_DATA:
+            if (NET_ReadWaitData(packet, &wait_data))
+            {
+                client->wait_data = wait_data;
+                client->received_wait_data = true;
+            }
+            break;
+
+        case NET_PACKET_TYPE_LAUNCH:
+            if (client->state == SIM_WAITING_LAUNCH)
+            {
+                client->state = SIM_WAITING_START;
+                SimCL_SendGameStart(client);
+            }
+            break;
+
+        case NET_PACKET_TYPE_GAMESTART:
+            if (client->state == SIM_WAITING_START
+             && NET_ReadSettings(packet, &client->settings))
+            {
+                client->state = SIM_IN_GAME;
+                client->start_time = I_GetTimeMS();
+                client->gamedata_recv_time = client->start_time;
+                NET_Redundancy_Init(&client->redundancy);
+            }
+            break;
+
+        case NET_PACKET_TYPE_GAMEDATA:
+            if (client->state == SIM_IN_GAME)
+            {
+                SimCL_ParseGameData(client, packet);
+            }
+            break;
+
+        case NET_PACKET_TYPE_GAMEDATA_RESEND:
+            if (client->state == SIM_IN_GAME)
+            {
+                SimCL_ParseResendRequest(client, packet);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Build tics as time passes and run the game as far as the tics that
+// have arrived allow. As in NetUpdate(), time that passes while we are
+// too far ahead of the server to build new tics is lost; that is a
+// stall.
+
+static void SimCL_RunGame(sim_client_t *client)
+{
+    int nowtime, adjusted, nowtic, newtics;
+
+    nowtime = I_GetTimeMS();
+
+    // The real client's clock is kept in step with the server, as in
+    // GetAdjustedTime().
+
+    adjusted = nowtime;
+
+    if (client->index == REAL_CLIENT)
+    {
+        adjusted += offsetms / FRACUNIT;
+    }
+
+    nowtic = ((adjusted - client->start_time) * TICRATE) / 1000;
+    newtics = nowtic - client->lasttic;
+    client->lasttic = nowtic;
+
+    while (newtics > 0 && client->maketic - client->gametic <= MAX_TICS_AHEAD)
+    {
+        SimCL_BuildTic(client);
+        --newtics;
+    }
+
+    while (client->gametic < client->maketic
+        && client->gametic < client->recvwindow_start)
+    {
+        ++client->gametic;
+    }
+
+    if (newtics > 0)
+    {
+        if (!client->stalled)
+        {
+            client->stalled = true;
+            client->stall_start = nowtime;
+            ++client->stalls;
+        }
+    }
+    else if (client->stalled
+          && client->maketic - client->gametic <= MAX_TICS_AHEAD)
+    {
+        client->stalled = false;
+        client->stall_time += nowtime - client->stall_start;
+    }
+
+    if (client->index != REAL_CLIENT)
+    {
+        SimCL_CheckResends(client);
+    }
+}
+
+static void SimCL_Run(sim_client_t *client)
+{
+    net_packet_t *packet;
+    int index;
+
+    while ((packet = QueuePop(&client_queues[client->index], &index))
+             != nullptr)
+    {
+        SimCL_ParsePacket(client, packet);
+        NET_FreePacket(packet);
+    }
+
+    NET_Conn_Run(&client->connection);
+
+    if (client->connection.state == NET_CONN_STATE_DISCONNECTED
+     || client->connection.state == NET_CONN_STATE_DISCONNECTED_SLEEP)
+    {
+        client->state = SIM_DISCONNECTED;
+        return;
+    }
+
+    // The controller (the first client to connect) launches the game
+    // once everyone has connected.
+
+    if (client->state == SIM_WAITING_LAUNCH && !client->sent_launch
+     && client->received_wait_data && client->wait_data.is_controller
+     && client->wait_data.num_players >= num_sim_clients)
+    {
+        NET_Conn_NewReliable(&client->connection, NET_PACKET_TYPE_LAUNCH);
+        client->sent_launch = true;
+    }
+
+    if (client->state == SIM_IN_GAME)
+    {
+        SimCL_RunGame(client);
+    }
+}
+
+static void SimCL_Init(sim_client_t *client, int index)
+{
+    memset(client, 0, sizeof(sim_client_t));
+
+    client->index = index;
+    client->state = SIM_CONNECTING;
+    client->rand_state = 0x12345 + index * 0x9e3779b9;
+    memset(client->send_seq, 0xff, sizeof(client->send_seq));
+
+    client_side_addrs[index].handle = (void *) (intptr_t) index;
+    server_side_addrs[index].module = &sim_server_module;
+    server_side_addrs[index].handle = (void *) (intptr_t) index;
+
+    if (index == REAL_CLIENT)
+    {
+        client_side_addrs[index].module = &sim_real_client_module;
+        real_client_queue.clear();
+    }
+    else
+    {
+        client_side_addrs[index].module = &sim_client_module;
+        QueueInit(&client_queues[index]);
+        NET_Conn_InitClient(&client->connection, &client_side_addrs[index],
+                            NET_PROTOCOL_UNKNOWN);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//
+// Real client
+//
+//-----------------------------------------------------------------------------
+
+// Called by net_client.cpp for each tic, in order, once the commands of
+// all players have arrived.
+
+void D_ReceiveTic(ticcmd_t *ticcmds, boolean *playeringame)
+{
+    sim_client_t *client = &sim_clients[REAL_CLIENT];
+
+    if (ticcmds == nullptr && playeringame == nullptr)
+    {
+        // Disconnected from the server.
+
+        client->state = SIM_DISCONNECTED;
+        return;
+    }
+
+    SimCL_RecordLatency(client, client->recvwindow_start);
+    ++client->recvwindow_start;
+}
+
+static void RealCL_Connect(sim_client_t *client)
+{
+    net_connect_data_t data;
+
+    SimConnectData(&data);
+    net_player_name = "sim0";
+
+    // This runs the server until we have connected. We connect before
+    // the peers, so that we are the controller.
+
+    if (!NET_CL_Connect(&client_side_addrs[REAL_CLIENT], &data))
+    {
+        I_Error("netsim: client %d failed to connect: %s", client->index,
+                net_client_reject_reason);
+    }
+
+    client->state = SIM_WAITING_LAUNCH;
+}
+
+// Run the real client as NetUpdate() would, except while its main loop
+// is being stalled with -stall.
+
+static void RealCL_Run(sim_client_t *client)
+{
+    net_gamesettings_t settings;
+    int nowtime;
+
+    if (client->state == SIM_IN_GAME && stall_ms > 0)
+    {
+        nowtime = I_GetTimeMS();
+
+        if (nowtime - stall_time >= 1000)
+        {
+            stall_time = nowtime;
+        }
+
+        if (nowtime - stall_time < stall_ms)
+        {
+            return;
+        }
+    }
+
+    NET_CL_Run();
+
+    if (!net_client_connected)
+    {
+        client->state = SIM_DISCONNECTED;
+        return;
+    }
+
+    switch (client->state)
+    {
+        case SIM_WAITING_LAUNCH:
+            if (!client->sent_launch && net_client_received_wait_data
+             && net_client_wait_data.is_controller
+             && net_client_wait_data.num_players >= num_sim_clients)
+            {
+                NET_CL_LaunchGame();
+                client->sent_launch = true;
+            }
+
+            if (!net_waiting_for_launch)
+            {
+                SimGameSettings(&settings);
+                NET_CL_StartGame(&settings);
+                client->state = SIM_WAITING_START;
+            }
+            break;
+
+        case SIM_WAITING_START:
+            if (NET_CL_GetSettings(&client->settings))
+            {
+                client->state = SIM_IN_GAME;
+                client->start_time = I_GetTimeMS();
+                stall_time = client->start_time;
+            }
+            break;
+
+        case SIM_IN_GAME:
+            SimCL_RunGame(client);
+            break;
+
+        default:
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//
+// Driver
+//
+//-----------------------------------------------------------------------------
+
+static void RunAll(void)
+{
+    int i;
+
+    NET_SV_Run();
+
+    for (i = 0; i < num_sim_clients; ++i)
+    {
+        if (i == REAL_CLIENT)
+        {
+            RealCL_Run(&sim_clients[i]);
+        }
+        else
+        {
+            SimCL_Run(&sim_clients[i]);
+        }
+    }
+
+    I_Sleep(1);
+}
+
+static boolean AllInState(sim_state_t state)
+{
+    int i;
+
+    for (i = 0; i < num_sim_clients; ++i)
+    {
+        if (sim_clients[i].state != state)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int LatencyPercentile(sim_client_t *client, int percent)
+{
+    unsigned int target, count;
+    int i;
+
+    target = (client->latency_count * percent + 99) / 100;
+    count = 0;
+
+    for (i = 0; i < LATENCY_BUCKETS; ++i)
+    {
+        count += client->latency_hist[i];
+
+        if (count >= target && count > 0)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+static void PrintReport(net_module_t *server_module, int duration_ms)
+{
+    net_impair_stats_t stats;
+    sim_client_t *client;
+    int i;
+
+    printf("\n%-6s %6s %7s %5s %5s %5s %6s %8s %8s %8s %7s\n",
+           "client", "tics", "latency", "p50", "p95", "max", "stalls",
+           "stall ms", "up B/s", "down B/s", "resends");
+
+    for (i = 0; i < num_sim_clients; ++i)
+    {
+        client = &sim_clients[i];
+
+        if (client->stalled)
+        {
+            client->stall_time += I_GetTimeMS() - client->stall_start;
+        }
+
+        printf("%-6d %6d %7.1f %5d %5d %5d %6u %8d %8u %8u %7u\n",
+               i, client->gametic,
+               client->latency_count > 0
+                   ? client->latency_sum / client->latency_count : 0.0,
+               LatencyPercentile(client, 50), LatencyPercentile(client, 95),
+               client->latency_max, client->stalls, client->stall_time,
+               (unsigned int) (client->bytes_sent * 1000.0 / duration_ms),
+               (unsigned int) (client->bytes_recv * 1000.0 / duration_ms),
+               client->resends_sent);
+    }
+
+    if (NET_Impair_GetStats(server_module, &stats))
+    {
+        printf("\nimpairment: %u packets, %u bytes, %u dropped, "
+               "%u duplicated, %u reordered, %u over capacity\n",
+               stats.packets, stats.bytes, stats.dropped, stats.duplicated,
+               stats.reordered, stats.overflowed);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    net_module_t *server_module;
+    int duration, start_time, game_time;
+    int i, p;
+
+    myargc = argc;
+    myargv = argv;
+
+    Z_Init();
+    I_InitTimer();
+    NET_OpenLog();
+
+    //!
+    // @arg <n>
+    //
+    // Number of simulated clients (default 4).
+    //
+
+    num_sim_clients = 4;
+    p = M_CheckParmWithArgs("-clients", 1);
+    if (p > 0)
+    {
+        num_sim_clients = atoi(myargv[p + 1]);
+    }
+
+    if (num_sim_clients < 1 || num_sim_clients > NET_MAXPLAYERS)
+    {
+        I_Error("netsim: number of clients must be 1-%d", NET_MAXPLAYERS);
+    }
+
+    //!
+    // @arg <secs>
+    //
+    // Length of the simulated game in seconds (default 30).
+    //
+
+    duration = 30;
+    p = M_CheckParmWithArgs("-duration", 1);
+    if (p > 0)
+    {
+        duration = atoi(myargv[p + 1]);
+    }
+
+    sim_extratics = 1;
+    p = M_CheckParmWithArgs("-extratics", 1);
+    if (p > 0)
+    {
+        sim_extratics = atoi(myargv[p + 1]);
+    }
+
+    //!
+    //
+    // Only offer the original protocol, so that ticcmds are sent with
+    // the unpacked encoding. This covers the real client as well.
+    //
+
+    sim_legacy_tics = M_ParmExists("-legacytics");
+
+    //!
+    //
+    // Simulate players that hold movement keys down and turn the mouse
+    // smoothly, instead of the default random walk.
+    //
+
+    sim_held_keys = M_ParmExists("-heldkeys");
+
+    //!
+    // @arg <ms>
+    //
+    // Stop the main loop of client 0, the one running the real client
+    // code, for the given time once a second, as a slow frame or a
+    // level load would.
+    //
+
+    stall_ms = 0;
+    p = M_CheckParmWithArgs("-stall", 1);
+    if (p > 0)
+    {
+        stall_ms = atoi(myargv[p + 1]);
+    }
+
+    if (stall_ms < 0 || stall_ms >= 1000)
+    {
+        I_Error("netsim: stall time must be 0-999 ms");
+    }
+
+    // Set up the server, with the impairment layer (if -netimpair is
+    // given) between it and the clients.
+
+    QueueInit(&server_queue);
+    NET_SV_Init();
+    server_module = NET_Impair_CheckModule(&sim_server_module);
+    NET_SV_AddModule(server_module);
+
+    for (i = 0; i < num_sim_clients; ++i)
+    {
+        SimCL_Init(&sim_clients[i], i);
+    }
+
+    RealCL_Connect(&sim_clients[REAL_CLIENT]);
+
+    for (i = 0; i < num_sim_clients; ++i)
+    {
+        if (i != REAL_CLIENT)
+        {
+            SimCL_SendSYN(&sim_clients[i]);
+        }
+    }
+
+    // Connect and start the game.
+
+    start_time = I_GetTimeMS();
+
+    while (!AllInState(SIM_IN_GAME))
+    {
+        if (I_GetTimeMS() - start_time > 10000)
+        {
+            I_Error("netsim: timed out waiting for the game to start");
+        }
+
+        for (i = 0; i < num_sim_clients; ++i)
+        {
+            if (i != REAL_CLIENT && sim_clients[i].state == SIM_CONNECTING
+             && I_GetTimeMS() - sim_clients[i].syn_time > 1000)
+            {
+                SimCL_SendSYN(&sim_clients[i]);
+            }
+        }
+
+        RunAll();
+    }
+
+    printf("netsim: %d clients in game, running for %d seconds\n",
+           num_sim_clients, duration);
+
+    // Run the game.
+
+    start_time = I_GetTimeMS();
+
+    while (I_GetTimeMS() - start_time < duration * 1000)
+    {
+        RunAll();
+    }
+
+    game_time = I_GetTimeMS() - start_time;
+
+    PrintReport(server_module, game_time);
+
+    // Disconnect cleanly, so that the log shows the whole session. The
+    // real client waits for its own disconnect to finish.
+
+    for (i = 0; i < num_sim_clients; ++i)
+    {
+        if (i != REAL_CLIENT)
+        {
+            NET_Conn_Disconnect(&sim_clients[i].connection);
+        }
+    }
+
+    NET_CL_Disconnect();
+    sim_clients[REAL_CLIENT].state = SIM_DISCONNECTED;
+
+    start_time = I_GetTimeMS();
+
+    while (!AllInState(SIM_DISCONNECTED)
+        && I_GetTimeMS() - start_time < 5000)
+    {
+        RunAll();
+    }
+
+    return 0;
+}
+
@@ -32,6 +32,7 @@ static struct
     const char *name;
 } protocol_names[] = {
     {NET_PROTOCOL_CHOCOLATE_DOOM_0, "CHOCOLATE_DOOM_0"},
+    {NET_PROTOCOL_CRISPY_DOOM_PACKED_1, "CRISPY_DOOM_PACKED_1"},
 };
 
 void NET_WriteConnectData(net_packet_t *packet, net_connect_data_t *data)
@@ -457,6 +458,625 @@ void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean l
     }
 }
 
+//
+// Bit-packed tic streams
+//
+// Layout of a packed stream (all fields MSB first, padded to a whole
+// byte at the end):
+//
+//   diffs (client -> server):  latency, then one slot per tic
+//   full ticcmds (server -> client): per tic: latency, playeringame,
+//                                    then one slot per player in game
+//
+// Before the first slot of a run, an Exp-Golomb code gives the number
+// of consecutive slots (across tics and players) whose diff is empty;
+// those slots take no further space. A non-empty slot is the flags
+// (as an Exp-Golomb code of the XOR with this player's previous flags
+// in the packet) followed by the changed fields. Movement, turning and latency are
+// written as deltas from the previous value in the packet.
+//
+
+// Exp-Golomb orders for the delta coded fields.
+
+#define PACK_K_LATENCY    3
+#define PACK_K_MOVE       2
+#define PACK_K_TURN_LOW   2
+#define PACK_K_TURN       5
+
+// Longest Exp-Golomb prefix we will accept when reading.
+
+#define PACK_MAX_ZEROS    24
+
+boolean NET_PackedTics(net_protocol_t protocol)
+{
+    return protocol == NET_PROTOCOL_CRISPY_DOOM_PACKED_1;
+}
+
+void NET_InitTicStream(net_ticstream_t *stream, net_packet_t *packet,
+                       net_protocol_t protocol, boolean lowres_turn)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->packet = packet;
+    stream->protocol = protocol;
+    stream->lowres_turn = lowres_turn;
+    stream->need_run = true;
+}
+
+static int SignExtend(unsigned int value, int width)
+{
+    unsigned int sign = 1U << (width - 1);
+
+    value &= (sign << 1) - 1;
+
+    return static_cast<int>(value ^ sign) - static_cast<int>(sign);
+}
+
+static void PutBits(net_ticstream_t *stream, unsigned int value, int n)
+{
+    if (n <= 0)
+    {
+        return;
+    }
+
+    stream->bits = (stream->bits << n) | (value & ((1ULL << n) - 1));
+    stream->num_bits += n;
+
+    while (stream->num_bits >= 8)
+    {
+        stream->num_bits -= 8;
+        NET_WriteInt8(stream->packet,
+                      static_cast<unsigned int>(stream->bits
+                                                >> stream->num_bits) & 0xff);
+    }
+}
+
+static void FlushBits(net_ticstream_t *stream)
+{
+    if (stream->num_bits > 0)
+    {
+        PutBits(stream, 0, 8 - stream->num_bits);
+    }
+}
+
+static boolean GetBits(net_ticstream_t *stream, unsigned int *value, int n)
+{
+    unsigned int b;
+
+    while (stream->num_bits < n)
+    {
+        if (!NET_ReadInt8(stream->packet, &b))
+        {
+            return false;
+        }
+
+        stream->bits = (stream->bits << 8) | b;
+        stream->num_bits += 8;
+    }
+
+    stream->num_bits -= n;
+    *value = static_cast<unsigned int>(stream->bits >> stream->num_bits)
+           & static_cast<unsigned int>((1ULL << n) - 1);
+
+    return true;
+}
+
+static int BitLength(unsigned int value)
+{
+    int result = 0;
+
+    while (value != 0)
+    {
+        ++result;
+        value >>= 1;
+    }
+
+    return result;
+}
+
+static void PutExpGolomb(net_ticstream_t *stream, unsigned int value, int k)
+{
+    unsigned int m = value + (1U << k);
+    int len = BitLength(m);
+
+    PutBits(stream, 0, len - k - 1);
+    PutBits(stream, m, len);
+}
+
+static boolean GetExpGolomb(net_ticstream_t *stream, unsigned int *value,
+                            int k)
+{
+    unsigned int bit, rest;
+    int zeros = 0;
+
+    for (;;)
+    {
+        if (!GetBits(stream, &bit, 1))
+        {
+            return false;
+        }
+        if (bit)
+        {
+            break;
+        }
+        if (++zeros > PACK_MAX_ZEROS)
+        {
+            return false;
+        }
+    }
+
+    rest = 0;
+
+    if (zeros + k > 0 && !GetBits(stream, &rest, zeros + k))
+    {
+        return false;
+    }
+
+    *value = ((1U << (zeros + k)) | rest) - (1U << k);
+
+    return true;
+}
+
+// A signed delta is written either as a zigzag Exp-Golomb code or as a
+// raw field of the given width, whichever is shorter, with one bit to
+// say which.
+
+static void PutDelta(net_ticstream_t *stream, int delta, int width, int k)
+{
+    unsigned int zz = (static_cast<unsigned int>(delta) << 1)
+                    ^ static_cast<unsigned int>(delta >> 31);
+    int golomb_len = 2 * BitLength(zz + (1U << k)) - k - 1;
+
+    if (golomb_len < width)
+    {
+        PutBits(stream, 1, 1);
+        PutExpGolomb(stream, zz, k);
+    }
+    else
+    {
+        PutBits(stream, 0, 1);
+        PutBits(stream, static_cast<unsigned int>(delta), width);
+    }
+}
+
+static boolean GetDelta(net_ticstream_t *stream, int *delta, int width, int k)
+{
+    unsigned int golomb, value;
+
+    if (!GetBits(stream, &golomb, 1))
+    {
+        return false;
+    }
+
+    if (golomb)
+    {
+        if (!GetExpGolomb(stream, &value, k))
+        {
+            return false;
+        }
+
+        *delta = static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+    }
+    else
+    {
+        if (!GetBits(stream, &value, width))
+        {
+            return false;
+        }
+
+        *delta = SignExtend(value, width);
+    }
+
+    return true;
+}
+
+static void PutTurn(net_ticstream_t *stream, ticcmd_t *last, ticcmd_t *cmd)
+{
+    if (stream->lowres_turn)
+    {
+        int turn = SignExtend(cmd->angleturn / 256, 8);
+
+        PutDelta(stream, SignExtend(turn - last->angleturn / 256, 8),
+                 8, PACK_K_TURN_LOW);
+        last->angleturn = turn * 256;
+    }
+    else
+    {
+        PutDelta(stream, SignExtend(cmd->angleturn - last->angleturn, 16),
+                 16, PACK_K_TURN);
+        last->angleturn = cmd->angleturn;
+    }
+}
+
+static boolean GetTurn(net_ticstream_t *stream, ticcmd_t *last)
+{
+    int delta;
+
+    if (stream->lowres_turn)
+    {
+        if (!GetDelta(stream, &delta, 8, PACK_K_TURN_LOW))
+        {
+            return false;
+        }
+
+        last->angleturn = SignExtend(last->angleturn / 256 + delta, 8) * 256;
+    }
+    else
+    {
+        if (!GetDelta(stream, &delta, 16, PACK_K_TURN))
+        {
+            return false;
+        }
+
+        last->angleturn = SignExtend(last->angleturn + delta, 16);
+    }
+
+    return true;
+}
+
+static void PutTiccmdDiff(net_ticstream_t *stream, int player,
+                          net_ticdiff_t *diff)
+{
+    ticcmd_t *last = &stream->last_cmd[player];
+    ticcmd_t *cmd = &diff->cmd;
+
+    PutExpGolomb(stream, diff->diff ^ stream->last_diff[player], 0);
+    stream->last_diff[player] = diff->diff;
+
+    if (diff->diff & NET_TICDIFF_FORWARD)
+    {
+        PutDelta(stream, SignExtend(cmd->forwardmove - last->forwardmove, 8),
+                 8, PACK_K_MOVE);
+        last->forwardmove = cmd->forwardmove;
+    }
+    if (diff->diff & NET_TICDIFF_SIDE)
+    {
+        PutDelta(stream, SignExtend(cmd->sidemove - last->sidemove, 8),
+                 8, PACK_K_MOVE);
+        last->sidemove = cmd->sidemove;
+    }
+    if (diff->diff & NET_TICDIFF_TURN)
+        PutTurn(stream, last, cmd);
+    if (diff->diff & NET_TICDIFF_BUTTONS)
+        PutBits(stream, cmd->buttons, 8);
+    if (diff->diff & NET_TICDIFF_CONSISTANCY)
+        PutBits(stream, cmd->consistancy, 8);
+    if (diff->diff & NET_TICDIFF_CHATCHAR)
+        PutBits(stream, cmd->chatchar, 8);
+    if (diff->diff & NET_TICDIFF_RAVEN)
+    {
+        PutBits(stream, cmd->lookfly, 8);
+        PutBits(stream, static_cast<unsigned int>(cmd->arti), 8);
+    }
+    if (diff->diff & NET_TICDIFF_STRIFE)
+    {
+        PutBits(stream, cmd->buttons2, 8);
+        PutBits(stream, static_cast<unsigned int>(cmd->inventory), 16);
+    }
+}
+
+static boolean GetTiccmdDiff(net_ticstream_t *stream, int player,
+                             net_ticdiff_t *diff)
+{
+    ticcmd_t *last = &stream->last_cmd[player];
+    unsigned int val;
+    int delta;
+
+    if (!GetExpGolomb(stream, &val, 0) || val > 0xff)
+        return false;
+
+    stream->last_diff[player] ^= val;
+    diff->diff = stream->last_diff[player];
+
+    if (diff->diff & NET_TICDIFF_FORWARD)
+    {
+        if (!GetDelta(stream, &delta, 8, PACK_K_MOVE))
+            return false;
+        last->forwardmove = SignExtend(last->forwardmove + delta, 8);
+    }
+    if (diff->diff & NET_TICDIFF_SIDE)
+    {
+        if (!GetDelta(stream, &delta, 8, PACK_K_MOVE))
+            return false;
+        last->sidemove = SignExtend(last->sidemove + delta, 8);
+    }
+    if (diff->diff & NET_TICDIFF_TURN)
+    {
+        if (!GetTurn(stream, last))
+            return false;
+    }
+    if (diff->diff & NET_TICDIFF_BUTTONS)
+    {
+        if (!GetBits(stream, &val, 8))
+            return false;
+        last->buttons = val;
+    }
+    if (diff->diff & NET_TICDIFF_CONSISTANCY)
+    {
+        if (!GetBits(stream, &val, 8))
+            return false;
+        last->consistancy = val;
+    }
+    if (diff->diff & NET_TICDIFF_CHATCHAR)
+    {
+        if (!GetBits(stream, &val, 8))
+            return false;
+        last->chatchar = val;
+    }
+    if (diff->diff & NET_TICDIFF_RAVEN)
+    {
+        if (!GetBits(stream, &val, 8))
+            return false;
+        last->lookfly = val;
+
+        if (!GetBits(stream, &val, 8))
+            return false;
+        last->arti = (artitype_t)val;
+    }
+    if (diff->diff & NET_TICDIFF_STRIFE)
+    {
+        if (!GetBits(stream, &val, 8))
+            return false;
+        last->buttons2 = val;
+
+        if (!GetBits(stream, &val, 16))
+            return false;
+        last->inventory = val;
+    }
+
+    diff->cmd = *last;
+
+    return true;
+}
+
+// Write one slot of the stream. empty_run counts the slots from this one
+// onwards that have an empty diff, and is only called at the start of
+// a run.
+
+template <typename Counter>
+static void PutSlot(net_ticstream_t *stream, int player, net_ticdiff_t *diff,
+                    Counter empty_run)
+{
+    if (stream->need_run)
+    {
+        stream->run = empty_run();
+        stream->need_run = false;
+        PutExpGolomb(stream, stream->run, 0);
+    }
+
+    if (stream->run > 0)
+    {
+        --stream->run;
+        return;
+    }
+
+    PutTiccmdDiff(stream, player, diff);
+    stream->need_run = true;
+}
+
+static boolean GetSlot(net_ticstream_t *stream, int player,
+                       net_ticdiff_t *diff)
+{
+    if (stream->need_run)
+    {
+        if (!GetExpGolomb(stream, &stream->run, 0))
+        {
+            return false;
+        }
+
+        stream->need_run = false;
+    }
+
+    if (stream->run > 0)
+    {
+        --stream->run;
+        diff->diff = 0;
+        diff->cmd = stream->last_cmd[player];
+        return true;
+    }
+
+    stream->need_run = true;
+
+    return GetTiccmdDiff(stream, player, diff);
+}
+
+static unsigned int PlayerInGameBits(net_full_ticcmd_t *cmd)
+{
+    unsigned int bitfield = 0;
+
+    for (int i = 0; i < NET_MAXPLAYERS; ++i)
+    {
+        if (cmd->playeringame[i])
+        {
+            bitfield |= 1 << i;
+        }
+    }
+
+    return bitfield;
+}
+
+void NET_WriteTiccmdDiffs(net_packet_t *packet, net_protocol_t protocol,
+                          signed int latency, net_ticdiff_t **diffs,
+                          unsigned int num_tics, boolean lowres_turn)
+{
+    net_ticstream_t stream;
+    unsigned int i;
+
+    if (!NET_PackedTics(protocol))
+    {
+        for (i = 0; i < num_tics; ++i)
+        {
+            NET_WriteInt16(packet, latency);
+            NET_WriteTiccmdDiff(packet, diffs[i], lowres_turn);
+        }
+
+        return;
+    }
+
+    NET_InitTicStream(&stream, packet, protocol, lowres_turn);
+
+    PutDelta(&stream, SignExtend(latency, 16), 16, PACK_K_LATENCY);
+
+    for (i = 0; i < num_tics; ++i)
+    {
+        PutSlot(&stream, 0, diffs[i], [&]() {
+            unsigned int j = i;
+
+            while (j < num_tics && diffs[j]->diff == 0)
+            {
+                ++j;
+            }
+
+            return j - i;
+        });
+    }
+
+    FlushBits(&stream);
+}
+
+void NET_WriteFullTiccmds(net_packet_t *packet, net_protocol_t protocol,
+                          net_full_ticcmd_t **cmds, unsigned int num_tics,
+                          boolean lowres_turn)
+{
+    net_ticstream_t stream;
+    unsigned int i, bitfield;
+    int latency;
+
+    if (!NET_PackedTics(protocol))
+    {
+        for (i = 0; i < num_tics; ++i)
+        {
+            NET_WriteFullTiccmd(packet, cmds[i], lowres_turn);
+        }
+
+        return;
+    }
+
+    NET_InitTicStream(&stream, packet, protocol, lowres_turn);
+
+    for (i = 0; i < num_tics; ++i)
+    {
+        latency = SignExtend(cmds[i]->latency, 16);
+        PutDelta(&stream, SignExtend(latency - stream.latency, 16),
+                 16, PACK_K_LATENCY);
+        stream.latency = latency;
+
+        bitfield = PlayerInGameBits(cmds[i]);
+
+        if (bitfield == stream.playeringame)
+        {
+            PutBits(&stream, 1, 1);
+        }
+        else
+        {
+            PutBits(&stream, 0, 1);
+            PutBits(&stream, bitfield, NET_MAXPLAYERS);
+            stream.playeringame = bitfield;
+        }
+
+        for (int p = 0; p < NET_MAXPLAYERS; ++p)
+        {
+            if (!cmds[i]->playeringame[p])
+            {
+                continue;
+            }
+
+            PutSlot(&stream, p, &cmds[i]->cmds[p], [&]() {
+                unsigned int run = 0;
+                unsigned int t = i;
+                int q = p;
+
+                for (; t < num_tics; ++t, q = 0)
+                {
+                    for (; q < NET_MAXPLAYERS; ++q)
+                    {
+                        if (!cmds[t]->playeringame[q])
+                        {
+                            continue;
+                        }
+                        if (cmds[t]->cmds[q].diff != 0)
+                        {
+                            return run;
+                        }
+
+                        ++run;
+                    }
+                }
+
+                return run;
+            });
+        }
+    }
+
+    FlushBits(&stream);
+}
+
+boolean NET_ReadStreamTiccmdDiff(net_ticstream_t *stream, signed int *latency,
+                                 net_ticdiff_t *diff)
+{
+    int delta;
+
+    if (!NET_PackedTics(stream->protocol))
+    {
+        return NET_ReadSInt16(stream->packet, latency)
+            && NET_ReadTiccmdDiff(stream->packet, diff, stream->lowres_turn);
+    }
+
+    if (stream->tics == 0)
+    {
+        if (!GetDelta(stream, &delta, 16, PACK_K_LATENCY))
+        {
+            return false;
+        }
+
+        stream->latency = delta;
+    }
+
+    ++stream->tics;
+    *latency = stream->latency;
+
+    return GetSlot(stream, 0, diff);
+}
+
+boolean NET_ReadStreamFullTiccmd(net_ticstream_t *stream,
+                                 net_full_ticcmd_t *cmd)
+{
+    unsigned int same;
+    int delta;
+
+    if (!NET_PackedTics(stream->protocol))
+    {
+        return NET_ReadFullTiccmd(stream->packet, cmd, stream->lowres_turn);
+    }
+
+    if (!GetDelta(stream, &delta, 16, PACK_K_LATENCY)
+     || !GetBits(stream, &same, 1))
+    {
+        return false;
+    }
+
+    stream->latency = SignExtend(stream->latency + delta, 16);
+    cmd->latency = stream->latency;
+
+    if (!same && !GetBits(stream, &stream->playeringame, NET_MAXPLAYERS))
+    {
+        return false;
+    }
+
+    ++stream->tics;
+
+    for (int i = 0; i < NET_MAXPLAYERS; ++i)
+    {
+        cmd->playeringame[i] = (stream->playeringame & (1 << i)) != 0;
+
+        if (cmd->playeringame[i] && !GetSlot(stream, i, &cmd->cmds[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void NET_WriteWaitData(net_packet_t *packet, net_waitdata_t *data)
 {
     int i;
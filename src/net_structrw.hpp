@@ -37,6 +37,53 @@ extern void NET_TiccmdPatch(ticcmd_t *src, net_ticdiff_t *diff, ticcmd_t *dest);
 boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn);
 void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn);
 
+// Runs of tics in game data packets. With NET_PROTOCOL_CHOCOLATE_DOOM_0
+// these are the plain per-tic encodings above; later protocols use a
+// bit-packed stream where movement is delta coded against the previous
+// tic in the same packet and runs of unchanged ticcmds are run-length
+// coded, so every packet can still be decoded on its own.
+
+struct net_ticstream_t
+{
+    net_packet_t *packet;
+    net_protocol_t protocol;
+    boolean lowres_turn;
+
+    // Bit buffer.
+
+    std::uint64_t bits;
+    int num_bits;
+
+    // Values of the previous tic, for delta coding.
+
+    int tics;
+    signed int latency;
+    unsigned int playeringame;
+    unsigned int last_diff[NET_MAXPLAYERS];
+    ticcmd_t last_cmd[NET_MAXPLAYERS];
+
+    // Run of unchanged ticcmds that is being read or written.
+
+    boolean need_run;
+    unsigned int run;
+};
+
+boolean NET_PackedTics(net_protocol_t protocol);
+
+void NET_WriteTiccmdDiffs(net_packet_t *packet, net_protocol_t protocol,
+                          signed int latency, net_ticdiff_t **diffs,
+                          unsigned int num_tics, boolean lowres_turn);
+void NET_WriteFullTiccmds(net_packet_t *packet, net_protocol_t protocol,
+                          net_full_ticcmd_t **cmds, unsigned int num_tics,
+                          boolean lowres_turn);
+
+void NET_InitTicStream(net_ticstream_t *stream, net_packet_t *packet,
+                       net_protocol_t protocol, boolean lowres_turn);
+boolean NET_ReadStreamTiccmdDiff(net_ticstream_t *stream, signed int *latency,
+                                 net_ticdiff_t *diff);
+boolean NET_ReadStreamFullTiccmd(net_ticstream_t *stream,
+                                 net_full_ticcmd_t *cmd);
+
 boolean NET_ReadSHA1Sum(net_packet_t *packet, sha1_digest_t digest);
 void NET_WriteSHA1Sum(net_packet_t *packet, sha1_digest_t digest);
 
@@ -39,6 +39,16 @@
 #include "i_swap.hpp"
 #include "sha1.hpp"
 
+/* The SHA extensions of x86 CPUs do four rounds per instruction; they
+ * are used when the CPU has them.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) \
+ && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_SHA_NI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 void SHA1_Init(sha1_context_t *hd)
 {
     hd->h0 = 0x67452301;
@@ -194,15 +204,124 @@ static void Transform(sha1_context_t *hd, byte *data)
 }
 
 
+#ifdef HAVE_SHA_NI
+
+static int HaveSHANI(void)
+{
+    static int result = -1;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (result < 0)
+    {
+        result = 0;
+
+        /* SHA (leaf 7), SSSE3 and SSE4.1 (leaf 1) */
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+         && (ecx & (1 << 9)) && (ecx & (1 << 19))
+         && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)
+         && (ebx & (1 << 29)))
+        {
+            result = 1;
+        }
+    }
+
+    return result;
+}
+
+/* Four rounds: the message words of this group have been expanded, so
+ * E is derived from them and the A of the previous group.
+ */
+#define RNDS4(i, f) do { \
+	    if (i > 0) \
+		e = _mm_sha1nexte_epu32(prev, msg[(i) & 3]); \
+	    prev = abcd; \
+	    abcd = _mm_sha1rnds4_epu32(abcd, e, f); \
+	    if (i >= 3 && i <= 18) \
+		msg[((i) + 1) & 3] = _mm_sha1msg2_epu32(msg[((i) + 1) & 3], \
+		                                        msg[(i) & 3]); \
+	    if (i >= 1 && i <= 16) \
+		msg[((i) - 1) & 3] = _mm_sha1msg1_epu32(msg[((i) - 1) & 3], \
+		                                        msg[(i) & 3]); \
+	    if (i >= 2 && i <= 17) \
+		msg[((i) - 2) & 3] = _mm_xor_si128(msg[((i) - 2) & 3], \
+		                                   msg[(i) & 3]); \
+	} while (0)
+
+__attribute__((target("sha,ssse3,sse4.1")))
+static void TransformSHANI(sha1_context_t *hd, byte *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+                                        0x08090a0b0c0d0e0fULL);
+    __m128i abcd, abcd_save, e, e_save, prev, msg[4];
+    int i;
+
+    abcd = _mm_set_epi32(hd->h0, hd->h1, hd->h2, hd->h3);
+    e_save = _mm_set_epi32(hd->h4, 0, 0, 0);
+
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        abcd_save = abcd;
+
+        for (i = 0; i < 4; i++)
+        {
+            msg[i] = _mm_loadu_si128((const __m128i *) (data + i * 16));
+            msg[i] = _mm_shuffle_epi8(msg[i], mask);
+        }
+
+        e = _mm_add_epi32(e_save, msg[0]);
+        prev = abcd;
+
+        RNDS4( 0, 0); RNDS4( 1, 0); RNDS4( 2, 0); RNDS4( 3, 0); RNDS4( 4, 0);
+        RNDS4( 5, 1); RNDS4( 6, 1); RNDS4( 7, 1); RNDS4( 8, 1); RNDS4( 9, 1);
+        RNDS4(10, 2); RNDS4(11, 2); RNDS4(12, 2); RNDS4(13, 2); RNDS4(14, 2);
+        RNDS4(15, 3); RNDS4(16, 3); RNDS4(17, 3); RNDS4(18, 3); RNDS4(19, 3);
+
+        /* E of the next block, and the updated chaining vars */
+        e_save = _mm_sha1nexte_epu32(prev, e_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    hd->h0 = _mm_extract_epi32(abcd, 3);
+    hd->h1 = _mm_extract_epi32(abcd, 2);
+    hd->h2 = _mm_extract_epi32(abcd, 1);
+    hd->h3 = _mm_extract_epi32(abcd, 0);
+    hd->h4 = _mm_extract_epi32(e_save, 3);
+}
+
+#undef RNDS4
+
+#endif /* #ifdef HAVE_SHA_NI */
+
+/* Transform a number of consecutive 64 byte blocks.
+ */
+static void TransformBlocks(sha1_context_t *hd, byte *data, size_t blocks)
+{
+#ifdef HAVE_SHA_NI
+    if (HaveSHANI())
+    {
+        TransformSHANI(hd, data, blocks);
+        return;
+    }
+#endif
+
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        Transform(hd, data);
+    }
+}
+
+
 /* Update the message digest with the contents
  * of INBUF with length INLEN.
  */
 void SHA1_Update(sha1_context_t *hd, byte *inbuf, size_t inlen)
 {
+    size_t n;
+
     if (hd->count == 64)
     {
         /* flush the buffer */
-	Transform(hd, hd->buf);
+	TransformBlocks(hd, hd->buf, 1);
 	hd->count = 0;
 	hd->nblocks++;
     }
@@ -210,23 +329,28 @@ void SHA1_Update(sha1_context_t *hd, byte *inbuf, size_t inlen)
 	return;
     if (hd->count)
     {
-	for (; inlen && hd->count < 64; inlen--)
-	    hd->buf[hd->count++] = *inbuf++;
+	n = inlen < (size_t) (64 - hd->count) ? inlen : 64 - hd->count;
+	memcpy(hd->buf + hd->count, inbuf, n);
+	hd->count += n;
+	inbuf += n;
+	inlen -= n;
 	SHA1_Update(hd, nullptr, 0);
 	if (!inlen)
 	    return;
     }
 
-    while (inlen >= 64)
+    /* whole blocks are transformed in place */
+    if (inlen >= 64)
     {
-	Transform(hd, inbuf);
+	n = inlen / 64;
+	TransformBlocks(hd, inbuf, n);
 	hd->count = 0;
-	hd->nblocks++;
-	inlen -= 64;
-	inbuf += 64;
+	hd->nblocks += n;
+	inlen -= n * 64;
+	inbuf += n * 64;
     }
-    for (; inlen && hd->count < 64; inlen--)
-	hd->buf[hd->count++] = *inbuf++;
+    memcpy(hd->buf + hd->count, inbuf, inlen);
+    hd->count += inlen;
 }
 
 
@@ -283,7 +407,7 @@ void SHA1_Final(sha1_digest_t digest, sha1_context_t *hd)
     hd->buf[61] = lsb >> 16;
     hd->buf[62] = lsb >>  8;
     hd->buf[63] = lsb	   ;
-    Transform(hd, hd->buf);
+    TransformBlocks(hd, hd->buf, 1);
 
     p = hd->buf;
 #ifdef SYS_BIG_ENDIAN
@@ -55,11 +55,14 @@ multiitem_t multiitem_freelook[NUM_FREELOOKS_HH] =
     {FREELOOK_HH_SPRING, "Spring"},
 };
 
-multiitem_t multiitem_sndchannels[3] =
+multiitem_t multiitem_sndchannels[6] =
 {
     {8, "8"},
     {16, "16"},
     {32, "32"},
+    {64, "64"},
+    {128, "128"},
+    {256, "256"},
 };
 
 multiitem_t multiitem_widescreen[NUM_RATIOS] =
@@ -461,7 +461,7 @@ void P_DialogLoad(void)
         numleveldialogs = W_LumpLength(lumpnum) / ORIG_MAPDIALOG_SIZE;
         P_ParseDialogLump(leveldialogptr, &leveldialogs, numleveldialogs, 
                           PU_LEVEL);
-        Z_Free(leveldialogptr); // haleyjd: free the original lump
+        W_ReleaseLumpNum(lumpnum); // haleyjd: free the original lump
     }
 
     // also load SCRIPT00 if it has not been loaded yet
@@ -476,7 +476,7 @@ void P_DialogLoad(void)
         numscript0dialogs = W_LumpLength(lumpnum) / ORIG_MAPDIALOG_SIZE;
         P_ParseDialogLump(script0ptr, &script0dialogs, numscript0dialogs,
                           PU_STATIC);
-        Z_Free(script0ptr); // haleyjd: free the original lump
+        W_ReleaseLumpNum(lumpnum); // haleyjd: free the original lump
     }
 }
 
@@ -919,6 +919,7 @@ P_SetupLevel
     else
 #endif
     Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    W_ReleasePrefetchedLumps ();
 
 
     // UNUSED W_Profile ();
@@ -150,6 +150,8 @@ void S_Init(int sfxVolume, int musicVolume, int voiceVolume)
     // (the maximum numer of sounds rendered
     // simultaneously) within zone memory.
     // [crispy] variable number of sound channels
+    if (snd_channels > I_MaxSoundChannels())
+        snd_channels = I_MaxSoundChannels();
     channels = (decltype(    channels)) I_Realloc(nullptr, snd_channels*sizeof(channel_t));
     sobjs = (decltype(    sobjs)) I_Realloc(nullptr, snd_channels*sizeof(degenmobj_t)); // [crispy] sound objects
 
@@ -895,10 +897,10 @@ void S_UpdateSndChannels (int choice)
     else
         snd_channels >>= 1;
 
-    if (snd_channels > 32)
+    if (snd_channels > I_MaxSoundChannels())
         snd_channels = 8;
     else if (snd_channels < 8)
-        snd_channels = 32;
+        snd_channels = I_MaxSoundChannels();
 
     channels = (decltype(    channels)) I_Realloc(channels, snd_channels * sizeof(channel_t));
     sobjs = (decltype(    sobjs)) I_Realloc(sobjs, snd_channels * sizeof(degenmobj_t)); // [crispy] sound objects
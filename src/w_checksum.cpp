@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "i_system.hpp"
 #include "m_misc.hpp"
@@ -31,13 +32,23 @@ static int num_open_wadfiles = 0;
 
 static int GetFileNumber(wad_file_t *handle)
 {
+    static int last = 0;
     int i;
     int result;
 
+    // Lumps of the same file are next to each other in the directory,
+    // so this is nearly always the file of the previous lump.
+
+    if (last < num_open_wadfiles && open_wadfiles[last] == handle)
+    {
+        return last;
+    }
+
     for (i = 0; i < num_open_wadfiles; ++i)
     {
         if (open_wadfiles[i] == handle)
         {
+            last = i;
             return i;
         }
     }
@@ -51,36 +62,102 @@ static int GetFileNumber(wad_file_t *handle)
 
     result = num_open_wadfiles;
     ++num_open_wadfiles;
+    last = result;
 
     return result;
 }
 
-static void ChecksumAddLump(sha1_context_t *sha1_context, lumpinfo_t *lump)
+// The entries are written out in the form SHA1_UpdateString() and
+// SHA1_UpdateInt32() would hash them, and hashed a buffer at a time.
+
+#define CHECKSUM_BUFFER_SIZE 4096
+#define CHECKSUM_ENTRY_SIZE  (8 + 1 + 3 * 4)
+
+static byte *WriteInt32(byte *p, unsigned int val)
 {
-    char buf[9];
+    p[0] = (val >> 24) & 0xff;
+    p[1] = (val >> 16) & 0xff;
+    p[2] = (val >> 8) & 0xff;
+    p[3] = val & 0xff;
 
-    M_StringCopy(buf, lump->name, sizeof(buf));
-    SHA1_UpdateString(sha1_context, buf);
-    SHA1_UpdateInt32(sha1_context, GetFileNumber(lump->wad_file));
-    SHA1_UpdateInt32(sha1_context, lump->position);
-    SHA1_UpdateInt32(sha1_context, lump->size);
+    return p + 4;
 }
 
-void W_Checksum(sha1_digest_t digest)
+static byte *ChecksumWriteLump(byte *p, lumpinfo_t *lump)
 {
-    sha1_context_t sha1_context;
-    unsigned int i;
+    char name[9];
+    size_t len;
 
-    SHA1_Init(&sha1_context);
+    M_StringCopy(name, lump->name, sizeof(name));
+    len = strlen(name) + 1;
+    memcpy(p, name, len);
+    p += len;
+
+    p = WriteInt32(p, GetFileNumber(lump->wad_file));
+    p = WriteInt32(p, lump->position);
+    p = WriteInt32(p, lump->size);
+
+    return p;
+}
+
+static void ChecksumAddDirectory(sha1_context_t *sha1_context)
+{
+    byte buf[CHECKSUM_BUFFER_SIZE];
+    byte *p;
+    unsigned int i;
 
     num_open_wadfiles = 0;
+    p = buf;
 
     // Go through each entry in the WAD directory, adding information
     // about each entry to the SHA1 hash.
 
     for (i = 0; i < numlumps; ++i)
     {
-        ChecksumAddLump(&sha1_context, lumpinfo[i]);
+        if (p + CHECKSUM_ENTRY_SIZE > buf + sizeof(buf))
+        {
+            SHA1_Update(sha1_context, buf, p - buf);
+            p = buf;
+        }
+
+        p = ChecksumWriteLump(p, lumpinfo[i]);
+    }
+
+    SHA1_Update(sha1_context, buf, p - buf);
+}
+
+void W_Checksum(sha1_digest_t digest)
+{
+    sha1_context_t sha1_context;
+
+    SHA1_Init(&sha1_context);
+    ChecksumAddDirectory(&sha1_context);
+    SHA1_Final(digest, &sha1_context);
+}
+
+void W_ChecksumFiles(sha1_digest_t digest)
+{
+    sha1_context_t sha1_context;
+    struct stat st;
+    int i;
+
+    SHA1_Init(&sha1_context);
+    ChecksumAddDirectory(&sha1_context);
+
+    // The directory alone doesn't change when a lump is rewritten in
+    // place, so add the size and modification time of each file.
+
+    for (i = 0; i < num_open_wadfiles; ++i)
+    {
+        SHA1_UpdateString(&sha1_context, open_wadfiles[i]->path);
+        SHA1_UpdateInt32(&sha1_context, open_wadfiles[i]->length);
+
+        if (M_stat(open_wadfiles[i]->path, &st) == 0)
+        {
+            SHA1_UpdateInt32(&sha1_context, (unsigned int) st.st_mtime);
+            SHA1_UpdateInt32(&sha1_context,
+                             (unsigned int) ((uint64_t) st.st_mtime >> 32));
+        }
     }
 
     SHA1_Final(digest, &sha1_context);
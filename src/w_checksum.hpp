@@ -23,5 +23,11 @@
 
 extern void W_Checksum(sha1_digest_t digest);
 
+// Like W_Checksum, but also covers the size and modification time of
+// every WAD file, so that the result changes whenever the contents of
+// a lump may have. Used to validate caches of data derived from lumps.
+
+extern void W_ChecksumFiles(sha1_digest_t digest);
+
 #endif /* #ifndef W_CHECKSUM_H */
 
@@ -25,6 +25,14 @@
 
 typedef struct _wad_file_s wad_file_t;
 
+// Hints about how a range of a mapped file is about to be used.
+
+typedef enum
+{
+    WAD_ADVICE_WILLNEED,        // Will be read soon; start paging it in.
+    WAD_ADVICE_DONTNEED,        // Not needed for now; pages may be dropped.
+} wad_advice_t;
+
 typedef struct
 {
     // Open a file for reading.
@@ -37,6 +45,11 @@ typedef struct
     // provided buffer.  Returns the number of bytes read.
     size_t (*Read)(wad_file_t *file, unsigned int offset,
                    void *buffer, size_t buffer_len);
+
+    // Pass a hint about the use of a range of a mapped file to the OS.
+    // May be nullptr if the class has no use for hints.
+    void (*Advise)(wad_file_t *file, unsigned int offset, size_t len,
+                   wad_advice_t advice);
 } wad_file_class_t;
 
 
@@ -83,4 +96,10 @@ void W_CloseFile(wad_file_t *wad);
 size_t W_Read(wad_file_t *wad, unsigned int offset,
               void *buffer, size_t buffer_len);
 
+// Hint that the specified range of a file is about to be used, or is
+// no longer needed. Only has an effect on files that are mapped.
+
+void W_Advise(wad_file_t *wad, unsigned int offset, size_t len,
+              wad_advice_t advice);
+
 #endif /* #ifndef __W_FILE__ */
@@ -30,6 +30,8 @@
 #include "w_file.hpp"
 #include "z_zone.hpp"
 
+#include "../utils/memory.hpp"
+
 typedef struct
 {
     wad_file_t wad;
@@ -51,7 +53,9 @@ static void MapFile(posix_wad_file_t *wad, const char *filename)
     protection = PROT_READ|PROT_WRITE;
 
     // Writes to the mapped area result in private changes that are
-    // *not* written to disk.
+    // *not* written to disk. Pages that are never written stay shared
+    // through the page cache with any other process that has the same
+    // WAD open.
 
     flags = MAP_PRIVATE;
 
@@ -66,7 +70,7 @@ static void MapFile(posix_wad_file_t *wad, const char *filename)
     }
     else
     {
-        wad->wad.mapped = result;
+        wad->wad.mapped = static_cast<byte *>(result);
     }
 }
 
@@ -118,6 +122,7 @@ static void W_POSIX_CloseFile(wad_file_t *wad)
         munmap(posix_wad->wad.mapped, posix_wad->wad.length);
     }
     close(posix_wad->handle);
+    free(posix_wad->wad.path);
     Z_Free(posix_wad);
 }
 
@@ -141,7 +146,7 @@ size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
     // Read into the buffer.
 
     bytes_read = 0;
-    byte_buffer = buffer;
+    byte_buffer = static_cast<byte *>(buffer);
 
     while (buffer_len > 0) {
         result = read(posix_wad->handle, byte_buffer, buffer_len);
@@ -163,12 +168,61 @@ size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
     return bytes_read;
 }
 
+static void W_POSIX_Advise(wad_file_t *wad, unsigned int offset, size_t len,
+                           wad_advice_t advice)
+{
+    static size_t page_size = 0;
+    size_t start, end;
+
+    if (page_size == 0)
+    {
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+
+    if (offset >= wad->length)
+    {
+        return;
+    }
+
+    if (len > wad->length - offset)
+    {
+        len = wad->length - offset;
+    }
+
+    // madvise() wants a page aligned address. Reading ahead covers
+    // whole pages, so round the range out. Dropping pages throws away
+    // private changes to them, so only drop the pages that lie wholly
+    // within the range, and leave those shared with neighbouring lumps.
+
+    if (advice == WAD_ADVICE_WILLNEED)
+    {
+        start = offset - offset % page_size;
+        end = offset + len;
+        end = (end + page_size - 1) - (end + page_size - 1) % page_size;
+
+        madvise(wad->mapped + start, end - start, MADV_WILLNEED);
+    }
+    else
+    {
+        start = offset + page_size - 1;
+        start -= start % page_size;
+        end = offset + len;
+        end -= end % page_size;
+
+        if (end > start)
+        {
+            madvise(wad->mapped + start, end - start, MADV_DONTNEED);
+        }
+    }
+}
+
 
 wad_file_class_t posix_wad_file = 
 {
     W_POSIX_OpenFile,
     W_POSIX_CloseFile,
     W_POSIX_Read,
+    W_POSIX_Advise,
 };
 
 
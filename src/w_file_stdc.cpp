@@ -63,6 +63,7 @@ static void W_StdC_CloseFile(wad_file_t *wad)
     stdc_wad = (stdc_wad_file_t *) wad;
 
     fclose(stdc_wad->fstream);
+    free(stdc_wad->wad.path);
     Z_Free(stdc_wad);
 }
 
@@ -94,6 +95,7 @@ wad_file_class_t stdc_wad_file =
     W_StdC_OpenFile,
     W_StdC_CloseFile,
     W_StdC_Read,
+    nullptr,
 };
 
 
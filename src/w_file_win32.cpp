@@ -155,6 +155,7 @@ static void W_Win32_CloseFile(wad_file_t *wad)
         CloseHandle(win32_wad->handle);
     }
 
+    free(win32_wad->wad.path);
     Z_Free(win32_wad);
 }
 
@@ -196,6 +197,7 @@ wad_file_class_t win32_wad_file =
     W_Win32_OpenFile,
     W_Win32_CloseFile,
     W_Win32_Read,
+    nullptr,
 };
 
 
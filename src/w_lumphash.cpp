@@ -0,0 +1,475 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Lump name lookup table.
+//
+//     Lump names are at most eight characters long, so an upper-cased
+//     name fits in a 64-bit integer. The table stores these keys in a
+//     flat array of a power-of-two size, using open addressing with
+//     linear probing, so a lookup hashes the name once and compares
+//     one key per probe without touching the lump directory.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.hpp"
+#include "w_lumphash.hpp"
+#include "z_zone.hpp"
+
+#include "../utils/memory.hpp"
+
+// Keys of the lumps in the table, 0 for an empty slot, and the
+// matching lump numbers.
+
+static uint64_t *hash_keys = nullptr;
+static lumpindex_t *hash_lumps = nullptr;
+static unsigned int hash_mask;
+static int hash_shift;
+
+// The directory the table was built for.
+
+static lumpinfo_t **hash_directory;
+static unsigned int hash_directory_size;
+
+// Upper-cased name, padded with zeros.
+
+static uint64_t LumpNameKey(const char *name)
+{
+    byte buf[8];
+    uint64_t key;
+    int i;
+
+    for (i = 0; i < 8 && name[i] != '\0'; ++i)
+    {
+        buf[i] = name[i] >= 'a' && name[i] <= 'z' ? name[i] - ('a' - 'A')
+                                                  : name[i];
+    }
+
+    for (; i < 8; ++i)
+    {
+        buf[i] = 0;
+    }
+
+    memcpy(&key, buf, sizeof(key));
+
+    return key;
+}
+
+// Fibonacci hashing: the top bits of the product depend on all the
+// characters of the name.
+
+static unsigned int KeySlot(uint64_t key)
+{
+    return (unsigned int) ((key * 0x9e3779b97f4a7c15ULL) >> hash_shift);
+}
+
+void W_LumpHashFree(void)
+{
+    if (hash_keys != nullptr)
+    {
+        Z_Free(hash_keys);
+        Z_Free(hash_lumps);
+        hash_keys = nullptr;
+        hash_lumps = nullptr;
+    }
+}
+
+void W_LumpHashBuild(lumpinfo_t **lumps, unsigned int count)
+{
+    unsigned int size, slot, i;
+    uint64_t key;
+    int bits;
+
+    W_LumpHashFree();
+
+    // Keep the table at most half full so that probe runs stay short.
+
+    size = 16;
+    bits = 4;
+
+    while (size < count * 2)
+    {
+        size <<= 1;
+        ++bits;
+    }
+
+    hash_keys = zmalloc<decltype(hash_keys)>(size * sizeof(*hash_keys),
+                                             PU_STATIC, nullptr);
+    hash_lumps = zmalloc<decltype(hash_lumps)>(size * sizeof(*hash_lumps),
+                                               PU_STATIC, nullptr);
+    memset(hash_keys, 0, size * sizeof(*hash_keys));
+    hash_mask = size - 1;
+    hash_shift = 64 - bits;
+    hash_directory = lumps;
+    hash_directory_size = count;
+
+    // Insert in directory order. A later lump with the same name takes
+    // over the slot of the earlier one, so that PWADs override the IWAD.
+
+    for (i = 0; i < count; ++i)
+    {
+        key = LumpNameKey(lumps[i]->name);
+
+        if (key == 0)
+        {
+            continue;
+        }
+
+        slot = KeySlot(key);
+
+        while (hash_keys[slot] != 0 && hash_keys[slot] != key)
+        {
+            slot = (slot + 1) & hash_mask;
+        }
+
+        hash_keys[slot] = key;
+        hash_lumps[slot] = i;
+    }
+}
+
+boolean W_LumpHashReady(void)
+{
+    return hash_keys != nullptr;
+}
+
+lumpindex_t W_LumpHashLookup(const char *name)
+{
+    unsigned int slot;
+    uint64_t key;
+    lumpindex_t i;
+
+    key = LumpNameKey(name);
+
+    // A lump with an empty name has no key; search for it the slow way.
+
+    if (key == 0)
+    {
+        for (i = hash_directory_size - 1; i >= 0; --i)
+        {
+            if (hash_directory[i]->name[0] == '\0')
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    for (slot = KeySlot(key); hash_keys[slot] != 0;
+         slot = (slot + 1) & hash_mask)
+    {
+        if (hash_keys[slot] == key)
+        {
+            return hash_lumps[slot];
+        }
+    }
+
+    return -1;
+}
+
+#ifdef TEST
+
+//
+// Benchmark of the table against the chained hash table that it
+// replaced, over the directory of a large stack of WAD files. The WAD
+// files to use can be given on the command line; otherwise an IWAD
+// and a stack of PWADs that replace many of its lumps are made up.
+//
+
+#include <ctype.h>
+
+#include "i_timer.hpp"
+#include "m_argv.hpp"
+#include "m_misc.hpp"
+
+#define NUM_LOOKUPS 20000000
+
+static lumpinfo_t **directory;
+static unsigned int num_lumps;
+
+// The previous table: djb2 buckets modulo the number of lumps, chained
+// through each lumpinfo_t.
+
+static lumpindex_t *chain_heads;
+static lumpindex_t *chain_next;
+
+static unsigned int ChainHash(const char *s)
+{
+    unsigned int result = 5381;
+    unsigned int i;
+
+    for (i=0; i < 8 && s[i] != '\0'; ++i)
+    {
+        result = ((result << 5) ^ result ) ^ toupper(s[i]);
+    }
+
+    return result;
+}
+
+static void ChainBuild(void)
+{
+    unsigned int i, hash;
+
+    chain_heads = static_cast<lumpindex_t *>(malloc(num_lumps * sizeof(lumpindex_t)));
+    chain_next = static_cast<lumpindex_t *>(malloc(num_lumps * sizeof(lumpindex_t)));
+
+    for (i = 0; i < num_lumps; ++i)
+    {
+        chain_heads[i] = -1;
+    }
+
+    for (i = 0; i < num_lumps; ++i)
+    {
+        hash = ChainHash(directory[i]->name) % num_lumps;
+        chain_next[i] = chain_heads[hash];
+        chain_heads[hash] = i;
+    }
+}
+
+static lumpindex_t ChainLookup(const char *name)
+{
+    lumpindex_t i;
+
+    for (i = chain_heads[ChainHash(name) % num_lumps]; i != -1;
+         i = chain_next[i])
+    {
+        if (!strncasecmp(directory[i]->name, name, 8))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Add the lumps of a file, allocated together like W_AddFile does.
+
+static lumpinfo_t *AddLumps(unsigned int count)
+{
+    lumpinfo_t *lumps;
+    unsigned int i;
+
+    lumps = static_cast<lumpinfo_t *>(calloc(count, sizeof(lumpinfo_t)));
+    directory = static_cast<lumpinfo_t **>(
+        realloc(directory, (num_lumps + count) * sizeof(lumpinfo_t *)));
+
+    for (i = 0; i < count; ++i)
+    {
+        directory[num_lumps + i] = &lumps[i];
+    }
+
+    num_lumps += count;
+
+    return lumps;
+}
+
+static void LoadWadDirectory(const char *filename)
+{
+    FILE *fstream;
+    byte header[12], entry[16];
+    lumpinfo_t *lumps;
+    int count, offset, i;
+
+    fstream = fopen(filename, "rb");
+
+    if (fstream == nullptr || fread(header, 1, 12, fstream) != 12)
+    {
+        fprintf(stderr, "Failed to read %s\n", filename);
+        exit(1);
+    }
+
+    count = header[4] | (header[5] << 8) | (header[6] << 16) | (header[7] << 24);
+    offset = header[8] | (header[9] << 8) | (header[10] << 16) | (header[11] << 24);
+    fseek(fstream, offset, SEEK_SET);
+    lumps = AddLumps(count);
+
+    for (i = 0; i < count && fread(entry, 1, 16, fstream) == 16; ++i)
+    {
+        memcpy(lumps[i].name, entry + 8, 8);
+    }
+
+    fclose(fstream);
+}
+
+static unsigned int rand_state = 1;
+
+static unsigned int Random(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static void RandomName(char *name)
+{
+    static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    int length, i;
+
+    length = 4 + Random() % 5;
+    memset(name, 0, 8);
+
+    for (i = 0; i < length; ++i)
+    {
+        name[i] = chars[Random() % (sizeof(chars) - 1)];
+    }
+}
+
+// An IWAD with 4000 lumps, 32 maps of 11 lumps each and 60 PWADs of
+// 1000 lumps each, a third of which replace lumps of the IWAD.
+
+static void MakeUpDirectory(void)
+{
+    static const char *map_lumps[] = {
+        "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+        "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP",
+    };
+    lumpinfo_t *iwad, *pwad;
+    unsigned int i, j, n;
+
+    iwad = AddLumps(4000);
+    n = 0;
+
+    for (i = 1; i <= 32; ++i)
+    {
+        snprintf(iwad[n++].name, 8, "MAP%02d", i);
+
+        for (j = 0; j < arrlen(map_lumps); ++j)
+        {
+            // None are longer than 8; the rest of the name stays zeroed.
+            memcpy(iwad[n++].name, map_lumps[j], strlen(map_lumps[j]));
+        }
+    }
+
+    for (; n < 4000; ++n)
+    {
+        RandomName(iwad[n].name);
+    }
+
+    for (i = 0; i < 60; ++i)
+    {
+        pwad = AddLumps(1000);
+
+        for (j = 0; j < 1000; ++j)
+        {
+            if (j % 3 == 0)
+            {
+                memcpy(pwad[j].name, iwad[Random() % 4000].name, 8);
+            }
+            else
+            {
+                RandomName(pwad[j].name);
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char (*names)[9];
+    unsigned int i, num_names;
+    lumpindex_t chain_result, hash_result;
+    int start, chain_time, hash_time;
+    unsigned int sum;
+
+    myargc = argc;
+    myargv = argv;
+    Z_Init();
+
+    if (argc > 1)
+    {
+        for (i = 1; i < (unsigned int) argc; ++i)
+        {
+            LoadWadDirectory(argv[i]);
+        }
+    }
+    else
+    {
+        MakeUpDirectory();
+    }
+
+    // Names to look up: every lump in the directory, in mixed case,
+    // and as many names that are not there.
+
+    num_names = num_lumps * 2;
+    names = static_cast<char (*)[9]>(malloc(num_names * sizeof(*names)));
+
+    for (i = 0; i < num_lumps; ++i)
+    {
+        memcpy(names[i], directory[i]->name, 8);
+        names[i][8] = '\0';
+
+        if (i % 2)
+        {
+            M_ForceLowercase(names[i]);
+        }
+
+        RandomName(names[num_lumps + i]);
+        names[num_lumps + i][7] = '~';
+        names[num_lumps + i][8] = '\0';
+    }
+
+    start = I_GetTimeMS();
+    ChainBuild();
+    chain_time = I_GetTimeMS() - start;
+
+    start = I_GetTimeMS();
+    W_LumpHashBuild(directory, num_lumps);
+    hash_time = I_GetTimeMS() - start;
+
+    printf("%u lumps, %u names looked up %d times\n",
+           num_lumps, num_names, NUM_LOOKUPS);
+    printf("build: chained %d ms, open addressing %d ms\n",
+           chain_time, hash_time);
+
+    for (i = 0; i < num_names; ++i)
+    {
+        chain_result = ChainLookup(names[i]);
+        hash_result = W_LumpHashLookup(names[i]);
+
+        if (chain_result != hash_result)
+        {
+            printf("Mismatch for '%s': %d vs %d\n",
+                   names[i], chain_result, hash_result);
+            return 1;
+        }
+    }
+
+    sum = 0;
+    start = I_GetTimeMS();
+
+    for (i = 0; i < NUM_LOOKUPS; ++i)
+    {
+        sum += ChainLookup(names[i % num_names]);
+    }
+
+    chain_time = I_GetTimeMS() - start;
+    start = I_GetTimeMS();
+
+    for (i = 0; i < NUM_LOOKUPS; ++i)
+    {
+        sum += W_LumpHashLookup(names[i % num_names]);
+    }
+
+    hash_time = I_GetTimeMS() - start;
+
+    printf("lookup: chained %.1f ns, open addressing %.1f ns (%u)\n",
+           chain_time * 1e6 / NUM_LOOKUPS, hash_time * 1e6 / NUM_LOOKUPS,
+           sum);
+
+    return 0;
+}
+
+#endif
+
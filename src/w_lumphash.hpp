@@ -0,0 +1,42 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Lump name lookup table.
+//
+
+#ifndef W_LUMPHASH_H
+#define W_LUMPHASH_H
+
+#include "doomtype.hpp"
+#include "w_wad.hpp"
+
+// Build the table for the given lump directory. Of several lumps with
+// the same name, the last one in the directory is found.
+
+void W_LumpHashBuild(lumpinfo_t **lumps, unsigned int count);
+
+// Free the table, for when the directory changes.
+
+void W_LumpHashFree(void);
+
+// Returns true if the table has been built.
+
+boolean W_LumpHashReady(void);
+
+// Look up a lump by name, ignoring case. Returns -1 if not found.
+
+lumpindex_t W_LumpHashLookup(const char *name);
+
+#endif /* #ifndef W_LUMPHASH_H */
+
@@ -209,7 +209,7 @@ void W_AutoLoadWADs(const char *path)
     const char *filename;
 
     glob = I_StartMultiGlob(path, GLOB_FLAG_NOCASE|GLOB_FLAG_SORTED,
-                            "*.wad", "*.lmp", nullptr);
+                            "*.wad", "*.lmp", "*.pk3", nullptr);
     for (;;)
     {
         filename = I_NextGlob(glob);
@@ -0,0 +1,303 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Background reading of lumps that are about to be needed.
+//
+//     The lumps of the next level can be read while the intermission
+//     screen is still up. Everything the thread needs is looked up on
+//     the main thread before it starts: lumps in a mapped file are
+//     paged in by touching the mapping, and other lumps are read into
+//     malloc'd buffers through a file handle of the thread's own. The
+//     thread never touches the lump directory or the zone memory.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <SDL.h>
+
+#include "doomtype.hpp"
+#include "i_system.hpp"
+#include "w_file.hpp"
+#include "w_preload.hpp"
+#include "w_wad.hpp"
+
+#define MAX_PRELOAD_LUMPS 32
+
+typedef struct
+{
+    lumpindex_t lump;
+    preload_decode_t decode;
+
+    // Where to read the lump from: either the mapped data, or a
+    // position in a file opened for the thread.
+    const byte *mapped;
+    wad_file_t *file;
+    unsigned int position;
+    int size;
+
+    // Set by the thread.
+    byte *data;
+    byte *decoded;
+    int decoded_len;
+} preload_lump_t;
+
+static preload_lump_t preload_lumps[MAX_PRELOAD_LUMPS];
+static int num_preload_lumps = 0;
+
+// Files opened for the thread, and the files they were opened for.
+
+static wad_file_t *preload_files[MAX_PRELOAD_LUMPS];
+static wad_file_t *preload_sources[MAX_PRELOAD_LUMPS];
+static int num_preload_files = 0;
+
+static SDL_Thread *preload_thread = nullptr;
+static std::atomic<bool> preload_cancel;
+
+void W_PreloadLump(lumpindex_t lump, preload_decode_t decode)
+{
+    preload_lump_t *entry;
+
+    if (preload_thread != nullptr || num_preload_lumps >= MAX_PRELOAD_LUMPS
+     || lump < 0 || (unsigned int) lump >= numlumps)
+    {
+        return;
+    }
+
+    entry = &preload_lumps[num_preload_lumps];
+    memset(entry, 0, sizeof(*entry));
+    entry->lump = lump;
+    entry->decode = decode;
+    ++num_preload_lumps;
+}
+
+// Get a file handle for the thread to read the given file with.
+
+static wad_file_t *PreloadFile(wad_file_t *source)
+{
+    wad_file_t *file;
+    int i;
+
+    for (i = 0; i < num_preload_files; ++i)
+    {
+        if (preload_sources[i] == source)
+        {
+            return preload_files[i];
+        }
+    }
+
+    file = stdc_wad_file.OpenFile(source->path);
+
+    if (file != nullptr)
+    {
+        preload_sources[num_preload_files] = source;
+        preload_files[num_preload_files] = file;
+        ++num_preload_files;
+    }
+
+    return file;
+}
+
+static int PreloadThread(void *unused)
+{
+    preload_lump_t *entry;
+    const byte *data;
+    volatile byte sum;
+    int i, j;
+
+    sum = 0;
+
+    for (i = 0; i < num_preload_lumps && !preload_cancel.load(); ++i)
+    {
+        entry = &preload_lumps[i];
+
+        if (entry->mapped != nullptr)
+        {
+            // Fault in every page of the lump now rather than when the
+            // level is being set up.
+
+            for (j = 0; j < entry->size; j += 4096)
+            {
+                sum += entry->mapped[j];
+            }
+
+            data = entry->mapped;
+        }
+        else if (entry->file != nullptr)
+        {
+            entry->data = static_cast<byte *>(malloc(entry->size + 1));
+
+            if (entry->data == nullptr
+             || entry->file->file_class->Read(entry->file, entry->position,
+                                              entry->data, entry->size)
+                    < (size_t) entry->size)
+            {
+                free(entry->data);
+                entry->data = nullptr;
+                continue;
+            }
+
+            data = entry->data;
+        }
+        else
+        {
+            continue;
+        }
+
+        if (entry->decode != nullptr)
+        {
+            entry->decoded = entry->decode(data, entry->size,
+                                           &entry->decoded_len);
+        }
+    }
+
+    return 0;
+}
+
+void W_StartPreload(void)
+{
+    preload_lump_t *entry;
+    lumpinfo_t *lump;
+    int i;
+
+    if (preload_thread != nullptr || num_preload_lumps == 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < num_preload_lumps; ++i)
+    {
+        entry = &preload_lumps[i];
+        lump = lumpinfo[entry->lump];
+        entry->position = lump->position;
+        entry->size = lump->size;
+
+        // Lumps that are only in memory, such as the inflated files of
+        // an archive, have positions past the end of the file.
+
+        if (lump->size <= 0
+         || (unsigned int) lump->position > lump->wad_file->length
+         || (unsigned int) lump->size
+                > lump->wad_file->length - lump->position)
+        {
+            continue;
+        }
+
+        if (lump->wad_file->mapped != nullptr)
+        {
+            entry->mapped = lump->wad_file->mapped + lump->position;
+            W_Advise(lump->wad_file, lump->position, lump->size,
+                     WAD_ADVICE_WILLNEED);
+        }
+        else
+        {
+            entry->file = PreloadFile(lump->wad_file);
+        }
+    }
+
+    preload_cancel.store(false);
+    preload_thread = SDL_CreateThread(PreloadThread, "preload", nullptr);
+
+    // If no thread could be started, the lumps are just read as usual.
+
+    if (preload_thread == nullptr)
+    {
+        W_FinishPreload();
+    }
+}
+
+static preload_lump_t *FindPreloadedLump(lumpindex_t lump)
+{
+    int i;
+
+    for (i = 0; i < num_preload_lumps; ++i)
+    {
+        if (preload_lumps[i].lump == lump)
+        {
+            if (preload_thread != nullptr)
+            {
+                SDL_WaitThread(preload_thread, nullptr);
+                preload_thread = nullptr;
+            }
+
+            return &preload_lumps[i];
+        }
+    }
+
+    return nullptr;
+}
+
+boolean W_ReadPreloadedLump(lumpindex_t lump, void *dest)
+{
+    preload_lump_t *entry;
+
+    entry = FindPreloadedLump(lump);
+
+    if (entry == nullptr || entry->data == nullptr)
+    {
+        return false;
+    }
+
+    memcpy(dest, entry->data, entry->size);
+
+    return true;
+}
+
+byte *W_TakeDecodedLump(lumpindex_t lump, int *len)
+{
+    preload_lump_t *entry;
+    byte *result;
+
+    entry = FindPreloadedLump(lump);
+
+    if (entry == nullptr || entry->decoded == nullptr)
+    {
+        return nullptr;
+    }
+
+    result = entry->decoded;
+    *len = entry->decoded_len;
+    entry->decoded = nullptr;
+
+    return result;
+}
+
+void W_FinishPreload(void)
+{
+    int i;
+
+    if (preload_thread != nullptr)
+    {
+        preload_cancel.store(true);
+        SDL_WaitThread(preload_thread, nullptr);
+        preload_thread = nullptr;
+    }
+
+    for (i = 0; i < num_preload_lumps; ++i)
+    {
+        free(preload_lumps[i].data);
+        free(preload_lumps[i].decoded);
+    }
+
+    for (i = 0; i < num_preload_files; ++i)
+    {
+        W_CloseFile(preload_files[i]);
+    }
+
+    num_preload_lumps = 0;
+    num_preload_files = 0;
+}
+
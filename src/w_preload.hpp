@@ -0,0 +1,54 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Background reading of lumps that are about to be needed.
+//
+
+#ifndef W_PRELOAD_H
+#define W_PRELOAD_H
+
+#include "doomtype.hpp"
+#include "w_wad.hpp"
+
+// Decodes the data of a lump on the preload thread. Returns a buffer
+// allocated with malloc(), or nullptr if there is nothing to decode.
+// Must not use the zone memory allocator or call I_Error().
+
+typedef byte *(*preload_decode_t)(const byte *data, int len, int *outlen);
+
+// Queue a lump to be read by the next W_StartPreload(). If decode is
+// not nullptr, it is run on the lump data once it has been read.
+
+void W_PreloadLump(lumpindex_t lump, preload_decode_t decode);
+
+// Start reading the queued lumps on a background thread.
+
+void W_StartPreload(void);
+
+// If the lump has been preloaded, copy its data to dest and return
+// true. Waits for the preload thread to finish first.
+
+boolean W_ReadPreloadedLump(lumpindex_t lump, void *dest);
+
+// Take the result of decoding a preloaded lump. The caller must free()
+// the returned buffer. Returns nullptr if the lump was not decoded.
+
+byte *W_TakeDecodedLump(lumpindex_t lump, int *len);
+
+// Stop the preload thread and free everything it has read.
+
+void W_FinishPreload(void);
+
+#endif /* #ifndef W_PRELOAD_H */
+
@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "doomtype.hpp"
 
@@ -33,7 +35,10 @@
 #include "v_diskicon.hpp"
 #include "z_zone.hpp"
 
+#include "w_lumphash.hpp"
+#include "w_preload.hpp"
 #include "w_wad.hpp"
+#include "w_zip.hpp"
 
 #include "../utils/memory.hpp"
 
@@ -62,9 +67,6 @@ typedef PACKED_STRUCT (
 lumpinfo_t **lumpinfo;
 unsigned int numlumps = 0;
 
-// Hash table for fast lookups
-static lumpindex_t *lumphash;
-
 // Variables for the reload hack: filename of the PWAD to reload, and the
 // lumps from WADs before the reload file, so we can resent numlumps and
 // load the file again.
@@ -73,8 +75,20 @@ static lumpinfo_t *reloadlumps = nullptr;
 static char *reloadname = nullptr;
 static int reloadlump = -1;
 
+// Size and modification time of the reload file when it was last read,
+// and the time at which it was read.
+static off_t reloadsize = -1;
+static time_t reloadmtime;
+static time_t reloadchecked;
+
 static char **wad_filenames;
 
+// Lumps in mapped files that W_PrefetchLumpNum has asked the OS to
+// page in, indexed by lump number.
+
+static byte *prefetched = nullptr;
+static unsigned int numprefetched = 0;
+
 static void AddWADFileName(const char *filename)
 {
     static int i;
@@ -106,6 +120,34 @@ unsigned int W_LumpNameHash(const char *s)
     return result;
 }
 
+// Returns true if the reload file may have changed since it was last
+// read, and remembers its current size and modification time.
+
+static boolean CheckReloadFile(void)
+{
+    struct stat st;
+    boolean changed;
+
+    if (M_stat(reloadname + 1, &st) != 0)
+    {
+        reloadsize = -1;
+        return true;
+    }
+
+    // Modification times only count whole seconds, so a file that was
+    // written in the same second as it was read may have been written
+    // again since.
+
+    changed = st.st_size != reloadsize || st.st_mtime != reloadmtime
+           || st.st_mtime >= reloadchecked;
+
+    reloadsize = st.st_size;
+    reloadmtime = st.st_mtime;
+    reloadchecked = time(nullptr);
+
+    return changed;
+}
+
 //
 // LUMP BASED ROUTINES.
 //
@@ -130,6 +172,7 @@ wad_file_t *W_AddFile (const char *filename)
     filelump_t *filerover;
     lumpinfo_t *filelumps;
     int numfilelumps;
+    boolean reload = false;
 
     // If the filename begins with a ~, it indicates that we should use the
     // reload hack.
@@ -147,11 +190,21 @@ wad_file_t *W_AddFile (const char *filename)
 
         reloadname = strdup(filename);
         reloadlump = numlumps;
+        reload = true;
         ++filename;
     }
 
-    // Open the file and add to directory
-    wad_file = W_OpenFile(filename);
+    // Open the file and add to directory. The reload file is never
+    // mapped: it is expected to be rewritten while we have it open,
+    // which would pull the pages out from under a mapping.
+    if (reload)
+    {
+        wad_file = stdc_wad_file.OpenFile(filename);
+    }
+    else
+    {
+        wad_file = W_OpenFile(filename);
+    }
 
     if (wad_file == nullptr)
     {
@@ -159,7 +212,21 @@ wad_file_t *W_AddFile (const char *filename)
 	return nullptr;
     }
 
-    if (strcasecmp(filename+strlen(filename)-3 , "wad" ) )
+    if (W_IsZipFileName(filename))
+    {
+	// [crispy] zip archive (PK3); its directory comes as lumps already
+	wad_file_t *zip_file = W_OpenZipFile(wad_file, &filelumps, &numfilelumps);
+
+	if (zip_file == nullptr)
+	{
+	    W_CloseFile(wad_file);
+	    I_Error ("Zip file %s is not a valid zip archive", filename);
+	}
+
+	wad_file = zip_file;
+	fileinfo = nullptr;
+    }
+    else if (strcasecmp(filename+strlen(filename)-3 , "wad" ) )
     {
 	// single lump file
 
@@ -216,39 +283,43 @@ wad_file_t *W_AddFile (const char *filename)
 	numfilelumps = header.numlumps;
     }
 
-    // Increase size of numlumps array to accomodate the new file.
-    filelumps = (lumpinfo_t*)calloc(numfilelumps, sizeof(lumpinfo_t));
-    if (filelumps == nullptr)
+    if (fileinfo != nullptr)
     {
-        W_CloseFile(wad_file);
-        I_Error("Failed to allocate array for lumps from new file.");
+        filelumps = (lumpinfo_t*)calloc(numfilelumps, sizeof(lumpinfo_t));
+        if (filelumps == nullptr)
+        {
+            W_CloseFile(wad_file);
+            I_Error("Failed to allocate array for lumps from new file.");
+        }
+
+        filerover = fileinfo;
+
+        for (i = 0; i < numfilelumps; ++i)
+        {
+            lumpinfo_t *lump_p = &filelumps[i];
+            lump_p->wad_file = wad_file;
+            lump_p->position = LONG(filerover->filepos);
+            lump_p->size = LONG(filerover->size);
+            lump_p->cache = nullptr;
+            strncpy(lump_p->name, filerover->name, 8);
+
+            ++filerover;
+        }
+
+        Z_Free(fileinfo);
     }
 
+    // Increase size of numlumps array to accomodate the new file.
     startlump = numlumps;
     numlumps += numfilelumps;
     lumpinfo = (decltype(    lumpinfo)) I_Realloc(lumpinfo, numlumps * sizeof(lumpinfo_t *));
-    filerover = fileinfo;
 
     for (i = startlump; i < numlumps; ++i)
     {
-        lumpinfo_t *lump_p = &filelumps[i - startlump];
-        lump_p->wad_file = wad_file;
-        lump_p->position = LONG(filerover->filepos);
-        lump_p->size = LONG(filerover->size);
-        lump_p->cache = nullptr;
-        strncpy(lump_p->name, filerover->name, 8);
-        lumpinfo[i] = lump_p;
-
-        ++filerover;
+        lumpinfo[i] = &filelumps[i - startlump];
     }
 
-    Z_Free(fileinfo);
-
-    if (lumphash != nullptr)
-    {
-        Z_Free(lumphash);
-        lumphash = nullptr;
-    }
+    W_LumpHashFree();
 
     // If this is the reload file, we need to save some details about the
     // file so that we can close it later on when we do a reload.
@@ -256,6 +327,7 @@ wad_file_t *W_AddFile (const char *filename)
     {
         reloadhandle = wad_file;
         reloadlumps = filelumps;
+        CheckReloadFile();
     }
 
     AddWADFileName(filename);
@@ -286,21 +358,11 @@ lumpindex_t W_CheckNumForName(const char *name)
 
     // Do we have a hash table yet?
 
-    if (lumphash != nullptr)
+    if (W_LumpHashReady())
     {
-        int hash;
-
         // We do! Excellent.
 
-        hash = W_LumpNameHash(name) % numlumps;
-
-        for (i = lumphash[hash]; i != -1; i = lumpinfo[i]->next)
-        {
-            if (!strncasecmp(lumpinfo[i]->name, name, 8))
-            {
-                return i;
-            }
-        }
+        return W_LumpHashLookup(name);
     }
     else
     {
@@ -405,6 +467,17 @@ void W_ReadLump(lumpindex_t lump, void *dest)
 
 
 
+// Returns true if the lump can be used in place in a memory-mapped
+// file. Archives may map only part of the lumps they provide.
+
+static boolean LumpIsMapped(const lumpinfo_t *lump)
+{
+    return lump->wad_file->mapped != nullptr
+        && (unsigned int) lump->position <= lump->wad_file->length
+        && (unsigned int) lump->size
+               <= lump->wad_file->length - lump->position;
+}
+
 //
 // W_CacheLumpNum
 //
@@ -434,7 +507,7 @@ void *W_CacheLumpNum(lumpindex_t lumpnum, int tag)
     // region.  If the lump is in an ordinary file, we may already
     // have it cached; otherwise, load it into memory.
 
-    if (lump->wad_file->mapped != nullptr)
+    if (LumpIsMapped(lump))
     {
         // Memory mapped file, return from the mmapped region.
 
@@ -452,7 +525,12 @@ void *W_CacheLumpNum(lumpindex_t lumpnum, int tag)
         // Not yet loaded, so load it now
 
         lump->cache = zmalloc<decltype(lump->cache)>(W_LumpLength(lumpnum), tag, &lump->cache);
-	    W_ReadLump (lumpnum, lump->cache);
+
+        if (!W_ReadPreloadedLump(lumpnum, lump->cache))
+        {
+            W_ReadLump(lumpnum, lump->cache);
+        }
+
         result = (byte*)lump->cache;
     }
 	
@@ -490,7 +568,7 @@ void W_ReleaseLumpNum(lumpindex_t lumpnum)
 
     lump = lumpinfo[lumpnum];
 
-    if (lump->wad_file->mapped != nullptr)
+    if (LumpIsMapped(lump))
     {
         // Memory-mapped file, so nothing needs to be done here.
     }
@@ -505,6 +583,75 @@ void W_ReleaseLumpName(const char *name)
     W_ReleaseLumpNum(W_GetNumForName(name));
 }
 
+//
+// W_PrefetchLumpNum
+//
+// Get a lump ready to be used soon, as R_PrecacheLevel does for the
+// graphics of a new level. Lumps in a memory-mapped file are not
+// copied; the OS is asked to start paging them in instead, and they
+// are remembered so that W_ReleasePrefetchedLumps can let go of them
+// again. Other lumps are loaded into the cache.
+//
+
+void W_PrefetchLumpNum(lumpindex_t lumpnum)
+{
+    lumpinfo_t *lump;
+
+    if ((unsigned)lumpnum >= numlumps)
+    {
+	I_Error ("W_PrefetchLumpNum: %i >= numlumps", lumpnum);
+    }
+
+    lump = lumpinfo[lumpnum];
+
+    if (!LumpIsMapped(lump))
+    {
+        W_CacheLumpNum(lumpnum, PU_CACHE);
+        return;
+    }
+
+    if (numprefetched < numlumps)
+    {
+        prefetched = (decltype(prefetched)) I_Realloc(prefetched, numlumps);
+        memset(prefetched + numprefetched, 0, numlumps - numprefetched);
+        numprefetched = numlumps;
+    }
+
+    if (!prefetched[lumpnum])
+    {
+        W_Advise(lump->wad_file, lump->position, lump->size,
+                 WAD_ADVICE_WILLNEED);
+        prefetched[lumpnum] = true;
+    }
+}
+
+//
+// W_ReleasePrefetchedLumps
+//
+// Tell the OS that the lumps prefetched for the last level are no
+// longer needed, so that their pages can be dropped from our address
+// space. They stay in the page cache and are cheap to fault in again.
+//
+
+void W_ReleasePrefetchedLumps(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < numprefetched && i < numlumps; ++i)
+    {
+        if (prefetched[i])
+        {
+            W_Advise(lumpinfo[i]->wad_file, lumpinfo[i]->position,
+                     lumpinfo[i]->size, WAD_ADVICE_DONTNEED);
+        }
+    }
+
+    if (numprefetched > 0)
+    {
+        memset(prefetched, 0, numprefetched);
+    }
+}
+
 #if 0
 
 //
@@ -575,38 +722,124 @@ void W_Profile (void)
 
 void W_GenerateHashTable(void)
 {
-    lumpindex_t i;
+    if (numlumps > 0)
+    {
+        W_LumpHashBuild(lumpinfo, numlumps);
+    }
+    else
+    {
+        W_LumpHashFree();
+    }
+}
 
-    // Free the old hash table, if there is one:
-    if (lumphash != nullptr)
+// Returns true if the data of a cached lump of the reload file is the
+// same in the rewritten file.
+
+static boolean ReloadLumpUnchanged(lumpinfo_t *lump, wad_file_t *wad_file,
+                                   int position, int size)
+{
+    byte *data;
+    boolean result;
+
+    if (size != lump->size)
     {
-        Z_Free(lumphash);
+        return false;
     }
 
-    // Generate hash table
-    if (numlumps > 0)
+    data = static_cast<byte *>(malloc(size));
+
+    result = data != nullptr
+          && W_Read(wad_file, position, data, size) == (size_t) size
+          && !memcmp(data, lump->cache, size);
+
+    free(data);
+
+    return result;
+}
+
+// Read the directory of the rewritten reload file. If it has the same
+// lumps in the same order as before, move the existing directory
+// entries over to the new file, dropping only the cached lumps whose
+// data has changed, and return true. Lump numbers and names stay the
+// same, so the lookup table is still good.
+
+static boolean ReloadInPlace(void)
+{
+    const char *filename = reloadname + 1;
+    wadinfo_t header;
+    filelump_t *fileinfo;
+    wad_file_t *wad_file;
+    lumpinfo_t *lump;
+    int numfilelumps, length, position, size;
+    int i;
+
+    // PK3 files and single lump files are always read again.
+
+    if (W_IsZipFileName(filename)
+     || strcasecmp(filename + strlen(filename) - 3, "wad"))
     {
-        lumphash = zmalloc<decltype(        lumphash)>(sizeof(lumpindex_t) * numlumps, PU_STATIC, nullptr);
+        return false;
+    }
 
-        for (i = 0; i < numlumps; ++i)
-        {
-            lumphash[i] = -1;
-        }
+    wad_file = stdc_wad_file.OpenFile(filename);
 
-        for (i = 0; i < numlumps; ++i)
-        {
-            unsigned int hash;
+    if (wad_file == nullptr)
+    {
+        return false;
+    }
+
+    numfilelumps = numlumps - reloadlump;
+
+    if (W_Read(wad_file, 0, &header, sizeof(header)) < sizeof(header)
+     || LONG(header.numlumps) != numfilelumps)
+    {
+        W_CloseFile(wad_file);
+        return false;
+    }
+
+    length = numfilelumps * sizeof(filelump_t);
+    fileinfo = zmalloc<decltype(fileinfo)>(length, PU_STATIC, 0);
+
+    if (W_Read(wad_file, LONG(header.infotableofs), fileinfo, length)
+            < (size_t) length)
+    {
+        Z_Free(fileinfo);
+        W_CloseFile(wad_file);
+        return false;
+    }
 
-            hash = W_LumpNameHash(lumpinfo[i]->name) % numlumps;
+    for (i = 0; i < numfilelumps; ++i)
+    {
+        if (strncmp(reloadlumps[i].name, fileinfo[i].name, 8))
+        {
+            Z_Free(fileinfo);
+            W_CloseFile(wad_file);
+            return false;
+        }
+    }
 
-            // Hook into the hash table
+    for (i = 0; i < numfilelumps; ++i)
+    {
+        lump = &reloadlumps[i];
+        position = LONG(fileinfo[i].filepos);
+        size = LONG(fileinfo[i].size);
 
-            lumpinfo[i]->next = lumphash[hash];
-            lumphash[hash] = i;
+        if (lump->cache != nullptr
+         && !ReloadLumpUnchanged(lump, wad_file, position, size))
+        {
+            Z_Free(lump->cache);
         }
+
+        lump->wad_file = wad_file;
+        lump->position = position;
+        lump->size = size;
     }
 
-    // All done!
+    Z_Free(fileinfo);
+    W_CloseFile(reloadhandle);
+    reloadhandle = wad_file;
+
+    return true;
 }
 
 // The Doom reload hack. The idea here is that if you give a WAD file to -file
@@ -625,6 +858,23 @@ void W_Reload(void)
         return;
     }
 
+    // Nothing to do if the file hasn't been written since it was read.
+    // Lumps already read ahead from it are still good, too.
+    if (!CheckReloadFile())
+    {
+        return;
+    }
+
+    // Lumps read ahead from the PWAD we're about to reload are stale:
+    W_FinishPreload();
+
+    // If only the contents of lumps have changed, just drop those lumps
+    // from the cache:
+    if (ReloadInPlace())
+    {
+        return;
+    }
+
     // We must free any lumps being cached from the PWAD we're about to reload:
     for (i = reloadlump; i < numlumps; ++i)
     {
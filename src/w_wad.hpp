@@ -45,9 +45,6 @@ struct lumpinfo_s
     int		position;
     int		size;
     void       *cache;
-
-    // Used for hash table lookups
-    lumpindex_t next;
 };
 
 
@@ -91,6 +88,9 @@ extern unsigned int W_LumpNameHash(const char *s);
 void W_ReleaseLumpNum(lumpindex_t lump);
 void W_ReleaseLumpName(const char *name);
 
+void W_PrefetchLumpNum(lumpindex_t lump);
+void W_ReleasePrefetchedLumps(void);
+
 const char *W_WadNameForLump(const lumpinfo_t *lump);
 boolean W_IsIWADLump(const lumpinfo_t *lump);
 
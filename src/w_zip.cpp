@@ -0,0 +1,978 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Zip (PK3) archive support.
+//
+//     The files in an archive become lumps named after the base of
+//     their file name. Files in the flats/ and sprites/ directories
+//     are put between FF_START/FF_END and SS_START/SS_END markers so
+//     that they get merged like those of a PWAD, and WAD files in
+//     maps/ have their lumps added, with the first one renamed after
+//     the file.
+//
+//     Stored files are addressed by their offset in the archive, so
+//     that they are read from it directly, or with no copy at all if
+//     the archive is mapped. Compressed files are given positions past
+//     the end of the archive and are inflated when read. The inflated
+//     data is kept in a cache shared by all archives, bounded in size
+//     and discarding the least recently used file first.
+//
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "config.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "doomtype.hpp"
+#include "i_system.hpp"
+#include "m_argv.hpp"
+#include "m_misc.hpp"
+#include "w_zip.hpp"
+#include "z_zone.hpp"
+
+#include "../utils/memory.hpp"
+
+#define ZIP_EOCD_SIG        0x06054b50
+#define ZIP_CENTRAL_SIG     0x02014b50
+#define ZIP_LOCAL_SIG       0x04034b50
+
+#define ZIP_EOCD_SIZE       22
+#define ZIP_CENTRAL_SIZE    46
+#define ZIP_LOCAL_SIZE      30
+#define ZIP_MAX_COMMENT     0xffff
+
+#define ZIP_FLAG_ENCRYPTED  0x0001
+
+#define ZIP_METHOD_STORED   0
+#define ZIP_METHOD_DEFLATED 8
+
+// Default total size of inflated data kept around for reuse, in MiB.
+// Enough for the textures, flats and sprites of a typical map of a
+// large mod; music and sounds beyond an eighth of it bypass the cache.
+
+#define ZIP_CACHE_SIZE      16
+
+// Size of the reads from an archive that is not mapped while inflating.
+
+#define ZIP_INFLATE_CHUNK   0x10000
+
+typedef enum
+{
+    NS_GLOBAL,
+    NS_FLATS,
+    NS_SPRITES,
+    NS_MAPS,
+    NS_SKIP,
+} zip_namespace_t;
+
+// Top level directories of an archive and what is done with their files.
+// Files in any other directory are ignored.
+
+static const struct
+{
+    const char *dir;
+    zip_namespace_t ns;
+} namespaces[] = {
+    { "flats",     NS_FLATS },
+    { "sprites",   NS_SPRITES },
+    { "maps",      NS_MAPS },
+    { "acs",       NS_GLOBAL },
+    { "colormaps", NS_GLOBAL },
+    { "graphics",  NS_GLOBAL },
+    { "music",     NS_GLOBAL },
+    { "patches",   NS_GLOBAL },
+    { "sounds",    NS_GLOBAL },
+    { "textures",  NS_GLOBAL },
+    { "voices",    NS_GLOBAL },
+};
+
+typedef struct zip_entry_s zip_entry_t;
+
+struct zip_entry_s
+{
+    const char *path;           // Only valid while the archive is opened.
+    zip_namespace_t ns;
+    char name[8];
+
+    int method;
+    unsigned int local_offset;
+    unsigned int data_offset;
+    unsigned int compressed_size;
+    unsigned int size;
+
+    // Position of the lump: data_offset if stored, otherwise a
+    // position past the end of the archive.
+    unsigned int position;
+
+    // Inflated data, if in the cache, and the links of the cache's list.
+    byte *data;
+    zip_entry_t *prev, *next;
+};
+
+typedef struct
+{
+    wad_file_t wad;
+
+    // The archive itself.
+    wad_file_t *archive;
+
+    // Compressed files, in order of position.
+    zip_entry_t *entries;
+    int num_entries;
+} zip_wad_file_t;
+
+extern wad_file_class_t zip_wad_file;
+
+// Cached entries, most recently used first.
+
+static zip_entry_t *cache_head = nullptr;
+static zip_entry_t *cache_tail = nullptr;
+static size_t cache_used = 0;
+static size_t cache_size = 0;
+
+static unsigned int ReadShort(const byte *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int ReadLong(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+boolean W_IsZipFileName(const char *filename)
+{
+    size_t len = strlen(filename);
+
+    return len > 4 && (!strcasecmp(filename + len - 4, ".pk3")
+                    || !strcasecmp(filename + len - 4, ".zip"));
+}
+
+//
+// Inflated data cache.
+//
+
+static void CacheUnlink(zip_entry_t *entry)
+{
+    if (entry->prev != nullptr)
+        entry->prev->next = entry->next;
+    else
+        cache_head = entry->next;
+
+    if (entry->next != nullptr)
+        entry->next->prev = entry->prev;
+    else
+        cache_tail = entry->prev;
+
+    entry->prev = entry->next = nullptr;
+}
+
+static void CacheLink(zip_entry_t *entry)
+{
+    entry->prev = nullptr;
+    entry->next = cache_head;
+
+    if (cache_head != nullptr)
+        cache_head->prev = entry;
+    else
+        cache_tail = entry;
+
+    cache_head = entry;
+}
+
+static void CacheDiscard(zip_entry_t *entry)
+{
+    CacheUnlink(entry);
+    cache_used -= entry->size;
+    free(entry->data);
+    entry->data = nullptr;
+}
+
+// Make room for size more bytes. A single entry larger than the whole
+// cache is still allowed in, alone.
+
+static void CacheEvict(size_t size)
+{
+    while (cache_tail != nullptr && cache_used + size > cache_size)
+    {
+        CacheDiscard(cache_tail);
+    }
+}
+
+//
+// Inflate a compressed entry into dest, which has room for all of it.
+//
+
+static boolean InflateEntry(zip_wad_file_t *zip, zip_entry_t *entry,
+                            byte *dest)
+{
+#ifdef HAVE_LIBZ
+    z_stream stream;
+    byte *inbuf = nullptr;
+    unsigned int offset, remaining, chunk;
+    int result;
+
+    memset(&stream, 0, sizeof(stream));
+
+    // Zip files contain raw deflate data, without a zlib header.
+
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+
+    stream.next_out = dest;
+    stream.avail_out = entry->size;
+
+    offset = entry->data_offset;
+    remaining = entry->compressed_size;
+    result = Z_OK;
+
+    while (result == Z_OK)
+    {
+        if (stream.avail_in == 0 && remaining > 0)
+        {
+            if (zip->archive->mapped != nullptr)
+            {
+                // Inflate straight from the mapping.
+
+                stream.next_in = zip->archive->mapped + offset;
+                chunk = remaining;
+            }
+            else
+            {
+                if (inbuf == nullptr)
+                {
+                    inbuf = static_cast<byte *>(malloc(ZIP_INFLATE_CHUNK));
+                }
+
+                chunk = remaining < ZIP_INFLATE_CHUNK ? remaining
+                                                      : ZIP_INFLATE_CHUNK;
+
+                if (inbuf == nullptr
+                 || W_Read(zip->archive, offset, inbuf, chunk) != chunk)
+                {
+                    break;
+                }
+
+                stream.next_in = inbuf;
+            }
+
+            stream.avail_in = chunk;
+            offset += chunk;
+            remaining -= chunk;
+        }
+
+        result = inflate(&stream, Z_NO_FLUSH);
+    }
+
+    inflateEnd(&stream);
+    free(inbuf);
+
+    return result == Z_STREAM_END && stream.total_out == entry->size;
+#else
+    return false;
+#endif
+}
+
+//
+// wad_file_class_t interface.
+//
+
+static zip_entry_t *FindEntry(zip_wad_file_t *zip, unsigned int offset)
+{
+    int lo = 0, hi = zip->num_entries - 1;
+
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        zip_entry_t *entry = &zip->entries[mid];
+
+        if (offset < entry->position)
+        {
+            hi = mid - 1;
+        }
+        else if (offset - entry->position >= entry->size)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+static void W_Zip_CloseFile(wad_file_t *wad)
+{
+    zip_wad_file_t *zip;
+    int i;
+
+    zip = (zip_wad_file_t *) wad;
+
+    for (i = 0; i < zip->num_entries; ++i)
+    {
+        if (zip->entries[i].data != nullptr)
+        {
+            CacheDiscard(&zip->entries[i]);
+        }
+    }
+
+    W_CloseFile(zip->archive);
+    free(zip->entries);
+    free(zip->wad.path);
+    Z_Free(zip);
+}
+
+static size_t W_Zip_Read(wad_file_t *wad, unsigned int offset,
+                         void *buffer, size_t buffer_len)
+{
+    zip_wad_file_t *zip;
+    zip_entry_t *entry;
+    unsigned int delta;
+
+    zip = (zip_wad_file_t *) wad;
+
+    // Stored files and the archive's own structures.
+
+    if (offset < wad->length)
+    {
+        return W_Read(zip->archive, offset, buffer, buffer_len);
+    }
+
+    entry = FindEntry(zip, offset);
+
+    if (entry == nullptr)
+    {
+        return 0;
+    }
+
+    delta = offset - entry->position;
+
+    if (buffer_len > entry->size - delta)
+    {
+        buffer_len = entry->size - delta;
+    }
+
+    if (entry->data == nullptr)
+    {
+        // A whole file that is too big to be worth keeping around is
+        // inflated straight into the caller's buffer.
+
+        if (delta == 0 && buffer_len == entry->size
+         && entry->size > cache_size / 8)
+        {
+            return InflateEntry(zip, entry, static_cast<byte *>(buffer))
+                 ? buffer_len : 0;
+        }
+
+        CacheEvict(entry->size);
+
+        entry->data = static_cast<byte *>(malloc(entry->size));
+
+        if (entry->data == nullptr || !InflateEntry(zip, entry, entry->data))
+        {
+            fprintf(stderr, "W_Zip_Read: Failed to inflate %.8s in %s\n",
+                            entry->name, wad->path);
+            free(entry->data);
+            entry->data = nullptr;
+            return 0;
+        }
+
+        cache_used += entry->size;
+    }
+    else
+    {
+        CacheUnlink(entry);
+    }
+
+    CacheLink(entry);
+    memcpy(buffer, entry->data + delta, buffer_len);
+
+    return buffer_len;
+}
+
+static void W_Zip_Advise(wad_file_t *wad, unsigned int offset, size_t len,
+                         wad_advice_t advice)
+{
+    zip_wad_file_t *zip;
+
+    zip = (zip_wad_file_t *) wad;
+
+    if (offset < wad->length)
+    {
+        W_Advise(zip->archive, offset, len, advice);
+    }
+}
+
+wad_file_class_t zip_wad_file =
+{
+    nullptr,                    // Opened through W_OpenZipFile.
+    W_Zip_CloseFile,
+    W_Zip_Read,
+    W_Zip_Advise,
+};
+
+//
+// Reading the directory.
+//
+
+// Work out what to do with the file at the given path and what to call
+// its lump. Returns false if it is skipped.
+
+static boolean ClassifyEntry(zip_entry_t *entry)
+{
+    const char *path = entry->path;
+    const char *base, *slash;
+    size_t dirlen;
+    int i, length;
+
+    slash = strchr(path, '/');
+
+    if (slash == nullptr)
+    {
+        entry->ns = NS_GLOBAL;
+    }
+    else
+    {
+        dirlen = slash - path;
+        entry->ns = NS_SKIP;
+
+        for (i = 0; i < (int) arrlen(namespaces); ++i)
+        {
+            if (strlen(namespaces[i].dir) == dirlen
+             && !strncasecmp(path, namespaces[i].dir, dirlen))
+            {
+                entry->ns = namespaces[i].ns;
+                break;
+            }
+        }
+
+        if (entry->ns == NS_SKIP)
+        {
+            return false;
+        }
+    }
+
+    base = strrchr(path, '/');
+    base = base != nullptr ? base + 1 : path;
+
+    if (entry->ns == NS_MAPS && !M_StringEndsWith(base, ".wad")
+                             && !M_StringEndsWith(base, ".WAD"))
+    {
+        return false;
+    }
+
+    memset(entry->name, 0, sizeof(entry->name));
+
+    for (length = 0; base[length] != '\0' && base[length] != '.'; ++length)
+    {
+        if (length >= 8)
+        {
+            printf(" skipping %s: name is too long for a lump\n", path);
+            return false;
+        }
+
+        // '\' can't be used in file names, so sprites use '^' for it.
+
+        entry->name[length] = base[length] == '^' ? '\\'
+                                                  : toupper(base[length]);
+    }
+
+    return length > 0;
+}
+
+static int CompareEntries(const void *a, const void *b)
+{
+    const zip_entry_t *ea = static_cast<const zip_entry_t *>(a);
+    const zip_entry_t *eb = static_cast<const zip_entry_t *>(b);
+
+    if (ea->ns != eb->ns)
+    {
+        return ea->ns - eb->ns;
+    }
+
+    return strcasecmp(ea->path, eb->path);
+}
+
+// Find the end of central directory record and read the position and
+// size of the central directory from it.
+
+static boolean ReadEndRecord(wad_file_t *archive, unsigned int *count,
+                             unsigned int *cd_offset, unsigned int *cd_size)
+{
+    byte *buf, *p;
+    unsigned int len;
+    boolean found = false;
+
+    if (archive->length < ZIP_EOCD_SIZE)
+    {
+        return false;
+    }
+
+    len = archive->length < ZIP_EOCD_SIZE + ZIP_MAX_COMMENT
+        ? archive->length : ZIP_EOCD_SIZE + ZIP_MAX_COMMENT;
+    buf = static_cast<byte *>(malloc(len));
+
+    if (buf == nullptr)
+    {
+        return false;
+    }
+
+    if (W_Read(archive, archive->length - len, buf, len) == len)
+    {
+        // The record is followed by a comment of up to 64k, so search
+        // backwards from the end for its signature.
+
+        for (p = buf + len - ZIP_EOCD_SIZE; p >= buf; --p)
+        {
+            if (ReadLong(p) == ZIP_EOCD_SIG)
+            {
+                *count = ReadShort(p + 10);
+                *cd_size = ReadLong(p + 12);
+                *cd_offset = ReadLong(p + 16);
+                found = true;
+                break;
+            }
+        }
+    }
+
+    free(buf);
+
+    return found;
+}
+
+// Read the central directory. Returns the entries that are used, or
+// nullptr if the directory is broken.
+
+static zip_entry_t *ReadCentralDirectory(wad_file_t *archive, byte **cd_buf,
+                                         int *num_entries)
+{
+    zip_entry_t *entries;
+    unsigned int count, cd_offset, cd_size, i;
+    unsigned int namelen, extralen, commentlen, flags;
+    byte *p, *end;
+    char *names;
+    int n;
+
+    if (!ReadEndRecord(archive, &count, &cd_offset, &cd_size))
+    {
+        return nullptr;
+    }
+
+    if (count == 0xffff || cd_offset == 0xffffffff)
+    {
+        printf(" zip64 archives are not supported\n");
+        return nullptr;
+    }
+
+    if (cd_offset > archive->length || cd_size > archive->length - cd_offset)
+    {
+        return nullptr;
+    }
+
+    // The paths are copied out of the directory, terminated, to the
+    // end of the same buffer; they can't be longer than the directory.
+
+    *cd_buf = static_cast<byte *>(malloc(cd_size * 2 + count + 1));
+    entries = static_cast<zip_entry_t *>(calloc(count + 1, sizeof(zip_entry_t)));
+
+    if (*cd_buf == nullptr || entries == nullptr)
+    {
+        free(entries);
+        return nullptr;
+    }
+
+    if (W_Read(archive, cd_offset, *cd_buf, cd_size) != cd_size)
+    {
+        free(entries);
+        return nullptr;
+    }
+
+    p = *cd_buf;
+    end = *cd_buf + cd_size;
+    names = (char *) end;
+    n = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        zip_entry_t *entry = &entries[n];
+
+        if (end - p < ZIP_CENTRAL_SIZE || ReadLong(p) != ZIP_CENTRAL_SIG)
+        {
+            free(entries);
+            return nullptr;
+        }
+
+        flags = ReadShort(p + 8);
+        entry->method = ReadShort(p + 10);
+        entry->compressed_size = ReadLong(p + 20);
+        entry->size = ReadLong(p + 24);
+        namelen = ReadShort(p + 28);
+        extralen = ReadShort(p + 30);
+        commentlen = ReadShort(p + 32);
+        entry->local_offset = ReadLong(p + 42);
+
+        if ((unsigned int) (end - p) < ZIP_CENTRAL_SIZE + namelen
+                                     + extralen + commentlen)
+        {
+            free(entries);
+            return nullptr;
+        }
+
+        memcpy(names, p + ZIP_CENTRAL_SIZE, namelen);
+        names[namelen] = '\0';
+        entry->path = names;
+        names += namelen + 1;
+        p += ZIP_CENTRAL_SIZE + namelen + extralen + commentlen;
+
+        // Directories, encrypted files and unknown compression methods.
+
+        if (namelen == 0 || entry->path[namelen - 1] == '/'
+         || (flags & ZIP_FLAG_ENCRYPTED) != 0)
+        {
+            continue;
+        }
+
+        if (entry->method != ZIP_METHOD_STORED
+         && entry->method != ZIP_METHOD_DEFLATED)
+        {
+            printf(" skipping %s: unsupported compression method %d\n",
+                   entry->path, entry->method);
+            continue;
+        }
+
+#ifndef HAVE_LIBZ
+        if (entry->method == ZIP_METHOD_DEFLATED)
+        {
+            printf(" skipping %s: compressed, but built without zlib\n",
+                   entry->path);
+            continue;
+        }
+#endif
+
+        if (ClassifyEntry(entry))
+        {
+            ++n;
+        }
+    }
+
+    *num_entries = n;
+
+    return entries;
+}
+
+// Find where the data of an entry starts, from its local header.
+
+static boolean FindEntryData(wad_file_t *archive, zip_entry_t *entry)
+{
+    byte header[ZIP_LOCAL_SIZE];
+    unsigned int data_offset, length;
+
+    if (W_Read(archive, entry->local_offset, header, sizeof(header))
+            != sizeof(header)
+     || ReadLong(header) != ZIP_LOCAL_SIG)
+    {
+        return false;
+    }
+
+    data_offset = entry->local_offset + ZIP_LOCAL_SIZE
+                + ReadShort(header + 26) + ReadShort(header + 28);
+    length = entry->method == ZIP_METHOD_STORED ? entry->size
+                                                : entry->compressed_size;
+
+    if (data_offset > archive->length || length > archive->length - data_offset)
+    {
+        return false;
+    }
+
+    entry->data_offset = data_offset;
+
+    return true;
+}
+
+static lumpinfo_t *AddLump(lumpinfo_t **lumps, int *numlumps, int *maxlumps,
+                           wad_file_t *wad, const char *name,
+                           unsigned int position, unsigned int size)
+{
+    lumpinfo_t *lump;
+
+    if (*numlumps == *maxlumps)
+    {
+        *maxlumps = *maxlumps * 2 + 16;
+        *lumps = static_cast<lumpinfo_t *>(
+            I_Realloc(*lumps, *maxlumps * sizeof(lumpinfo_t)));
+    }
+
+    lump = &(*lumps)[(*numlumps)++];
+    memset(lump, 0, sizeof(*lump));
+    memcpy(lump->name, name, strnlen(name, 8));
+    lump->wad_file = wad;
+    lump->position = position;
+    lump->size = size;
+
+    return lump;
+}
+
+// Add the lumps of a WAD file in the maps/ directory.
+
+static void AddMapWad(zip_wad_file_t *zip, zip_entry_t *entry,
+                      lumpinfo_t **lumps, int *numlumps, int *maxlumps)
+{
+    byte header[12];
+    byte *dir;
+    unsigned int count, dir_offset, filepos, size, i;
+    int first;
+
+    if (entry->size < sizeof(header)
+     || W_Read(&zip->wad, entry->position, header, sizeof(header))
+            != sizeof(header)
+     || (memcmp(header, "PWAD", 4) && memcmp(header, "IWAD", 4)))
+    {
+        printf(" skipping %s: not a WAD file\n", entry->path);
+        return;
+    }
+
+    count = ReadLong(header + 4);
+    dir_offset = ReadLong(header + 8);
+
+    if (dir_offset > entry->size || count > (entry->size - dir_offset) / 16)
+    {
+        printf(" skipping %s: bad WAD directory\n", entry->path);
+        return;
+    }
+
+    dir = static_cast<byte *>(malloc(count * 16 + 1));
+
+    if (dir == nullptr
+     || W_Read(&zip->wad, entry->position + dir_offset, dir, count * 16)
+            != count * 16)
+    {
+        free(dir);
+        return;
+    }
+
+    first = *numlumps;
+
+    for (i = 0; i < count; ++i)
+    {
+        filepos = ReadLong(dir + i * 16);
+        size = ReadLong(dir + i * 16 + 4);
+
+        if (filepos > entry->size || size > entry->size - filepos)
+        {
+            filepos = size = 0;
+        }
+
+        AddLump(lumps, numlumps, maxlumps, &zip->wad,
+                (const char *) dir + i * 16 + 8,
+                entry->position + filepos, size);
+    }
+
+    // The map is named after the file, not its header lump.
+
+    if (*numlumps > first)
+    {
+        memcpy((*lumps)[first].name, entry->name, 8);
+    }
+
+    free(dir);
+}
+
+static void AddNamespace(zip_wad_file_t *zip, zip_entry_t *entries,
+                         int num_entries, zip_namespace_t ns,
+                         const char *start, const char *end,
+                         lumpinfo_t **lumps, int *numlumps, int *maxlumps)
+{
+    boolean found = false;
+    int i;
+
+    for (i = 0; i < num_entries; ++i)
+    {
+        if (entries[i].ns != ns)
+        {
+            continue;
+        }
+
+        if (!found && start != nullptr)
+        {
+            AddLump(lumps, numlumps, maxlumps, &zip->wad, start, 0, 0);
+        }
+
+        found = true;
+
+        if (ns == NS_MAPS)
+        {
+            AddMapWad(zip, &entries[i], lumps, numlumps, maxlumps);
+        }
+        else
+        {
+            AddLump(lumps, numlumps, maxlumps, &zip->wad, entries[i].name,
+                    entries[i].position, entries[i].size);
+        }
+    }
+
+    if (found && end != nullptr)
+    {
+        AddLump(lumps, numlumps, maxlumps, &zip->wad, end, 0, 0);
+    }
+}
+
+wad_file_t *W_OpenZipFile(wad_file_t *archive, lumpinfo_t **lumps,
+                          int *numlumps)
+{
+    zip_wad_file_t *zip;
+    zip_entry_t *entries;
+    byte *cd_buf = nullptr;
+    unsigned int position;
+    int num_entries, num_compressed, maxlumps;
+    int i, j;
+
+    if (cache_size == 0)
+    {
+        int mb = ZIP_CACHE_SIZE;
+
+        //!
+        // @arg <mb>
+        // @category mod
+        //
+        // Keep up to <mb> MiB of data inflated from compressed files of
+        // .pk3 and .zip archives for reuse (default 16).
+        //
+
+        i = M_CheckParmWithArgs("-zipcache", 1);
+
+        if (i > 0)
+        {
+            mb = atoi(myargv[i + 1]);
+
+            if (mb < 1)
+            {
+                mb = 1;
+            }
+        }
+
+        cache_size = (size_t) mb * 1024 * 1024;
+    }
+
+    entries = ReadCentralDirectory(archive, &cd_buf, &num_entries);
+
+    if (entries == nullptr)
+    {
+        free(cd_buf);
+        return nullptr;
+    }
+
+    qsort(entries, num_entries, sizeof(zip_entry_t), CompareEntries);
+
+    // Compressed files are placed one after another past the end of
+    // the archive. Lump positions are signed, which limits the space.
+
+    position = archive->length;
+    num_compressed = 0;
+
+    for (i = 0, j = 0; i < num_entries; ++i)
+    {
+        zip_entry_t *entry = &entries[i];
+
+        if (!FindEntryData(archive, entry))
+        {
+            printf(" skipping %s: bad local header\n", entry->path);
+            continue;
+        }
+
+        if (entry->method == ZIP_METHOD_STORED)
+        {
+            entry->position = entry->data_offset;
+        }
+        else if (entry->size > (unsigned int) INT_MAX - position)
+        {
+            printf(" skipping %s: archive too large\n", entry->path);
+            continue;
+        }
+        else
+        {
+            entry->position = position;
+            position += entry->size;
+            ++num_compressed;
+        }
+
+        entries[j++] = *entry;
+    }
+
+    num_entries = j;
+
+    zip = zmalloc<decltype(zip)>(sizeof(zip_wad_file_t), PU_STATIC, 0);
+    zip->wad.file_class = &zip_wad_file;
+    zip->wad.mapped = archive->mapped;
+    zip->wad.length = archive->length;
+    zip->wad.path = M_StringDuplicate(archive->path);
+    zip->archive = archive;
+
+    // Compressed entries were given positions in sorted order, so
+    // copying them out keeps them ordered for FindEntry.
+
+    zip->entries = static_cast<zip_entry_t *>(
+        I_Realloc(nullptr, (num_compressed + 1) * sizeof(zip_entry_t)));
+    zip->num_entries = 0;
+
+    for (i = 0; i < num_entries; ++i)
+    {
+        if (entries[i].method != ZIP_METHOD_STORED)
+        {
+            zip->entries[zip->num_entries++] = entries[i];
+        }
+    }
+
+    *lumps = nullptr;
+    *numlumps = 0;
+    maxlumps = 0;
+
+    AddNamespace(zip, entries, num_entries, NS_GLOBAL, nullptr, nullptr,
+                 lumps, numlumps, &maxlumps);
+    AddNamespace(zip, entries, num_entries, NS_FLATS, "FF_START", "FF_END",
+                 lumps, numlumps, &maxlumps);
+    AddNamespace(zip, entries, num_entries, NS_SPRITES, "SS_START", "SS_END",
+                 lumps, numlumps, &maxlumps);
+    AddNamespace(zip, entries, num_entries, NS_MAPS, nullptr, nullptr,
+                 lumps, numlumps, &maxlumps);
+
+    // The paths were only needed for messages.
+
+    for (i = 0; i < zip->num_entries; ++i)
+    {
+        zip->entries[i].path = nullptr;
+    }
+
+    free(entries);
+    free(cd_buf);
+
+    if (*lumps == nullptr)
+    {
+        *lumps = static_cast<lumpinfo_t *>(
+            I_Realloc(nullptr, sizeof(lumpinfo_t)));
+    }
+
+    return &zip->wad;
+}
+
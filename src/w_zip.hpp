@@ -0,0 +1,39 @@
+//
+// Copyright(C) 2026 Crispy Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Zip (PK3) archive support.
+//
+
+#ifndef W_ZIP_H
+#define W_ZIP_H
+
+#include "doomtype.hpp"
+#include "w_file.hpp"
+#include "w_wad.hpp"
+
+// Returns true if the filename has the extension of a zip archive
+// (.zip or .pk3).
+
+boolean W_IsZipFileName(const char *filename);
+
+// Read the central directory of the zip archive that is open as
+// archive. The returned handle takes over the archive and must be used
+// in its place. The lumps found are returned in a calloc'd array.
+// Returns nullptr if the file is not a zip archive we can read.
+
+wad_file_t *W_OpenZipFile(wad_file_t *archive, lumpinfo_t **lumps,
+                          int *numlumps);
+
+#endif /* #ifndef W_ZIP_H */
+
@@ -0,0 +1,110 @@
+#ifndef CRISPY_DOOM_CPP_UTILS_SPSC_QUEUE_HPP
+#define CRISPY_DOOM_CPP_UTILS_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef> // size_t
+#include <type_traits>
+
+// Bounded lock-free queue for exactly one producer thread and one
+// consumer thread. N must be a power of two; one slot is never used so
+// that a full queue can be told apart from an empty one.
+
+template <typename T, std::size_t N>
+class spsc_queue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "T must be trivially copyable");
+
+public:
+    spsc_queue() : head(0), tail(0) {}
+
+    spsc_queue(const spsc_queue &) = delete;
+    spsc_queue &operator=(const spsc_queue &) = delete;
+
+    // Producer: reserve the next slot, fill it in place, then commit it.
+    // Returns nullptr if the queue is full.
+    T *begin_push()
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+
+        if (((t + 1) & (N - 1)) == head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        return &items[t];
+    }
+
+    void end_push()
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+
+        tail.store((t + 1) & (N - 1), std::memory_order_release);
+    }
+
+    bool push(const T &item)
+    {
+        T *slot = begin_push();
+
+        if (slot == nullptr)
+        {
+            return false;
+        }
+
+        *slot = item;
+        end_push();
+
+        return true;
+    }
+
+    // Consumer: look at the oldest item without removing it, then
+    // release it. Returns nullptr if the queue is empty.
+    T *front()
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        return &items[h];
+    }
+
+    void pop_front()
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+
+        head.store((h + 1) & (N - 1), std::memory_order_release);
+    }
+
+    bool pop(T &item)
+    {
+        T *slot = front();
+
+        if (slot == nullptr)
+        {
+            return false;
+        }
+
+        item = *slot;
+        pop_front();
+
+        return true;
+    }
+
+    // Only meaningful when neither thread is running.
+    void clear()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    T items[N];
+    alignas(64) std::atomic<std::size_t> head;
+    alignas(64) std::atomic<std::size_t> tail;
+};
+
+#endif // CRISPY_DOOM_CPP_UTILS_SPSC_QUEUE_HPP